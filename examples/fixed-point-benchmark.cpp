@@ -0,0 +1,71 @@
+//
+// Created by Otto Winter on 17.10.26.
+//
+
+// Prints the CPU cycles per value of the averaging filters with float and with Fixed16 (USE_FIXED_POINT_FILTERS)
+// numbers, to decide whether the fixed point filters are worth it on a chip. See also
+// host/benchmarks/bench_fixed_point.cpp. Run with `pio run -e fixed-point-benchmark -t upload -t monitor`.
+
+#include <Arduino.h>
+#include <esphomelib/fixed_point.h>
+#include <esphomelib/helpers.h>
+
+using namespace esphomelib;
+
+static const size_t VALUES = 256;
+static const size_t WINDOW_SIZE = 15;
+static const float ALPHA = 0.1f;
+
+float values[VALUES];
+volatile float sink;
+
+/// The cycles per value of f, which processes all values. The best of 5 runs so that interrupts don't count.
+template<typename F>
+uint32_t cycles_per_value(F &&f) {
+  uint32_t best = UINT32_MAX;
+  for (int run = 0; run < 5; run++) {
+    const uint32_t start = ESP.getCycleCount();
+    f();
+    const uint32_t cycles = ESP.getCycleCount() - start;
+    if (cycles < best)
+      best = cycles;
+  }
+  return best / VALUES;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  for (size_t i = 0; i < VALUES; i++)
+    values[i] = 20.0f + 5.0f * sinf(i * 0.01f) + random(-500, 500) / 1000.0f;
+
+  SlidingWindowMovingAverage<float> window(WINDOW_SIZE);
+  const uint32_t window_float = cycles_per_value([&window]() {
+    for (float value : values)
+      sink = window.next_value(value);
+  });
+  SlidingWindowMovingAverage<int32_t, int64_t> fixed_window(WINDOW_SIZE);
+  const uint32_t window_fixed = cycles_per_value([&fixed_window]() {
+    for (float value : values)
+      sink = Fixed16::from_raw(fixed_window.next_value(Fixed16::from_float(value).raw())).to_float();
+  });
+  ExponentialMovingAverage ema(ALPHA);
+  const uint32_t ema_float = cycles_per_value([&ema]() {
+    for (float value : values)
+      sink = ema.next_value(value);
+  });
+  FixedExponentialMovingAverage fixed_ema(ALPHA);
+  const uint32_t ema_fixed = cycles_per_value([&fixed_ema]() {
+    for (float value : values)
+      sink = fixed_ema.next_value(Fixed16::from_float(value)).to_float();
+  });
+
+  Serial.printf("CPU cycles per value at %u MHz\n\n", ESP.getCpuFreqMHz());
+  Serial.printf("%-32s %8s %8s\n", "", "float", "Fixed16");
+  Serial.printf("%-32s %8u %8u\n", "sliding window (15 values)", unsigned(window_float), unsigned(window_fixed));
+  Serial.printf("%-32s %8u %8u\n", "exponential moving average", unsigned(ema_float), unsigned(ema_fixed));
+}
+
+void loop() {
+  delay(1000);
+}
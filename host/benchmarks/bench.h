@@ -0,0 +1,45 @@
+#ifndef ESPHOMELIB_HOST_BENCHMARKS_BENCH_H
+#define ESPHOMELIB_HOST_BENCHMARKS_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+
+/** Helpers for the host benchmarks.
+ *
+ * Each benchmark is a program with its own main() that prints a table of its results, see host/CMakeLists.txt.
+ * They aren't run by ctest, build them with -DCMAKE_BUILD_TYPE=Release for meaningful numbers. Times are
+ * measured with the real monotonic clock, also when the benchmark runs esphomelib on the virtual clock.
+ */
+
+/// Make the compiler assume value is used, so that the computation of it isn't optimized away.
+template<typename T>
+inline void bench_keep(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+/** Measure how long one operation of f takes, in ns.
+ *
+ * f performs ops operations per call. It is called repeatedly for at least 50ms, five times, and the fastest
+ * of those rounds is used so that other processes on the machine don't skew the result.
+ */
+template<typename F>
+double bench_ns_per_op(uint64_t ops, F &&f) {
+  using clock = std::chrono::steady_clock;
+  double best = 0.0;
+  for (int round = 0; round < 5; round++) {
+    uint64_t calls = 0;
+    const clock::time_point start = clock::now();
+    clock::duration elapsed;
+    do {
+      f();
+      calls++;
+      elapsed = clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(50));
+    const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / double(calls * ops);
+    if (round == 0 || ns < best)
+      best = ns;
+  }
+  return best;
+}
+
+#endif //ESPHOMELIB_HOST_BENCHMARKS_BENCH_H
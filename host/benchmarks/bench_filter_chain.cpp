@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "esphomelib/sensor/filter.h"
+#include "esphomelib/sensor/filter_chain.h"
+#include "bench.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+static const size_t VALUES = 4096;
+
+/// The cost per value of running values through filters one by one, like Sensor::push_new_value().
+static double bench_list(const std::list<Filter *> &filters, const std::vector<float> &values,
+                         const std::vector<uint32_t> &times) {
+  const std::list<Filter *> *f = &filters;
+  const std::vector<float> *v = &values;
+  const std::vector<uint32_t> *t = &times;
+  return bench_ns_per_op(values.size(), [f, v, t]() {
+    for (size_t i = 0; i < v->size(); i++) {
+      Optional<float> value = (*v)[i];
+      for (Filter *filter : *f) {
+        value = filter->new_timed_value(value.value, (*t)[i]);
+        if (!value.defined)
+          break;
+      }
+      bench_keep(value);
+    }
+  });
+}
+
+/// The cost per value of running blocks of values through filters, like Sensor::push_new_values().
+static double bench_list_block(const std::list<Filter *> &filters, const std::vector<float> &values,
+                               const std::vector<uint32_t> &times) {
+  const std::list<Filter *> *f = &filters;
+  const std::vector<float> *v = &values;
+  const std::vector<uint32_t> *t = &times;
+  std::vector<float> block_values;
+  std::vector<uint32_t> block_times;
+  return bench_ns_per_op(values.size(), [f, v, t, &block_values, &block_times]() {
+    block_values = *v;
+    block_times = *t;
+    size_t count = block_values.size();
+    for (Filter *filter : *f)
+      count = filter->new_values(block_values.data(), block_times.data(), count);
+    bench_keep(count);
+  });
+}
+
+/** The cost per value of the list-based Filter pipeline against a FilterChain of the same steps: Offset,
+ * Multiply and a sliding window average of 15 values sent on every value, the calibration of a high-rate ADC.
+ *
+ * The chain is measured through the Filter interface (as a sensor would call it, one virtual call per value),
+ * through FilterChain::apply() directly and in blocks. The block runs include copying the input.
+ */
+int main() {
+  std::vector<float> values(VALUES);
+  std::vector<uint32_t> times(VALUES);
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  for (size_t i = 0; i < VALUES; i++) {
+    values[i] = dist(rng);
+    times[i] = i;
+  }
+
+  std::list<Filter *> filters = {new OffsetFilter(-0.05f), new MultiplyFilter(3.3f),
+                                 new SlidingWindowMovingAverageFilter(15, 1)};
+  auto *chain = make_filter_chain(OffsetStep(-0.05f), MultiplyStep(3.3f), SlidingWindowStep<15, 1>());
+  std::list<Filter *> chain_filter = {chain};
+
+  const double list_ns = bench_list(filters, values, times);
+  const double chain_filter_ns = bench_list(chain_filter, values, times);
+  const std::vector<float> *v = &values;
+  const double chain_apply_ns = bench_ns_per_op(values.size(), [chain, v]() {
+    for (size_t i = 0; i < v->size(); i++) {
+      float value = (*v)[i];
+      bench_keep(chain->apply(value, i));
+      bench_keep(value);
+    }
+  });
+  const double list_block_ns = bench_list_block(filters, values, times);
+  const double chain_block_ns = bench_list_block(chain_filter, values, times);
+
+  printf("Offset, Multiply, SlidingWindow<15, 1>, ns per value\n\n");
+  printf("%-32s %10.2f\n", "std::list<Filter *>", list_ns);
+  printf("%-32s %10.2f\n", "FilterChain (Filter interface)", chain_filter_ns);
+  printf("%-32s %10.2f\n", "FilterChain::apply()", chain_apply_ns);
+  printf("%-32s %10.2f\n", "std::list<Filter *> blocks", list_block_ns);
+  printf("%-32s %10.2f\n", "FilterChain blocks", chain_block_ns);
+
+  for (Filter *filter : filters)
+    delete filter;
+  delete chain;
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "esphomelib/fixed_point.h"
+#include "esphomelib/helpers.h"
+#include "bench.h"
+
+using namespace esphomelib;
+
+/// The number of sensor values per call, like a temperature sensor: 15-25 with some noise.
+static const size_t VALUES = 1024;
+static const size_t WINDOW_SIZE = 15;
+static const float ALPHA = 0.1f;
+
+static std::vector<float> make_values() {
+  std::vector<float> values(VALUES);
+  uint32_t noise = 1;
+  for (size_t i = 0; i < VALUES; i++) {
+    noise = noise * 1103515245u + 12345u;
+    values[i] = 20.0f + 5.0f * sinf(i * 0.01f) + (noise >> 16) / 65536.0f - 0.5f;
+  }
+  return values;
+}
+
+/// The largest difference between the float and fixed point averages over all values.
+static float max_difference(const std::vector<float> &values) {
+  SlidingWindowMovingAverage<float> window(WINDOW_SIZE);
+  SlidingWindowMovingAverage<int32_t, int64_t> fixed_window(WINDOW_SIZE);
+  ExponentialMovingAverage ema(ALPHA);
+  FixedExponentialMovingAverage fixed_ema(ALPHA);
+  float max = 0.0f;
+  for (float value : values) {
+    const float a = window.next_value(value);
+    const float b = Fixed16::from_raw(fixed_window.next_value(Fixed16::from_float(value).raw())).to_float();
+    const float c = ema.next_value(value);
+    const float d = fixed_ema.next_value(Fixed16::from_float(value)).to_float();
+    max = fmaxf(max, fmaxf(fabsf(a - b), fabsf(c - d)));
+  }
+  return max;
+}
+
+/** The cost of the averaging filters per value with float (the default) and with Fixed16 numbers
+ * (USE_FIXED_POINT_FILTERS), including the conversions from and to float that the filters do.
+ *
+ * The host has an FPU, so this shows the overhead of the conversions more than the benefit of fixed point.
+ * On the ESP8266 every float operation is a soft-float library call, run examples/fixed-point-benchmark.cpp
+ * there for the cycle counts.
+ */
+int main() {
+  const std::vector<float> values = make_values();
+  const std::vector<float> *v = &values;
+
+  SlidingWindowMovingAverage<float> window(WINDOW_SIZE);
+  const double window_float = bench_ns_per_op(VALUES, [v, &window]() {
+    for (float value : *v)
+      bench_keep(window.next_value(value));
+  });
+  SlidingWindowMovingAverage<int32_t, int64_t> fixed_window(WINDOW_SIZE);
+  const double window_fixed = bench_ns_per_op(VALUES, [v, &fixed_window]() {
+    for (float value : *v)
+      bench_keep(Fixed16::from_raw(fixed_window.next_value(Fixed16::from_float(value).raw())).to_float());
+  });
+  ExponentialMovingAverage ema(ALPHA);
+  const double ema_float = bench_ns_per_op(VALUES, [v, &ema]() {
+    for (float value : *v)
+      bench_keep(ema.next_value(value));
+  });
+  FixedExponentialMovingAverage fixed_ema(ALPHA);
+  const double ema_fixed = bench_ns_per_op(VALUES, [v, &fixed_ema]() {
+    for (float value : *v)
+      bench_keep(fixed_ema.next_value(Fixed16::from_float(value)).to_float());
+  });
+
+  printf("ns per value\n\n");
+  printf("%-32s %8s %8s\n", "", "float", "Fixed16");
+  printf("%-32s %8.2f %8.2f\n", "sliding window (15 values)", window_float, window_fixed);
+  printf("%-32s %8.2f %8.2f\n", "exponential moving average", ema_float, ema_fixed);
+  printf("\nlargest difference of the averages: %g\n", max_difference(values));
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "esphomelib/profiler.h"
+#include "bench.h"
+
+using namespace esphomelib;
+
+/// Stand-in for a component with a trivial loop(), so that only the cost of profiling it is measured.
+class LoopingComponent {
+ public:
+  virtual ~LoopingComponent() = default;
+  virtual void loop() { this->loops_++; }
+
+ protected:
+  uint32_t loops_{0};
+};
+
+/// The number of looping components of the simulated node.
+static const size_t COMPONENTS = 20;
+
+/** The overhead of the component profiler: ProfileStats::add() (the bookkeeping), the start()/record() pair
+ * around each call (which additionally reads the clocks twice) and a loop iteration over COMPONENTS components
+ * with and without profiling, like ComponentLoop::loop_component_().
+ *
+ * The clocks are much more expensive on the host (a system call) than on the ESP32/ESP8266 (the CCOUNT register
+ * and the RTOS tick counter), so start()/record() are an upper bound there.
+ */
+int main() {
+  ProfileStats stats;
+  uint32_t duration = 0;
+  const double add = bench_ns_per_op(1000, [&stats, &duration]() {
+    for (uint32_t i = 0; i < 1000; i++)
+      stats.add((duration++ * 7) % 5000);
+  });
+  const double start_record = bench_ns_per_op(1000, [&stats]() {
+    for (uint32_t i = 0; i < 1000; i++) {
+      const ProfileStats::Start start = ProfileStats::start();
+      stats.record(start);
+    }
+  });
+  ProfileStats snapshot;
+  const double read = bench_ns_per_op(1000, [&stats, &snapshot]() {
+    for (uint32_t i = 0; i < 1000; i++) {
+      stats.read(snapshot);
+      bench_keep(snapshot);
+    }
+  });
+
+  std::vector<std::unique_ptr<LoopingComponent>> components;
+  for (size_t i = 0; i < COMPONENTS; i++)
+    components.emplace_back(new LoopingComponent());
+  std::vector<ProfileStats> profiles(COMPONENTS);
+  const double plain = bench_ns_per_op(1, [&components]() {
+    for (auto &component : components)
+      component->loop();
+  });
+  const double profiled = bench_ns_per_op(1, [&components, &profiles]() {
+    for (size_t i = 0; i < COMPONENTS; i++) {
+      const ProfileStats::Start start = ProfileStats::start();
+      components[i]->loop();
+      profiles[i].record(start);
+    }
+  });
+
+  printf("ns per call\n\n");
+  printf("%-34s %8.1f\n", "ProfileStats::add()", add);
+  printf("%-34s %8.1f\n", "ProfileStats::start() + record()", start_record);
+  printf("%-34s %8.1f\n", "ProfileStats::read()", read);
+  printf("\nns per loop iteration with %zu components\n\n", COMPONENTS);
+  printf("%-34s %8.1f\n", "without profiling", plain);
+  printf("%-34s %8.1f\n", "with profiling", profiled);
+  printf("%-34s %8.1f\n", "overhead per component", (profiled - plain) / COMPONENTS);
+  return 0;
+}
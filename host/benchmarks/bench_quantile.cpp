@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "esphomelib/helpers.h"
+#include "esphomelib/sensor/filter.h"
+#include "bench.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+/// The median the simple way: copy the window and partially sort the copy for every value.
+class NthElementMedian {
+ public:
+  explicit NthElementMedian(size_t max_size) : max_size_(max_size) {}
+
+  float next_value(float value) {
+    if (this->window_.size() == this->max_size_)
+      this->window_.pop_front();
+    this->window_.push_back(value);
+    this->sorted_.assign(this->window_.begin(), this->window_.end());
+    auto middle = this->sorted_.begin() + this->sorted_.size() / 2;
+    std::nth_element(this->sorted_.begin(), middle, this->sorted_.end());
+    return *middle;
+  }
+
+ protected:
+  size_t max_size_;
+  std::deque<float> window_;
+  std::vector<float> sorted_;
+};
+
+/// Sensor values like those of a DHT: a slow signal with noise and a spike every 50 values.
+static std::vector<float> make_values() {
+  std::vector<float> values(4096);
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 0.2f);
+  for (size_t i = 0; i < values.size(); i++)
+    values[i] = 21.0f + (i % 500) * 0.01f + noise(rng) + (i % 50 == 0 ? 40.0f : 0.0f);
+  return values;
+}
+
+template<typename F>
+static double bench_values(const std::vector<float> &values, F &&next_value) {
+  const std::vector<float> *v = &values;
+  return bench_ns_per_op(values.size(), [v, &next_value]() {
+    for (float value : *v)
+      next_value(value);
+  });
+}
+
+/** The cost per value of the median of SlidingWindowQuantile (a treap, O(log n)) against copying the window and
+ * using std::nth_element (O(n)), and of MedianFilter and HampelFilter, for windows of 5, 31, 255 and 1023 values.
+ */
+int main() {
+  const std::vector<float> values = make_values();
+  printf("ns per value\n\n");
+  printf("%8s %14s %14s %14s %14s\n", "window", "nth_element", "treap median", "MedianFilter", "HampelFilter");
+  for (size_t window : {5, 31, 255, 1023}) {
+    NthElementMedian reference(window);
+    const double nth = bench_values(values, [&reference](float value) { bench_keep(reference.next_value(value)); });
+    SlidingWindowQuantile quantile(window);
+    const double treap = bench_values(values, [&quantile](float value) {
+      quantile.next_value(value);
+      bench_keep(quantile.get_median());
+    });
+    MedianFilter median_filter(window, 1);
+    const double median = bench_values(values, [&median_filter](float value) {
+      bench_keep(median_filter.new_value(value));
+    });
+    HampelFilter hampel_filter(window);
+    const double hampel = bench_values(values, [&hampel_filter](float value) {
+      bench_keep(hampel_filter.new_value(value));
+    });
+    printf("%8zu %14.1f %14.1f %14.1f %14.1f\n", window, nth, treap, median, hampel);
+  }
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "esphomelib/esphal.h"
+#include "esphomelib/helpers.h"
+#include "esphomelib/scheduler.h"
+#include "bench.h"
+#include "host_platform.h"
+
+using namespace esphomelib;
+
+/** The time functions of one component as they were stored before the Scheduler: a vector per component
+ * that Component::loop_internal() walked every loop, calling millis() for each entry.
+ */
+class VectorTimers {
+ public:
+  void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+    const uint32_t offset = (random_uint32() % interval) / 2;
+    this->time_functions_.push_back(TimeFunction{
+        name, TimeFunction::INTERVAL, interval, millis() - interval - offset, std::move(f), false});
+  }
+
+  void loop() {
+    for (size_t i = 0; i < this->time_functions_.size(); i++) {
+      const uint32_t now = millis();
+      TimeFunction *tf = &this->time_functions_[i];
+      if (tf->should_run(now)) {
+        tf->f();
+        tf = &this->time_functions_[i];
+        if (tf->type == TimeFunction::INTERVAL) {
+          const uint32_t amount = (now - tf->last_execution) / tf->interval;
+          tf->last_execution += amount * tf->interval;
+        } else {
+          tf->remove = true;
+        }
+      }
+    }
+    this->time_functions_.erase(
+        std::remove_if(this->time_functions_.begin(), this->time_functions_.end(),
+                       [](const TimeFunction &tf) { return tf.remove; }),
+        this->time_functions_.end());
+  }
+
+ protected:
+  struct TimeFunction {
+    std::string name;
+    enum Type { TIMEOUT, INTERVAL, DEFER } type;
+    uint32_t interval;
+    uint32_t last_execution;
+    std::function<void()> f;
+    bool remove;
+
+    bool should_run(uint32_t now) const {
+      if (this->remove)
+        return false;
+      if (this->type == DEFER)
+        return true;
+      return now - this->last_execution > this->interval;
+    }
+  };
+
+  std::vector<TimeFunction> time_functions_;
+};
+
+/// The update intervals of the simulated components, like the sensors of a typical node.
+static uint32_t update_interval(size_t component) {
+  const uint32_t intervals[] = {1000, 5000, 15000, 15000, 60000};
+  return intervals[component % 5];
+}
+
+/// How many loop iterations are timed per call, each one advances the virtual clock by 1ms.
+static const uint32_t ITERATIONS = 100;
+
+/// The cost of a loop iteration without any time functions, the virtual clock isn't free either.
+static double bench_empty() {
+  return bench_ns_per_op(ITERATIONS, []() {
+    for (uint32_t i = 0; i < ITERATIONS; i++)
+      host::advance_time(1000);
+  });
+}
+
+static double bench_vector(size_t components, uint32_t *calls) {
+  std::vector<VectorTimers> timers(components);
+  for (size_t i = 0; i < components; i++)
+    timers[i].set_interval("update", update_interval(i), [calls]() { (*calls)++; });
+  auto *t = &timers;
+  return bench_ns_per_op(ITERATIONS, [t]() {
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+      host::advance_time(1000);
+      for (VectorTimers &component : *t)
+        component.loop();
+    }
+  });
+}
+
+static double bench_scheduler(size_t components, uint32_t *calls) {
+  std::unique_ptr<Scheduler> scheduler(new Scheduler());
+  for (size_t i = 0; i < components; i++)
+    scheduler->set_interval(nullptr, fnv1a_hash("update") + i, update_interval(i), [calls]() { (*calls)++; });
+  Scheduler *s = scheduler.get();
+  return bench_ns_per_op(ITERATIONS, [s]() {
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+      host::advance_time(1000);
+      s->call();
+    }
+  });
+}
+
+/** The cost of dispatching the interval functions of 10 to 1000 components per loop iteration, with the
+ * per-component vectors from before the Scheduler and with the Scheduler. The loop runs every 1ms on the
+ * virtual clock, the time of a loop iteration without any time functions is subtracted.
+ */
+int main() {
+  host::use_virtual_clock(true);
+  const double empty = bench_empty();
+  printf("ns per loop iteration (1ms virtual time), minus %.1fns for an empty iteration\n\n", empty);
+  printf("%10s %12s %12s %8s\n", "components", "vector", "scheduler", "speedup");
+  for (size_t components : {10, 30, 100, 300, 1000}) {
+    uint32_t vector_calls = 0, scheduler_calls = 0;
+    const double vector = bench_vector(components, &vector_calls) - empty;
+    const double scheduler = bench_scheduler(components, &scheduler_calls) - empty;
+    printf("%10zu %12.1f %12.1f %7.1fx\n", components, vector, scheduler, vector / scheduler);
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "esphomelib/sensor/sensor_history.h"
+#include "bench.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+struct Sample {
+  uint32_t time;
+  float value;
+};
+
+/// A named series of samples and the accuracy decimals of its sensor.
+struct Trace {
+  std::string name;
+  int8_t accuracy_decimals;
+  std::vector<Sample> samples;
+};
+
+/// The number of samples of the synthetic traces, about 35 days at 15s.
+static const size_t SAMPLES = 200000;
+
+/** A synthetic trace: polled every interval ms with 0-300ms jitter and an occasional missed poll, following a
+ * daily cycle of amplitude around base with random-walk drift and noise of the given standard deviation.
+ */
+static Trace make_trace(const char *name, int8_t accuracy_decimals, uint32_t interval, float base, float amplitude,
+                        float noise) {
+  std::mt19937 rng(interval + accuracy_decimals);
+  std::uniform_int_distribution<uint32_t> jitter(0, 300);
+  std::uniform_int_distribution<uint32_t> percent(0, 99);
+  std::normal_distribution<float> noise_dist(0.0f, noise);
+  std::normal_distribution<float> drift_dist(0.0f, noise / 10.0f);
+  Trace trace{name, accuracy_decimals, {}};
+  uint32_t time = 0;
+  float drift = 0.0f;
+  for (size_t i = 0; i < SAMPLES; i++) {
+    time += interval + jitter(rng) + (percent(rng) == 0 ? interval : 0);
+    drift += drift_dist(rng);
+    const float day = (time % 86400000u) / 86400000.0f;
+    trace.samples.push_back(Sample{time, base + drift + amplitude * sinf(day * 6.2831853f) + noise_dist(rng)});
+  }
+  return trace;
+}
+
+/// Read a recorded trace, one "time_ms,value" line per sample in chronological order.
+static bool read_trace(const char *path, int8_t accuracy_decimals, Trace *trace) {
+  FILE *file = fopen(path, "r");
+  if (file == nullptr)
+    return false;
+  trace->name = path;
+  trace->accuracy_decimals = accuracy_decimals;
+  unsigned long time;
+  float value;
+  while (fscanf(file, "%lu,%f", &time, &value) == 2)
+    trace->samples.push_back(Sample{uint32_t(time), value});
+  fclose(file);
+  return !trace->samples.empty();
+}
+
+static void bench_trace(const Trace &trace) {
+  // large enough for the whole trace, so that the bytes per sample aren't skewed by evicted blocks
+  const size_t budget = trace.samples.size() * 8 + 2 * SensorHistory::BLOCK_SIZE;
+  SensorHistory history(budget, trace.accuracy_decimals);
+  for (const Sample &sample : trace.samples)
+    history.add(sample.time, sample.value);
+  const double bytes_per_sample = history.get_bytes_used() / double(history.size());
+
+  const std::vector<Sample> *samples = &trace.samples;
+  const double add_ns = bench_ns_per_op(samples->size(), [samples, budget, &trace]() {
+    SensorHistory h(budget, trace.accuracy_decimals);
+    for (const Sample &sample : *samples)
+      h.add(sample.time, sample.value);
+    bench_keep(h);
+  });
+  float sum = 0.0f;
+  const double decode_ns = bench_ns_per_op(history.size(), [&history, &sum]() {
+    history.for_each(0, [&sum](uint32_t /*time*/, float value) { sum += value; }, true);
+    bench_keep(sum);
+  });
+  printf("%-28s %9d %9zu %14.2f %10.1f %10.1f\n", trace.name.c_str(), trace.accuracy_decimals, history.size(),
+         bytes_per_sample, add_ns, decode_ns);
+}
+
+/** The compression ratio (bytes per sample, a raw sample being 8 bytes) and the add() and decoding throughput
+ * of SensorHistory.
+ *
+ * Pass recorded data as `bench_sensor_history <file.csv> <accuracy_decimals>` ("time_ms,value" lines, for
+ * example exported from Home Assistant). Without arguments, synthetic traces modelled on typical sensors are
+ * used. add() is timed including the allocation of the history.
+ */
+int main(int argc, char **argv) {
+  std::vector<Trace> traces;
+  if (argc >= 3) {
+    Trace trace;
+    if (!read_trace(argv[1], int8_t(atoi(argv[2])), &trace)) {
+      fprintf(stderr, "Couldn't read samples from %s\n", argv[1]);
+      return 1;
+    }
+    traces.push_back(trace);
+  } else {
+    traces.push_back(make_trace("temperature 15s (synthetic)", 1, 15000, 21.0f, 2.0f, 0.05f));
+    traces.push_back(make_trace("temperature 15s (synthetic)", 2, 15000, 21.0f, 2.0f, 0.05f));
+    traces.push_back(make_trace("temperature 15s (synthetic)", -1, 15000, 21.0f, 2.0f, 0.05f));
+    traces.push_back(make_trace("humidity 60s (synthetic)", 1, 60000, 45.0f, 10.0f, 0.3f));
+    traces.push_back(make_trace("pressure 60s (synthetic)", 1, 60000, 1013.0f, 3.0f, 0.1f));
+  }
+  printf("%-28s %9s %9s %14s %10s %10s\n", "trace", "decimals", "samples", "bytes/sample", "add ns",
+         "decode ns");
+  for (const Trace &trace : traces)
+    bench_trace(trace);
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "esphomelib/helpers.h"
+#include "bench.h"
+
+using namespace esphomelib;
+
+/// The moving average as it was before the ring buffer: a std::queue and a sum that's only ever updated.
+class QueueMovingAverage {
+ public:
+  explicit QueueMovingAverage(size_t max_size) : max_size_(max_size) {}
+
+  float next_value(float value) {
+    if (this->queue_.size() == this->max_size_) {
+      this->sum_ -= this->queue_.front();
+      this->queue_.pop();
+    }
+    this->queue_.push(value);
+    this->sum_ += value;
+    return this->sum_ / this->queue_.size();
+  }
+
+ protected:
+  std::queue<float> queue_;
+  size_t max_size_;
+  float sum_{0.0f};
+};
+
+/// The default window of the sensors, see Sensor::Sensor().
+static const size_t WINDOW_SIZE = 15;
+/// The number of samples of the accuracy run.
+static const uint64_t SAMPLES = 100000000;
+
+template<typename A>
+static double bench(A *average, const std::vector<float> &values) {
+  const std::vector<float> *v = &values;
+  return bench_ns_per_op(values.size(), [average, v]() {
+    for (float value : *v)
+      bench_keep(average->next_value(value));
+  });
+}
+
+/// The largest difference between the average and the mean of the window (in double precision) over SAMPLES
+/// random samples in 15 to 30.
+template<typename A>
+static double max_error(A *average) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(15.0f, 30.0f);
+  std::deque<float> window;
+  double max = 0.0;
+  for (uint64_t i = 0; i < SAMPLES; i++) {
+    const float value = dist(rng);
+    window.push_back(value);
+    if (window.size() > WINDOW_SIZE)
+      window.pop_front();
+    const float result = average->next_value(value);
+    double sum = 0.0;
+    for (float v : window)
+      sum += v;
+    max = std::max(max, std::fabs(result - sum / window.size()));
+  }
+  return max;
+}
+
+/** The cost per value and the long-run accuracy of SlidingWindowMovingAverage (ring buffer, sum recomputed on
+ * each wrap around) against the std::queue implementation it replaced, with the default window of 15 values.
+ */
+int main() {
+  std::vector<float> values(1024);
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> dist(15.0f, 30.0f);
+  for (float &value : values)
+    value = dist(rng);
+
+  QueueMovingAverage queue(WINDOW_SIZE);
+  SlidingWindowMovingAverage<float> ring(WINDOW_SIZE);
+  const double queue_ns = bench(&queue, values);
+  const double ring_ns = bench(&ring, values);
+
+  QueueMovingAverage queue_accuracy(WINDOW_SIZE);
+  SlidingWindowMovingAverage<float> ring_accuracy(WINDOW_SIZE);
+  const double queue_error = max_error(&queue_accuracy);
+  const double ring_error = max_error(&ring_accuracy);
+
+  printf("window of %zu values, %llu samples in 15-30 for the error\n\n", WINDOW_SIZE, (unsigned long long) SAMPLES);
+  printf("%-14s %12s %12s\n", "", "ns per value", "max error");
+  printf("%-14s %12.2f %12.2e\n", "std::queue", queue_ns, queue_error);
+  printf("%-14s %12.2f %12.2e\n", "ring buffer", ring_ns, ring_error);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "esphomelib/mqtt/mqtt_topic_index.h"
+#include "bench.h"
+
+using namespace esphomelib;
+using namespace esphomelib::mqtt;
+
+/// The dispatch as it was before the index: copy the topic into a std::string and compare it to every filter.
+class LinearDispatch {
+ public:
+  void insert(const std::string &filter, size_t value) { this->filters_.push_back(Filter{filter, value}); }
+
+  size_t match(const char *topic, size_t len) const {
+    const std::string topic_s(topic, len);
+    size_t matches = 0;
+    for (const Filter &filter : this->filters_)
+      if (topic_s == filter.filter)
+        matches += filter.value;
+    return matches;
+  }
+
+ protected:
+  struct Filter {
+    std::string filter;
+    size_t value;
+  };
+  std::vector<Filter> filters_;
+};
+
+/// The command topic of the i-th component of a node, like the ones of MQTTComponent::get_command_topic().
+static std::string command_topic(size_t i) {
+  static const char *const TYPES[] = {"light", "switch", "fan", "cover"};
+  return "livingroom/" + std::string(TYPES[i % 4]) + "/component_" + std::to_string(i) + "/command";
+}
+
+/** The cost of dispatching one message to n subscriptions, for n from 10 to 1000: the linear scan with a string
+ * compare per subscription against the MQTTTopicIndex, with command topics only and with two wildcard filters
+ * (like a Home Assistant status and a custom `+` subscription) added. Half of the messages are command topics
+ * of the node, half are topics no filter matches.
+ */
+int main() {
+  printf("ns per message\n\n");
+  printf("%14s %14s %14s %18s\n", "subscriptions", "linear scan", "topic index", "index+wildcards");
+  for (size_t n : {10, 30, 100, 300, 1000}) {
+    LinearDispatch linear;
+    MQTTTopicIndex index, wildcard_index;
+    for (size_t i = 0; i < n; i++) {
+      linear.insert(command_topic(i), i);
+      index.insert(command_topic(i), i);
+      wildcard_index.insert(command_topic(i), i);
+    }
+    wildcard_index.insert("homeassistant/status", n);
+    wildcard_index.insert("livingroom/+/custom/#", n + 1);
+
+    std::vector<std::string> topics;
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<size_t> component(0, n - 1);
+    for (size_t i = 0; i < 512; i++) {
+      const std::string topic = command_topic(component(rng));
+      topics.push_back(i % 2 == 0 ? topic : "kitchen" + topic.substr(10));
+    }
+
+    const std::vector<std::string> *t = &topics;
+    const double linear_ns = bench_ns_per_op(topics.size(), [t, &linear]() {
+      for (const std::string &topic : *t)
+        bench_keep(linear.match(topic.data(), topic.size()));
+    });
+    size_t matches = 0;
+    const double index_ns = bench_ns_per_op(topics.size(), [t, &index, &matches]() {
+      for (const std::string &topic : *t)
+        index.match(topic.data(), topic.size(), [&matches](size_t value) { matches += value; });
+      bench_keep(matches);
+    });
+    const double wildcard_ns = bench_ns_per_op(topics.size(), [t, &wildcard_index, &matches]() {
+      for (const std::string &topic : *t)
+        wildcard_index.match(topic.data(), topic.size(), [&matches](size_t value) { matches += value; });
+      bench_keep(matches);
+    });
+    printf("%14zu %14.1f %14.1f %18.1f\n", n, linear_ns, index_ns, wildcard_ns);
+  }
+  return 0;
+}
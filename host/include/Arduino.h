@@ -0,0 +1,90 @@
+#ifndef ESPHOMELIB_HOST_ARDUINO_H
+#define ESPHOMELIB_HOST_ARDUINO_H
+
+// The Arduino core API of the native host platform, see host_platform.h.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "WString.h"
+#include "HardwareSerial.h"
+#include "Esp.h"
+
+#define HIGH 0x1
+#define LOW  0x0
+
+// Pin modes, same values as the ESP32 core.
+#define INPUT             0x01
+#define OUTPUT            0x02
+#define PULLUP            0x04
+#define INPUT_PULLUP      0x05
+#define PULLDOWN          0x08
+#define INPUT_PULLDOWN    0x09
+#define OPEN_DRAIN        0x10
+#define OUTPUT_OPEN_DRAIN 0x12
+#define SPECIAL           0xF0
+#define FUNCTION_1        0x00
+#define FUNCTION_2        0x20
+#define FUNCTION_3        0x40
+#define FUNCTION_4        0x60
+#define FUNCTION_5        0x80
+#define FUNCTION_6        0xA0
+#define ANALOG            0xC0
+
+// Interrupt modes
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+// There's no instruction RAM or flash-mapped constant data on the host.
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define PROGMEM
+
+#define digitalPinToInterrupt(p) (p)
+
+// The default I2C pins, same as on the ESP32.
+static const uint8_t SDA = 21;
+static const uint8_t SCL = 22;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000UL);
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+/// Block the simulated interrupt handlers (host::set_pin() from other threads), can be nested.
+void noInterrupts();
+void interrupts();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+/// Hardware random number, like the SDK function of the same name.
+uint32_t os_random();
+
+// Functions of the newlib/avr-libc of the chip toolchains that glibc doesn't have.
+double pow10(double x);
+char *dtostrf(double number, signed char width, unsigned char prec, char *s);
+
+// Implemented by the sketch.
+void setup();
+void loop();
+
+#endif //ESPHOMELIB_HOST_ARDUINO_H
@@ -0,0 +1,40 @@
+#ifndef ESPHOMELIB_HOST_ARDUINO_OTA_H
+#define ESPHOMELIB_HOST_ARDUINO_OTA_H
+
+#include <cstdint>
+#include <functional>
+#include <sys/types.h>
+
+typedef enum {
+  OTA_AUTH_ERROR,
+  OTA_BEGIN_ERROR,
+  OTA_CONNECT_ERROR,
+  OTA_RECEIVE_ERROR,
+  OTA_END_ERROR
+} ota_error_t;
+
+/// There's nothing to flash on the host, the settings and callbacks are accepted but an update never starts.
+class ArduinoOTAClass {
+ public:
+  typedef std::function<void()> THandlerFunction;
+  typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+  typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+  void setPort(uint16_t port);
+  void setHostname(const char *hostname);
+  void setPassword(const char *password);
+  void setPasswordHash(const char *password);
+
+  void onStart(THandlerFunction fn);
+  void onEnd(THandlerFunction fn);
+  void onError(THandlerFunction_Error fn);
+  void onProgress(THandlerFunction_Progress fn);
+
+  void begin();
+  void end();
+  void handle();
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif //ESPHOMELIB_HOST_ARDUINO_OTA_H
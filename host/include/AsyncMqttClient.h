@@ -0,0 +1,110 @@
+#ifndef ESPHOMELIB_HOST_ASYNC_MQTT_CLIENT_H
+#define ESPHOMELIB_HOST_ASYNC_MQTT_CLIENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class AsyncMqttClientDisconnectReason : int8_t {
+  TCP_DISCONNECTED = 0,
+
+  MQTT_UNACCEPTABLE_PROTOCOL_VERSION = 1,
+  MQTT_IDENTIFIER_REJECTED = 2,
+  MQTT_SERVER_UNAVAILABLE = 3,
+  MQTT_MALFORMED_CREDENTIALS = 4,
+  MQTT_NOT_AUTHORIZED = 5,
+
+  ESP8266_NOT_ENOUGH_SPACE = 6,
+
+  TLS_BAD_FINGERPRINT = 7
+};
+
+struct AsyncMqttClientMessageProperties {
+  uint8_t qos;
+  bool dup;
+  bool retain;
+};
+
+/** The AsyncMqttClient API of the host platform: An MQTT 3.1.1 client over a POSIX TCP socket.
+ *
+ * Like the async_tcp task on the ESP32, a network thread receives the packets and calls the
+ * onConnect/onDisconnect/onMessage callbacks, publish() and subscribe() send directly from the calling thread.
+ * QoS 1 and 2 messages are sent with their QoS but acknowledgements aren't tracked, so nothing is retransmitted.
+ *
+ * The ESPHOMELIB_MQTT_HOST and ESPHOMELIB_MQTT_PORT environment variables override the server passed to
+ * setServer(), which lets the example sketches connect to a local broker.
+ */
+class AsyncMqttClient {
+ public:
+  typedef std::function<void(bool session_present)> OnConnectUserCallback;
+  typedef std::function<void(AsyncMqttClientDisconnectReason reason)> OnDisconnectUserCallback;
+  typedef std::function<void(char *topic, char *payload, AsyncMqttClientMessageProperties properties,
+                             size_t len, size_t index, size_t total)> OnMessageUserCallback;
+
+  AsyncMqttClient() = default;
+  ~AsyncMqttClient();
+
+  AsyncMqttClient &setKeepAlive(uint16_t keep_alive);
+  AsyncMqttClient &setClientId(const char *client_id);
+  AsyncMqttClient &setCleanSession(bool clean_session);
+  AsyncMqttClient &setCredentials(const char *username, const char *password = nullptr);
+  AsyncMqttClient &setWill(const char *topic, uint8_t qos, bool retain,
+                           const char *payload = nullptr, size_t length = 0);
+  AsyncMqttClient &setServer(const char *host, uint16_t port);
+
+  AsyncMqttClient &onConnect(OnConnectUserCallback callback);
+  AsyncMqttClient &onDisconnect(OnDisconnectUserCallback callback);
+  AsyncMqttClient &onMessage(OnMessageUserCallback callback);
+
+  bool connected() const;
+  /// Start connecting in the network thread, connected() becomes true once the broker accepted the connection.
+  void connect();
+  /// Close the connection, force skips the DISCONNECT packet (no will message is suppressed then).
+  void disconnect(bool force = false);
+  uint16_t subscribe(const char *topic, uint8_t qos);
+  uint16_t unsubscribe(const char *topic);
+  /// Returns the packet id (1 for QoS 0), 0 if not connected or the write failed.
+  uint16_t publish(const char *topic, uint8_t qos, bool retain,
+                   const char *payload = nullptr, size_t length = 0, bool dup = false, uint16_t message_id = 0);
+
+ protected:
+  void run_();
+  bool connect_socket_();
+  bool send_packet_(uint8_t header, const std::vector<uint8_t> &body);
+  bool receive_packet_(uint8_t &header, std::vector<uint8_t> &body);
+  void handle_packet_(uint8_t header, const std::vector<uint8_t> &body);
+  void close_(AsyncMqttClientDisconnectReason reason);
+  uint16_t next_packet_id_();
+
+  std::string host_;
+  uint16_t port_{1883};
+  std::string client_id_;
+  bool clean_session_{true};
+  std::string username_;
+  std::string password_;
+  bool has_credentials_{false};
+  std::string will_topic_;
+  std::string will_payload_;
+  uint8_t will_qos_{0};
+  bool will_retain_{false};
+  uint16_t keep_alive_{15};
+
+  OnConnectUserCallback on_connect_;
+  OnDisconnectUserCallback on_disconnect_;
+  OnMessageUserCallback on_message_;
+
+  std::thread thread_;
+  int socket_{-1};
+  std::atomic<bool> connected_{false};
+  std::atomic<bool> stop_{false};
+  std::mutex write_lock_;
+  std::atomic<uint32_t> last_write_{0}; ///< Real time of the last write in ms, for the keep alive pings.
+  std::atomic<uint16_t> packet_id_{0};
+};
+
+#endif //ESPHOMELIB_HOST_ASYNC_MQTT_CLIENT_H
@@ -0,0 +1,41 @@
+#ifndef ESPHOMELIB_HOST_ESP_H
+#define ESPHOMELIB_HOST_ESP_H
+
+#include <cstdint>
+
+typedef enum {
+  FM_QIO = 0x00,
+  FM_QOUT = 0x01,
+  FM_DIO = 0x02,
+  FM_DOUT = 0x03,
+  FM_FAST_READ = 0x04,
+  FM_SLOW_READ = 0x05,
+  FM_UNKNOWN = 0xff
+} FlashMode_t;
+
+/// The chip functions of the host platform.
+class EspClass {
+ public:
+  /// Re-execute the current program with the same arguments, like a reboot of the chip.
+  void restart();
+  /// There's no deep sleep on the host, the program exits.
+  void deepSleep(uint64_t time_us);
+
+  /// A counter of the real monotonic clock (also with the virtual clock) that ticks like a 240MHz cycle counter.
+  uint32_t getCycleCount();
+  /// The frequency of getCycleCount().
+  uint32_t getCpuFreqMHz();
+
+  /// The heap isn't limited on the host, always returns 0.
+  uint32_t getFreeHeap();
+  uint32_t getFlashChipSize();
+  uint32_t getFlashChipSpeed();
+  FlashMode_t getFlashChipMode();
+};
+
+extern EspClass ESP;
+
+/// Store the arguments of main() for ESP.restart().
+void host_set_restart_args(int argc, char **argv);
+
+#endif //ESPHOMELIB_HOST_ESP_H
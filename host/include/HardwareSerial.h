@@ -0,0 +1,23 @@
+#ifndef ESPHOMELIB_HOST_HARDWARE_SERIAL_H
+#define ESPHOMELIB_HOST_HARDWARE_SERIAL_H
+
+#include <cstdint>
+#include <cstddef>
+
+/// The serial port of the host platform is stdout, which makes it the log sink of LogComponent.
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud);
+  void end();
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *str);
+  size_t println(const char *str);
+  size_t println();
+  void flush();
+};
+
+extern HardwareSerial Serial;
+
+#endif //ESPHOMELIB_HOST_HARDWARE_SERIAL_H
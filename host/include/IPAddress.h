@@ -0,0 +1,25 @@
+#ifndef ESPHOMELIB_HOST_IP_ADDRESS_H
+#define ESPHOMELIB_HOST_IP_ADDRESS_H
+
+#include <cstdint>
+#include "WString.h"
+
+/// An IPv4 address, like the Arduino class.
+class IPAddress {
+ public:
+  IPAddress();
+  IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet);
+  explicit IPAddress(uint32_t address);
+
+  operator uint32_t() const; // NOLINT
+  bool operator==(const IPAddress &other) const;
+  uint8_t operator[](int index) const;
+  uint8_t &operator[](int index);
+
+  String toString() const;
+
+ protected:
+  uint8_t octets_[4];
+};
+
+#endif //ESPHOMELIB_HOST_IP_ADDRESS_H
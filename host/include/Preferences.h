@@ -0,0 +1,51 @@
+#ifndef ESPHOMELIB_HOST_PREFERENCES_H
+#define ESPHOMELIB_HOST_PREFERENCES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+
+/** The ESP32 Preferences API of the host platform.
+ *
+ * Values are kept in memory for the lifetime of the process, shared by all Preferences objects
+ * with the same namespace. They're not persisted to disk.
+ */
+class Preferences {
+ public:
+  bool begin(const char *name, bool read_only = false);
+  void end();
+
+  size_t putChar(const char *key, int8_t value);
+  size_t putUChar(const char *key, uint8_t value);
+  size_t putShort(const char *key, int16_t value);
+  size_t putUShort(const char *key, uint16_t value);
+  size_t putInt(const char *key, int32_t value);
+  size_t putUInt(const char *key, uint32_t value);
+  size_t putLong64(const char *key, int64_t value);
+  size_t putULong64(const char *key, uint64_t value);
+  size_t putFloat(const char *key, float value);
+  size_t putDouble(const char *key, double value);
+  size_t putBool(const char *key, bool value);
+
+  int8_t getChar(const char *key, int8_t default_value = 0);
+  uint8_t getUChar(const char *key, uint8_t default_value = 0);
+  int16_t getShort(const char *key, int16_t default_value = 0);
+  uint16_t getUShort(const char *key, uint16_t default_value = 0);
+  int32_t getInt(const char *key, int32_t default_value = 0);
+  uint32_t getUInt(const char *key, uint32_t default_value = 0);
+  int64_t getLong64(const char *key, int64_t default_value = 0);
+  uint64_t getULong64(const char *key, uint64_t default_value = 0);
+  float getFloat(const char *key, float default_value = NAN);
+  double getDouble(const char *key, double default_value = NAN);
+  bool getBool(const char *key, bool default_value = false);
+
+ protected:
+  size_t put_(const char *key, const void *value, size_t len);
+  bool get_(const char *key, void *value, size_t len);
+
+  std::string name_;
+  bool read_only_{false};
+};
+
+#endif //ESPHOMELIB_HOST_PREFERENCES_H
@@ -0,0 +1,17 @@
+#ifndef ESPHOMELIB_HOST_WSTRING_H
+#define ESPHOMELIB_HOST_WSTRING_H
+
+#include <string>
+
+/// The Arduino String class, only what esphomelib uses of it.
+class String : public std::string {
+ public:
+  using std::string::string;
+  String() = default;
+  String(const std::string &str) : std::string(str) {} // NOLINT
+
+  float toFloat() const;
+  long toInt() const;
+};
+
+#endif //ESPHOMELIB_HOST_WSTRING_H
@@ -0,0 +1,59 @@
+#ifndef ESPHOMELIB_HOST_WIFI_H
+#define ESPHOMELIB_HOST_WIFI_H
+
+#include <cstdint>
+#include "IPAddress.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} WiFiMode_t;
+
+/** The WiFi of the host platform is the network of the host, so the station is always connected.
+ *
+ * SSIDs and passwords are ignored, the addresses are the ones of the first IPv4 interface of the host.
+ */
+class WiFiClass {
+ public:
+  bool mode(WiFiMode_t mode);
+  void persistent(bool persistent);
+  bool enableSTA(bool enable);
+  bool enableAP(bool enable);
+  bool setAutoConnect(bool auto_connect);
+  bool setAutoReconnect(bool auto_reconnect);
+  bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+              IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  bool hostname(const char *hostname);
+  bool setHostname(const char *hostname);
+
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr);
+  wl_status_t status();
+
+  bool softAP(const char *ssid, const char *passphrase = nullptr, int channel = 1);
+  bool softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet);
+  bool softAPsetHostname(const char *hostname);
+  IPAddress softAPIP();
+
+  IPAddress localIP();
+  IPAddress subnetMask();
+  IPAddress gatewayIP();
+  IPAddress dnsIP(uint8_t dns_no = 0);
+  /// A stable, locally administered MAC address derived from the host name.
+  uint8_t *macAddress(uint8_t *mac);
+};
+
+extern WiFiClass WiFi;
+
+#endif //ESPHOMELIB_HOST_WIFI_H
@@ -0,0 +1,7 @@
+#ifndef ESPHOMELIB_HOST_WIFI_CLIENT_H
+#define ESPHOMELIB_HOST_WIFI_CLIENT_H
+
+// Only included for the types of the Arduino cores, the MQTT client of the host platform uses POSIX sockets.
+#include "WiFi.h"
+
+#endif //ESPHOMELIB_HOST_WIFI_CLIENT_H
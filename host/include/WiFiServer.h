@@ -0,0 +1,19 @@
+#ifndef ESPHOMELIB_HOST_WIFI_SERVER_H
+#define ESPHOMELIB_HOST_WIFI_SERVER_H
+
+#include <cstdint>
+#include "WiFi.h"
+
+/// Placeholder for the server OTAComponent opens to keep the port reserved, doesn't listen on the host.
+class WiFiServer {
+ public:
+  explicit WiFiServer(uint16_t port) : port_(port) {}
+
+  void begin() {}
+  void close() {}
+
+ protected:
+  uint16_t port_;
+};
+
+#endif //ESPHOMELIB_HOST_WIFI_SERVER_H
@@ -0,0 +1,37 @@
+#ifndef ESPHOMELIB_HOST_WIRE_H
+#define ESPHOMELIB_HOST_WIRE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/// The I2C bus of the host platform, transactions go to the devices registered with host::add_i2c_device().
+/// All TwoWire instances share the same simulated bus.
+class TwoWire {
+ public:
+  explicit TwoWire(uint8_t bus_num = 0);
+
+  void begin(int sda = -1, int scl = -1, uint32_t frequency = 100000);
+  void setClock(uint32_t frequency);
+
+  void beginTransmission(uint8_t address);
+  /// Returns 0 on success, 2 if the address or 3 if the data was NACKed, like the Arduino cores.
+  uint8_t endTransmission(bool send_stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, bool send_stop = true);
+
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t quantity);
+  int available();
+  int read();
+
+ protected:
+  uint8_t bus_num_;
+  uint8_t tx_address_{0};
+  std::vector<uint8_t> tx_buffer_;
+  std::vector<uint8_t> rx_buffer_;
+  size_t rx_index_{0};
+};
+
+extern TwoWire Wire;
+
+#endif //ESPHOMELIB_HOST_WIRE_H
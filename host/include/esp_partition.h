@@ -0,0 +1,47 @@
+#ifndef ESPHOMELIB_HOST_ESP_PARTITION_H
+#define ESPHOMELIB_HOST_ESP_PARTITION_H
+
+#include <cstdint>
+#include <cstddef>
+
+/** The ESP-IDF flash partition API of the host platform.
+ *
+ * Partitions are simulated in memory and have to be created with host::add_flash_partition() first. Like
+ * NOR flash, writes can only clear bits (the written data is AND-ed with the current contents) and
+ * erasing sets whole sectors back to 0xFF. Erases are counted per sector, see host::get_flash_erase_count().
+ */
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t start_addr, size_t size);
+
+#endif //ESPHOMELIB_HOST_ESP_PARTITION_H
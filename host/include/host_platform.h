@@ -0,0 +1,93 @@
+#ifndef ESPHOMELIB_HOST_PLATFORM_H
+#define ESPHOMELIB_HOST_PLATFORM_H
+
+#include <cstdint>
+#include <cstddef>
+
+/** Simulation hooks of the native host platform (ARDUINO_ARCH_HOST).
+ *
+ * The host platform implements the subset of the Arduino API esphomelib uses on top of POSIX so that
+ * Application and its components can run (and be profiled) on a Linux machine. The hardware is simulated:
+ *
+ *  - Time comes from a clock that is either the real monotonic clock (default) or a virtual clock that only
+ *    advances with delay()/delayMicroseconds() and advance_time(), so that hours of run time can be simulated
+ *    in seconds. Set the ESPHOMELIB_VIRTUAL_CLOCK environment variable to start with the virtual clock.
+ *    Each millis()/micros()/yield() call costs 1µs of virtual time so that busy-wait loops still time out.
+ *  - GPIO pins are a simple pin map: Outputs can be inspected with get_pin(), inputs are driven with set_pin()
+ *    which also calls the attached interrupt handlers.
+ *  - The I2C bus (Wire) forwards transactions to the I2CDeviceSimulator registered for the address.
+ *  - AsyncMqttClient is a real MQTT 3.1.1 client over TCP (which can deliver payloads in fragments like on the
+ *    ESP, see set_mqtt_fragment_size()); Serial writes to stdout.
+ *  - Flash partitions (esp_partition.h) are simulated in memory, see add_flash_partition().
+ */
+namespace host {
+
+/// Switch between the real monotonic clock and the virtual clock, the current time is kept.
+void use_virtual_clock(bool virtual_clock);
+/// Whether the virtual clock is in use.
+bool is_virtual_clock();
+/// Advance the virtual clock by us microseconds (real clock: sleep for that long).
+void advance_time(uint64_t us);
+/// The time since start in µs, the base of millis() and micros().
+uint64_t get_time();
+
+/// Drive input pin to value, calls the attached interrupt handler if the edge matches.
+void set_pin(uint8_t pin, bool value);
+/// The last value written to (or driven on) pin.
+bool get_pin(uint8_t pin);
+/// The last pinMode() of pin.
+uint8_t get_pin_mode(uint8_t pin);
+/// Set the value analogRead() returns for pin.
+void set_analog_value(uint8_t pin, uint16_t value);
+/// The last value passed to analogWrite() for pin.
+int get_analog_output(uint8_t pin);
+
+/// A simulated I2C device, see add_i2c_device().
+class I2CDeviceSimulator {
+ public:
+  virtual ~I2CDeviceSimulator() = default;
+
+  /// Handle a write transaction, return false to NACK it.
+  virtual bool write(const uint8_t *data, size_t len) = 0;
+  /// Handle a read transaction of up to len bytes, returns the number of bytes read.
+  virtual size_t read(uint8_t *data, size_t len) = 0;
+};
+
+/** A simulated I2C device with a register map, which is what most sensors look like.
+ *
+ * The first byte of a write selects the register, all following bytes are written to consecutive registers.
+ * Reads return consecutive registers starting at the selected one.
+ */
+class I2CRegisterDevice : public I2CDeviceSimulator {
+ public:
+  bool write(const uint8_t *data, size_t len) override;
+  size_t read(uint8_t *data, size_t len) override;
+
+  void set_register(uint8_t a_register, uint8_t value);
+  uint8_t get_register(uint8_t a_register) const;
+
+ protected:
+  uint8_t registers_[256]{};
+  uint8_t pointer_{0};
+};
+
+/// Attach device to the simulated I2C bus at address, transactions to other addresses are NACKed.
+void add_i2c_device(uint8_t address, I2CDeviceSimulator *device);
+/// Remove the device at address from the simulated I2C bus.
+void remove_i2c_device(uint8_t address);
+
+/** Deliver received MQTT payloads to the onMessage callback in fragments of at most size bytes.
+ *
+ * The ESP AsyncMqttClient does this for messages that don't arrive in one TCP segment. 0 (the default)
+ * delivers whole payloads.
+ */
+void set_mqtt_fragment_size(size_t size);
+
+/// Create a simulated data flash partition for the esp_partition API, size is rounded down to whole sectors.
+void add_flash_partition(const char *label, size_t size);
+/// How often sector of the partition with label was erased.
+uint32_t get_flash_erase_count(const char *label, size_t sector);
+
+} // namespace host
+
+#endif //ESPHOMELIB_HOST_PLATFORM_H
@@ -0,0 +1,197 @@
+#include "Arduino.h"
+#include "host_platform.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace host {
+
+/// Virtual time every millis()/micros()/yield() call costs, so that busy-wait loops terminate.
+static const uint64_t VIRTUAL_CALL_COST = 1;
+
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+static std::atomic<bool> virtual_clock{false};
+static std::atomic<uint64_t> virtual_time{0};
+static std::atomic<int64_t> real_time_offset{0};
+
+static uint64_t get_real_time() {
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void use_virtual_clock(bool use_virtual) {
+  const uint64_t now = get_time();
+  if (use_virtual)
+    virtual_time = now;
+  else
+    real_time_offset = int64_t(now) - int64_t(get_real_time());
+  virtual_clock = use_virtual;
+}
+bool is_virtual_clock() {
+  return virtual_clock;
+}
+void advance_time(uint64_t us) {
+  if (virtual_clock)
+    virtual_time += us;
+  else
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+uint64_t get_time() {
+  if (virtual_clock)
+    return virtual_time;
+  return get_real_time() + real_time_offset;
+}
+
+static uint64_t read_time() {
+  if (virtual_clock)
+    return virtual_time += VIRTUAL_CALL_COST;
+  return get_real_time() + real_time_offset;
+}
+
+struct Pin {
+  bool value{false};
+  bool driven{false}; ///< Whether set_pin() was called, pull-ups/pull-downs don't change the value then.
+  uint8_t mode{INPUT};
+  uint16_t analog_value{0};
+  int analog_output{0};
+  void (*isr)(){nullptr};
+  int isr_mode{0};
+};
+
+static Pin pins[256];
+
+/// Held while interrupts are disabled and while an interrupt handler runs.
+static std::recursive_mutex interrupt_lock;
+static thread_local int interrupt_lock_depth = 0;
+
+void set_pin(uint8_t pin, bool value) {
+  std::lock_guard<std::recursive_mutex> lock(interrupt_lock);
+  Pin &p = pins[pin];
+  const bool old_value = p.value;
+  p.value = value;
+  p.driven = true;
+  if (p.isr == nullptr || old_value == value)
+    return;
+  if ((p.isr_mode == RISING && value) || (p.isr_mode == FALLING && !value) || p.isr_mode == CHANGE)
+    p.isr();
+}
+bool get_pin(uint8_t pin) {
+  return pins[pin].value;
+}
+uint8_t get_pin_mode(uint8_t pin) {
+  return pins[pin].mode;
+}
+void set_analog_value(uint8_t pin, uint16_t value) {
+  pins[pin].analog_value = value;
+}
+int get_analog_output(uint8_t pin) {
+  return pins[pin].analog_output;
+}
+
+} // namespace host
+
+uint32_t millis() {
+  return uint32_t(host::read_time() / 1000);
+}
+uint32_t micros() {
+  return uint32_t(host::read_time());
+}
+void delay(uint32_t ms) {
+  host::advance_time(uint64_t(ms) * 1000);
+}
+void delayMicroseconds(uint32_t us) {
+  host::advance_time(us);
+}
+void yield() {
+  if (host::virtual_clock)
+    host::virtual_time += host::VIRTUAL_CALL_COST;
+  else
+    std::this_thread::yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  host::Pin &p = host::pins[pin];
+  p.mode = mode;
+  if (!p.driven && (mode & PULLUP) != 0 && (mode & OUTPUT) == 0)
+    p.value = true;
+  if (!p.driven && (mode & PULLDOWN) != 0)
+    p.value = false;
+}
+void digitalWrite(uint8_t pin, uint8_t val) {
+  host::pins[pin].value = val != LOW;
+}
+int digitalRead(uint8_t pin) {
+  return host::pins[pin].value ? HIGH : LOW;
+}
+uint16_t analogRead(uint8_t pin) {
+  return host::pins[pin].analog_value;
+}
+void analogWrite(uint8_t pin, int val) {
+  host::pins[pin].analog_output = val;
+}
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout) {
+  const uint32_t start = micros();
+  // wait for the previous pulse to end, then for the pulse to start.
+  while (digitalRead(pin) == state)
+    if (micros() - start >= timeout)
+      return 0;
+  while (digitalRead(pin) != state)
+    if (micros() - start >= timeout)
+      return 0;
+  const uint32_t pulse_start = micros();
+  while (digitalRead(pin) == state)
+    if (micros() - start >= timeout)
+      return 0;
+  return micros() - pulse_start;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  std::lock_guard<std::recursive_mutex> lock(host::interrupt_lock);
+  host::pins[pin].isr = isr;
+  host::pins[pin].isr_mode = mode;
+}
+void detachInterrupt(uint8_t pin) {
+  std::lock_guard<std::recursive_mutex> lock(host::interrupt_lock);
+  host::pins[pin].isr = nullptr;
+}
+void noInterrupts() {
+  if (host::interrupt_lock_depth++ == 0)
+    host::interrupt_lock.lock();
+}
+void interrupts() {
+  if (host::interrupt_lock_depth > 0 && --host::interrupt_lock_depth == 0)
+    host::interrupt_lock.unlock();
+}
+
+static std::mt19937 random_engine; // NOLINT
+
+long random(long max) {
+  if (max <= 0)
+    return 0;
+  return std::uniform_int_distribution<long>(0, max - 1)(random_engine);
+}
+long random(long min, long max) {
+  if (min >= max)
+    return min;
+  return min + random(max - min);
+}
+void randomSeed(unsigned long seed) {
+  random_engine.seed(seed);
+}
+uint32_t os_random() {
+  static std::random_device device;
+  return device();
+}
+
+double pow10(double x) {
+  return std::pow(10.0, x);
+}
+char *dtostrf(double number, signed char width, unsigned char prec, char *s) {
+  sprintf(s, "%*.*f", width, prec, number);
+  return s;
+}
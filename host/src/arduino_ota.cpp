@@ -0,0 +1,15 @@
+#include "ArduinoOTA.h"
+
+ArduinoOTAClass ArduinoOTA;
+
+void ArduinoOTAClass::setPort(uint16_t port) {}
+void ArduinoOTAClass::setHostname(const char *hostname) {}
+void ArduinoOTAClass::setPassword(const char *password) {}
+void ArduinoOTAClass::setPasswordHash(const char *password) {}
+void ArduinoOTAClass::onStart(THandlerFunction fn) {}
+void ArduinoOTAClass::onEnd(THandlerFunction fn) {}
+void ArduinoOTAClass::onError(THandlerFunction_Error fn) {}
+void ArduinoOTAClass::onProgress(THandlerFunction_Progress fn) {}
+void ArduinoOTAClass::begin() {}
+void ArduinoOTAClass::end() {}
+void ArduinoOTAClass::handle() {}
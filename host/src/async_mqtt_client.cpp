@@ -0,0 +1,423 @@
+#include "AsyncMqttClient.h"
+#include "host_platform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+enum PacketType : uint8_t {
+  CONNECT = 0x10,
+  CONNACK = 0x20,
+  PUBLISH = 0x30,
+  PUBACK = 0x40,
+  PUBREC = 0x50,
+  PUBREL = 0x62,
+  PUBCOMP = 0x70,
+  SUBSCRIBE = 0x82,
+  UNSUBSCRIBE = 0xA2,
+  PINGREQ = 0xC0,
+  DISCONNECT = 0xE0,
+};
+
+/// How long connecting the TCP socket may take, in ms.
+const int CONNECT_TIMEOUT = 10000;
+
+/// See host::set_mqtt_fragment_size(), 0 delivers whole payloads.
+std::atomic<size_t> fragment_size{0};
+
+uint32_t real_millis() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+}
+
+void put_uint16(std::vector<uint8_t> &body, uint16_t value) {
+  body.push_back(uint8_t(value >> 8));
+  body.push_back(uint8_t(value));
+}
+void put_string(std::vector<uint8_t> &body, const char *str, size_t len) {
+  put_uint16(body, uint16_t(len));
+  body.insert(body.end(), str, str + len);
+}
+void put_string(std::vector<uint8_t> &body, const std::string &str) {
+  put_string(body, str.data(), str.size());
+}
+uint16_t get_uint16(const std::vector<uint8_t> &body, size_t index) {
+  return uint16_t((body[index] << 8) | body[index + 1]);
+}
+
+bool read_exact(int fd, uint8_t *data, size_t len) {
+  while (len > 0) {
+    ssize_t ret = recv(fd, data, len, 0);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return false;
+    data += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+} // namespace
+
+namespace host {
+
+void set_mqtt_fragment_size(size_t size) {
+  fragment_size = size;
+}
+
+} // namespace host
+
+AsyncMqttClient::~AsyncMqttClient() {
+  this->disconnect(true);
+}
+
+AsyncMqttClient &AsyncMqttClient::setKeepAlive(uint16_t keep_alive) {
+  this->keep_alive_ = keep_alive;
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::setClientId(const char *client_id) {
+  this->client_id_ = client_id;
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::setCleanSession(bool clean_session) {
+  this->clean_session_ = clean_session;
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::setCredentials(const char *username, const char *password) {
+  this->has_credentials_ = username != nullptr && *username != '\0';
+  this->username_ = this->has_credentials_ ? username : "";
+  this->password_ = password != nullptr ? password : "";
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::setWill(const char *topic, uint8_t qos, bool retain,
+                                          const char *payload, size_t length) {
+  this->will_topic_ = topic;
+  this->will_qos_ = qos;
+  this->will_retain_ = retain;
+  if (payload == nullptr)
+    this->will_payload_.clear();
+  else
+    this->will_payload_.assign(payload, length != 0 ? length : strlen(payload));
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::setServer(const char *host, uint16_t port) {
+  const char *env_host = getenv("ESPHOMELIB_MQTT_HOST");
+  const char *env_port = getenv("ESPHOMELIB_MQTT_PORT");
+  this->host_ = env_host != nullptr ? env_host : host;
+  this->port_ = env_port != nullptr ? uint16_t(atoi(env_port)) : port;
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::onConnect(OnConnectUserCallback callback) {
+  this->on_connect_ = std::move(callback);
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::onDisconnect(OnDisconnectUserCallback callback) {
+  this->on_disconnect_ = std::move(callback);
+  return *this;
+}
+AsyncMqttClient &AsyncMqttClient::onMessage(OnMessageUserCallback callback) {
+  this->on_message_ = std::move(callback);
+  return *this;
+}
+
+bool AsyncMqttClient::connected() const {
+  return this->connected_;
+}
+void AsyncMqttClient::connect() {
+  this->disconnect(true);
+  this->thread_ = std::thread(&AsyncMqttClient::run_, this);
+}
+void AsyncMqttClient::disconnect(bool force) {
+  if (!this->thread_.joinable())
+    return;
+  if (!force && this->connected_)
+    this->send_packet_(DISCONNECT, {});
+  this->stop_ = true;
+  {
+    // wake up the network thread if it's blocked in recv()
+    std::lock_guard<std::mutex> lock(this->write_lock_);
+    if (this->socket_ >= 0)
+      shutdown(this->socket_, SHUT_RDWR);
+  }
+  this->thread_.join();
+  this->stop_ = false;
+}
+uint16_t AsyncMqttClient::subscribe(const char *topic, uint8_t qos) {
+  if (!this->connected_)
+    return 0;
+  const uint16_t packet_id = this->next_packet_id_();
+  std::vector<uint8_t> body;
+  put_uint16(body, packet_id);
+  put_string(body, topic, strlen(topic));
+  body.push_back(qos);
+  return this->send_packet_(SUBSCRIBE, body) ? packet_id : uint16_t(0);
+}
+uint16_t AsyncMqttClient::unsubscribe(const char *topic) {
+  if (!this->connected_)
+    return 0;
+  const uint16_t packet_id = this->next_packet_id_();
+  std::vector<uint8_t> body;
+  put_uint16(body, packet_id);
+  put_string(body, topic, strlen(topic));
+  return this->send_packet_(UNSUBSCRIBE, body) ? packet_id : uint16_t(0);
+}
+uint16_t AsyncMqttClient::publish(const char *topic, uint8_t qos, bool retain,
+                                  const char *payload, size_t length, bool dup, uint16_t message_id) {
+  if (!this->connected_)
+    return 0;
+  if (payload != nullptr && length == 0)
+    length = strlen(payload);
+  uint16_t packet_id = 1;
+  std::vector<uint8_t> body;
+  body.reserve(2 + strlen(topic) + 2 + length);
+  put_string(body, topic, strlen(topic));
+  if (qos > 0) {
+    packet_id = message_id != 0 ? message_id : this->next_packet_id_();
+    put_uint16(body, packet_id);
+  }
+  if (payload != nullptr)
+    body.insert(body.end(), payload, payload + length);
+  const uint8_t header = PUBLISH | (dup ? 0x08 : 0x00) | ((qos & 0x03) << 1) | (retain ? 0x01 : 0x00);
+  return this->send_packet_(header, body) ? packet_id : uint16_t(0);
+}
+
+void AsyncMqttClient::run_() {
+  if (!this->connect_socket_()) {
+    if (this->on_disconnect_)
+      this->on_disconnect_(AsyncMqttClientDisconnectReason::TCP_DISCONNECTED);
+    return;
+  }
+
+  std::vector<uint8_t> body;
+  uint8_t flags = this->clean_session_ ? 0x02 : 0x00;
+  if (!this->will_topic_.empty())
+    flags |= 0x04 | ((this->will_qos_ & 0x03) << 3) | (this->will_retain_ ? 0x20 : 0x00);
+  if (this->has_credentials_)
+    flags |= 0x80 | (this->password_.empty() ? 0x00 : 0x40);
+  put_string(body, "MQTT", 4);
+  body.push_back(4); // protocol level 3.1.1
+  body.push_back(flags);
+  put_uint16(body, this->keep_alive_);
+  put_string(body, this->client_id_);
+  if (!this->will_topic_.empty()) {
+    put_string(body, this->will_topic_);
+    put_string(body, this->will_payload_);
+  }
+  if (this->has_credentials_) {
+    put_string(body, this->username_);
+    if (!this->password_.empty())
+      put_string(body, this->password_);
+  }
+  this->send_packet_(CONNECT, body);
+
+  while (!this->stop_) {
+    struct pollfd fd{.fd = this->socket_, .events = POLLIN, .revents = 0};
+    // wake up at least every second for the keep alive pings
+    int ret = poll(&fd, 1, 1000);
+    if (ret < 0 && errno != EINTR)
+      break;
+    if (ret > 0) {
+      uint8_t header;
+      if (!this->receive_packet_(header, body))
+        break;
+      this->handle_packet_(header, body);
+    }
+    const uint32_t keep_alive_ms = this->keep_alive_ * 1000u;
+    if (this->connected_ && keep_alive_ms != 0 && real_millis() - this->last_write_ >= keep_alive_ms / 2)
+      this->send_packet_(PINGREQ, {});
+  }
+  this->close_(AsyncMqttClientDisconnectReason::TCP_DISCONNECTED);
+}
+bool AsyncMqttClient::connect_socket_() {
+  struct addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *addresses;
+  const std::string port = std::to_string(this->port_);
+  if (getaddrinfo(this->host_.c_str(), port.c_str(), &hints, &addresses) != 0)
+    return false;
+
+  int fd = -1;
+  for (struct addrinfo *address = addresses; address != nullptr && fd < 0 && !this->stop_;
+       address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0)
+      continue;
+    // connect without blocking so that disconnect() doesn't have to wait for the connect timeout.
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    bool success = ::connect(fd, address->ai_addr, address->ai_addrlen) == 0;
+    if (!success && errno == EINPROGRESS) {
+      const uint32_t start = real_millis();
+      while (!this->stop_ && real_millis() - start < CONNECT_TIMEOUT) {
+        struct pollfd pfd{.fd = fd, .events = POLLOUT, .revents = 0};
+        if (poll(&pfd, 1, 100) > 0) {
+          int error = 0;
+          socklen_t len = sizeof(error);
+          getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+          success = error == 0;
+          break;
+        }
+      }
+    }
+    if (!success) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0)
+    return false;
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  std::lock_guard<std::mutex> lock(this->write_lock_);
+  this->socket_ = fd;
+  return true;
+}
+bool AsyncMqttClient::send_packet_(uint8_t header, const std::vector<uint8_t> &body) {
+  std::vector<uint8_t> packet;
+  packet.reserve(body.size() + 5);
+  packet.push_back(header);
+  size_t remaining = body.size();
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    if (remaining > 0)
+      digit |= 0x80;
+    packet.push_back(digit);
+  } while (remaining > 0);
+  packet.insert(packet.end(), body.begin(), body.end());
+
+  std::lock_guard<std::mutex> lock(this->write_lock_);
+  if (this->socket_ < 0)
+    return false;
+  size_t sent = 0;
+  while (sent < packet.size()) {
+    ssize_t ret = send(this->socket_, packet.data() + sent, packet.size() - sent, MSG_NOSIGNAL);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return false;
+    sent += ret;
+  }
+  this->last_write_ = real_millis();
+  return true;
+}
+bool AsyncMqttClient::receive_packet_(uint8_t &header, std::vector<uint8_t> &body) {
+  if (!read_exact(this->socket_, &header, 1))
+    return false;
+  size_t length = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t digit;
+    if (!read_exact(this->socket_, &digit, 1))
+      return false;
+    length |= size_t(digit & 0x7F) << (7 * i);
+    if ((digit & 0x80) == 0)
+      break;
+  }
+  body.resize(length);
+  return length == 0 || read_exact(this->socket_, body.data(), length);
+}
+void AsyncMqttClient::handle_packet_(uint8_t header, const std::vector<uint8_t> &body) {
+  switch (header & 0xF0) {
+    case CONNACK: {
+      if (body.size() < 2)
+        return;
+      if (body[1] != 0) {
+        // return codes 1-5 are the same as the disconnect reasons.
+        this->close_(AsyncMqttClientDisconnectReason(body[1]));
+        this->stop_ = true;
+        return;
+      }
+      this->connected_ = true;
+      if (this->on_connect_)
+        this->on_connect_((body[0] & 0x01) != 0);
+      break;
+    }
+    case PUBLISH: {
+      const uint8_t qos = (header >> 1) & 0x03;
+      if (body.size() < 2)
+        return;
+      size_t index = 2 + get_uint16(body, 0);
+      if (index > body.size())
+        return;
+      std::string topic(body.begin() + 2, body.begin() + index);
+      uint16_t packet_id = 0;
+      if (qos > 0) {
+        if (index + 2 > body.size())
+          return;
+        packet_id = get_uint16(body, index);
+        index += 2;
+      }
+      std::string payload(body.begin() + index, body.end());
+      if (this->on_message_) {
+        AsyncMqttClientMessageProperties properties{
+            .qos = qos,
+            .dup = (header & 0x08) != 0,
+            .retain = (header & 0x01) != 0,
+        };
+        const size_t fragment = fragment_size != 0 ? size_t(fragment_size) : payload.size();
+        size_t offset = 0;
+        do {
+          const size_t len = std::min(fragment, payload.size() - offset);
+          this->on_message_(&topic[0], &payload[offset], properties, len, offset, payload.size());
+          offset += len;
+        } while (offset < payload.size());
+      }
+      if (qos > 0) {
+        std::vector<uint8_t> ack;
+        put_uint16(ack, packet_id);
+        this->send_packet_(qos == 1 ? PUBACK : PUBREC, ack);
+      }
+      break;
+    }
+    case PUBREC & 0xF0: {
+      // second step of an outgoing QoS 2 publish
+      if (body.size() >= 2)
+        this->send_packet_(PUBREL, {body[0], body[1]});
+      break;
+    }
+    case PUBREL & 0xF0: {
+      // last step of an incoming QoS 2 publish
+      if (body.size() >= 2)
+        this->send_packet_(PUBCOMP, {body[0], body[1]});
+      break;
+    }
+    default:
+      // PUBACK, PUBCOMP, SUBACK, UNSUBACK, PINGRESP; nothing is tracked.
+      break;
+  }
+}
+void AsyncMqttClient::close_(AsyncMqttClientDisconnectReason reason) {
+  {
+    std::lock_guard<std::mutex> lock(this->write_lock_);
+    if (this->socket_ < 0)
+      return;
+    ::close(this->socket_);
+    this->socket_ = -1;
+  }
+  this->connected_ = false;
+  if (this->on_disconnect_)
+    this->on_disconnect_(reason);
+}
+uint16_t AsyncMqttClient::next_packet_id_() {
+  uint16_t packet_id = ++this->packet_id_;
+  if (packet_id == 0)
+    // 0 isn't a valid packet id
+    packet_id = ++this->packet_id_;
+  return packet_id;
+}
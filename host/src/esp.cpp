@@ -0,0 +1,46 @@
+#include "Esp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+EspClass ESP;
+
+static char **restart_argv = nullptr;
+
+void host_set_restart_args(int argc, char **argv) {
+  restart_argv = argv;
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  if (restart_argv != nullptr)
+    execv("/proc/self/exe", restart_argv);
+  // exec failed, there's nothing left to do.
+  exit(1);
+}
+void EspClass::deepSleep(uint64_t time_us) {
+  fflush(stdout);
+  exit(0);
+}
+uint32_t EspClass::getCycleCount() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+  return uint32_t(ns * this->getCpuFreqMHz() / 1000);
+}
+uint32_t EspClass::getCpuFreqMHz() {
+  return 240;
+}
+uint32_t EspClass::getFreeHeap() {
+  return 0;
+}
+uint32_t EspClass::getFlashChipSize() {
+  return 0;
+}
+uint32_t EspClass::getFlashChipSpeed() {
+  return 0;
+}
+FlashMode_t EspClass::getFlashChipMode() {
+  return FM_UNKNOWN;
+}
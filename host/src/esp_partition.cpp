@@ -0,0 +1,103 @@
+#include "esp_partition.h"
+#include "host_platform.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SimulatedPartition {
+  esp_partition_t partition;
+  std::vector<uint8_t> data;
+  std::vector<uint32_t> erase_counts; ///< per sector
+};
+
+std::map<std::string, std::unique_ptr<SimulatedPartition>> &get_partitions() {
+  static std::map<std::string, std::unique_ptr<SimulatedPartition>> partitions;
+  return partitions;
+}
+
+SimulatedPartition *find(const esp_partition_t *partition) {
+  if (partition == nullptr)
+    return nullptr;
+  auto it = get_partitions().find(partition->label);
+  return it == get_partitions().end() ? nullptr : it->second.get();
+}
+
+} // namespace
+
+namespace host {
+
+void add_flash_partition(const char *label, size_t size) {
+  std::unique_ptr<SimulatedPartition> simulated(new SimulatedPartition());
+  simulated->partition.type = ESP_PARTITION_TYPE_DATA;
+  simulated->partition.subtype = esp_partition_subtype_t(0x40);
+  simulated->partition.address = 0;
+  simulated->partition.size = uint32_t(size - size % SPI_FLASH_SEC_SIZE);
+  strncpy(simulated->partition.label, label, sizeof(simulated->partition.label) - 1);
+  simulated->partition.encrypted = false;
+  // fresh chips aren't necessarily erased, start with garbage.
+  simulated->data.resize(simulated->partition.size);
+  for (size_t i = 0; i < simulated->data.size(); i++)
+    simulated->data[i] = uint8_t(i * 37 + 11);
+  simulated->erase_counts.resize(simulated->partition.size / SPI_FLASH_SEC_SIZE);
+  get_partitions()[label] = std::move(simulated);
+}
+uint32_t get_flash_erase_count(const char *label, size_t sector) {
+  auto it = get_partitions().find(label);
+  if (it == get_partitions().end() || sector >= it->second->erase_counts.size())
+    return 0;
+  return it->second->erase_counts[sector];
+}
+
+} // namespace host
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+  for (auto &it : get_partitions()) {
+    const esp_partition_t &partition = it.second->partition;
+    if (partition.type != type)
+      continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && partition.subtype != subtype)
+      continue;
+    if (label != nullptr && it.first != label)
+      continue;
+    return &partition;
+  }
+  return nullptr;
+}
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+  SimulatedPartition *simulated = find(partition);
+  if (simulated == nullptr)
+    return ESP_ERR_INVALID_ARG;
+  if (src_offset + size > simulated->data.size())
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, &simulated->data[src_offset], size);
+  return ESP_OK;
+}
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+  SimulatedPartition *simulated = find(partition);
+  if (simulated == nullptr)
+    return ESP_ERR_INVALID_ARG;
+  if (dst_offset + size > simulated->data.size())
+    return ESP_ERR_INVALID_SIZE;
+  auto *bytes = reinterpret_cast<const uint8_t *>(src);
+  for (size_t i = 0; i < size; i++)
+    simulated->data[dst_offset + i] &= bytes[i];
+  return ESP_OK;
+}
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t start_addr, size_t size) {
+  SimulatedPartition *simulated = find(partition);
+  if (simulated == nullptr)
+    return ESP_ERR_INVALID_ARG;
+  if (start_addr % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0 ||
+      start_addr + size > simulated->data.size())
+    return ESP_ERR_INVALID_SIZE;
+  memset(&simulated->data[start_addr], 0xFF, size);
+  for (size_t sector = start_addr / SPI_FLASH_SEC_SIZE; sector < (start_addr + size) / SPI_FLASH_SEC_SIZE; sector++)
+    simulated->erase_counts[sector]++;
+  return ESP_OK;
+}
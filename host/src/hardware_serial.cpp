@@ -0,0 +1,31 @@
+#include "HardwareSerial.h"
+
+#include <cstdio>
+#include <cstring>
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) {
+  // the baud rate doesn't matter for stdout.
+}
+void HardwareSerial::end() {
+  fflush(stdout);
+}
+size_t HardwareSerial::write(uint8_t c) {
+  return fputc(c, stdout) == EOF ? 0 : 1;
+}
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+size_t HardwareSerial::print(const char *str) {
+  return fwrite(str, 1, strlen(str), stdout);
+}
+size_t HardwareSerial::println(const char *str) {
+  return this->print(str) + this->println();
+}
+size_t HardwareSerial::println() {
+  return this->write('\n');
+}
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
@@ -0,0 +1,33 @@
+#include "IPAddress.h"
+
+#include <cstdio>
+
+IPAddress::IPAddress() : octets_{0, 0, 0, 0} {}
+IPAddress::IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet)
+    : octets_{first_octet, second_octet, third_octet, fourth_octet} {}
+IPAddress::IPAddress(uint32_t address) {
+  // network byte order in memory, like the Arduino class.
+  for (int i = 0; i < 4; i++)
+    this->octets_[i] = uint8_t(address >> (8 * i));
+}
+IPAddress::operator uint32_t() const {
+  uint32_t address = 0;
+  for (int i = 0; i < 4; i++)
+    address |= uint32_t(this->octets_[i]) << (8 * i);
+  return address;
+}
+bool IPAddress::operator==(const IPAddress &other) const {
+  return uint32_t(*this) == uint32_t(other);
+}
+uint8_t IPAddress::operator[](int index) const {
+  return this->octets_[index];
+}
+uint8_t &IPAddress::operator[](int index) {
+  return this->octets_[index];
+}
+String IPAddress::toString() const {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", this->octets_[0], this->octets_[1], this->octets_[2],
+           this->octets_[3]);
+  return String(buffer);
+}
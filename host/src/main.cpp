@@ -0,0 +1,18 @@
+#include "Arduino.h"
+#include "host_platform.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// Runs the sketch like the Arduino cores do.
+int main(int argc, char **argv) {
+  host_set_restart_args(argc, argv);
+  // flush every log line, also when stdout isn't a terminal.
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if (getenv("ESPHOMELIB_VIRTUAL_CLOCK") != nullptr)
+    host::use_virtual_clock(true);
+
+  setup();
+  while (true)
+    loop();
+}
@@ -0,0 +1,60 @@
+#include "Preferences.h"
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+/// namespace -> key -> raw value
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> &get_storage() {
+  static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> storage;
+  return storage;
+}
+
+bool Preferences::begin(const char *name, bool read_only) {
+  this->name_ = name;
+  this->read_only_ = read_only;
+  return true;
+}
+void Preferences::end() {
+  this->name_.clear();
+}
+size_t Preferences::put_(const char *key, const void *value, size_t len) {
+  if (this->name_.empty() || this->read_only_)
+    return 0;
+  auto *data = reinterpret_cast<const uint8_t *>(value);
+  get_storage()[this->name_][key] = std::vector<uint8_t>(data, data + len);
+  return len;
+}
+bool Preferences::get_(const char *key, void *value, size_t len) {
+  auto ns = get_storage().find(this->name_);
+  if (ns == get_storage().end())
+    return false;
+  auto it = ns->second.find(key);
+  if (it == ns->second.end() || it->second.size() != len)
+    return false;
+  memcpy(value, it->second.data(), len);
+  return true;
+}
+
+#define HOST_PREFERENCES_TYPE(put_name, get_name, type) \
+  size_t Preferences::put_name(const char *key, type value) { \
+    return this->put_(key, &value, sizeof(value)); \
+  } \
+  type Preferences::get_name(const char *key, type default_value) { \
+    type value; \
+    if (!this->get_(key, &value, sizeof(value))) \
+      return default_value; \
+    return value; \
+  }
+
+HOST_PREFERENCES_TYPE(putChar, getChar, int8_t)
+HOST_PREFERENCES_TYPE(putUChar, getUChar, uint8_t)
+HOST_PREFERENCES_TYPE(putShort, getShort, int16_t)
+HOST_PREFERENCES_TYPE(putUShort, getUShort, uint16_t)
+HOST_PREFERENCES_TYPE(putInt, getInt, int32_t)
+HOST_PREFERENCES_TYPE(putUInt, getUInt, uint32_t)
+HOST_PREFERENCES_TYPE(putLong64, getLong64, int64_t)
+HOST_PREFERENCES_TYPE(putULong64, getULong64, uint64_t)
+HOST_PREFERENCES_TYPE(putFloat, getFloat, float)
+HOST_PREFERENCES_TYPE(putDouble, getDouble, double)
+HOST_PREFERENCES_TYPE(putBool, getBool, bool)
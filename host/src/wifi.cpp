@@ -0,0 +1,105 @@
+#include "WiFi.h"
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+/// The address (or netmask) of the first IPv4 interface that's up and not the loopback interface.
+static IPAddress get_interface_address(bool netmask) {
+  IPAddress result(127, 0, 0, 1);
+  if (netmask)
+    result = IPAddress(255, 0, 0, 0);
+  struct ifaddrs *interfaces;
+  if (getifaddrs(&interfaces) != 0)
+    return result;
+  for (struct ifaddrs *ifa = interfaces; ifa != nullptr; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr == nullptr || ifa->ifa_addr->sa_family != AF_INET)
+      continue;
+    if ((ifa->ifa_flags & IFF_UP) == 0 || (ifa->ifa_flags & IFF_LOOPBACK) != 0)
+      continue;
+    const sockaddr *address = netmask ? ifa->ifa_netmask : ifa->ifa_addr;
+    if (address == nullptr)
+      continue;
+    // s_addr is in network byte order, which is the byte order of IPAddress too.
+    result = IPAddress(uint32_t(reinterpret_cast<const sockaddr_in *>(address)->sin_addr.s_addr));
+    break;
+  }
+  freeifaddrs(interfaces);
+  return result;
+}
+
+bool WiFiClass::mode(WiFiMode_t mode) {
+  return true;
+}
+void WiFiClass::persistent(bool persistent) {}
+bool WiFiClass::enableSTA(bool enable) {
+  return true;
+}
+bool WiFiClass::enableAP(bool enable) {
+  return true;
+}
+bool WiFiClass::setAutoConnect(bool auto_connect) {
+  return true;
+}
+bool WiFiClass::setAutoReconnect(bool auto_reconnect) {
+  return true;
+}
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+  // the addresses of the host are used.
+  return true;
+}
+bool WiFiClass::hostname(const char *hostname) {
+  return true;
+}
+bool WiFiClass::setHostname(const char *hostname) {
+  return true;
+}
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase) {
+  return WL_CONNECTED;
+}
+wl_status_t WiFiClass::status() {
+  return WL_CONNECTED;
+}
+bool WiFiClass::softAP(const char *ssid, const char *passphrase, int channel) {
+  return true;
+}
+bool WiFiClass::softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet) {
+  return true;
+}
+bool WiFiClass::softAPsetHostname(const char *hostname) {
+  return true;
+}
+IPAddress WiFiClass::softAPIP() {
+  return this->localIP();
+}
+IPAddress WiFiClass::localIP() {
+  return get_interface_address(false);
+}
+IPAddress WiFiClass::subnetMask() {
+  return get_interface_address(true);
+}
+IPAddress WiFiClass::gatewayIP() {
+  return IPAddress();
+}
+IPAddress WiFiClass::dnsIP(uint8_t dns_no) {
+  return IPAddress();
+}
+uint8_t *WiFiClass::macAddress(uint8_t *mac) {
+  char hostname[256] = "";
+  gethostname(hostname, sizeof(hostname) - 1);
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (const char *c = hostname; *c != '\0'; c++) {
+    hash ^= uint8_t(*c);
+    hash *= 16777619UL;
+  }
+  mac[0] = 0x02; // locally administered, unicast
+  mac[1] = 0x00;
+  for (int i = 0; i < 4; i++)
+    mac[2 + i] = uint8_t(hash >> (8 * i));
+  return mac;
+}
@@ -0,0 +1,91 @@
+#include "Wire.h"
+#include "host_platform.h"
+
+#include <map>
+
+TwoWire Wire(0);
+
+static std::map<uint8_t, host::I2CDeviceSimulator *> &get_i2c_devices() {
+  static std::map<uint8_t, host::I2CDeviceSimulator *> devices;
+  return devices;
+}
+static host::I2CDeviceSimulator *get_i2c_device(uint8_t address) {
+  auto it = get_i2c_devices().find(address);
+  if (it == get_i2c_devices().end())
+    return nullptr;
+  return it->second;
+}
+
+namespace host {
+
+void add_i2c_device(uint8_t address, I2CDeviceSimulator *device) {
+  get_i2c_devices()[address] = device;
+}
+void remove_i2c_device(uint8_t address) {
+  get_i2c_devices().erase(address);
+}
+
+bool I2CRegisterDevice::write(const uint8_t *data, size_t len) {
+  if (len == 0)
+    return true;
+  this->pointer_ = data[0];
+  for (size_t i = 1; i < len; i++)
+    this->registers_[this->pointer_++] = data[i];
+  return true;
+}
+size_t I2CRegisterDevice::read(uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    data[i] = this->registers_[this->pointer_++];
+  return len;
+}
+void I2CRegisterDevice::set_register(uint8_t a_register, uint8_t value) {
+  this->registers_[a_register] = value;
+}
+uint8_t I2CRegisterDevice::get_register(uint8_t a_register) const {
+  return this->registers_[a_register];
+}
+
+} // namespace host
+
+TwoWire::TwoWire(uint8_t bus_num) : bus_num_(bus_num) {}
+
+void TwoWire::begin(int sda, int scl, uint32_t frequency) {}
+void TwoWire::setClock(uint32_t frequency) {}
+void TwoWire::beginTransmission(uint8_t address) {
+  this->tx_address_ = address;
+  this->tx_buffer_.clear();
+}
+uint8_t TwoWire::endTransmission(bool send_stop) {
+  host::I2CDeviceSimulator *device = get_i2c_device(this->tx_address_);
+  if (device == nullptr)
+    return 2;
+  if (!device->write(this->tx_buffer_.data(), this->tx_buffer_.size()))
+    return 3;
+  return 0;
+}
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool send_stop) {
+  this->rx_buffer_.clear();
+  this->rx_index_ = 0;
+  host::I2CDeviceSimulator *device = get_i2c_device(address);
+  if (device == nullptr)
+    return 0;
+  this->rx_buffer_.resize(quantity);
+  this->rx_buffer_.resize(device->read(this->rx_buffer_.data(), quantity));
+  return uint8_t(this->rx_buffer_.size());
+}
+size_t TwoWire::write(uint8_t data) {
+  this->tx_buffer_.push_back(data);
+  return 1;
+}
+size_t TwoWire::write(const uint8_t *data, size_t quantity) {
+  this->tx_buffer_.insert(this->tx_buffer_.end(), data, data + quantity);
+  return quantity;
+}
+int TwoWire::available() {
+  return int(this->rx_buffer_.size() - this->rx_index_);
+}
+int TwoWire::read() {
+  if (this->rx_index_ >= this->rx_buffer_.size())
+    return -1;
+  return this->rx_buffer_[this->rx_index_++];
+}
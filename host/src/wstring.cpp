@@ -0,0 +1,10 @@
+#include "WString.h"
+
+#include <cstdlib>
+
+float String::toFloat() const {
+  return strtof(this->c_str(), nullptr);
+}
+long String::toInt() const {
+  return strtol(this->c_str(), nullptr, 10);
+}
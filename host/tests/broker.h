@@ -0,0 +1,185 @@
+#ifndef ESPHOMELIB_HOST_TESTS_BROKER_H
+#define ESPHOMELIB_HOST_TESTS_BROKER_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+/// A message the client published to the TestBroker.
+struct TestBrokerMessage {
+  std::string topic;
+  std::string payload;
+  bool retain;
+};
+
+/** A minimal MQTT broker for the host tests, on a free port of the loopback interface.
+ *
+ * It accepts the connections of one client after another, records the messages the client publishes and can send
+ * messages to the client with send(). Subscriptions aren't tracked, everything that's sent goes to the client.
+ */
+class TestBroker {
+ public:
+  /// Start listening and accepting in a background thread, returns the port.
+  uint16_t start() {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(fd >= 0);
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    TEST_ASSERT(bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0);
+    TEST_ASSERT(listen(fd, 4) == 0);
+    socklen_t len = sizeof(address);
+    TEST_ASSERT(getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &len) == 0);
+    std::thread(&TestBroker::run_, this, fd).detach();
+    return ntohs(address.sin_port);
+  }
+
+  /// The messages published by the client so far, in the order they arrived.
+  std::vector<TestBrokerMessage> get_published() {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    return this->published_;
+  }
+  size_t get_published_count() {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    return this->published_.size();
+  }
+  void clear_published() {
+    std::lock_guard<std::mutex> lock(this->lock_);
+    this->published_.clear();
+  }
+
+  /// Send a QoS 0 message to the connected client.
+  void send(const std::string &topic, const std::string &payload) {
+    std::vector<uint8_t> packet{0x30};
+    size_t remaining = 2 + topic.size() + payload.size();
+    do {
+      uint8_t digit = remaining % 128;
+      remaining /= 128;
+      if (remaining > 0)
+        digit |= 0x80;
+      packet.push_back(digit);
+    } while (remaining > 0);
+    packet.push_back(uint8_t(topic.size() >> 8));
+    packet.push_back(uint8_t(topic.size()));
+    packet.insert(packet.end(), topic.begin(), topic.end());
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    TEST_ASSERT(this->write_(packet.data(), packet.size()));
+  }
+
+ protected:
+  void run_(int listen_fd) {
+    while (true) {
+      const int fd = accept(listen_fd, nullptr, nullptr);
+      if (fd < 0)
+        continue;
+      this->client_ = fd;
+      this->handle_client_(fd);
+      this->client_ = -1;
+      close(fd);
+    }
+  }
+
+  void handle_client_(int fd) {
+    uint8_t header;
+    std::vector<uint8_t> body;
+    while (read_packet_(fd, header, body)) {
+      switch (header & 0xF0) {
+        case 0x10: {
+          // CONNECT, answered with CONNACK "accepted"
+          const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+          this->write_(connack, sizeof(connack));
+          break;
+        }
+        case 0x30: {
+          const uint8_t qos = (header >> 1) & 0x03;
+          size_t index = 2 + ((body[0] << 8) | body[1]);
+          TestBrokerMessage message;
+          message.topic.assign(body.begin() + 2, body.begin() + index);
+          if (qos > 0) {
+            const uint8_t ack[] = {uint8_t(qos == 1 ? 0x40 : 0x50), 0x02, body[index], body[index + 1]};
+            this->write_(ack, sizeof(ack));
+            index += 2;
+          }
+          message.payload.assign(body.begin() + index, body.end());
+          message.retain = (header & 0x01) != 0;
+          std::lock_guard<std::mutex> lock(this->lock_);
+          this->published_.push_back(std::move(message));
+          break;
+        }
+        case 0x80: {
+          // SUBSCRIBE, every filter is granted QoS 0
+          const uint8_t suback[] = {0x90, 0x03, body[0], body[1], 0x00};
+          this->write_(suback, sizeof(suback));
+          break;
+        }
+        case 0xC0: {
+          const uint8_t pingresp[] = {0xD0, 0x00};
+          this->write_(pingresp, sizeof(pingresp));
+          break;
+        }
+        default:
+          break;
+      }
+    }
+  }
+
+  static bool read_exact_(int fd, uint8_t *data, size_t len) {
+    while (len > 0) {
+      const ssize_t ret = recv(fd, data, len, 0);
+      if (ret <= 0)
+        return false;
+      data += ret;
+      len -= ret;
+    }
+    return true;
+  }
+
+  static bool read_packet_(int fd, uint8_t &header, std::vector<uint8_t> &body) {
+    if (!read_exact_(fd, &header, 1))
+      return false;
+    size_t length = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+      uint8_t digit;
+      if (!read_exact_(fd, &digit, 1))
+        return false;
+      length |= size_t(digit & 0x7F) << (7 * i);
+      if ((digit & 0x80) == 0)
+        break;
+    }
+    body.resize(length);
+    return length == 0 || read_exact_(fd, body.data(), length);
+  }
+
+  bool write_(const uint8_t *data, size_t len) {
+    std::lock_guard<std::mutex> lock(this->write_lock_);
+    const int fd = this->client_;
+    if (fd < 0)
+      return false;
+    while (len > 0) {
+      const ssize_t ret = ::send(fd, data, len, MSG_NOSIGNAL);
+      if (ret <= 0)
+        return false;
+      data += ret;
+      len -= ret;
+    }
+    return true;
+  }
+
+  std::atomic<int> client_{-1};
+  std::mutex write_lock_;
+  std::mutex lock_;
+  std::vector<TestBrokerMessage> published_;
+};
+
+#endif //ESPHOMELIB_HOST_TESTS_BROKER_H
@@ -0,0 +1,44 @@
+#ifndef ESPHOMELIB_HOST_TESTS_TEST_H
+#define ESPHOMELIB_HOST_TESTS_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+
+/** Assertions for the host tests.
+ *
+ * Each test is a program with its own main() (instead of the setup()/loop() one from host/src/main.cpp)
+ * that runs its test cases and exits with status 1 on the first failed assertion, see host/CMakeLists.txt.
+ */
+
+/// Fail the test if condition is false.
+#define TEST_ASSERT(condition) \
+  do { \
+    if (!(condition)) \
+      test_fail(__FILE__, __LINE__, #condition); \
+  } while (false)
+
+/// Fail the test if the numbers a and b differ by more than epsilon.
+#define TEST_ASSERT_NEAR(a, b, epsilon) \
+  do { \
+    const double test_a = (a), test_b = (b); \
+    if (!(test_a - test_b <= (epsilon) && test_b - test_a <= (epsilon))) { \
+      fprintf(stderr, "%s = %f, %s = %f\n", #a, test_a, #b, test_b); \
+      test_fail(__FILE__, __LINE__, #a " near " #b); \
+    } \
+  } while (false)
+
+/// Print the failed assertion and exit right away, without destructors (loop threads might still be running).
+[[noreturn]] inline void test_fail(const char *file, int line, const char *condition) {
+  fprintf(stderr, "%s:%d: assertion failed: %s\n", file, line, condition);
+  fflush(stdout);
+  _Exit(1);
+}
+
+/// Exit successfully, like test_fail() without destructors.
+[[noreturn]] inline void test_pass() {
+  printf("All tests passed.\n");
+  fflush(stdout);
+  _Exit(0);
+}
+
+#endif //ESPHOMELIB_HOST_TESTS_TEST_H
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+static const uint32_t MIN_INTERVAL = 50;
+static const uint32_t MAX_INTERVAL = 800;
+static const float THRESHOLD = 0.5f;
+
+/// When the signal starts and stops changing, relative to the start of the test.
+static const uint32_t RAMP_START = 6000;
+static const uint32_t RAMP_END = 8000;
+
+/// A sensor measuring 20 until RAMP_START, then a ramp of 1.0 per 50ms until RAMP_END, then 60 again.
+class RampSensor : public sensor::PollingSensorComponent {
+ public:
+  explicit RampSensor(uint32_t start) : PollingSensorComponent("Ramp", 60000), start_(start) {}
+
+  void update() override {
+    const uint32_t time = millis() - this->start_;
+    this->update_times.push_back(time);
+    float value = 20.0f;
+    if (time >= RAMP_END)
+      value = 60.0f;
+    else if (time >= RAMP_START)
+      value = 20.0f + (time - RAMP_START) * 0.02f;
+    this->push_new_value(value);
+  }
+
+  std::vector<uint32_t> update_times;
+
+ protected:
+  uint32_t start_;
+};
+
+/// The time between update i - 1 and i.
+static uint32_t gap(const std::vector<uint32_t> &times, size_t i) {
+  return times[i] - times[i - 1];
+}
+
+/** The interval backs off from the minimum to the maximum while the value is stable, drops to the minimum
+ * with the first changed value, stays there while the value changes and backs off again once it's stable.
+ */
+static void test_ramp() {
+  auto *sensor = App.register_component(new RampSensor(millis()));
+  sensor->clear_filters();
+  sensor->set_adaptive_update_interval(MIN_INTERVAL, MAX_INTERVAL, THRESHOLD);
+  std::vector<uint32_t> changes;
+  auto *c = &changes;
+  sensor->add_on_update_interval_change_callback([c](uint32_t update_interval) { c->push_back(update_interval); });
+  App.setup();
+
+  const uint32_t start = millis();
+  while (millis() - start < 14000)
+    App.loop();
+
+  const std::vector<uint32_t> &times = sensor->update_times;
+  // the first value counts as a change, afterwards the interval doubles with each stable update
+  const uint32_t back_off[] = {MIN_INTERVAL, MIN_INTERVAL, 100, 200, 400, MAX_INTERVAL};
+  size_t i = 1;
+  for (uint32_t expected : back_off)
+    TEST_ASSERT_NEAR(gap(times, i++), expected, 2);
+  for (; times[i] < RAMP_START; i++)
+    TEST_ASSERT_NEAR(gap(times, i), MAX_INTERVAL, 2);
+
+  // the first changed value is noticed by the next regular update, the next one follows after the minimum
+  TEST_ASSERT(times[i] - RAMP_START <= MAX_INTERVAL + 2);
+  for (i++; times[i] < RAMP_END; i++)
+    TEST_ASSERT_NEAR(gap(times, i), MIN_INTERVAL, 2);
+
+  // the first update after the ramp still sees a change, then it backs off again
+  TEST_ASSERT_NEAR(gap(times, i), MIN_INTERVAL, 2);
+  i++;
+  for (uint32_t expected : back_off)
+    TEST_ASSERT_NEAR(gap(times, i++), expected, 2);
+  for (; i < times.size(); i++)
+    TEST_ASSERT_NEAR(gap(times, i), MAX_INTERVAL, 2);
+
+  // the sensor front-ends (for example the MQTT expire_after) see each change of the interval
+  const std::vector<uint32_t> expected_changes = {100, 200, 400, MAX_INTERVAL, MIN_INTERVAL, 100, 200, 400,
+                                                  MAX_INTERVAL};
+  TEST_ASSERT(changes == expected_changes);
+  TEST_ASSERT(sensor->get_update_interval() == MAX_INTERVAL);
+}
+
+int main() {
+  host::use_virtual_clock(true);
+  App.set_name("adaptive");
+  App.init_log();
+  test_ramp();
+  test_pass();
+}
@@ -0,0 +1,112 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "esphomelib/sensor/aggregate_filter.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+/// Record the statistics of each complete period of filter in periods.
+static void record(AggregateFilter *filter, std::vector<AggregateStats> *periods) {
+  filter->add_on_aggregate_callback([periods](const AggregateStats &stats) { periods->push_back(stats); });
+}
+
+/** Periods are aligned to the first value, also after periods without values and across the millis() overflow.
+ * A period is complete with the first value of a later period, which pushes out its mean.
+ */
+static void test_alignment() {
+  AggregateFilter filter(1000);
+  std::vector<AggregateStats> periods;
+  record(&filter, &periods);
+  TEST_ASSERT(!filter.new_timed_value(1.0f, 500).defined);
+  TEST_ASSERT(!filter.new_timed_value(2.0f, 700).defined);
+  TEST_ASSERT(!filter.new_timed_value(NAN, 1200).defined);
+  TEST_ASSERT(!filter.new_timed_value(6.0f, 1499).defined);
+  TEST_ASSERT(periods.empty());
+
+  // three empty periods later
+  Optional<float> out = filter.new_timed_value(10.0f, 4700);
+  TEST_ASSERT(out.defined && out.value == 3.0f);
+  TEST_ASSERT(periods.size() == 1);
+  const AggregateStats &first = periods[0];
+  TEST_ASSERT(first.start == 500 && first.last_time == 1499 && first.count == 3);
+  TEST_ASSERT(first.min == 1.0f && first.max == 6.0f && first.last == 6.0f);
+
+  // still the period starting at 4500
+  TEST_ASSERT(!filter.new_timed_value(20.0f, 5499).defined);
+  out = filter.new_timed_value(0.0f, 5500);
+  TEST_ASSERT(out.defined && out.value == 15.0f);
+  TEST_ASSERT(periods[1].start == 4500 && periods[1].count == 2);
+
+  AggregateFilter overflow(1000);
+  std::vector<AggregateStats> overflow_periods;
+  record(&overflow, &overflow_periods);
+  overflow.new_timed_value(1.0f, UINT32_MAX - 299);
+  // the period started at UINT32_MAX - 299 and ends at 700 after the overflow
+  TEST_ASSERT(!overflow.new_timed_value(3.0f, 699).defined);
+  TEST_ASSERT(overflow.new_timed_value(5.0f, 2750).defined);
+  TEST_ASSERT(overflow_periods.size() == 1 && overflow_periods[0].count == 2);
+  TEST_ASSERT(overflow.new_timed_value(5.0f, 3700).defined);
+  TEST_ASSERT(overflow_periods[1].start == 2700 && overflow_periods[1].count == 1);
+}
+
+/// The mean and population standard deviation of values with the two-pass algorithm, in double precision.
+static void reference_stats(const std::vector<float> &values, double &mean, double &stddev) {
+  double sum = 0;
+  for (float value : values)
+    sum += value;
+  mean = sum / values.size();
+  double squares = 0;
+  for (float value : values)
+    squares += (value - mean) * (value - mean);
+  stddev = std::sqrt(squares / values.size());
+}
+
+/** Mean and standard deviation match the two-pass reference, also with a large offset and a small spread (where
+ * the sum of squares in float precision loses all digits). A single value and constant values have no deviation.
+ */
+static void test_stddev() {
+  AggregateFilter filter(1000);
+  std::vector<AggregateStats> periods;
+  record(&filter, &periods);
+  std::mt19937 rng(17);
+  std::uniform_int_distribution<uint32_t> counts(1, 500);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  const float offsets[] = {0.0f, 273.15f, 100000.0f};
+
+  std::vector<std::vector<float>> inputs;
+  uint32_t time = 0;
+  for (int period = 0; period < 30; period++) {
+    const uint32_t count = period == 0 ? 1 : counts(rng);
+    const float offset = offsets[period % 3];
+    std::vector<float> values;
+    for (uint32_t i = 0; i < count; i++) {
+      const float value = period == 1 ? offset : offset + noise(rng);
+      values.push_back(value);
+      filter.new_timed_value(value, time + i * 999 / count);
+    }
+    inputs.push_back(values);
+    time += 1000;
+  }
+  filter.new_timed_value(0.0f, time);
+
+  TEST_ASSERT(periods.size() == inputs.size());
+  TEST_ASSERT(periods[0].stddev == 0.0f && periods[1].stddev == 0.0f);
+  for (size_t i = 0; i < inputs.size(); i++) {
+    const AggregateStats &period = periods[i];
+    double mean, stddev;
+    reference_stats(inputs[i], mean, stddev);
+    TEST_ASSERT(period.count == inputs[i].size());
+    TEST_ASSERT_NEAR(period.mean, mean, std::fabs(mean) * 1e-6 + 1e-6);
+    TEST_ASSERT_NEAR(period.stddev, stddev, stddev * 1e-4 + 1e-6);
+  }
+}
+
+int main() {
+  test_alignment();
+  test_stddev();
+  test_pass();
+}
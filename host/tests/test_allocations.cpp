@@ -0,0 +1,85 @@
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "esphomelib/helpers.h"
+#include "esphomelib/scheduler.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// The number of heap allocations so far, counted by the replaced global operator new.
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+void operator delete[](void *ptr) noexcept {
+  free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept {
+  free(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept {
+  free(ptr);
+}
+
+/// Creating, moving and calling InlineFunctions with small captures never allocates.
+static void test_inline_function() {
+  uint32_t counter = 0;
+  uint32_t *c = &counter;
+  const size_t before = allocations;
+  for (uint32_t i = 0; i < 1000; i++) {
+    InlineFunction<void(uint32_t)> f = [c, i](uint32_t x) { *c += i + x; };
+    InlineFunction<void(uint32_t)> g = std::move(f);
+    g(1);
+    f = [c](uint32_t x) { *c -= x; };
+    f(1);
+  }
+  TEST_ASSERT(allocations == before);
+  TEST_ASSERT(counter == 999 * 1000 / 2);
+}
+
+/// After a warm-up, scheduling, rescheduling, cancelling and running time functions doesn't allocate.
+static void test_scheduler() {
+  Scheduler scheduler;
+  uint32_t calls = 0;
+  uint32_t *c = &calls;
+  auto iteration = [&scheduler, c]() {
+    scheduler.set_timeout(nullptr, 1, 5, [c]() { (*c)++; });
+    scheduler.defer(nullptr, 2, [c]() { (*c)++; });
+    scheduler.set_timeout(nullptr, 3, 1, [c]() { (*c)++; });
+    scheduler.cancel_timeout(nullptr, 3);
+    host::advance_time(1000);
+    scheduler.call();
+  };
+  scheduler.set_interval(nullptr, 4, 0, [c]() { (*c)++; });
+
+  for (int i = 0; i < 100; i++)
+    iteration();
+  const size_t before = allocations;
+  const uint32_t calls_before = calls;
+  for (int i = 0; i < 10000; i++)
+    iteration();
+  TEST_ASSERT(allocations == before);
+  // the interval and the defer run every iteration, the timeout is always rescheduled before it's due
+  TEST_ASSERT(calls - calls_before == 2 * 10000);
+}
+
+int main() {
+  host::use_virtual_clock(true);
+  test_inline_function();
+  test_scheduler();
+  test_pass();
+}
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "esphomelib/application.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+static const uint32_t MAX_IDLE_TIME = 100;
+
+/// A component doing work_us µs of work in each loop(), that needs continuous loops while continuous is set.
+class WorkComponent : public Component {
+ public:
+  void loop() override {
+    if (this->work_us != 0)
+      host::advance_time(this->work_us);
+  }
+  bool needs_continuous_loop() const override { return this->continuous; }
+
+  /// Schedule a timeout in ms ms that counts deadlines.
+  void set_deadline(uint32_t ms) {
+    this->set_timeout("deadline", ms, [this]() { this->deadlines++; });
+  }
+
+  bool continuous{false};
+  uint32_t work_us{0};
+  uint32_t deadlines{0};
+};
+
+/// A component without loop() that counts its loop_() calls and can request the next one from within loop_().
+class ProbeComponent : public Component {
+ public:
+  void loop_() override {
+    this->loops++;
+    if (this->requests_from_loop != 0) {
+      this->requests_from_loop--;
+      this->request_loop();
+    }
+    Component::loop_();
+  }
+
+  uint32_t loops{0};
+  uint32_t requests_from_loop{0};
+};
+
+/// How long one App.loop() iteration took, in ms.
+static uint32_t loop_time() {
+  const uint32_t start = millis();
+  App.loop();
+  return millis() - start;
+}
+
+/** The loop idles until the next scheduled deadline, but at most for the max idle time, and doesn't idle
+ * while a component needs continuous loops or idling is disabled.
+ */
+static void test_idle(WorkComponent *work) {
+  work->set_deadline(30);
+  TEST_ASSERT_NEAR(loop_time(), 30, 1);
+  TEST_ASSERT(work->deadlines == 0);
+  // the timeout runs at the start of the next iteration, which then idles for the max idle time
+  TEST_ASSERT_NEAR(loop_time(), MAX_IDLE_TIME, 1);
+  TEST_ASSERT(work->deadlines == 1);
+
+  work->continuous = true;
+  for (int i = 0; i < 10; i++)
+    TEST_ASSERT(loop_time() == 0);
+  work->continuous = false;
+
+  App.set_max_idle_time(0);
+  for (int i = 0; i < 10; i++)
+    TEST_ASSERT(loop_time() == 0);
+  App.set_max_idle_time(MAX_IDLE_TIME);
+  TEST_ASSERT_NEAR(loop_time(), MAX_IDLE_TIME, 1);
+}
+
+/// Run the loop for duration ms.
+static void run_for(uint32_t duration) {
+  const uint32_t start = millis();
+  while (millis() - start < duration)
+    App.loop();
+}
+
+/// The idle ratio of the last minute, close to 1 with nothing to do and close to 0 with busy loops.
+static void test_idle_ratio(WorkComponent *work) {
+  // two windows, so that the last complete one only saw this phase
+  run_for(121000);
+  TEST_ASSERT(App.get_idle_ratio() > 0.99f);
+
+  work->continuous = true;
+  work->work_us = 1000;
+  run_for(121000);
+  TEST_ASSERT(App.get_idle_ratio() < 0.01f);
+  work->continuous = false;
+  work->work_us = 0;
+}
+
+/** A component without loop() is only looped in the first iteration. request_loop() loops it exactly once in
+ * the next iteration, however often it's called, and a request from within loop_() keeps the loop from idling.
+ */
+static void test_dispatch(ProbeComponent *probe) {
+  TEST_ASSERT(probe->loops == 1);
+  for (int i = 0; i < 10; i++)
+    App.loop();
+  TEST_ASSERT(probe->loops == 1);
+
+  probe->request_loop();
+  probe->request_loop();
+  probe->request_loop();
+  TEST_ASSERT(probe->loops == 1);
+  App.loop();
+  TEST_ASSERT(probe->loops == 2);
+  App.loop();
+  TEST_ASSERT(probe->loops == 2);
+
+  probe->requests_from_loop = 1;
+  probe->request_loop();
+  TEST_ASSERT(loop_time() == 0);
+  TEST_ASSERT(probe->loops == 3);
+  TEST_ASSERT_NEAR(loop_time(), MAX_IDLE_TIME, 1);
+  TEST_ASSERT(probe->loops == 4);
+  App.loop();
+  TEST_ASSERT(probe->loops == 4);
+}
+
+/// The max idle time and wake_loop() cut the idle time short, even with the next deadline far away.
+static void test_idle_bounds(WorkComponent *work) {
+  work->set_deadline(5000);
+  App.set_max_idle_time(20);
+  TEST_ASSERT_NEAR(loop_time(), 20, 1);
+  App.set_max_idle_time(1000);
+  TEST_ASSERT_NEAR(loop_time(), 1000, 1);
+
+  // a wake before the loop idles (for example from a component looped in the same iteration)
+  App.wake_loop();
+  TEST_ASSERT(loop_time() == 0);
+
+  // a wake from another task while the loop idles, on the real clock
+  host::use_virtual_clock(false);
+  std::thread waker([]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    App.wake_loop();
+  });
+  const uint32_t woken = loop_time();
+  waker.join();
+  host::use_virtual_clock(true);
+  TEST_ASSERT(woken >= 15 && woken < 500);
+
+  App.set_max_idle_time(MAX_IDLE_TIME);
+  while (work->deadlines == 1)
+    App.loop();
+}
+
+int main() {
+  host::use_virtual_clock(true);
+  App.set_name("component_loop");
+  App.init_log();
+  auto *work = App.register_component(new WorkComponent());
+  auto *probe = App.register_component(new ProbeComponent());
+  App.setup();
+  App.loop();
+
+  test_dispatch(probe);
+  test_idle(work);
+  test_idle_bounds(work);
+  test_idle_ratio(work);
+  test_pass();
+}
@@ -0,0 +1,228 @@
+#include <cstdint>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// Run the loop until ms have passed on the virtual clock.
+static void run_for(uint32_t ms) {
+  const uint32_t start = millis();
+  while (millis() - start < ms)
+    App.loop();
+}
+
+/// A component with coroutines that record when they got to which point.
+class CoroutineComponent : public Component {
+ public:
+  void start_sleeping() {
+    TEST_ASSERT(this->start_coroutine(&this->co_, [this](Coroutine &co) { return this->sleeping_(co); }));
+  }
+  void start_waiting(bool *condition, uint32_t timeout) {
+    this->condition_ = condition;
+    this->timeout_ = timeout;
+    TEST_ASSERT(this->start_coroutine(&this->co_, [this](Coroutine &co) { return this->waiting_(co); }));
+  }
+  void start_returning() {
+    TEST_ASSERT(this->start_coroutine(&this->co_, [this](Coroutine &co) { return this->returning_(co); }));
+  }
+  bool start_again() {
+    return this->start_coroutine(&this->co_, [this](Coroutine &co) { return this->sleeping_(co); });
+  }
+  void stop() { this->stop_coroutine(&this->co_); }
+  void set_after(bool *condition, uint32_t ms) {
+    this->set_timeout(ms, [condition]() { *condition = true; });
+  }
+  const Coroutine &get_coroutine() const { return this->co_; }
+
+  std::vector<uint32_t> times;
+  uint32_t count{0};
+
+ protected:
+  CoroutineResult sleeping_(Coroutine &co) {
+    CO_BEGIN(co);
+    this->times.push_back(millis());
+    // members survive a suspension
+    this->count = 1;
+    CO_SLEEP(co, 100);
+    this->times.push_back(millis());
+    this->count++;
+    CO_YIELD(co);
+    this->times.push_back(millis());
+    for (this->i_ = 0; this->i_ < 3; this->i_++) {
+      CO_SLEEP(co, 10);
+      this->count++;
+    }
+    this->times.push_back(millis());
+    CO_END(co);
+  }
+  CoroutineResult waiting_(Coroutine &co) {
+    CO_BEGIN(co);
+    this->times.push_back(millis());
+    CO_WAIT_UNTIL(co, *this->condition_, 10, this->timeout_);
+    this->times.push_back(millis());
+    CO_END(co);
+  }
+  CoroutineResult returning_(Coroutine &co) {
+    CO_BEGIN(co);
+    this->times.push_back(millis());
+    CO_SLEEP(co, 10);
+    if (this->count == 0)
+      CO_RETURN(co);
+    this->times.push_back(millis());
+    CO_END(co);
+  }
+
+  Coroutine co_;
+  uint32_t i_;
+  bool *condition_{nullptr};
+  uint32_t timeout_{0};
+};
+
+/// Sleeps and yields resume after the given time while the loop keeps running, loops continue.
+static void test_sleep(CoroutineComponent *component) {
+  component->times.clear();
+  component->start_sleeping();
+  // the first step runs right away
+  TEST_ASSERT(component->times.size() == 1);
+  TEST_ASSERT(component->get_coroutine().is_running());
+  // can't be started twice
+  TEST_ASSERT(!component->start_again());
+  run_for(200);
+  TEST_ASSERT(!component->get_coroutine().is_running());
+  TEST_ASSERT(component->times.size() == 4);
+  TEST_ASSERT(component->count == 5);
+  TEST_ASSERT_NEAR(component->times[1] - component->times[0], 100, 1);
+  TEST_ASSERT_NEAR(component->times[2] - component->times[1], 0, 1);
+  TEST_ASSERT_NEAR(component->times[3] - component->times[2], 30, 3);
+}
+
+/// CO_WAIT_UNTIL() continues once the condition is true, or after the timeout.
+static void test_wait_until(CoroutineComponent *component) {
+  bool condition = false;
+  auto *c = &condition;
+  component->times.clear();
+  component->start_waiting(c, 1000);
+  component->set_after(c, 250);
+  run_for(400);
+  TEST_ASSERT(component->times.size() == 2);
+  TEST_ASSERT(!component->get_coroutine().is_timed_out());
+  TEST_ASSERT(component->times[1] - component->times[0] >= 250 && component->times[1] - component->times[0] <= 262);
+
+  // a condition that's already true doesn't suspend
+  component->times.clear();
+  component->start_waiting(c, 1000);
+  TEST_ASSERT(component->times.size() == 2);
+  TEST_ASSERT(!component->get_coroutine().is_running());
+
+  condition = false;
+  component->times.clear();
+  component->start_waiting(c, 300);
+  run_for(400);
+  TEST_ASSERT(component->times.size() == 2);
+  TEST_ASSERT(component->get_coroutine().is_timed_out());
+  TEST_ASSERT(component->times[1] - component->times[0] >= 300 && component->times[1] - component->times[0] <= 312);
+}
+
+/// CO_RETURN() and stop_coroutine() end the coroutine, it starts from the beginning next time.
+static void test_return_and_stop(CoroutineComponent *component) {
+  component->count = 0;
+  component->times.clear();
+  component->start_returning();
+  run_for(50);
+  TEST_ASSERT(component->times.size() == 1);
+  TEST_ASSERT(!component->get_coroutine().is_running());
+
+  component->times.clear();
+  component->start_sleeping();
+  run_for(50);
+  component->stop();
+  TEST_ASSERT(!component->get_coroutine().is_running());
+  run_for(200);
+  TEST_ASSERT(component->times.size() == 1);
+  TEST_ASSERT(component->count == 1);
+  test_sleep(component);
+}
+
+/** A HTU21D that NACKs commands for 15ms after a soft reset and until a conversion is done, like the real one.
+ *
+ * The measurements are 24.0°C and 50%, the third byte (CRC) isn't used by the driver.
+ */
+class HTU21DSimulator : public host::I2CDeviceSimulator {
+ public:
+  bool write(const uint8_t *data, size_t len) override {
+    if (len == 0)
+      return true;
+    const uint32_t now = millis();
+    if (now - this->reset_time_ < 15) {
+      this->nacks++;
+      return false;
+    }
+    if (data[0] == 0xFE) {
+      this->reset_time_ = now;
+    } else if (data[0] == 0xF3 || data[0] == 0xF5) {
+      this->command_ = data[0];
+      this->conversion_end_ = now + (data[0] == 0xF3 ? 50 : 16);
+    }
+    return true;
+  }
+  size_t read(uint8_t *data, size_t len) override {
+    if (this->command_ == 0 || int32_t(millis() - this->conversion_end_) < 0) {
+      this->nacks++;
+      return 0;
+    }
+    // raw = (value + 46.85) / 175.72 * 65536, (value + 6) / 125 * 65536
+    const uint16_t raw = this->command_ == 0xF3 ? 26424 : 29360;
+    const uint8_t bytes[3] = {uint8_t(raw >> 8), uint8_t(raw & 0xFF), 0};
+    for (size_t i = 0; i < len && i < 3; i++)
+      data[i] = bytes[i];
+    this->command_ = 0;
+    return len < 3 ? len : 3;
+  }
+
+  uint32_t nacks{0};
+
+ protected:
+  uint32_t reset_time_{UINT32_MAX - 100};
+  uint8_t command_{0};
+  uint32_t conversion_end_{0};
+};
+
+/// The first measurement right after setup() waits for the soft reset instead of being NACKed.
+static void test_htu21d(HTU21DSimulator *simulator, sensor::HTU21DComponent *htu21d) {
+  std::vector<float> temperatures, humidities;
+  auto *t = &temperatures;
+  auto *h = &humidities;
+  htu21d->get_temperature_sensor()->clear_filters();
+  htu21d->get_humidity_sensor()->clear_filters();
+  htu21d->get_temperature_sensor()->add_on_value_callback([t](float value) { t->push_back(value); });
+  htu21d->get_humidity_sensor()->add_on_value_callback([h](float value) { h->push_back(value); });
+
+  // the first update() runs in the first loop iteration, right after setup() reset the sensor
+  run_for(200);
+  TEST_ASSERT(!htu21d->is_failed());
+  TEST_ASSERT(simulator->nacks == 0);
+  TEST_ASSERT(temperatures.size() == 1 && humidities.size() == 1);
+  TEST_ASSERT_NEAR(temperatures[0], 24.0f, 0.1f);
+  TEST_ASSERT_NEAR(humidities[0], 50.0f, 0.1f);
+}
+
+int main() {
+  host::use_virtual_clock(true);
+  App.set_name("coroutine");
+  App.init_log();
+  auto *component = App.register_component(new CoroutineComponent());
+  auto *simulator = new HTU21DSimulator();
+  host::add_i2c_device(0x40, simulator);
+  auto *htu21d = App.register_component(new sensor::HTU21DComponent(App.init_i2c(), "Temperature", "Humidity",
+                                                                     60000));
+  App.setup();
+
+  test_htu21d(simulator, htu21d);
+  test_sleep(component);
+  test_wait_until(component);
+  test_return_and_stop(component);
+  test_pass();
+}
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "esphomelib/event_queue.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// An item spanning several words, so that torn writes and reads are noticed.
+struct Item {
+  uint32_t producer;
+  uint32_t sequence;
+  uint32_t check;
+};
+
+static uint32_t check_of(uint32_t producer, uint32_t sequence) {
+  return (producer * 0x9E3779B1u) ^ sequence;
+}
+
+static const size_t QUEUE_SIZE = 64;
+static const uint32_t PRODUCERS = 4;
+static const uint32_t ITEMS_PER_PRODUCER = 200000;
+
+/// A full queue rejects pushes without losing items and accepts them again once the consumer pops.
+static void test_full() {
+  EventQueue<Item, QUEUE_SIZE> queue;
+  for (uint32_t round = 0; round < 3; round++) {
+    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+      TEST_ASSERT(queue.push(Item{0, i, check_of(0, i)}));
+    TEST_ASSERT(!queue.push(Item{0, 999, 0}));
+
+    Item item{};
+    TEST_ASSERT(queue.pop(item) && item.sequence == 0);
+    TEST_ASSERT(queue.push(Item{0, QUEUE_SIZE, check_of(0, QUEUE_SIZE)}));
+    TEST_ASSERT(!queue.push(Item{0, 999, 0}));
+    for (uint32_t i = 1; i <= QUEUE_SIZE; i++)
+      TEST_ASSERT(queue.pop(item) && item.sequence == i && item.check == check_of(0, i));
+    TEST_ASSERT(!queue.pop(item));
+  }
+}
+
+/** Several producer threads push into a small queue (so that it's full most of the time) while a single
+ * consumer pops: every item arrives exactly once, intact and in the order of its producer.
+ */
+static void test_producers() {
+  static EventQueue<Item, QUEUE_SIZE> queue;
+  std::atomic<uint32_t> full_count{0};
+  std::atomic<uint32_t> finished{0};
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([p, &full_count, &finished]() {
+      for (uint32_t i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        while (!queue.push(Item{p, i, check_of(p, i)})) {
+          full_count++;
+          std::this_thread::yield();
+        }
+      }
+      finished++;
+    });
+  }
+
+  std::vector<uint32_t> next(PRODUCERS, 0);
+  uint32_t received = 0;
+  while (received < PRODUCERS * ITEMS_PER_PRODUCER) {
+    // checked before pop(), so that the queue can't be empty only because the last pushes are still running
+    const bool all_pushed = finished == PRODUCERS;
+    Item item{};
+    if (!queue.pop(item)) {
+      // items are missing if nothing is left to wait for
+      TEST_ASSERT(!all_pushed);
+      std::this_thread::yield();
+      continue;
+    }
+    TEST_ASSERT(item.producer < PRODUCERS);
+    TEST_ASSERT(item.check == check_of(item.producer, item.sequence));
+    TEST_ASSERT(item.sequence == next[item.producer]);
+    next[item.producer]++;
+    received++;
+  }
+  for (auto &producer : producers)
+    producer.join();
+
+  Item item{};
+  TEST_ASSERT(!queue.pop(item));
+  printf("Queue was full %u times.\n", unsigned(full_count.load()));
+}
+
+int main() {
+  test_full();
+  test_producers();
+  test_pass();
+}
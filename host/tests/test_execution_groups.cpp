@@ -0,0 +1,136 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// The values BurstSensor pushes per update, many more than fit into the event queue.
+static const uint32_t BURST = 100;
+/// The number of bursts BurstSensor pushes in total.
+static const uint32_t BURSTS = 50;
+static const uint32_t MIN_INTERVAL = 5;
+static const uint32_t MAX_INTERVAL = 400;
+
+/// A sensor in the secondary loop pushing BURST consecutive numbers per update, with adaptive polling.
+class BurstSensor : public sensor::PollingSensorComponent {
+ public:
+  BurstSensor() : PollingSensorComponent("Burst", MIN_INTERVAL) {}
+
+  void update() override {
+    if (this->bursts_ == BURSTS)
+      return;
+    for (uint32_t i = 0; i < BURST; i++)
+      this->push_new_value(this->next_++);
+    this->bursts_++;
+  }
+
+ protected:
+  uint32_t bursts_{0};
+  uint32_t next_{0};
+};
+
+/// An adaptive polling component in the secondary loop that reports stable values from its own updates.
+class StableComponent : public PollingComponent {
+ public:
+  StableComponent() : PollingComponent(MIN_INTERVAL) {}
+
+  void update() override { this->report_update_change(false); }
+};
+
+/// Holds up the secondary loop while blocked is set, so that its event queue can be filled from the main loop.
+class GateComponent : public Component {
+ public:
+  void loop() override {
+    while (this->blocked) {
+      this->waiting = true;
+      std::this_thread::yield();
+    }
+    this->waiting = false;
+  }
+
+  std::atomic<bool> blocked{false};
+  std::atomic<bool> waiting{false};
+};
+
+/// Run the main loop until done() or timeout ms passed.
+template<typename F>
+static void loop_until(F &&done, uint32_t timeout) {
+  const uint32_t start = millis();
+  while (!done() && millis() - start < timeout)
+    App.loop();
+}
+
+/** Values pushed in the secondary loop reach the main loop in order and none are dropped, even though each
+ * update pushes many more values than the event queue holds. The changes each value reports back to the
+ * adaptive polling of the sensor in the secondary loop are coalesced, so they don't fill its queue either.
+ */
+static void test_values(BurstSensor *sensor, const std::vector<float> &received) {
+  loop_until([&received]() { return received.size() == BURST * BURSTS; }, 10000);
+  TEST_ASSERT(received.size() == BURST * BURSTS);
+  for (uint32_t i = 0; i < received.size(); i++)
+    TEST_ASSERT(received[i] == float(i));
+  TEST_ASSERT(sensor->get_value() == float(BURST * BURSTS - 1));
+}
+
+/** A change reported from the main loop while the queue of the secondary loop is full isn't lost: the reaction
+ * can't be posted, but the next update still sees the change and returns to the minimum interval.
+ */
+static void test_report_with_full_queue(StableComponent *component, GateComponent *gate,
+                                        const std::atomic<uint32_t> &interval, const std::atomic<uint32_t> &resets) {
+  loop_until([&interval]() { return interval == MAX_INTERVAL; }, 10000);
+  TEST_ASSERT(interval == MAX_INTERVAL);
+  const uint32_t resets_before = resets;
+
+  gate->blocked = true;
+  while (!gate->waiting)
+    std::this_thread::yield();
+  uint32_t posted = 0;
+  while (App.post(EXECUTION_GROUP_SECONDARY, []() {}))
+    posted++;
+  TEST_ASSERT(posted <= App.EVENT_QUEUE_SIZE);
+  component->report_update_change(true);
+  gate->blocked = false;
+
+  // it backs off again right away, so count the returns to the minimum instead of looking at the interval
+  loop_until([&resets, resets_before]() { return resets != resets_before; }, 2 * MAX_INTERVAL);
+  TEST_ASSERT(resets == resets_before + 1);
+}
+
+int main() {
+  App.set_name("execution_groups");
+  App.init_log();
+
+  auto *sensor = App.register_component(new BurstSensor());
+  sensor->set_execution_group(EXECUTION_GROUP_SECONDARY);
+  sensor->clear_filters();
+  sensor->set_adaptive_update_interval(MIN_INTERVAL, MAX_INTERVAL, 0.5f);
+  std::vector<float> received;
+  auto *r = &received;
+  sensor->add_on_value_callback([r](float value) { r->push_back(value); });
+
+  auto *component = App.register_component(new StableComponent());
+  component->set_execution_group(EXECUTION_GROUP_SECONDARY);
+  component->set_adaptive_update_interval(MIN_INTERVAL, MAX_INTERVAL);
+  std::atomic<uint32_t> interval{MIN_INTERVAL};
+  std::atomic<uint32_t> resets{0};
+  auto *i = &interval;
+  auto *n = &resets;
+  component->add_on_update_interval_callback([i, n](uint32_t update_interval) {
+    *i = update_interval;
+    if (update_interval == MIN_INTERVAL)
+      (*n)++;
+  });
+
+  auto *gate = App.register_component(new GateComponent());
+  gate->set_execution_group(EXECUTION_GROUP_SECONDARY);
+  App.setup();
+
+  test_values(sensor, received);
+  test_report_with_full_queue(component, gate, interval, resets);
+  test_pass();
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "esphomelib/sensor/filter.h"
+#include "esphomelib/sensor/filter_chain.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+/// One output of a filter pipeline.
+struct Output {
+  float value;
+  uint32_t time;
+};
+
+static Optional<float> lambda(float value) {
+  if (value > 60.0f)
+    return Optional<float>();
+  return value * 2.0f;
+}
+
+/// The virtual Filter pipeline the chain replaces.
+static std::vector<Filter *> make_filters() {
+  return {
+      new FilterOutNANFilter(),
+      new FilterOutValueFilter(-1.0f),
+      new OffsetFilter(2.0f),
+      new MultiplyFilter(0.5f),
+      new SlidingWindowMovingAverageFilter(7, 3),
+      new LambdaFilter(lambda),
+      new ExponentialMovingAverageFilter(0.3f, 2),
+      new DeltaFilter(0.5f),
+      new ThrottleFilter(30),
+  };
+}
+
+static FilterChain<FilterOutNANStep, FilterOutValueStep, OffsetStep, MultiplyStep, SlidingWindowStep<7, 3>,
+                   LambdaStep<Optional<float> (*)(float)>, ExponentialMovingAverageStep, DeltaStep, ThrottleStep> *
+make_chain() {
+  return make_filter_chain(
+      FilterOutNANStep(),
+      FilterOutValueStep(-1.0f),
+      OffsetStep(2.0f),
+      MultiplyStep(0.5f),
+      SlidingWindowStep<7, 3>(),
+      lambda_step(&lambda),
+      ExponentialMovingAverageStep(0.3f, 2),
+      DeltaStep(0.5f),
+      ThrottleStep(30));
+}
+
+/// Random values with NANs and values to filter out, at irregular times.
+static void make_input(std::vector<float> &values, std::vector<uint32_t> &times) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> value_dist(0.0f, 100.0f);
+  std::uniform_int_distribution<uint32_t> step_dist(1, 20);
+  std::uniform_int_distribution<uint32_t> special_dist(0, 49);
+  uint32_t time = 1000;
+  for (uint32_t i = 0; i < 100000; i++) {
+    const uint32_t special = special_dist(rng);
+    values.push_back(special == 0 ? NAN : (special == 1 ? -1.0f : value_dist(rng)));
+    time += step_dist(rng);
+    times.push_back(time);
+  }
+}
+
+static void assert_equal(const std::vector<Output> &a, const std::vector<Output> &b) {
+  TEST_ASSERT(a.size() == b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    TEST_ASSERT_NEAR(a[i].value, b[i].value, 1e-4);
+    TEST_ASSERT(a[i].time == b[i].time);
+  }
+}
+
+/// The chain gives the same values as the Filter pipeline, one by one and in blocks.
+static void test_equivalence() {
+  std::vector<float> values;
+  std::vector<uint32_t> times;
+  make_input(values, times);
+
+  // one value at a time through the pipeline, like Sensor::push_new_value()
+  std::vector<Output> expected;
+  std::vector<Filter *> filters = make_filters();
+  for (size_t i = 0; i < values.size(); i++) {
+    Optional<float> value = values[i];
+    for (Filter *filter : filters) {
+      value = filter->new_timed_value(value.value, times[i]);
+      if (!value.defined)
+        break;
+    }
+    if (value.defined)
+      expected.push_back(Output{value.value, times[i]});
+  }
+  for (Filter *filter : filters)
+    delete filter;
+  // the input is long enough that all steps matter
+  TEST_ASSERT(expected.size() > 1000);
+
+  auto *chain = make_chain();
+  std::vector<Output> actual;
+  for (size_t i = 0; i < values.size(); i++) {
+    Optional<float> value = chain->new_timed_value(values[i], times[i]);
+    if (value.defined)
+      actual.push_back(Output{value.value, times[i]});
+  }
+  assert_equal(expected, actual);
+  delete chain;
+
+  // blocks of different sizes through the pipeline and the chain, like Sensor::push_new_values()
+  filters = make_filters();
+  chain = make_chain();
+  std::vector<Output> pipeline_blocks, chain_blocks;
+  size_t block = 1;
+  for (size_t start = 0; start < values.size(); start += block, block = block % 97 + 1) {
+    const size_t count = std::min(block, values.size() - start);
+    std::vector<float> pipeline_values(values.begin() + start, values.begin() + start + count);
+    std::vector<uint32_t> pipeline_times(times.begin() + start, times.begin() + start + count);
+    std::vector<float> chain_values = pipeline_values;
+    std::vector<uint32_t> chain_times = pipeline_times;
+
+    size_t pipeline_count = count;
+    for (Filter *filter : filters)
+      pipeline_count = filter->new_values(pipeline_values.data(), pipeline_times.data(), pipeline_count);
+    for (size_t i = 0; i < pipeline_count; i++)
+      pipeline_blocks.push_back(Output{pipeline_values[i], pipeline_times[i]});
+
+    const size_t chain_count = chain->new_values(chain_values.data(), chain_times.data(), count);
+    for (size_t i = 0; i < chain_count; i++)
+      chain_blocks.push_back(Output{chain_values[i], chain_times[i]});
+  }
+  assert_equal(expected, pipeline_blocks);
+  assert_equal(expected, chain_blocks);
+
+  uint32_t interval = 1000;
+  for (Filter *filter : filters)
+    interval = filter->expected_interval(interval);
+  TEST_ASSERT(chain->expected_interval(1000) == interval);
+  TEST_ASSERT(interval == 6000);
+  for (Filter *filter : filters)
+    delete filter;
+  delete chain;
+}
+
+int main() {
+  test_equivalence();
+  test_pass();
+}
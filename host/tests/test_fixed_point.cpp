@@ -0,0 +1,49 @@
+#include <cmath>
+#include <cstdint>
+
+#include "esphomelib/fixed_point.h"
+#include "esphomelib/helpers.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// Conversions round-trip within the resolution and saturate at the limits of the range.
+static void test_conversions() {
+  TEST_ASSERT(Fixed16::from_int(3).raw() == 3 * Fixed16::ONE);
+  TEST_ASSERT_NEAR(Fixed16::from_float(-21.375f).to_float(), -21.375f, 0.0);
+  TEST_ASSERT_NEAR(Fixed16::from_float(1013.25f).to_float(), 1013.25f, 1.0 / Fixed16::ONE);
+  TEST_ASSERT(Fixed16::from_float(40000.0f).raw() == INT32_MAX);
+  TEST_ASSERT(Fixed16::from_float(-40000.0f).raw() == INT32_MIN);
+  TEST_ASSERT(Fixed16::from_float(NAN).raw() == 0);
+
+  const Fixed16 a = Fixed16::from_float(2.5f), b = Fixed16::from_float(-4.0f);
+  TEST_ASSERT_NEAR((a + b).to_float(), -1.5f, 0.0);
+  TEST_ASSERT_NEAR((a - b).to_float(), 6.5f, 0.0);
+  TEST_ASSERT_NEAR((a * b).to_float(), -10.0f, 0.0);
+  TEST_ASSERT_NEAR((b / a).to_float(), -1.6f, 1.0 / Fixed16::ONE);
+}
+
+/** The fixed point averages used with USE_FIXED_POINT_FILTERS stay close to the float ones, the sliding window
+ * sum is exact so it doesn't drift over many values.
+ */
+static void test_averages() {
+  SlidingWindowMovingAverage<float> window(15);
+  SlidingWindowMovingAverage<int32_t, int64_t> fixed_window(15);
+  ExponentialMovingAverage ema(0.1f);
+  FixedExponentialMovingAverage fixed_ema(0.1f);
+  for (uint32_t i = 0; i < 100000; i++) {
+    const float value = 20.0f + 5.0f * sinf(i * 0.01f);
+    const float average = window.next_value(value);
+    const float fixed_average =
+        Fixed16::from_raw(fixed_window.next_value(Fixed16::from_float(value).raw())).to_float();
+    TEST_ASSERT_NEAR(fixed_average, average, 1e-3);
+    TEST_ASSERT_NEAR(fixed_ema.next_value(Fixed16::from_float(value)).to_float(), ema.next_value(value), 1e-3);
+  }
+  TEST_ASSERT_NEAR(fixed_ema.get_alpha(), 0.1f, 1.0 / Fixed16::ONE);
+}
+
+int main() {
+  test_conversions();
+  test_averages();
+  test_pass();
+}
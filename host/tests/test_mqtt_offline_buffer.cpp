@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <esp_partition.h>
+
+#include "esphomelib/mqtt/mqtt_offline_buffer.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::mqtt;
+
+static const size_t SECTORS = 4;
+static const size_t SECTOR_SIZE = MQTTFlashBufferStorage::SECTOR_SIZE;
+
+/// The i-th message of a sensor node, about 40 bytes per record.
+static MQTTBufferedMessage make_message(uint32_t i, uint16_t boot = 0) {
+  return MQTTBufferedMessage{"node/sensor/sensor_" + std::to_string(i % 3) + "/state", std::to_string(i),
+                             i * 1000, boot};
+}
+
+static void assert_message(const MQTTBufferedMessage &message, uint32_t i, uint16_t boot = 0) {
+  const MQTTBufferedMessage expected = make_message(i, boot);
+  TEST_ASSERT(message.topic == expected.topic);
+  TEST_ASSERT(message.payload == expected.payload);
+  TEST_ASSERT(message.time == expected.time);
+  TEST_ASSERT(message.boot == expected.boot);
+}
+
+/// Replay everything in storage, returns the indices of the messages (their payloads).
+static std::vector<uint32_t> replay(MQTTBufferStorage *storage, size_t max = SIZE_MAX) {
+  std::vector<uint32_t> replayed;
+  MQTTBufferedMessage message;
+  while (replayed.size() < max && storage->peek(message)) {
+    replayed.push_back(uint32_t(std::stoul(message.payload)));
+    storage->pop();
+  }
+  return replayed;
+}
+
+/// Whether indices are the consecutive numbers from first to last.
+static bool is_range(const std::vector<uint32_t> &indices, uint32_t first, uint32_t last) {
+  if (indices.size() != last - first + 1)
+    return false;
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] != first + i)
+      return false;
+  }
+  return true;
+}
+
+/// Let the storage write everything it queued.
+static void flush(MQTTBufferStorage *storage) {
+  while (storage->process()) {}
+}
+
+/// Messages come back oldest first, a full ring drops the oldest ones and messages larger than a record.
+static void test_ram() {
+  MQTTRAMBufferStorage storage(1000);
+  for (uint32_t i = 0; i < 10; i++)
+    storage.push(make_message(i));
+  MQTTBufferedMessage message;
+  TEST_ASSERT(storage.peek(message));
+  assert_message(message, 0);
+  // peek() without pop() returns the same message again
+  TEST_ASSERT(storage.peek(message));
+  assert_message(message, 0);
+  TEST_ASSERT(is_range(replay(&storage), 0, 9));
+  TEST_ASSERT(!storage.peek(message));
+  TEST_ASSERT(storage.get_dropped() == 0);
+
+  // many times the capacity, so the ring wraps around with records split at the end
+  const uint32_t count = 500;
+  for (uint32_t i = 0; i < count; i++)
+    storage.push(make_message(i));
+  const std::vector<uint32_t> replayed = replay(&storage);
+  TEST_ASSERT(replayed.size() > 20);
+  TEST_ASSERT(is_range(replayed, count - replayed.size(), count - 1));
+  TEST_ASSERT(storage.get_dropped() == count - replayed.size());
+
+  storage.push(MQTTBufferedMessage{"topic", std::string(MQTTBufferStorage::MAX_RECORD_SIZE, 'x'), 0, 0});
+  TEST_ASSERT(!storage.peek(message));
+  TEST_ASSERT(storage.get_dropped() == count - replayed.size() + 1);
+}
+
+/** Messages are written by process() and replayed oldest first, the ones still waiting in RAM after the ones in
+ * flash. Once the log is full the oldest sector is dropped, and all sectors are erased equally often.
+ */
+static void test_flash() {
+  host::add_flash_partition("mqttbuf", SECTORS * SECTOR_SIZE);
+  MQTTFlashBufferStorage storage("mqttbuf");
+  storage.setup();
+  TEST_ASSERT(storage.is_ready());
+  TEST_ASSERT(storage.get_boot() == 0);
+
+  for (uint32_t i = 0; i < 10; i++)
+    storage.push(make_message(i));
+  flush(&storage);
+  for (uint32_t i = 10; i < 15; i++)
+    storage.push(make_message(i));
+  MQTTBufferedMessage message;
+  TEST_ASSERT(storage.peek(message));
+  assert_message(message, 0);
+  TEST_ASSERT(is_range(replay(&storage), 0, 14));
+  TEST_ASSERT(storage.get_dropped() == 0);
+
+  // about 25 sectors of messages
+  const uint32_t count = 2500;
+  for (uint32_t i = 15; i < count; i++) {
+    storage.push(make_message(i));
+    if (i % 10 == 0)
+      flush(&storage);
+  }
+  flush(&storage);
+  const std::vector<uint32_t> replayed = replay(&storage);
+  // between two and three full sectors of the newest messages are left
+  TEST_ASSERT(replayed.size() > 2 * SECTOR_SIZE / 45 && replayed.size() < SECTORS * SECTOR_SIZE / 35);
+  TEST_ASSERT(is_range(replayed, count - replayed.size(), count - 1));
+  TEST_ASSERT(storage.get_dropped() == count - 15 - replayed.size());
+
+  uint32_t min_erases = UINT32_MAX, max_erases = 0;
+  for (size_t sector = 0; sector < SECTORS; sector++) {
+    min_erases = std::min(min_erases, host::get_flash_erase_count("mqttbuf", sector));
+    max_erases = std::max(max_erases, host::get_flash_erase_count("mqttbuf", sector));
+  }
+  TEST_ASSERT(min_erases >= 5 && max_erases - min_erases <= 1);
+}
+
+/// The sector written last, the one with the highest sequence number in its header.
+static size_t find_head_sector(const esp_partition_t *partition) {
+  size_t head = 0;
+  uint32_t head_sequence = 0;
+  for (size_t sector = 0; sector < SECTORS; sector++) {
+    uint32_t header[2];
+    esp_partition_read(partition, sector * SECTOR_SIZE, header, sizeof(header));
+    if (header[0] == 0x3142514D && header[1] >= head_sequence) {
+      head = sector;
+      head_sequence = header[1];
+    }
+  }
+  return head;
+}
+
+/// The offset of the free space after the records of sector.
+static size_t free_offset(const esp_partition_t *partition, size_t sector) {
+  size_t offset = 8;
+  uint8_t header[2];
+  while (true) {
+    esp_partition_read(partition, sector * SECTOR_SIZE + offset, header, 2);
+    if (header[0] == 0xFF)
+      return offset;
+    offset += header[1];
+  }
+}
+
+/** After a reboot the messages that weren't replayed yet are recovered in order, with the boot they were
+ * published in. A record torn by a power loss is skipped and nothing is written after it, the messages
+ * before it and the ones published after the reboot are all replayed.
+ */
+static void test_flash_reboot() {
+  host::add_flash_partition("reboot", SECTORS * SECTOR_SIZE);
+  {
+    MQTTFlashBufferStorage storage("reboot");
+    storage.setup();
+    for (uint32_t i = 0; i < 150; i++) {
+      storage.push(make_message(i));
+      flush(&storage);
+    }
+    TEST_ASSERT(is_range(replay(&storage, 40), 0, 39));
+    // not written to flash yet, lost with the reboot
+    storage.push(make_message(150));
+  }
+
+  MQTTFlashBufferStorage rebooted("reboot");
+  rebooted.setup();
+  TEST_ASSERT(rebooted.get_boot() == 1);
+  TEST_ASSERT(is_range(replay(&rebooted, 10), 40, 49));
+  for (uint32_t i = 0; i < 5; i++)
+    rebooted.push(make_message(200 + i, 1));
+  flush(&rebooted);
+
+  // power loss in the middle of writing the next record: its header is there, the rest of it isn't
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                              "reboot");
+  const size_t head_sector = find_head_sector(partition);
+  const size_t torn = free_offset(partition, head_sector);
+  const uint8_t torn_header[] = {0xA5, 40, 0x12, 0x02, 0x00};
+  esp_partition_write(partition, head_sector * SECTOR_SIZE + torn, torn_header, sizeof(torn_header));
+
+  MQTTFlashBufferStorage torn_storage("reboot");
+  torn_storage.setup();
+  TEST_ASSERT(torn_storage.get_boot() == 2);
+  for (uint32_t i = 0; i < 5; i++)
+    torn_storage.push(make_message(300 + i, 2));
+  flush(&torn_storage);
+  // the torn record wasn't overwritten, the new messages went to the next sector
+  uint8_t marker;
+  esp_partition_read(partition, head_sector * SECTOR_SIZE + torn, &marker, 1);
+  TEST_ASSERT(marker == 0xA5);
+
+  MQTTBufferedMessage message;
+  TEST_ASSERT(torn_storage.peek(message));
+  assert_message(message, 50, 0);
+  std::vector<uint32_t> replayed = replay(&torn_storage);
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 50; i < 150; i++)
+    expected.push_back(i);
+  for (uint32_t i = 200; i < 205; i++)
+    expected.push_back(i);
+  for (uint32_t i = 300; i < 305; i++)
+    expected.push_back(i);
+  TEST_ASSERT(replayed == expected);
+  TEST_ASSERT(torn_storage.get_dropped() == 0);
+}
+
+int main() {
+  test_ram();
+  test_flash();
+  test_flash_reboot();
+  test_pass();
+}
@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "broker.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::mqtt;
+
+/// The size (topic and payload) of the messages of test_priority_drop().
+static const size_t MESSAGE_SIZE = 100;
+
+static TestBroker broker;
+
+/// Run the loop until the broker received count messages, or for at most timeout ms.
+static void loop_until_published(size_t count, uint32_t timeout = 2000) {
+  const uint32_t start = millis();
+  while (broker.get_published_count() < count && millis() - start < timeout)
+    App.loop();
+}
+
+/// Publish a message of MESSAGE_SIZE bytes with name at the start of its payload.
+static bool publish_sized(MQTTClientComponent *mqtt, const std::string &name, MQTTPublishPriority priority) {
+  const std::string topic = "q/x";
+  return mqtt->publish(topic, name + std::string(MESSAGE_SIZE - topic.size() - name.size(), '.'), 0, false,
+                       priority);
+}
+
+/// The names (see publish_sized()) of the messages the broker received.
+static std::vector<std::string> published_names() {
+  std::vector<std::string> names;
+  for (const TestBrokerMessage &message : broker.get_published())
+    names.push_back(message.payload.substr(0, message.payload.find('.')));
+  return names;
+}
+
+/** A retained message replaces a queued retained message of the same topic and priority, keeping its place in the
+ * queue. Messages that aren't retained or have another priority are all sent.
+ */
+static void test_coalescing(MQTTClientComponent *mqtt) {
+  broker.clear_published();
+  const uint32_t coalesced = mqtt->get_messages_coalesced();
+  TEST_ASSERT(mqtt->publish("q/a", "1", 0, true));
+  TEST_ASSERT(mqtt->publish("q/b", "1", 0, true));
+  TEST_ASSERT(mqtt->publish("q/a", "2", 0, true));
+  TEST_ASSERT(mqtt->publish("q/c", "1", 0, false));
+  TEST_ASSERT(mqtt->publish("q/c", "2", 0, false));
+  TEST_ASSERT(mqtt->publish("q/a", "d", 0, true, MQTT_PRIORITY_DISCOVERY));
+  TEST_ASSERT(mqtt->publish("q/a", "3", 0, true));
+  TEST_ASSERT(mqtt->get_messages_coalesced() == coalesced + 2);
+
+  loop_until_published(5);
+  // give messages that shouldn't be there a chance to arrive
+  for (int i = 0; i < 10; i++)
+    App.loop();
+  const std::vector<TestBrokerMessage> published = broker.get_published();
+  const std::vector<std::pair<std::string, std::string>> expected = {
+      {"q/a", "3"}, {"q/b", "1"}, {"q/c", "1"}, {"q/c", "2"}, {"q/a", "d"},
+  };
+  TEST_ASSERT(published.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    TEST_ASSERT(published[i].topic == expected[i].first);
+    TEST_ASSERT(published[i].payload == expected[i].second);
+  }
+  TEST_ASSERT(published[0].retain && !published[2].retain);
+}
+
+/** A full queue makes room by dropping the oldest messages of the lowest priority class, states before discovery
+ * before logs. A message is dropped itself if only messages of a higher class are queued.
+ */
+static void test_priority_drop(MQTTClientComponent *mqtt) {
+  broker.clear_published();
+  mqtt->set_max_queue_size(10 * MESSAGE_SIZE);
+  const uint32_t dropped = mqtt->get_messages_dropped();
+  for (const char *name : {"s0", "s1", "s2", "s3"})
+    TEST_ASSERT(publish_sized(mqtt, name, MQTT_PRIORITY_STATE));
+  for (const char *name : {"l0", "l1", "l2"})
+    TEST_ASSERT(publish_sized(mqtt, name, MQTT_PRIORITY_LOG));
+  for (const char *name : {"d0", "d1", "d2"})
+    TEST_ASSERT(publish_sized(mqtt, name, MQTT_PRIORITY_DISCOVERY));
+  TEST_ASSERT(mqtt->get_messages_dropped() == dropped);
+
+  // each drops the oldest log message
+  TEST_ASSERT(publish_sized(mqtt, "s4", MQTT_PRIORITY_STATE));
+  TEST_ASSERT(publish_sized(mqtt, "d3", MQTT_PRIORITY_DISCOVERY));
+  TEST_ASSERT(publish_sized(mqtt, "l3", MQTT_PRIORITY_LOG));
+  TEST_ASSERT(mqtt->get_messages_dropped() == dropped + 3);
+  // the last log message, then the oldest discovery message
+  TEST_ASSERT(publish_sized(mqtt, "s5", MQTT_PRIORITY_STATE));
+  TEST_ASSERT(publish_sized(mqtt, "s6", MQTT_PRIORITY_STATE));
+  TEST_ASSERT(mqtt->get_messages_dropped() == dropped + 5);
+  // doesn't displace the queued discovery messages
+  TEST_ASSERT(!publish_sized(mqtt, "l4", MQTT_PRIORITY_LOG));
+  TEST_ASSERT(mqtt->get_messages_dropped() == dropped + 6);
+
+  loop_until_published(10);
+  for (int i = 0; i < 10; i++)
+    App.loop();
+  const std::vector<std::string> expected = {"s0", "s1", "s2", "s3", "s4", "s5", "s6", "d1", "d2", "d3"};
+  TEST_ASSERT(published_names() == expected);
+  mqtt->set_max_queue_size(8192);
+}
+
+int main() {
+  const uint16_t port = broker.start();
+  App.set_name("publish_queue");
+  App.init_log();
+  auto *mqtt = App.init_mqtt("127.0.0.1", port, "", "");
+  mqtt->disable_log_message();
+  mqtt->disable_birth_message();
+  App.set_max_idle_time(1);
+  App.setup();
+  const uint32_t start = millis();
+  while (!mqtt->is_connected() && millis() - start < 5000)
+    App.loop();
+  TEST_ASSERT(mqtt->is_connected());
+
+  test_coalescing(mqtt);
+  test_priority_drop(mqtt);
+  test_pass();
+}
@@ -0,0 +1,101 @@
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "broker.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::mqtt;
+
+/// Small enough that the messages of each test case wrap around the receive buffer many times.
+static const size_t RECEIVE_BUFFER_SIZE = 256;
+static const uint32_t MESSAGES = 300;
+
+static TestBroker broker;
+static std::vector<std::pair<std::string, std::string>> received;
+
+static std::string make_topic(uint32_t i) {
+  return "r/" + std::to_string(i % 7);
+}
+
+/// Between 1 and 200 bytes, so that messages end at all offsets of the buffer and some don't fit at its end.
+static std::string make_payload(uint32_t i) {
+  std::string payload(1 + (i * 37) % 200, ' ');
+  for (size_t j = 0; j < payload.size(); j++)
+    payload[j] = char('a' + (i + j) % 26);
+  return payload;
+}
+
+/// Run the loop until count messages were received, or for at most timeout ms.
+static void loop_until_received(size_t count, uint32_t timeout = 5000) {
+  const uint32_t start = millis();
+  while (received.size() < count && millis() - start < timeout)
+    App.loop();
+}
+
+/** Messages sent by the broker in a burst (the network task waits for the main loop to make room) are all handled
+ * in order with their complete payload, whole or delivered in fragments of fragment_size bytes.
+ */
+static void test_receive(MQTTClientComponent *mqtt, size_t fragment_size) {
+  host::set_mqtt_fragment_size(fragment_size);
+  received.clear();
+  const uint32_t rejected = mqtt->get_messages_rejected();
+  std::thread sender([]() {
+    for (uint32_t i = 0; i < MESSAGES; i++)
+      broker.send(make_topic(i), make_payload(i));
+  });
+  loop_until_received(MESSAGES);
+  sender.join();
+
+  TEST_ASSERT(received.size() == MESSAGES);
+  for (uint32_t i = 0; i < MESSAGES; i++) {
+    TEST_ASSERT(received[i].first == make_topic(i));
+    TEST_ASSERT(received[i].second == make_payload(i));
+  }
+  TEST_ASSERT(mqtt->get_messages_rejected() == rejected);
+}
+
+/// A message larger than the receive buffer is rejected with all its fragments, the next one is handled.
+static void test_too_large(MQTTClientComponent *mqtt) {
+  host::set_mqtt_fragment_size(16);
+  received.clear();
+  const uint32_t rejected = mqtt->get_messages_rejected();
+  broker.send("r/large", std::string(RECEIVE_BUFFER_SIZE, 'x'));
+  broker.send(make_topic(1), make_payload(1));
+  loop_until_received(1);
+  for (int i = 0; i < 10; i++)
+    App.loop();
+
+  TEST_ASSERT(received.size() == 1);
+  TEST_ASSERT(received[0].first == make_topic(1));
+  TEST_ASSERT(received[0].second == make_payload(1));
+  TEST_ASSERT(mqtt->get_messages_rejected() == rejected + 1);
+}
+
+int main() {
+  const uint16_t port = broker.start();
+  App.set_name("receive");
+  App.init_log();
+  auto *mqtt = App.init_mqtt("127.0.0.1", port, "", "");
+  mqtt->disable_log_message();
+  mqtt->set_receive_buffer_size(RECEIVE_BUFFER_SIZE);
+  mqtt->subscribe_with_topic("r/#", [](const StringRef &topic, const StringRef &payload) {
+    received.emplace_back(topic.str(), payload.str());
+  });
+  App.set_max_idle_time(1);
+  App.setup();
+  const uint32_t start = millis();
+  while (!mqtt->is_connected() && millis() - start < 5000)
+    App.loop();
+  TEST_ASSERT(mqtt->is_connected());
+
+  test_receive(mqtt, 0);
+  test_receive(mqtt, 7);
+  test_receive(mqtt, 64);
+  test_too_large(mqtt);
+  test_pass();
+}
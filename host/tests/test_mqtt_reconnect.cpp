@@ -0,0 +1,121 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// How many connections the broker closes right away before it accepts one, enough to reach MAX_DELAY.
+static const uint32_t REFUSED_CONNECTIONS = 5;
+static const uint32_t MIN_DELAY = 100;
+static const uint32_t MAX_DELAY = 800;
+
+static std::atomic<uint32_t> connections{0};
+
+/** A broker that closes the first REFUSED_CONNECTIONS connections right away, accepts the next one and
+ * closes it after 300ms, then closes all further connections right away again.
+ */
+static void run_broker(int listen_fd) {
+  while (true) {
+    const int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+    if (++connections == REFUSED_CONNECTIONS + 1) {
+      uint8_t buffer[256];
+      // the CONNECT packet, answered with CONNACK "accepted"
+      if (recv(fd, buffer, sizeof(buffer), 0) > 0) {
+        const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+        send(fd, connack, sizeof(connack), 0);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    close(fd);
+  }
+}
+
+/// Start the broker on a free port, returns the port.
+static uint16_t start_broker() {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  TEST_ASSERT(fd >= 0);
+  struct sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  TEST_ASSERT(bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0);
+  TEST_ASSERT(listen(fd, 4) == 0);
+  socklen_t len = sizeof(address);
+  TEST_ASSERT(getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &len) == 0);
+  std::thread(run_broker, fd).detach();
+  return ntohs(address.sin_port);
+}
+
+static uint32_t now_ms() {
+  return uint32_t(host::get_time() / 1000);
+}
+
+/** The delays between failed attempts double from the minimum up to the maximum, are randomized to between
+ * half and all of that, reset after a successful connection, and the loop never blocks while waiting.
+ */
+static void test_backoff(uint16_t port) {
+  auto *mqtt = App.init_mqtt("127.0.0.1", port, "", "");
+  mqtt->set_reconnect_delay(MIN_DELAY, MAX_DELAY);
+  mqtt->set_connect_timeout(1000);
+  App.set_max_idle_time(0);
+  App.setup();
+
+  // the delays before each attempt, 0 marks the connection being accepted
+  std::vector<uint32_t> delays;
+  mqtt::MQTTClientState state = mqtt->get_state();
+  uint32_t state_start = now_ms();
+  uint32_t max_loop_time = 0;
+  const uint32_t start = now_ms();
+  while (delays.size() < REFUSED_CONNECTIONS + 3 && now_ms() - start < 10000) {
+    const uint32_t loop_start = now_ms();
+    App.loop();
+    max_loop_time = std::max(max_loop_time, now_ms() - loop_start);
+
+    const mqtt::MQTTClientState new_state = mqtt->get_state();
+    if (new_state == state)
+      continue;
+    if (new_state == mqtt::MQTT_CLIENT_CONNECTING && state == mqtt::MQTT_CLIENT_DISCONNECTED)
+      delays.push_back(now_ms() - state_start);
+    if (new_state == mqtt::MQTT_CLIENT_CONNECTED)
+      delays.push_back(0);
+    state = new_state;
+    state_start = now_ms();
+  }
+
+  TEST_ASSERT(delays.size() == REFUSED_CONNECTIONS + 3);
+  uint32_t backoff = MIN_DELAY;
+  for (uint32_t i = 0; i < REFUSED_CONNECTIONS; i++) {
+    TEST_ASSERT(delays[i] + 2 >= backoff / 2 && delays[i] <= backoff + 50);
+    backoff = std::min(backoff * 2, MAX_DELAY);
+  }
+  TEST_ASSERT(delays[REFUSED_CONNECTIONS] == 0);
+  TEST_ASSERT(connections.load() >= REFUSED_CONNECTIONS + 1);
+  // back at the minimum delay after the connection was lost
+  const uint32_t after_loss = delays[REFUSED_CONNECTIONS + 1];
+  TEST_ASSERT(after_loss + 2 >= MIN_DELAY / 2 && after_loss <= MIN_DELAY + 50);
+  const uint32_t second = delays[REFUSED_CONNECTIONS + 2];
+  TEST_ASSERT(second + 2 >= MIN_DELAY && second <= 2 * MIN_DELAY + 50);
+  TEST_ASSERT(max_loop_time < 50);
+}
+
+int main() {
+  const uint16_t port = start_broker();
+  App.set_name("reconnect");
+  App.init_log();
+  test_backoff(port);
+  test_pass();
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "esphomelib/helpers.h"
+#include "esphomelib/sensor/filter.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+/// Quantile q of the sorted values, interpolating linearly between the closest ranks.
+static float reference_quantile(const std::vector<float> &sorted, float q) {
+  const float position = q * (sorted.size() - 1);
+  const size_t lower = size_t(position);
+  if (lower + 1 >= sorted.size())
+    return sorted[lower];
+  return sorted[lower] + (position - lower) * (sorted[lower + 1] - sorted[lower]);
+}
+
+static float reference_mad(const std::vector<float> &sorted) {
+  const float median = reference_quantile(sorted, 0.5f);
+  std::vector<float> distances;
+  for (float value : sorted)
+    distances.push_back(fabsf(value - median));
+  std::sort(distances.begin(), distances.end());
+  return reference_quantile(distances, 0.5f);
+}
+
+/** Every rank, quantile and the MAD of the treap match a sorted copy of the window.
+ *
+ * @param max_size The window size.
+ * @param distinct The number of distinct values, small values give lots of duplicates.
+ */
+static void test_against_sorted(size_t max_size, uint32_t distinct) {
+  SlidingWindowQuantile window(max_size);
+  std::deque<float> reference;
+  std::mt19937 rng(max_size * 31 + distinct);
+  std::uniform_int_distribution<uint32_t> dist(0, distinct - 1);
+
+  TEST_ASSERT(std::isnan(window.get_median()));
+  TEST_ASSERT(std::isnan(window.get_median_absolute_deviation()));
+  for (uint32_t i = 0; i < 5 * max_size + 100; i++) {
+    const float value = dist(rng) * 0.25f - 10.0f;
+    window.next_value(value);
+    reference.push_back(value);
+    if (reference.size() > max_size)
+      reference.pop_front();
+
+    std::vector<float> sorted(reference.begin(), reference.end());
+    std::sort(sorted.begin(), sorted.end());
+    TEST_ASSERT(window.size() == sorted.size());
+    for (size_t k = 0; k < sorted.size(); k++)
+      TEST_ASSERT(window.get_kth(k) == sorted[k]);
+    for (float q : {0.0f, 0.1f, 0.25f, 0.5f, 0.9f, 1.0f})
+      TEST_ASSERT_NEAR(window.get_quantile(q), reference_quantile(sorted, q), 1e-4);
+    TEST_ASSERT_NEAR(window.get_median_absolute_deviation(), reference_mad(sorted), 1e-4);
+  }
+}
+
+/// Outliers are replaced by the median, also in a window without any deviation.
+static void test_hampel() {
+  HampelFilter noisy(9, 3.0f);
+  std::mt19937 rng(3);
+  std::normal_distribution<float> noise(20.0f, 0.1f);
+  for (int i = 0; i < 50; i++) {
+    const float value = noise(rng);
+    TEST_ASSERT(noisy.new_value(value).value == value);
+  }
+  Optional<float> out = noisy.new_value(35.0f);
+  TEST_ASSERT(out.defined);
+  TEST_ASSERT_NEAR(out.value, 20.0f, 0.5f);
+
+  // the MAD of a constant signal is 0, the relative minimum deviation still rejects spikes
+  HampelFilter constant(9, 3.0f);
+  for (int i = 0; i < 20; i++)
+    TEST_ASSERT(constant.new_value(20.0f).value == 20.0f);
+  TEST_ASSERT(constant.new_value(25.0f).value == 20.0f);
+  // changes within the minimum deviation pass
+  TEST_ASSERT(constant.new_value(20.01f).value == 20.01f);
+
+  // the minimum deviation can be set, also for a signal around 0
+  HampelFilter zero(9, 3.0f, 0.5f);
+  for (int i = 0; i < 20; i++)
+    zero.new_value(0.0f);
+  TEST_ASSERT(zero.new_value(1.0f).value == 1.0f);
+  TEST_ASSERT(zero.new_value(2.0f).value == 0.0f);
+  TEST_ASSERT(!zero.new_value(NAN).defined);
+}
+
+int main() {
+  for (size_t max_size : {1, 2, 5, 64, 301})
+    for (uint32_t distinct : {3, 50, 100000})
+      test_against_sorted(max_size, distinct);
+  test_hampel();
+  test_pass();
+}
@@ -0,0 +1,180 @@
+#include <cstdint>
+#include <vector>
+
+#include "esphomelib/scheduler.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// The virtual time in ms, unlike millis() this doesn't roll over.
+static uint64_t now_ms() {
+  return host::get_time() / 1000;
+}
+
+/// Advance the virtual clock by ms in 1ms steps, running the due functions after each one.
+static void run_for(Scheduler &scheduler, uint32_t ms) {
+  for (uint32_t i = 0; i < ms; i++) {
+    host::advance_time(1000);
+    scheduler.call();
+  }
+}
+
+/// Timeouts run in the order of their deadlines, not in the order they were scheduled.
+static void test_timeout_order() {
+  Scheduler scheduler;
+  std::vector<uint32_t> order;
+  std::vector<uint64_t> fired_at;
+  auto *o = &order;
+  auto *f = &fired_at;
+  const uint64_t start = now_ms();
+
+  for (uint32_t timeout : {50, 10, 30, 20, 40})
+    scheduler.set_timeout(nullptr, 0, timeout, [o, f, timeout]() {
+      o->push_back(timeout);
+      f->push_back(now_ms());
+    });
+  run_for(scheduler, 100);
+
+  TEST_ASSERT((order == std::vector<uint32_t>{10, 20, 30, 40, 50}));
+  for (size_t i = 0; i < order.size(); i++)
+    TEST_ASSERT_NEAR(fired_at[i] - start, order[i], 1);
+}
+
+/// Intervals run right away and then every interval ms.
+static void test_interval() {
+  Scheduler scheduler;
+  std::vector<uint64_t> fired_at;
+  auto *f = &fired_at;
+
+  scheduler.set_interval(nullptr, 1, 100, [f]() {
+    f->push_back(now_ms());
+  });
+  run_for(scheduler, 1000);
+
+  // the first gap is shortened by the random offset
+  TEST_ASSERT(fired_at.size() == 10 || fired_at.size() == 11);
+  for (size_t i = 2; i < fired_at.size(); i++)
+    TEST_ASSERT_NEAR(fired_at[i] - fired_at[i - 1], 100, 1);
+}
+
+/// Name ids replace and cancel functions, but only those of the same type.
+static void test_cancel() {
+  Scheduler scheduler;
+  std::vector<char> calls;
+  auto *c = &calls;
+
+  scheduler.set_timeout(nullptr, 1, 10, [c]() { c->push_back('a'); });
+  // replaces 'a'
+  scheduler.set_timeout(nullptr, 1, 20, [c]() { c->push_back('b'); });
+  scheduler.set_timeout(nullptr, 2, 10, [c]() { c->push_back('c'); });
+  // an interval with the same name id doesn't replace the timeout
+  scheduler.set_interval(nullptr, 2, 1000, [c]() { c->push_back('i'); });
+  TEST_ASSERT(scheduler.cancel_timeout(nullptr, 2));
+  TEST_ASSERT(!scheduler.cancel_timeout(nullptr, 2));
+  TEST_ASSERT(!scheduler.cancel_timeout(nullptr, 3));
+  scheduler.defer(nullptr, 3, [c]() { c->push_back('d'); });
+  // nothing without a name id can be cancelled
+  TEST_ASSERT(!scheduler.cancel_defer(nullptr, 0));
+
+  scheduler.call();
+  TEST_ASSERT((calls == std::vector<char>{'i', 'd'}) || (calls == std::vector<char>{'d', 'i'}));
+  run_for(scheduler, 50);
+  TEST_ASSERT((calls.size() == 3 && calls[2] == 'b'));
+
+  // an interval cancelling itself from its callback
+  auto *s = &scheduler;
+  scheduler.set_interval(nullptr, 4, 10, [c, s]() {
+    c->push_back('x');
+    s->cancel_interval(nullptr, 4);
+  });
+  run_for(scheduler, 100);
+  TEST_ASSERT(calls.size() == 4 && calls[3] == 'x');
+  TEST_ASSERT(scheduler.cancel_interval(nullptr, 2));
+  TEST_ASSERT(scheduler.next_schedule_in() == UINT32_MAX);
+}
+
+/// Deadlines after the roll-over of millis() (every 49.7 days) keep their order and don't run early.
+static void test_rollover() {
+  // 300ms before millis() rolls over
+  host::advance_time(((uint64_t(1) << 32) - 300 - millis()) * 1000);
+  Scheduler scheduler;
+  std::vector<uint64_t> intervals;
+  std::vector<uint32_t> order;
+  auto *i = &intervals;
+  auto *o = &order;
+  const uint64_t start = now_ms();
+
+  scheduler.set_interval(nullptr, 1, 100, [i]() {
+    i->push_back(now_ms());
+  });
+  scheduler.set_timeout(nullptr, 2, 1000, [o, start]() {
+    TEST_ASSERT_NEAR(now_ms() - start, 1000, 1);
+    o->push_back(1000);
+  });
+  scheduler.set_timeout(nullptr, 3, 200, [o, start]() {
+    TEST_ASSERT_NEAR(now_ms() - start, 200, 1);
+    o->push_back(200);
+  });
+  run_for(scheduler, 100);
+  // the timeouts are both still due after the roll-over
+  TEST_ASSERT(scheduler.next_schedule_in() <= 100);
+
+  run_for(scheduler, 1400);
+  TEST_ASSERT(millis() < 2000);
+  TEST_ASSERT((order == std::vector<uint32_t>{200, 1000}));
+  TEST_ASSERT(intervals.size() >= 14);
+  for (size_t k = 2; k < intervals.size(); k++)
+    TEST_ASSERT_NEAR(intervals[k] - intervals[k - 1], 100, 1);
+}
+
+/// Intervals with a phase run at phase ms after multiples of their interval, intervals with different
+/// phases never run in the same call().
+static void test_phase() {
+  Scheduler scheduler;
+  struct Run {
+    uint32_t id;
+    uint32_t time;
+    uint32_t call;
+  };
+  std::vector<Run> runs;
+  uint32_t call = 0;
+  auto *r = &runs;
+  auto *c = &call;
+  const uint32_t intervals[] = {1000, 2000, 500};
+  // 2300 is the same phase as 300
+  const uint32_t phases[] = {0, 150, 2300};
+  for (uint32_t id = 0; id < 3; id++)
+    scheduler.set_interval(nullptr, id + 1, intervals[id], phases[id], [r, c, id]() {
+      r->push_back(Run{id, millis(), *c});
+    });
+
+  for (uint32_t i = 0; i < 10000; i++) {
+    host::advance_time(1000);
+    call++;
+    scheduler.call();
+  }
+
+  uint32_t count[3] = {0, 0, 0};
+  for (size_t i = 0; i < runs.size(); i++) {
+    const Run &run = runs[i];
+    // the first run is right away, the others in phase
+    if (count[run.id]++ != 0)
+      TEST_ASSERT_NEAR(run.time % intervals[run.id], phases[run.id] % intervals[run.id], 1);
+    if (i != 0 && run.call != 1)
+      TEST_ASSERT(run.call != runs[i - 1].call);
+  }
+  TEST_ASSERT_NEAR(count[0], 11, 1);
+  TEST_ASSERT_NEAR(count[1], 6, 1);
+  TEST_ASSERT_NEAR(count[2], 21, 1);
+}
+
+int main() {
+  host::use_virtual_clock(true);
+  test_timeout_order();
+  test_interval();
+  test_cancel();
+  test_phase();
+  test_rollover();
+  test_pass();
+}
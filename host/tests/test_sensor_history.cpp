@@ -0,0 +1,127 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "esphomelib/sensor/sensor_history.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::sensor;
+
+struct Sample {
+  uint32_t time;
+  float value;
+};
+
+static std::vector<Sample> decode(const SensorHistory &history, uint32_t since = 0, bool all_samples = true) {
+  std::vector<Sample> samples;
+  auto *s = &samples;
+  TEST_ASSERT(history.for_each(since, [s](uint32_t time, float value) {
+    s->push_back(Sample{time, value});
+  }, all_samples));
+  return samples;
+}
+
+static bool same_bits(float a, float b) {
+  return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+/// Regular intervals with jitter, gaps of hours and a millis() roll-over, with random values.
+static std::vector<Sample> make_input(size_t count, bool smooth) {
+  std::mt19937 rng(count);
+  std::uniform_int_distribution<uint32_t> percent(0, 99);
+  std::uniform_int_distribution<uint32_t> jitter(0, 300);
+  std::uniform_int_distribution<uint32_t> gap(60000, 100000000);
+  std::normal_distribution<float> step(0.0f, 0.3f);
+  std::uniform_real_distribution<float> any(-1e6f, 1e6f);
+  // about 1000 samples before the roll-over
+  uint32_t time = UINT32_MAX - 1000000;
+  float value = 21.5f;
+  std::vector<Sample> samples;
+  for (size_t i = 0; i < count; i++) {
+    const uint32_t p = percent(rng);
+    time += p < 80 ? 1000 : (p < 98 ? 700 + jitter(rng) : gap(rng));
+    if (smooth)
+      value += step(rng);
+    else
+      value = p < 5 ? 0.0f : (p < 7 ? -INFINITY : any(rng));
+    samples.push_back(Sample{time, value});
+  }
+  return samples;
+}
+
+/// Without rounding, values come back bit for bit and times with TIME_RESOLUTION.
+static void test_exact(bool smooth) {
+  const std::vector<Sample> input = make_input(3000, smooth);
+  SensorHistory history(64 * 1024);
+  for (const Sample &sample : input)
+    history.add(sample.time, sample.value);
+
+  const std::vector<Sample> output = decode(history);
+  TEST_ASSERT(history.size() == input.size());
+  TEST_ASSERT(output.size() == input.size());
+  for (size_t i = 0; i < input.size(); i++) {
+    TEST_ASSERT(output[i].time == input[i].time / SensorHistory::TIME_RESOLUTION * SensorHistory::TIME_RESOLUTION);
+    TEST_ASSERT(same_bits(output[i].value, input[i].value));
+  }
+  TEST_ASSERT(history.get_bytes_used() <= history.get_capacity());
+}
+
+/// Rounded values come back rounded, and compress to a few bytes per sample.
+static void test_rounded() {
+  const std::vector<Sample> input = make_input(3000, true);
+  SensorHistory history(64 * 1024, 1);
+  for (const Sample &sample : input)
+    history.add(sample.time, sample.value);
+
+  const std::vector<Sample> output = decode(history);
+  TEST_ASSERT(output.size() == input.size());
+  for (size_t i = 0; i < input.size(); i++)
+    TEST_ASSERT_NEAR(output[i].value, roundf(input[i].value * 10.0f) / 10.0f, 1e-3);
+  TEST_ASSERT(history.get_bytes_used() < 3 * input.size());
+}
+
+/// Once the memory budget is used up the oldest blocks are dropped, the newest samples are kept.
+static void test_full() {
+  const std::vector<Sample> input = make_input(20000, true);
+  SensorHistory history(1024, 1);
+  for (const Sample &sample : input)
+    history.add(sample.time, sample.value);
+
+  const std::vector<Sample> output = decode(history);
+  TEST_ASSERT(history.size() == output.size());
+  TEST_ASSERT(output.size() > 100 && output.size() < input.size());
+  const size_t offset = input.size() - output.size();
+  for (size_t i = 0; i < output.size(); i++) {
+    TEST_ASSERT(output[i].time / SensorHistory::TIME_RESOLUTION ==
+                input[offset + i].time / SensorHistory::TIME_RESOLUTION);
+    TEST_ASSERT_NEAR(output[i].value, roundf(input[offset + i].value * 10.0f) / 10.0f, 1e-3);
+  }
+  TEST_ASSERT(history.get_bytes_used() <= history.get_capacity());
+}
+
+/// Only samples after since are passed, also when since is before the roll-over.
+static void test_since() {
+  SensorHistory history(4096);
+  const uint32_t start = UINT32_MAX - 4999;
+  for (uint32_t i = 0; i < 10; i++)
+    history.add(start + i * 1000, float(i));
+
+  std::vector<Sample> output = decode(history, start + 2000, false);
+  TEST_ASSERT(output.size() == 7);
+  TEST_ASSERT(output[0].value == 3.0f);
+  output = decode(history, start + 7000, false);
+  TEST_ASSERT(output.size() == 2);
+  TEST_ASSERT(output[0].value == 8.0f);
+}
+
+int main() {
+  test_exact(true);
+  test_exact(false);
+  test_rounded();
+  test_full();
+  test_since();
+  test_pass();
+}
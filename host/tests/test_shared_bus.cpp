@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "esphomelib/application.h"
+#include "host_platform.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// A transaction on the simulated bus, from the update() that starts it to the end of its deferred read.
+struct Transaction {
+  uint32_t start;
+  uint32_t end;
+};
+
+/// The simulation state shared by all devices.
+struct Bus {
+  std::vector<Transaction> transactions;
+  uint32_t iteration_busy{0}; ///< How long the current loop iteration was blocked by the devices, in ms.
+  uint32_t worst_read_delay{0}; ///< The longest a read ran after the end of its conversion, in ms.
+};
+
+/** A sensor on a shared bus like the I2C drivers: update() sends a measurement request (start ms of blocking
+ * bus traffic) and the data is read (read ms) conversion ms later from a timeout.
+ */
+class SimulatedDevice : public PollingComponent {
+ public:
+  SimulatedDevice(Bus *bus, SharedBus *shared_bus, uint32_t interval, uint32_t start, uint32_t conversion,
+                  uint32_t read)
+      : PollingComponent(interval), bus_(bus), shared_bus_(shared_bus), start_(start), conversion_(conversion),
+        read_(read) {}
+
+  void setup() override {
+    if (this->shared_bus_ != nullptr)
+      this->set_polling_bus(this->shared_bus_, this->get_transaction_time());
+  }
+  void update() override {
+    if (!this->active)
+      return;
+    const uint32_t start = millis();
+    this->block_(this->start_);
+    const uint32_t converted = millis() + this->conversion_;
+    this->set_timeout(fnv1a_hash("read"), this->conversion_, [this, start, converted]() {
+      // another device blocked the loop when the conversion was done
+      this->bus_->worst_read_delay = std::max(this->bus_->worst_read_delay, millis() - converted);
+      this->block_(this->read_);
+      this->bus_->transactions.push_back(Transaction{start, millis()});
+    });
+  }
+
+  uint32_t get_transaction_time() const { return this->start_ + this->conversion_ + this->read_; }
+  uint32_t get_phase() const { return this->update_phase_.value; }
+  /// Schedule the updates again, with a new random offset if this device isn't on a SharedBus.
+  void reschedule() { this->schedule_update_(); }
+
+  bool active{false};
+
+ protected:
+  /// Occupy the bus and the loop for ms, like a blocking I2C transfer.
+  void block_(uint32_t ms) {
+    delay(ms);
+    this->bus_->iteration_busy += ms;
+  }
+
+  Bus *bus_;
+  SharedBus *shared_bus_;
+  uint32_t start_;
+  uint32_t conversion_;
+  uint32_t read_;
+};
+
+/// A polling interval, request time, conversion time and read time in ms, like the I2C sensors of a fast node.
+struct DeviceSpec {
+  uint32_t interval;
+  uint32_t start;
+  uint32_t conversion;
+  uint32_t read;
+};
+static const DeviceSpec SPECS[] = {
+    {1000, 1, 10, 2},  // BME280
+    {1000, 1, 31, 2},  // BMP085
+    {2000, 1, 66, 2},  // HTU21D
+    {2000, 1, 15, 1},  // SHT3xD
+    {5000, 1, 24, 1},  // BH1750
+    {5000, 1, 122, 1}, // TSL2561
+};
+static const size_t DEVICES = sizeof(SPECS) / sizeof(SPECS[0]);
+/// The intervals repeat after this many ms (their LCM).
+static const uint32_t HYPERPERIOD = 10000;
+
+struct Result {
+  uint32_t worst_loop_time{0}; ///< The longest loop iteration, in ms.
+  uint32_t worst_read_delay{0}; ///< The longest a read was delayed by other devices, in ms.
+  uint32_t overlapping{0}; ///< Transactions that started while another one was still running.
+  uint32_t transactions{0};
+};
+
+/// Run the loop for duration ms and record the loop time and bus overlaps of the active devices.
+static void simulate(Bus *bus, uint32_t duration, Result *result) {
+  bus->transactions.clear();
+  bus->worst_read_delay = 0;
+  const uint32_t start = millis();
+  while (millis() - start < duration) {
+    bus->iteration_busy = 0;
+    App.loop();
+    result->worst_loop_time = std::max(result->worst_loop_time, bus->iteration_busy);
+  }
+  result->worst_read_delay = std::max(result->worst_read_delay, bus->worst_read_delay);
+  std::vector<Transaction> &t = bus->transactions;
+  std::sort(t.begin(), t.end(), [](const Transaction &a, const Transaction &b) { return a.start < b.start; });
+  uint32_t busy_until = 0;
+  for (size_t i = 0; i < t.size(); i++) {
+    if (i != 0 && t[i].start < busy_until)
+      result->overlapping++;
+    busy_until = std::max(busy_until, t[i].end);
+  }
+  result->transactions += t.size();
+}
+
+/// The phases are spread evenly over the bus period (the GCD of the intervals), each one after the previous
+/// transaction plus an equal share of the free time.
+static void test_phases(SharedBus *shared_bus, const std::vector<SimulatedDevice *> &devices) {
+  TEST_ASSERT(shared_bus->get_bus_period() == 1000);
+  uint32_t bus_time = 0;
+  for (auto *device : devices)
+    bus_time += device->get_transaction_time();
+  TEST_ASSERT(shared_bus->get_bus_time() == bus_time);
+  const uint32_t gap = (1000 - bus_time) / DEVICES;
+  TEST_ASSERT(devices[0]->get_phase() == 0);
+  for (size_t i = 1; i < DEVICES; i++) {
+    const SimulatedDevice *previous = devices[i - 1];
+    TEST_ASSERT(devices[i]->get_phase() == previous->get_phase() + previous->get_transaction_time() + gap);
+  }
+}
+
+/** Worst-case loop time, read delay and overlapping bus transactions of the same devices with random offsets
+ * (before) and with the phases of a SharedBus (after). The random offsets are drawn again (from the hardware
+ * random source, so only the SharedBus results are checked) for each of TRIALS runs. Each run starts after one
+ * hyperperiod, so the first updates right after (re-)scheduling don't count.
+ */
+static void test_worst_case(Bus *bus, const std::vector<SimulatedDevice *> &random_devices,
+                            const std::vector<SimulatedDevice *> &phased_devices) {
+  const int TRIALS = 100;
+  Result before, after;
+  for (auto *device : random_devices)
+    device->active = true;
+  for (int trial = 0; trial < TRIALS; trial++) {
+    for (auto *device : random_devices)
+      device->reschedule();
+    Result warm_up;
+    simulate(bus, HYPERPERIOD, &warm_up);
+    simulate(bus, 2 * HYPERPERIOD, &before);
+  }
+  for (auto *device : random_devices)
+    device->active = false;
+  for (auto *device : phased_devices)
+    device->active = true;
+  Result warm_up;
+  simulate(bus, HYPERPERIOD, &warm_up);
+  for (int trial = 0; trial < TRIALS; trial++)
+    simulate(bus, 2 * HYPERPERIOD, &after);
+
+  printf("%-16s %16s %17s %24s\n", "", "worst loop time", "worst read delay", "overlapping transactions");
+  printf("%-16s %14ums %15ums %15u of %6u\n", "random offsets", before.worst_loop_time, before.worst_read_delay,
+         before.overlapping, before.transactions);
+  printf("%-16s %14ums %15ums %15u of %6u\n", "SharedBus", after.worst_loop_time, after.worst_read_delay,
+         after.overlapping, after.transactions);
+
+  uint32_t expected = 0;
+  for (const DeviceSpec &spec : SPECS)
+    expected += TRIALS * 2 * HYPERPERIOD / spec.interval;
+  // a transaction that's still running at the end of a run is counted in the next one
+  TEST_ASSERT_NEAR(after.transactions, expected, 1);
+  TEST_ASSERT(after.overlapping == 0);
+  // timeouts can run up to 1ms late on the virtual clock, but never because another device blocked the loop
+  TEST_ASSERT(after.worst_read_delay <= 1);
+  // a single request or read, never two in the same iteration
+  TEST_ASSERT(after.worst_loop_time == 2);
+}
+
+int main() {
+  host::use_virtual_clock(true);
+  App.set_name("shared_bus");
+  App.init_log();
+  Bus bus;
+  SharedBus shared_bus;
+  std::vector<SimulatedDevice *> random_devices, phased_devices;
+  for (const DeviceSpec &spec : SPECS) {
+    random_devices.push_back(App.register_component(
+        new SimulatedDevice(&bus, nullptr, spec.interval, spec.start, spec.conversion, spec.read)));
+    phased_devices.push_back(App.register_component(
+        new SimulatedDevice(&bus, &shared_bus, spec.interval, spec.start, spec.conversion, spec.read)));
+  }
+  App.setup();
+
+  test_phases(&shared_bus, phased_devices);
+  test_worst_case(&bus, random_devices, phased_devices);
+  test_pass();
+}
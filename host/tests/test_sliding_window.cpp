@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <deque>
+#include <random>
+
+#include "esphomelib/helpers.h"
+#include "test.h"
+
+using namespace esphomelib;
+
+/// The exact average of window, in double precision.
+template<typename T> static double reference_average(const std::deque<T> &window) {
+  double sum = 0;
+  for (T value : window)
+    sum += value;
+  return sum / window.size();
+}
+
+/// The average follows the exact one of the last max_size values, also after millions of values.
+static void test_no_drift() {
+  SlidingWindowMovingAverage<float> average(15);
+  std::deque<float> window;
+  std::mt19937 rng(42);
+  // a large offset with small changes, where an incrementally updated float sum drifts the most
+  std::uniform_real_distribution<float> dist(-5.0f, 5.0f);
+
+  for (uint32_t i = 0; i < 2000000; i++) {
+    const float value = 10000.0f + dist(rng) + (i % 1000 == 0 ? 5000.0f : 0.0f);
+    window.push_back(value);
+    if (window.size() > 15)
+      window.pop_front();
+    const float result = average.next_value(value);
+    if (i % 997 == 0)
+      TEST_ASSERT_NEAR(result, reference_average(window), 0.01);
+  }
+  TEST_ASSERT_NEAR(average.calculate_average(), reference_average(window), 0.01);
+}
+
+/// Integer averages are exact, also while the window is filling up.
+static void test_integer() {
+  SlidingWindowMovingAverage<int32_t> average(4);
+  TEST_ASSERT(average.calculate_average() == 0);
+  TEST_ASSERT(average.next_value(4) == 4);
+  TEST_ASSERT(average.next_value(8) == 6);
+  TEST_ASSERT(average.next_value(12) == 8);
+  TEST_ASSERT(average.next_value(16) == 10);
+  // 4 drops out
+  TEST_ASSERT(average.next_value(20) == 14);
+  TEST_ASSERT(average.next_value(-56) == -2);
+}
+
+/// Resizing keeps the newest values.
+static void test_set_max_size() {
+  SlidingWindowMovingAverage<int32_t> average(5);
+  for (int32_t value = 1; value <= 7; value++)
+    average.next_value(value);
+  // window is 3, 4, 5, 6, 7 with the ring buffer wrapped around
+  average.set_max_size(2);
+  TEST_ASSERT(average.get_max_size() == 2);
+  TEST_ASSERT(average.calculate_average() == 6);
+  TEST_ASSERT(average.next_value(9) == 8);
+
+  average.set_max_size(4);
+  TEST_ASSERT(average.calculate_average() == 8);
+  TEST_ASSERT(average.next_value(1) == 5);
+  TEST_ASSERT(average.next_value(3) == 5);
+  // 7 drops out
+  TEST_ASSERT(average.next_value(11) == 6);
+}
+
+int main() {
+  test_no_drift();
+  test_integer();
+  test_set_max_size();
+  test_pass();
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "esphomelib/mqtt/mqtt_topic_index.h"
+#include "test.h"
+
+using namespace esphomelib;
+using namespace esphomelib::mqtt;
+
+static std::vector<std::string> split(const std::string &topic) {
+  std::vector<std::string> levels;
+  size_t begin = 0;
+  while (true) {
+    const size_t end = topic.find('/', begin);
+    levels.push_back(topic.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+    if (end == std::string::npos)
+      return levels;
+    begin = end + 1;
+  }
+}
+
+/// Whether filter matches topic, straight from the MQTT 3.1.1 specification (4.7).
+static bool reference_match(const std::string &filter, const std::string &topic) {
+  const std::vector<std::string> filter_levels = split(filter);
+  const std::vector<std::string> topic_levels = split(topic);
+  if (!topic.empty() && topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+    return false;
+  for (size_t i = 0; i < filter_levels.size(); i++) {
+    if (filter_levels[i] == "#")
+      return true;
+    if (i >= topic_levels.size())
+      return false;
+    if (filter_levels[i] != "+" && filter_levels[i] != topic_levels[i])
+      return false;
+  }
+  return filter_levels.size() == topic_levels.size();
+}
+
+static std::vector<size_t> match(const MQTTTopicIndex &index, const std::string &topic) {
+  std::vector<size_t> values;
+  auto *v = &values;
+  index.match(topic.data(), topic.size(), [v](size_t value) { v->push_back(value); });
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+static void test_filters() {
+  TEST_ASSERT(MQTTTopicIndex::is_valid_filter("a/b/c"));
+  TEST_ASSERT(MQTTTopicIndex::is_valid_filter("#"));
+  TEST_ASSERT(MQTTTopicIndex::is_valid_filter("+"));
+  TEST_ASSERT(MQTTTopicIndex::is_valid_filter("+/a/+/#"));
+  TEST_ASSERT(MQTTTopicIndex::is_valid_filter("a//b"));
+  TEST_ASSERT(!MQTTTopicIndex::is_valid_filter(""));
+  TEST_ASSERT(!MQTTTopicIndex::is_valid_filter("a#"));
+  TEST_ASSERT(!MQTTTopicIndex::is_valid_filter("a/#/b"));
+  TEST_ASSERT(!MQTTTopicIndex::is_valid_filter("a/b+"));
+  TEST_ASSERT(!MQTTTopicIndex::is_valid_filter("+a/b"));
+
+  MQTTTopicIndex index;
+  TEST_ASSERT(index.empty());
+  TEST_ASSERT(!index.insert("a/#/b", 0));
+  TEST_ASSERT(index.empty());
+}
+
+/// The edge cases of the wildcards and topics starting with `$`.
+static void test_wildcards() {
+  MQTTTopicIndex index;
+  const char *filters[] = {"#", "+", "+/+", "a/#", "a/+", "a/+/c", "$SYS/#", "$SYS/+/load", "a/b", "a/b", "/+"};
+  for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+    TEST_ASSERT(index.insert(filters[i], i));
+  TEST_ASSERT(!index.empty());
+
+  // `#` also matches the parent level, the same filter can be added twice
+  TEST_ASSERT((match(index, "a") == std::vector<size_t>{0, 1, 3}));
+  TEST_ASSERT((match(index, "a/b") == std::vector<size_t>{0, 2, 3, 4, 8, 9}));
+  TEST_ASSERT((match(index, "a/b/c") == std::vector<size_t>{0, 3, 5}));
+  // `+` matches empty levels
+  TEST_ASSERT((match(index, "a//c") == std::vector<size_t>{0, 3, 5}));
+  TEST_ASSERT((match(index, "/x") == std::vector<size_t>{0, 2, 10}));
+  // wildcards at the first level don't match topics starting with `$`, explicit `$` filters do
+  TEST_ASSERT((match(index, "$SYS/broker/load") == std::vector<size_t>{6, 7}));
+  TEST_ASSERT((match(index, "$SYS") == std::vector<size_t>{6}));
+  TEST_ASSERT((match(index, "a/$x") == std::vector<size_t>{0, 2, 3, 4}));
+  TEST_ASSERT((match(index, "b/c/d") == std::vector<size_t>{0}));
+}
+
+/// Random filters and topics over a small alphabet, so that lots of them match, against the specification.
+static void test_against_reference() {
+  std::mt19937 rng(24);
+  const char *levels[] = {"a", "b", "", "$x", "long_level_name"};
+  std::uniform_int_distribution<size_t> level_dist(0, 4);
+  std::uniform_int_distribution<size_t> depth_dist(1, 4);
+  std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+  std::vector<std::string> filters;
+  MQTTTopicIndex index;
+  for (size_t i = 0; i < 300; i++) {
+    std::string filter;
+    const size_t depth = depth_dist(rng);
+    for (size_t level = 0; level < depth; level++) {
+      if (level != 0)
+        filter += '/';
+      const uint32_t p = percent(rng);
+      if (p < 20)
+        filter += '+';
+      else if (p < 30 && level + 1 == depth)
+        filter += '#';
+      else
+        filter += levels[level_dist(rng)];
+    }
+    if (filter.empty())
+      // not a valid filter
+      continue;
+    TEST_ASSERT(index.insert(filter, filters.size()));
+    filters.push_back(filter);
+  }
+
+  for (size_t i = 0; i < 5000; i++) {
+    std::string topic;
+    const size_t depth = depth_dist(rng);
+    for (size_t level = 0; level < depth; level++) {
+      if (level != 0)
+        topic += '/';
+      topic += levels[level_dist(rng)];
+    }
+    if (topic.empty())
+      // not a valid topic
+      continue;
+    std::vector<size_t> expected;
+    for (size_t value = 0; value < filters.size(); value++)
+      if (reference_match(filters[value], topic))
+        expected.push_back(value);
+    TEST_ASSERT(match(index, topic) == expected);
+  }
+}
+
+int main() {
+  test_filters();
+  test_wildcards();
+  test_against_reference();
+  test_pass();
+}
@@ -40,21 +40,33 @@ static const char *TAG = "application";
 void Application::setup() {
   ESP_LOGI(TAG, "Application::setup()");
   assert(this->application_state_ == Component::CONSTRUCTION && "setup() called twice.");
+  // setup() and loop() are run by the same task.
+  this->loops_[0].bind_current_task();
   ESP_LOGV(TAG, "Sorting components by setup priority...");
   std::stable_sort(this->components_.begin(), this->components_.end(), [](const Component *a, const Component *b) {
     return a->get_setup_priority() > b->get_setup_priority();
   });
   ESP_LOGV(TAG, "Calling setup");
   for (Component *component : this->components_) {
-    if (!component->is_failed())
-      component->setup_();
+    if (component->is_failed())
+      continue;
+#ifdef USE_COMPONENT_PROFILER
+    const ProfileStats::Start start = ProfileStats::start();
+    component->setup_();
+    component->get_profile().setup.record(start);
+#else
+    component->setup_();
+#endif
   }
 
   ESP_LOGV(TAG, "Sorting components by loop priority...");
   std::stable_sort(this->components_.begin(), this->components_.end(), [](const Component *a, const Component *b) {
     return a->get_loop_priority() > b->get_loop_priority();
   });
+  for (Component *component : this->components_)
+    this->get_loop(component->get_execution_group()).add_component(component);
   this->application_state_ = Component::SETUP;
+  this->start_secondary_loops_();
 }
 
 void Application::loop() {
@@ -66,16 +78,94 @@ void Application::loop() {
     this->application_state_ = Component::LOOP;
   }
 
-  for (Component *component : this->components_) {
-    if (!component->is_failed())
-      component->loop_();
-  }
-  yield();
+  this->loops_[0].loop();
 
   if (first_loop)
     ESP_LOGI(TAG, "First loop finished successfully!");
 }
 
+#ifdef ARDUINO_ARCH_ESP32
+/// Stack size of the loop tasks of the secondary execution groups.
+static const uint32_t SECONDARY_LOOP_STACK_SIZE = 8192;
+
+static void secondary_loop_task(void *param) {
+  auto *loop = reinterpret_cast<ComponentLoop *>(param);
+  loop->bind_current_task();
+  while (true) {
+    // The IDLE task of this core feeds the task watchdog, give it some time if nothing idled.
+    if (!loop->loop())
+      vTaskDelay(1);
+  }
+}
+#endif
+
+void Application::start_secondary_loops_() {
+  for (uint8_t i = 1; i < EXECUTION_GROUP_LOOPS; i++) {
+    ComponentLoop *loop = &this->loops_[i];
+    if (!loop->has_components())
+      continue;
+    ESP_LOGCONFIG(TAG, "Starting the loop of execution group %u...", i);
+#ifdef ARDUINO_ARCH_ESP32
+    // The Arduino loop task runs on the application core, run the secondary group on the other one.
+    const int core = xPortGetCoreID() == 0 ? 1 : 0;
+    xTaskCreatePinnedToCore(secondary_loop_task, "secondary_loop", SECONDARY_LOOP_STACK_SIZE, loop, 1, nullptr, core);
+#endif
+#ifdef ARDUINO_ARCH_HOST
+    std::thread([loop]() {
+      loop->bind_current_task();
+      while (true)
+        loop->loop();
+    }).detach();
+#endif
+  }
+}
+
+void Application::set_max_idle_time(uint32_t max_idle_time) {
+  for (ComponentLoop &loop : this->loops_)
+    loop.set_max_idle_time(max_idle_time);
+}
+
+void Application::wake_loop() {
+  this->loops_[0].wake();
+}
+
+void ICACHE_RAM_ATTR Application::wake_loop_isr() {
+  this->loops_[0].wake_isr();
+}
+
+float Application::get_idle_ratio() const {
+  return this->loops_[0].get_idle_ratio();
+}
+
+void Application::request_loop(Component *component) {
+  this->get_loop(component->get_execution_group()).request_loop(component);
+}
+
+bool Application::post(event_func_t &&f) {
+  return this->loops_[0].post(std::move(f));
+}
+
+bool Application::post(ExecutionGroup group, event_func_t &&f) {
+  return this->get_loop(group).post(std::move(f));
+}
+
+bool Application::post_wait(event_func_t &&f) {
+  for (uint8_t i = 1; i < EXECUTION_GROUP_LOOPS; i++) {
+    if (this->loops_[i].is_current())
+      return this->loops_[0].post_wait(std::move(f));
+  }
+  return this->loops_[0].post(std::move(f));
+}
+
+bool Application::is_in_execution_group(ExecutionGroup group) const {
+  const uint8_t index = group < EXECUTION_GROUP_LOOPS ? group : 0;
+  return this->loops_[index].is_current();
+}
+
+ComponentLoop &Application::get_loop(ExecutionGroup group) {
+  return this->loops_[group < EXECUTION_GROUP_LOOPS ? group : 0];
+}
+
 WiFiComponent *Application::init_wifi(const std::string &ssid, const std::string &password) {
   WiFiComponent *wifi = this->init_wifi();
   wifi->set_sta(ssid, password);
@@ -304,6 +394,9 @@ Application::MakeGPIOSwitch Application::make_gpio_switch(const std::string &fri
 const std::string &Application::get_name() const {
   return this->name_;
 }
+const std::vector<Component *> &Application::get_components() const {
+  return this->components_;
+}
 
 #ifdef USE_FAN
 Application::MakeFan Application::make_fan(const std::string &friendly_name) {
@@ -480,6 +573,12 @@ DebugComponent *Application::make_debug_component() {
 }
 #endif
 
+#ifdef USE_COMPONENT_PROFILER
+ProfilerComponent *Application::make_profiler_component(uint32_t update_interval) {
+  return this->register_component(new ProfilerComponent(update_interval));
+}
+#endif
+
 #ifdef USE_FAN
 fan::MQTTFanComponent *Application::register_fan(fan::FanState *state) {
   for (auto *controller : this->controllers_)
@@ -8,9 +8,11 @@
 #include <vector>
 #include "esphomelib/defines.h"
 #include "esphomelib/component.h"
+#include "esphomelib/component_loop.h"
 #include "esphomelib/controller.h"
 #include "esphomelib/esp32_ble_tracker.h"
 #include "esphomelib/debug_component.h"
+#include "esphomelib/profiler_component.h"
 #include "esphomelib/deep_sleep_component.h"
 #include "esphomelib/log.h"
 #include "esphomelib/log_component.h"
@@ -34,6 +36,7 @@
 #include "esphomelib/output/ledc_output_component.h"
 #include "esphomelib/output/pca9685_output_component.h"
 #include "esphomelib/sensor/adc_sensor_component.h"
+#include "esphomelib/sensor/aggregate_filter.h"
 #include "esphomelib/sensor/ads1115_component.h"
 #include "esphomelib/sensor/bh1750_sensor.h"
 #include "esphomelib/sensor/bme280_component.h"
@@ -42,6 +45,7 @@
 #include "esphomelib/sensor/dallas_component.h"
 #include "esphomelib/sensor/dht_component.h"
 #include "esphomelib/sensor/dht12_component.h"
+#include "esphomelib/sensor/filter_chain.h"
 #include "esphomelib/sensor/htu21d_component.h"
 #include "esphomelib/sensor/hdc1080_component.h"
 #include "esphomelib/sensor/mqtt_sensor_component.h"
@@ -837,6 +841,15 @@ class Application {
   DebugComponent *make_debug_component();
 #endif
 
+#ifdef USE_COMPONENT_PROFILER
+  /** Create a component periodically reporting the run time of all components.
+   *
+   * @param update_interval The interval in ms the profiling data should be reported in, defaults to 60s.
+   * @return The ProfilerComponent instance.
+   */
+  ProfilerComponent *make_profiler_component(uint32_t update_interval = 60000);
+#endif
+
 #ifdef USE_DEEP_SLEEP
   DeepSleepComponent *make_deep_sleep_component();
 #endif
@@ -871,18 +884,104 @@ class Application {
   /// Make a loop iteration. Call this in your loop() function.
   void loop();
 
+  /** Set the maximum time in ms loop() idles for if no component needs continuous loop() calls.
+   *
+   * loop() sleeps until the next time function is due, but at most this long so that components
+   * still checking something in loop() (like WiFi reconnects) stay responsive. Set to 0 to never idle.
+   * Defaults to 100ms. Applies to the loops of all execution groups.
+   *
+   * @see Component::needs_continuous_loop()
+   */
+  void set_max_idle_time(uint32_t max_idle_time);
+
+  /// Wake up loop() if it's idling. Call this if something happened that needs to be handled in a loop().
+  void wake_loop();
+
+  /** Like wake_loop(), but safe to call from an interrupt service routine, it's placed in IRAM.
+   *
+   * This is the only thing an interrupt should do besides updating its own (volatile or atomic) state:
+   * set a flag in the ISR, wake the loop and handle the flag in the loop() of the component.
+   */
+  void wake_loop_isr();
+
+  /// Get the fraction (0.0 to 1.0) of time loop() spent idling during the last minute.
+  float get_idle_ratio() const;
+
+  /// Internal: loop component in the next iteration, use Component::request_loop() instead.
+  void request_loop(Component *component);
+
+  /// Function type of events posted with post().
+  using event_func_t = ComponentLoop::event_func_t;
+  /// The number of events that can be queued between two loop() iterations.
+  static const uint8_t EVENT_QUEUE_SIZE = ComponentLoop::EVENT_QUEUE_SIZE;
+
+  /** Run f at the start of the next loop() iteration and wake up loop() if it's idling.
+   *
+   * This is the way to get something into the main loop from another task/context (for example the BLE
+   * task, async network callbacks or the loop of another execution group): The event is stored in a bounded
+   * lock-free queue, so this never blocks or allocates. Components shouldn't be touched directly from those
+   * contexts. This isn't placed in IRAM, so don't call it from interrupts, see wake_loop_isr() for those.
+   *
+   * The queue is shared by all producers, so a producer that can have many events at once should coalesce
+   * them into a single pending event (see ESP32BLETracker::post_publish_()) and handle false.
+   *
+   * @param f The function to call, its captures need to fit into event_func_t.
+   * @return Whether the event was queued, false if the queue was full and the event was dropped.
+   */
+  bool post(event_func_t &&f);
+
+  /// Like post(), but run f in the loop of the given execution group.
+  bool post(ExecutionGroup group, event_func_t &&f);
+
+  /** Like post(), but if called from the loop of another execution group and the queue is full, block until the
+   * main loop made room instead of dropping f.
+   *
+   * This is how the other loops hand over values (see Sensor::push_new_value()), so that none are lost and they
+   * keep their order while the main loop is busy. The main loop never waits for another loop, so this can't
+   * deadlock. From any other context (the BLE or network tasks, which need to keep up with the radio) this is
+   * the same as post().
+   *
+   * @param f The function to call, its captures need to fit into event_func_t.
+   * @return Whether the event was queued, always true from the loop of another execution group.
+   */
+  bool post_wait(event_func_t &&f);
+
+  /// Whether the caller is running in the loop of the given execution group.
+  bool is_in_execution_group(ExecutionGroup group) const;
+
+  /** Get the loop running the components of an execution group.
+   *
+   * On chips with a single core (ESP8266) all execution groups share the main loop.
+   */
+  ComponentLoop &get_loop(ExecutionGroup group);
+
   WiFiComponent *get_wifi() const;
+  /// Get all registered components, sorted by loop priority after setup().
+  const std::vector<Component *> &get_components() const;
   mqtt::MQTTClientComponent *get_mqtt_client() const;
 
   /// Get the name of this Application set by set_name().
   const std::string &get_name() const;
 
  protected:
+  /// Start the loops of the execution groups other than the main one.
+  void start_secondary_loops_();
+
   std::vector<Component *> components_{};
+  /// The loops of the execution groups, the first one is run by loop().
+  ComponentLoop loops_[EXECUTION_GROUP_LOOPS];
   std::vector<Controller *> controllers_{};
   mqtt::MQTTClientComponent *mqtt_client_{nullptr};
   WiFiComponent *wifi_{nullptr};
 
+#ifdef USE_COMPONENT_PROFILER
+  /// Name of a component in the profiling reports: its type and, if it has one, its name.
+  template<class C>
+  static std::string profile_name_(C *c, std::true_type);
+  template<class C>
+  static std::string profile_name_(C *c, std::false_type);
+#endif
+
   std::string name_;
   Component::ComponentState application_state_{Component::CONSTRUCTION};
 #ifdef USE_I2C
@@ -897,11 +996,27 @@ template<class C>
 C *Application::register_component(C *c) {
   static_assert(std::is_base_of<Component, C>::value, "Only Component subclasses can be registered");
   Component *component = c;
-  if (c != nullptr)
+  if (c != nullptr) {
     this->components_.push_back(component);
+#ifdef USE_COMPONENT_PROFILER
+    component->get_profile().name = this->profile_name_(c, std::is_base_of<Nameable, C>());
+#endif
+  }
   return c;
 }
 
+#ifdef USE_COMPONENT_PROFILER
+template<class C>
+std::string Application::profile_name_(C *c, std::true_type) {
+  return profile_type_name<C>() + " '" + c->get_name() + "'";
+}
+
+template<class C>
+std::string Application::profile_name_(C * /*c*/, std::false_type) {
+  return profile_type_name<C>();
+}
+#endif
+
 template<class C>
 C *Application::register_controller(C *c) {
   static_assert(std::is_base_of<Controller, C>::value, "Only Controller subclasses can be registered");
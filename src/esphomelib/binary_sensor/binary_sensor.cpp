@@ -3,6 +3,7 @@
 //
 
 #include "esphomelib/binary_sensor/binary_sensor.h"
+#include "esphomelib/application.h"
 
 #ifdef USE_BINARY_SENSOR
 
@@ -15,6 +16,13 @@ void BinarySensor::add_on_state_callback(binary_callback_t &&callback) {
 }
 
 void BinarySensor::publish_state(bool state) {
+  if (!App.is_in_execution_group(EXECUTION_GROUP_MAIN)) {
+    // Published from the loop of another execution group, the front-ends run in the main loop.
+    App.post_wait([this, state] {
+      this->publish_state(state);
+    });
+    return;
+  }
   bool actual = state != this->inverted_;
   if (!this->first_value_ && actual == this->value_)
     return;
@@ -22,6 +30,11 @@ void BinarySensor::publish_state(bool state) {
   this->value_ = actual;
   this->state_callback_.call(actual);
 }
+bool BinarySensor::post_state(bool state) {
+  return App.post([this, state] {
+    this->publish_state(state);
+  });
+}
 bool BinarySensor::is_inverted() const {
   return this->inverted_;
 }
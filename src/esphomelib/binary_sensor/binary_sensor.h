@@ -16,7 +16,7 @@ ESPHOMELIB_NAMESPACE_BEGIN
 namespace binary_sensor {
 
 /// typedef for binary_sensor callbacks. First parameter is new value.
-using binary_callback_t = std::function<void(bool)>;
+using binary_callback_t = InlineFunction<void(bool)>;
 
 /** Base class for all binary_sensor-type classes.
  *
@@ -44,11 +44,23 @@ class BinarySensor : public Nameable {
   /** Publish a new state.
    *
    * Inverted input is handled by this method and sub-classes don't need to worry about inverting themselves.
+   * If called from the loop of another execution group, the state is handed over to the main loop with
+   * Application::post_wait().
    *
    * @param state The new state.
    */
   virtual void publish_state(bool state);
 
+  /** Like publish_state(), but safe to call from other tasks (not from interrupts, see
+   * Application::wake_loop_isr()).
+   *
+   * The state is published in the next Application::loop() iteration, see Application::post().
+   *
+   * @param state The new state.
+   * @return Whether the state could be posted, false if the event queue was full.
+   */
+  bool post_state(bool state);
+
   /// Get the current boolean value of this binary sensor.
   bool get_value() const;
 
@@ -108,6 +108,9 @@ void ESP32TouchComponent::loop() {
   }
 
 }
+bool ESP32TouchComponent::needs_continuous_loop() const {
+  return this->setup_mode_;
+}
 ESP32TouchBinarySensor *ESP32TouchComponent::make_touch_pad(const std::string &name,
                                                             touch_pad_t touch_pad,
                                                             uint16_t threshold) {
@@ -174,6 +174,7 @@ class ESP32TouchComponent : public Component {
   // (In most use cases you won't need these)
   void setup() override;
   void loop() override;
+  bool needs_continuous_loop() const override;
   float get_setup_priority() const override;
 
  protected:
@@ -8,6 +8,7 @@
 #include "esphomelib/esphal.h"
 #include "esphomelib/log.h"
 #include "esphomelib/helpers.h"
+#include "esphomelib/application.h"
 
 ESPHOMELIB_NAMESPACE_BEGIN
 
@@ -17,6 +18,10 @@ float Component::get_loop_priority() const {
   return 0.0f;
 }
 
+bool Component::needs_continuous_loop() const {
+  return this->loop_overridden_;
+}
+
 float Component::get_setup_priority() const {
   return 0.0f;
 }
@@ -26,47 +31,44 @@ void Component::setup() {
 }
 
 void Component::loop() {
-
+  // Only reached if loop() is not overridden, so this component doesn't need to be looped continuously.
+  this->loop_overridden_ = false;
 }
 
 void Component::set_interval(const std::string &name, uint32_t interval, time_func_t &&f) {
-  // only put offset in lower half
-  uint32_t offset = (random_uint32() % interval) / 2;
-  ESP_LOGV(TAG, "set_interval(name='%s', interval=%u, offset=%u)", name.c_str(), interval, offset);
-
-  this->cancel_interval(name);
-  struct TimeFunction function = {
-      .name = name,
-      .type = TimeFunction::INTERVAL,
-      .interval = interval,
-      .last_execution = millis() - interval - offset,
-      .f = std::move(f),
-      .remove = false,
-  };
-  this->time_functions_.push_back(function);
+  this->set_interval(fnv1a_hash(name), interval, std::move(f));
+}
+
+void Component::set_interval(uint32_t name_id, uint32_t interval, time_func_t &&f) {
+  App.get_loop(this->execution_group_).scheduler.set_interval(this, name_id, interval, std::move(f));
+}
+
+void Component::set_interval(uint32_t name_id, uint32_t interval, uint32_t phase, time_func_t &&f) {
+  App.get_loop(this->execution_group_).scheduler.set_interval(this, name_id, interval, phase, std::move(f));
 }
 
 bool Component::cancel_interval(const std::string &name) {
-  return this->cancel_time_function(name, TimeFunction::INTERVAL);
+  return this->cancel_interval(fnv1a_hash(name));
+}
+
+bool Component::cancel_interval(uint32_t name_id) {
+  return App.get_loop(this->execution_group_).scheduler.cancel_interval(this, name_id);
 }
 
 void Component::set_timeout(const std::string &name, uint32_t timeout, time_func_t &&f) {
-  ESP_LOGV(TAG, "set_timeout(name='%s', timeout=%u)", name.c_str(), timeout);
+  this->set_timeout(fnv1a_hash(name), timeout, std::move(f));
+}
 
-  this->cancel_timeout(name);
-  struct TimeFunction function = {
-      .name = name,
-      .type = TimeFunction::TIMEOUT,
-      .interval = timeout,
-      .last_execution = millis(),
-      .f = std::move(f),
-      .remove = false,
-  };
-  this->time_functions_.push_back(function);
+void Component::set_timeout(uint32_t name_id, uint32_t timeout, time_func_t &&f) {
+  App.get_loop(this->execution_group_).scheduler.set_timeout(this, name_id, timeout, std::move(f));
 }
 
 bool Component::cancel_timeout(const std::string &name) {
-  return this->cancel_time_function(name, TimeFunction::TIMEOUT);
+  return this->cancel_timeout(fnv1a_hash(name));
+}
+
+bool Component::cancel_timeout(uint32_t name_id) {
+  return App.get_loop(this->execution_group_).scheduler.cancel_timeout(this, name_id);
 }
 
 void Component::loop_() {
@@ -74,18 +76,6 @@ void Component::loop_() {
   this->loop();
 }
 
-bool Component::cancel_time_function(const std::string &name, TimeFunction::Type type) {
-  if (name.empty())
-    return false;
-  for (auto iter = this->time_functions_.begin(); iter != this->time_functions_.end(); iter++) {
-    if (!iter->remove && iter->name == name && iter->type == type) {
-      ESP_LOGV(TAG, "Removing old time function %s.", iter->name.c_str());
-      iter->remove = true;
-      return true;
-    }
-  }
-  return false;
-}
 void Component::setup_() {
   this->setup_internal();
   this->setup();
@@ -96,37 +86,6 @@ Component::ComponentState Component::get_component_state() const {
 void Component::loop_internal() {
   assert_setup(this);
   this->component_state_ = LOOP;
-
-  for (unsigned int i = 0; i < this->time_functions_.size(); i++) { // NOLINT
-    const uint32_t now = millis();
-    TimeFunction *tf = &this->time_functions_[i];
-    if (tf->should_run(now)) {
-      if_very_verbose {
-        const char *type = tf->type == TimeFunction::INTERVAL ? "interval" : (tf->type == TimeFunction::TIMEOUT ? "timeout" : "defer");
-        ESP_LOGVV(TAG, "Running %s '%s':%u with interval=%u last_execution=%u (now=%u)",
-                  type, tf->name.c_str(), i, tf->interval, tf->last_execution, now);
-      }
-
-      tf->f();
-      // The vector might have reallocated due to new items
-      tf = &this->time_functions_[i];
-
-      if (tf->type == TimeFunction::INTERVAL) {
-        const uint32_t amount = (now - tf->last_execution) / tf->interval;
-        tf->last_execution += (amount * tf->interval);
-      } else if (tf->type == TimeFunction::DEFER || tf->type == TimeFunction::TIMEOUT) {
-        tf->remove = true;
-      }
-    }
-  }
-
-  this->time_functions_.erase(
-      std::remove_if(this->time_functions_.begin(), this->time_functions_.end(),
-                     [](const TimeFunction &tf) -> bool {
-                       return tf.remove;
-                     }),
-      this->time_functions_.end()
-  );
 }
 void Component::setup_internal() {
   assert_construction_state(this);
@@ -137,32 +96,82 @@ void Component::mark_failed() {
   this->component_state_ = FAILED;
 }
 void Component::defer(Component::time_func_t &&f) {
-  this->defer("", std::move(f));
+  this->defer(uint32_t(0), std::move(f));
 }
 bool Component::cancel_defer(const std::string &name) {
-  return this->cancel_time_function(name, TimeFunction::DEFER);
+  return this->cancel_defer(fnv1a_hash(name));
+}
+bool Component::cancel_defer(uint32_t name_id) {
+  return App.get_loop(this->execution_group_).scheduler.cancel_defer(this, name_id);
 }
 void Component::defer(const std::string &name, Component::time_func_t &&f) {
-  this->cancel_defer(name);
-  struct TimeFunction function = {
-      .name = name,
-      .type = TimeFunction::DEFER,
-      .interval = 0,
-      .last_execution = 0,
-      .f = std::move(f),
-      .remove = false,
-  };
-  this->time_functions_.push_back(function);
+  this->defer(fnv1a_hash(name), std::move(f));
+}
+void Component::defer(uint32_t name_id, Component::time_func_t &&f) {
+  App.get_loop(this->execution_group_).scheduler.defer(this, name_id, std::move(f));
 }
 void Component::set_timeout(uint32_t timeout, Component::time_func_t &&f) {
-  this->set_timeout("", timeout, std::move(f));
+  this->set_timeout(uint32_t(0), timeout, std::move(f));
 }
 void Component::set_interval(uint32_t interval, Component::time_func_t &&f) {
-  this->set_interval("", interval, std::move(f));
+  this->set_interval(uint32_t(0), interval, std::move(f));
+}
+void Component::request_loop() {
+  if (this->loop_requested_)
+    return;
+  this->loop_requested_ = true;
+  App.request_loop(this);
+}
+void Component::set_execution_group(ExecutionGroup execution_group) {
+  assert_construction_state(this);
+  this->execution_group_ = execution_group;
+}
+ExecutionGroup Component::get_execution_group() const {
+  return this->execution_group_;
 }
 bool Component::is_failed() {
   return this->component_state_ == FAILED;
 }
+#ifdef USE_COMPONENT_PROFILER
+ComponentProfile &Component::get_profile() {
+  return this->profile_;
+}
+#endif
+
+/// The scheduler name id of a coroutine, only needs to be unique within the component.
+static uint32_t coroutine_name_id(Coroutine *co) {
+  return uint32_t(reinterpret_cast<uintptr_t>(co));
+}
+bool Component::start_coroutine(Coroutine *co, coroutine_func_t &&body) {
+  if (co->running_)
+    return false;
+  co->running_ = true;
+  co->resume_point_ = 0;
+  co->timed_out_ = false;
+  co->body_ = std::move(body);
+  this->resume_coroutine_(co);
+  return true;
+}
+void Component::stop_coroutine(Coroutine *co) {
+  const uint32_t name_id = coroutine_name_id(co);
+  this->cancel_timeout(name_id);
+  this->cancel_defer(name_id);
+  co->running_ = false;
+  co->resume_point_ = 0;
+}
+void Component::resume_coroutine_(Coroutine *co) {
+  const CoroutineResult result = co->body_(*co);
+  if (result == COROUTINE_DONE) {
+    co->running_ = false;
+    return;
+  }
+
+  auto f = [this, co]() { this->resume_coroutine_(co); };
+  if (result == 0)
+    this->defer(coroutine_name_id(co), f);
+  else
+    this->set_timeout(coroutine_name_id(co), result, f);
+}
 
 PollingComponent::PollingComponent(uint32_t update_interval)
     : Component(), update_interval_(update_interval) {}
@@ -175,8 +184,130 @@ void PollingComponent::setup_() {
   this->setup();
 
   // Register interval.
+  if (this->polling_bus_ != nullptr && !this->is_failed())
+    this->polling_bus_->add_polling_device(this, this->transaction_time_);
   ESP_LOGCONFIG(TAG, "    Update interval: %ums", this->get_update_interval());
-  this->set_interval("update", this->get_update_interval(), [this]() { this->update(); });
+  if (this->update_phase_.defined && !this->is_adaptive())
+    ESP_LOGCONFIG(TAG, "    Update phase: %ums", this->update_phase_.value);
+  if (this->is_adaptive())
+    ESP_LOGCONFIG(TAG, "    Adaptive update interval: %ums - %ums",
+                  this->min_update_interval_, this->max_update_interval_);
+  this->schedule_update_();
+}
+void PollingComponent::schedule_update_() {
+  if (!this->is_adaptive()) {
+    if (this->update_phase_.defined)
+      this->set_interval(fnv1a_hash("update"), this->update_interval_, this->update_phase_.value,
+                         [this]() { this->update(); });
+    else
+      this->set_interval(fnv1a_hash("update"), this->update_interval_, [this]() { this->update(); });
+    return;
+  }
+  // Adaptive polling chains timeouts instead, those can be moved without running update() right away.
+  this->set_timeout(fnv1a_hash("update"), 0, [this]() { this->adaptive_update_(); });
+}
+void PollingComponent::adaptive_update_() {
+  // exchanged, so that reports from other execution groups between the check and the reset aren't lost
+  const bool changed = this->update_changed_.exchange(false);
+  const bool stable = this->update_stable_.exchange(false);
+  if (changed)
+    // usually react_to_change_() already did this, unless posting it from another execution group failed
+    this->change_update_interval_(this->min_update_interval_);
+  else if (stable)
+    // exponential back-off while the values are stable
+    this->change_update_interval_(std::min(this->update_interval_ * 2, this->max_update_interval_));
+  this->set_timeout(fnv1a_hash("update"), this->update_interval_, [this]() { this->adaptive_update_(); });
+  this->update();
+}
+void PollingComponent::change_update_interval_(uint32_t update_interval) {
+  if (update_interval == this->update_interval_)
+    return;
+  ESP_LOGV(TAG, "Changing update interval to %ums", update_interval);
+  this->update_interval_ = update_interval;
+  this->update_interval_callback_.call(update_interval);
+}
+void PollingComponent::set_adaptive_update_interval(uint32_t min_interval, uint32_t max_interval) {
+  this->min_update_interval_ = min_interval;
+  this->max_update_interval_ = std::max(min_interval, max_interval);
+  this->update_interval_ = min_interval;
+}
+void PollingComponent::report_update_change(bool changed) {
+  if (!this->is_adaptive())
+    return;
+  if (!changed) {
+    this->update_stable_ = true;
+    return;
+  }
+  const bool reported = this->update_changed_.exchange(true);
+  if (App.is_in_execution_group(this->execution_group_)) {
+    this->react_to_change_();
+  } else if (!reported) {
+    // One event per update, the following changes until then are already covered by it.
+    App.post(this->execution_group_, [this]() {
+      this->react_to_change_();
+    });
+  }
+}
+void PollingComponent::react_to_change_() {
+  if (this->update_interval_ == this->min_update_interval_)
+    return;
+  // react right away, the next update is in min_interval instead of the current (long) interval.
+  this->change_update_interval_(this->min_update_interval_);
+  this->set_timeout(fnv1a_hash("update"), this->update_interval_, [this]() { this->adaptive_update_(); });
+}
+bool PollingComponent::is_adaptive() const {
+  return this->max_update_interval_ != 0;
+}
+void PollingComponent::add_on_update_interval_callback(InlineFunction<void(uint32_t)> &&callback) {
+  this->update_interval_callback_.add(std::move(callback));
+}
+void PollingComponent::set_polling_bus(SharedBus *bus, uint32_t transaction_time) {
+  this->polling_bus_ = bus;
+  this->transaction_time_ = transaction_time;
+}
+void PollingComponent::set_update_phase(uint32_t phase) {
+  this->update_phase_ = phase;
+}
+
+void SharedBus::add_polling_device(PollingComponent *device, uint32_t transaction_time) {
+  if (device->is_adaptive())
+    return;
+  this->devices_.push_back(PollingDevice{device, transaction_time});
+  this->bus_time_ += transaction_time;
+  // Euclid's algorithm, the GCD with bus_period_ 0 is the interval itself.
+  uint32_t period = device->get_update_interval();
+  for (uint32_t b = this->bus_period_; b != 0;) {
+    const uint32_t r = period % b;
+    period = b;
+    b = r;
+  }
+  this->bus_period_ = period;
+
+  const auto n = uint32_t(this->devices_.size());
+  const bool fits = this->bus_time_ <= this->bus_period_;
+  if (!fits)
+    ESP_LOGW(TAG, "The polling components on this bus need %ums, more than the bus period of %ums. "
+                  "Their updates will overlap.", this->bus_time_, this->bus_period_);
+  // the free time of the period after each transaction.
+  const uint32_t gap = fits ? (this->bus_period_ - this->bus_time_) / n : 0;
+  uint32_t start = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    PollingDevice &d = this->devices_[i];
+    // if the transactions don't fit, at least spread their starts evenly.
+    const uint32_t phase = fits ? start : uint32_t(uint64_t(this->bus_period_) * i / n);
+    const bool changed = !d.device->update_phase_.defined || d.device->update_phase_.value != phase;
+    d.device->set_update_phase(phase);
+    // the devices before this one are already scheduled with their old phase.
+    if (changed && d.device != device)
+      d.device->schedule_update_();
+    start += d.transaction_time + gap;
+  }
+}
+uint32_t SharedBus::get_bus_time() const {
+  return this->bus_time_;
+}
+uint32_t SharedBus::get_bus_period() const {
+  return this->bus_period_;
 }
 
 uint32_t PollingComponent::get_update_interval() const {
@@ -201,12 +332,4 @@ const std::string &Nameable::get_name_id() {
   return this->name_id_;
 }
 
-bool Component::TimeFunction::should_run(uint32_t now) const {
-  if (this->remove)
-    return false;
-  if (this->type == DEFER)
-    return true;
-  return now - this->last_execution > this->interval;
-}
-
 ESPHOMELIB_NAMESPACE_END
@@ -5,9 +5,13 @@
 #ifndef ESPHOMELIB_COMPONENT_H
 #define ESPHOMELIB_COMPONENT_H
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <vector>
+#include "esphomelib/coroutine.h"
+#include "esphomelib/helpers.h"
+#include "esphomelib/profiler.h"
 #include "esphomelib/defines.h"
 
 #define assert_is_pin(num) assert((0 <= (num) && (num) <= 39) && "Is not a valid pin number")
@@ -16,6 +20,8 @@
 
 ESPHOMELIB_NAMESPACE_BEGIN
 
+class SharedBus;
+
 /// default setup priorities for components of different types.
 namespace setup_priority {
 
@@ -28,6 +34,16 @@ const float LATE = -10.0f;
 
 } // namespace setup_priority
 
+/** The loops components can run in, see Component::set_execution_group().
+ *
+ * Every execution group has its own loop with its own time functions. On the ESP32 the secondary group runs
+ * in a task on the other core, on the ESP8266 both groups share the main loop.
+ */
+enum ExecutionGroup : uint8_t {
+  EXECUTION_GROUP_MAIN = 0, ///< The Arduino loop task, with WiFi, MQTT, OTA and the web server.
+  EXECUTION_GROUP_SECONDARY = 1, ///< A second loop, for example for LED strips or slow sensors.
+};
+
 /** The base class for all esphomelib components.
  *
  * esphomelib uses components to separate code for self-contained units such as
@@ -84,6 +100,14 @@ class Component {
    */
   virtual float get_loop_priority() const;
 
+  /** Whether loop() currently needs to be called continuously.
+   *
+   * If no component needs it, Application::loop() idles until the next time function is due.
+   * Defaults to true for components that override loop(). Override this if loop() only has
+   * work to do some of the time (for example during a light transition).
+   */
+  virtual bool needs_continuous_loop() const;
+
   /** Public loop() functions. These will be called by the Application instance.
    *
    * Note: This should normally not be overriden, unless you know what you're doing.
@@ -92,13 +116,37 @@ class Component {
    * methods within their custom sensors. These methods should ALWAYS call the loop_internal()
    * and setup_internal() methods.
    *
-   * Basically, it handles stuff like interval/timeout functions and eventually calls loop().
+   * Basically, it handles the component state and eventually calls loop(). Interval/timeout functions
+   * are run by the application-wide Scheduler.
+   *
+   * After the first iteration, only components overriding loop() are looped every iteration. All others
+   * are only looped again after request_loop(), so components overriding just loop_() need to call it.
    */
   virtual void loop_();
   virtual void setup_();
 
+  /** Request a loop_() call in the next Application::loop() iteration.
+   *
+   * Cheap to call, and multiple requests before the next iteration result in a single loop_() call.
+   * Only call this from the main loop (for example in a time function), not from interrupts or other tasks.
+   */
+  void request_loop();
+
   ComponentState get_component_state() const;
 
+  /** Run this component in the loop of another execution group, must be called before setup.
+   *
+   * setup() of all components still runs in the main loop, but loop() and all time functions then run
+   * in the loop of the group. Components in different groups must not call each other directly, use
+   * Application::post() to get something into the loop of another group. Sensors and binary sensors
+   * do that automatically when they publish a value, so that their front-ends stay in the main loop.
+   *
+   * Only move components that aren't controlled from the front-ends, like polling sensors or light outputs,
+   * and keep all components sharing a bus (like the I2C devices) in the same group.
+   */
+  void set_execution_group(ExecutionGroup execution_group);
+  ExecutionGroup get_execution_group() const;
+
   /** Mark this component as failed. Any future timeouts/intervals/setup/loop will no longer be called.
    *
    * This might be useful if a component wants to indicate that a connection to its peripheral failed.
@@ -109,16 +157,22 @@ class Component {
 
   bool is_failed();
 
+#ifdef USE_COMPONENT_PROFILER
+  /// Get the run time statistics of this component, see ProfilerComponent.
+  ComponentProfile &get_profile();
+#endif
+
  protected:
   void loop_internal();
   void setup_internal();
 
-  /** Simple typedef for interval/timeout functions
+  /** Simple typedef for interval/timeout functions. The callable is stored inline, so keep
+   * the captures small (`this` and up to two pointers).
    *
    * @see set_interval()
    * @see set_timeout()
    */
-  using time_func_t = std::function<void()>;
+  using time_func_t = InlineFunction<void()>;
 
   void set_interval(uint32_t interval, time_func_t &&f);
 
@@ -139,6 +193,20 @@ class Component {
    */
   void set_interval(const std::string &name, uint32_t interval, time_func_t &&f);
 
+  /** Set an interval function with an integer name id, 0 means no cancelling possible.
+   *
+   * Same as the std::string version, but never allocates. Use fnv1a_hash("name") to get
+   * the name id at compile time.
+   */
+  void set_interval(uint32_t name_id, uint32_t interval, time_func_t &&f);
+
+  /** Set an interval function with a fixed phase instead of a random offset, see SharedBus.
+   *
+   * f is called right away and then at the times that are phase ms after a multiple of interval (since boot),
+   * so that intervals with different phases never run in the same loop iteration.
+   */
+  void set_interval(uint32_t name_id, uint32_t interval, uint32_t phase, time_func_t &&f);
+
   /** Cancel an interval function.
    *
    * @param name The identifier for this interval function.
@@ -146,6 +214,9 @@ class Component {
    */
   bool cancel_interval(const std::string &name);
 
+  /// Cancel an interval function using its integer name id.
+  bool cancel_interval(uint32_t name_id);
+
   void set_timeout(uint32_t timeout, time_func_t &&f);
 
   /** Set a timeout function with a unique name.
@@ -164,6 +235,9 @@ class Component {
    */
   void set_timeout(const std::string &name, uint32_t timeout, time_func_t &&f);
 
+  /// Set a timeout function with an integer name id, see set_interval(uint32_t, uint32_t, time_func_t &&).
+  void set_timeout(uint32_t name_id, uint32_t timeout, time_func_t &&f);
+
   /** Cancel a timeout function.
    *
    * @param name The identifier for this timeout function.
@@ -171,6 +245,9 @@ class Component {
    */
   bool cancel_timeout(const std::string &name);
 
+  /// Cancel a timeout function using its integer name id.
+  bool cancel_timeout(uint32_t name_id);
+
   /** Defer a callback to the next loop() call.
    *
    * If name is specified and a defer() object with the same name exists, the old one is first removed.
@@ -180,36 +257,46 @@ class Component {
    */
   void defer(const std::string &name, time_func_t &&f);
 
+  /// Defer a callback to the next loop() call with an integer name id.
+  void defer(uint32_t name_id, time_func_t &&f);
+
   /// Defer a callback to the next loop() call.
   void defer(time_func_t &&f);
 
   /// Cancel a defer callback using the specified name, name must not be empty.
   bool cancel_defer(const std::string &name);
 
-  /// Internal struct for storing timeout/interval functions.
-  struct TimeFunction {
-    std::string name; ///< The name/id of this TimeFunction.
-    enum Type { TIMEOUT, INTERVAL, DEFER } type; ///< The type of this TimeFunction. Either TIMEOUT, INTERVAL or DEFER.
-    uint32_t interval; ///< The interval/timeout of this function.
-    /// The last execution for interval functions and the time, SetInterval was called, for timeout functions.
-    uint32_t last_execution;
-    time_func_t f; ///< The function (or callback) itself.
-    bool remove;
-
-    bool should_run(uint32_t now) const;
-  };
+  /// Cancel a defer callback using its integer name id, name_id must not be 0.
+  bool cancel_defer(uint32_t name_id);
 
-  /// Cancel an only time function. If name is empty, won't do anything.
-  bool cancel_time_function(const std::string &name, TimeFunction::Type type);
-
-  /** Storage for interval/timeout functions.
+  /** Start the coroutine co with the given body, see Coroutine.
+   *
+   * The first step runs right away, the following ones are run by the scheduler after the time the
+   * previous step asked for. Does nothing if co is still running, for example if a sensor is polled
+   * faster than it can measure.
    *
-   * Intentionally a vector despite its map-like nature, because of the
-   * memory overhead.
+   * @param co The state of the coroutine, must outlive it (usually a member of the component).
+   * @param body The function implementing the coroutine, usually `[this](Coroutine &co) { return this->xyz_(co); }`.
+   * @return Whether the coroutine was started.
    */
-  std::vector<TimeFunction> time_functions_;
+  bool start_coroutine(Coroutine *co, coroutine_func_t &&body);
+
+  /// Stop a running coroutine, it won't be resumed anymore and starts from the beginning next time.
+  void stop_coroutine(Coroutine *co);
+
+  /// Run the next step of co and schedule the one after it.
+  void resume_coroutine_(Coroutine *co);
 
   ComponentState component_state_{CONSTRUCTION}; ///< State of this component.
+  bool loop_overridden_{true}; ///< Cleared by the default loop(), see needs_continuous_loop().
+  bool loop_requested_{false}; ///< Whether this component is waiting in the loop requests of its loop.
+  ExecutionGroup execution_group_{EXECUTION_GROUP_MAIN};
+#ifdef USE_COMPONENT_PROFILER
+  ComponentProfile profile_;
+#endif
+
+  friend class Application;
+  friend class ComponentLoop;
 };
 
 /** This class simplifies creating components that periodically check a state.
@@ -234,6 +321,46 @@ class PollingComponent : public Component {
    */
   virtual void set_update_interval(uint32_t update_interval);
 
+  /** Enable adaptive polling with an update interval between min_interval and max_interval ms.
+   *
+   * Whoever sees the values (usually the sensors, see Sensor::report_changes_to()) calls
+   * report_update_change() for them. A change shortens the update interval to min_interval right away,
+   * each update after which only stable values were reported doubles it, up to max_interval. Updates
+   * without any reports keep the interval. Call this before setup().
+   *
+   * @param min_interval The shortest update interval in ms, used while the values change.
+   * @param max_interval The longest update interval in ms, used while the values are stable.
+   */
+  void set_adaptive_update_interval(uint32_t min_interval, uint32_t max_interval);
+
+  /** Report whether a value of the last update changed, see set_adaptive_update_interval().
+   *
+   * Does nothing if adaptive polling is disabled. Can be called from any execution group, reports from
+   * other groups are stored in atomic flags, so they're never lost. Only the reaction to a change is posted
+   * to this component's loop, if that fails the next update picks the change up.
+   *
+   * @param changed Whether the value changed significantly.
+   */
+  void report_update_change(bool changed);
+
+  /// Whether adaptive polling is enabled, see set_adaptive_update_interval().
+  bool is_adaptive() const;
+
+  /// Add a callback that's called (in this component's loop) with the new update interval when it changes.
+  void add_on_update_interval_callback(InlineFunction<void(uint32_t)> &&callback);
+
+  /** Set the bus this component polls on, so that its updates get a phase on that bus (see SharedBus).
+   *
+   * Without one (or with adaptive polling) the updates have a random offset.
+   *
+   * @param bus The bus, for example the I2CComponent.
+   * @param transaction_time How long (in ms) one update occupies the bus and the loop.
+   */
+  void set_polling_bus(SharedBus *bus, uint32_t transaction_time);
+
+  /// Set the phase of update() manually, see Component::set_interval(uint32_t, uint32_t, uint32_t, time_func_t &&).
+  void set_update_phase(uint32_t phase);
+
   // ========== OVERRIDE METHODS ==========
   // (You'll only need this when creating your own custom sensor)
   virtual void update() = 0;
@@ -245,7 +372,66 @@ class PollingComponent : public Component {
   /// Get the update interval in ms of this sensor
   virtual uint32_t get_update_interval() const;
  protected:
-  uint32_t update_interval_;
+  /// (Re-)schedule update() with the current update interval.
+  void schedule_update_();
+  /// Call update() and schedule the next one, for adaptive polling.
+  void adaptive_update_();
+  /// Change the current update interval and call the update interval callbacks if it changed.
+  void change_update_interval_(uint32_t update_interval);
+  /// A change was reported, move the next update to min_interval from now.
+  void react_to_change_();
+
+  friend SharedBus;
+
+  SharedBus *polling_bus_{nullptr};
+  uint32_t transaction_time_{0}; ///< How long one update occupies polling_bus_.
+  Optional<uint32_t> update_phase_{}; ///< The phase of update(), random if not set.
+  uint32_t update_interval_; ///< The current update interval.
+  uint32_t min_update_interval_{0}; ///< The shortest adaptive update interval.
+  uint32_t max_update_interval_{0}; ///< The longest adaptive update interval, 0 if adaptive polling is disabled.
+  std::atomic<bool> update_changed_{false}; ///< Whether a change was reported since the last update.
+  std::atomic<bool> update_stable_{false}; ///< Whether a stable value was reported since the last update.
+  CallbackManager<void(uint32_t)> update_interval_callback_{};
+};
+
+/** A bus shared by several polling components, like I2C or 1-Wire.
+ *
+ * Instead of random offsets the updates of the components on the bus get evenly staggered phases
+ * (see Component::set_interval(uint32_t, uint32_t, uint32_t, time_func_t &&)) within the bus period, the
+ * greatest common divisor of their update intervals. Every update of a component then starts at the same
+ * offset into a bus period, whatever its interval. The free time of the period is split evenly between the
+ * transactions, so with n components of the same transaction time the phases are period / n apart. As long as
+ * the sum of all transaction times fits into the bus period, no two transactions on the bus ever overlap,
+ * which keeps the loop latency flat.
+ *
+ * The phases are assigned in setup order and re-assigned when another component is added, see
+ * PollingComponent::set_polling_bus(). Components with adaptive polling keep their random offsets.
+ */
+class SharedBus {
+ public:
+  /** Add device to this bus and (re-)assign the phases of all devices, called by its setup.
+   *
+   * @param device The polling component.
+   * @param transaction_time How long (in ms) one update of device occupies the bus, including the reads
+   *                         that update() defers until the measurement is done.
+   */
+  void add_polling_device(PollingComponent *device, uint32_t transaction_time);
+
+  /// The sum of the transaction times of all polling components on this bus.
+  uint32_t get_bus_time() const;
+
+  /// The period in ms in which all updates on this bus repeat, the GCD of their update intervals.
+  uint32_t get_bus_period() const;
+
+ protected:
+  struct PollingDevice {
+    PollingComponent *device;
+    uint32_t transaction_time;
+  };
+
+  std::vector<PollingDevice> devices_;
+  uint32_t bus_time_{0};
+  uint32_t bus_period_{0};
 };
 
 /// Helper class that enables naming of objects so that it doesn't have to be re-implement every single time.
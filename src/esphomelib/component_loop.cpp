@@ -0,0 +1,198 @@
+#include "esphomelib/component_loop.h"
+
+#include <algorithm>
+
+#include "esphomelib/esphal.h"
+#include "esphomelib/log.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+static const char *TAG = "component_loop";
+
+/// Length of the window over which the idle ratio is measured, in µs.
+static const uint32_t IDLE_RATIO_WINDOW = 60000000;
+
+void ComponentLoop::add_component(Component *component) {
+  this->components_.push_back(component);
+}
+
+bool ComponentLoop::has_components() const {
+  return !this->components_.empty();
+}
+
+void ComponentLoop::bind_current_task() {
+#ifdef ARDUINO_ARCH_ESP32
+  this->task_ = xTaskGetCurrentTaskHandle();
+#endif
+#ifdef ARDUINO_ARCH_HOST
+  this->thread_ = std::this_thread::get_id();
+#endif
+  this->idle_window_start_ = micros();
+}
+
+bool ComponentLoop::loop() {
+  this->process_events_();
+  this->scheduler.call();
+  if (this->first_loop_) {
+    // Loop everything once, afterwards only the components that have a loop() or requested one.
+    this->first_loop_ = false;
+    for (Component *component : this->components_)
+      this->loop_component_(component);
+    for (Component *component : this->components_) {
+      if (component->loop_overridden_)
+        this->looping_components_.push_back(component);
+    }
+    ESP_LOGV(TAG, "Looping %u of %u components continuously.",
+             this->looping_components_.size(), this->components_.size());
+  } else {
+    for (Component *component : this->looping_components_)
+      this->loop_component_(component);
+  }
+
+  this->processing_loop_requests_.swap(this->loop_requests_);
+  for (Component *component : this->processing_loop_requests_) {
+    // cleared before the call so that the component can request the next loop from within loop_()
+    component->loop_requested_ = false;
+    this->loop_component_(component);
+  }
+  this->processing_loop_requests_.clear();
+  yield();
+
+  bool idled = false;
+  if (this->max_idle_time_ != 0 && !this->needs_continuous_loop_()) {
+    const uint32_t idle_time = std::min(this->scheduler.next_schedule_in(), this->max_idle_time_);
+    if (idle_time != 0) {
+      this->idle_(idle_time);
+      idled = true;
+    }
+  }
+
+  const uint32_t now = micros();
+  if (now - this->idle_window_start_ >= IDLE_RATIO_WINDOW) {
+    this->idle_ratio_ = this->idle_time_ / float(now - this->idle_window_start_);
+    this->idle_window_start_ = now;
+    this->idle_time_ = 0;
+  }
+  return idled;
+}
+
+void ComponentLoop::loop_component_(Component *component) {
+  if (component->is_failed())
+    return;
+#ifdef USE_COMPONENT_PROFILER
+  const ProfileStats::Start start = ProfileStats::start();
+  component->loop_();
+  component->get_profile().loop.record(start);
+#else
+  component->loop_();
+#endif
+}
+
+bool ComponentLoop::needs_continuous_loop_() const {
+  if (!this->loop_requests_.empty())
+    return true;
+  // checked after all loop() calls, so that flags set by components looped later are seen too.
+  for (Component *component : this->looping_components_) {
+    if (!component->is_failed() && component->needs_continuous_loop())
+      return true;
+  }
+  return false;
+}
+
+void ComponentLoop::idle_(uint32_t idle_time) {
+  const uint32_t start = micros();
+#ifdef ARDUINO_ARCH_ESP32
+  // Block the loop task so that the CPU can idle until the timeout or a wake() notification.
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle_time));
+#endif
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
+  // delay() lets the SDK put the chip into (modem) sleep, check for wake() every millisecond.
+  for (uint32_t i = 0; i < idle_time && !this->wake_requested_; i++)
+    delay(1);
+  this->wake_requested_ = false;
+#endif
+  this->idle_time_ += micros() - start;
+}
+
+void ComponentLoop::set_max_idle_time(uint32_t max_idle_time) {
+  this->max_idle_time_ = max_idle_time;
+}
+
+void ComponentLoop::wake() {
+#ifdef ARDUINO_ARCH_ESP32
+  if (this->task_ != nullptr)
+    xTaskNotifyGive(this->task_);
+#endif
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
+  this->wake_requested_ = true;
+#endif
+}
+
+void ICACHE_RAM_ATTR ComponentLoop::wake_isr() {
+#ifdef ARDUINO_ARCH_ESP32
+  if (this->task_ != nullptr) {
+    BaseType_t higher_priority_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(this->task_, &higher_priority_woken);
+    // switch to the loop task right away if it has a higher priority than the interrupted task.
+    if (higher_priority_woken == pdTRUE)
+      portYIELD_FROM_ISR();
+  }
+#endif
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
+  this->wake_requested_ = true;
+#endif
+}
+
+float ComponentLoop::get_idle_ratio() const {
+  return this->idle_ratio_;
+}
+
+void ComponentLoop::request_loop(Component *component) {
+  this->loop_requests_.push_back(component);
+}
+
+bool ComponentLoop::post(event_func_t &&f) {
+  if (!this->events_.push(std::move(f))) {
+    this->events_dropped_ = true;
+    return false;
+  }
+  this->wake();
+  return true;
+}
+
+bool ComponentLoop::post_wait(event_func_t &&f) {
+  if (this->is_current())
+    return this->post(std::move(f));
+  // push() leaves f alone if the queue is full, so it can be tried again.
+  while (!this->events_.push(std::move(f))) {
+    this->wake();
+    delay(1);
+  }
+  this->wake();
+  return true;
+}
+
+bool ComponentLoop::is_current() const {
+#ifdef ARDUINO_ARCH_ESP32
+  return this->task_ == xTaskGetCurrentTaskHandle();
+#endif
+#ifdef ARDUINO_ARCH_HOST
+  return this->thread_ == std::this_thread::get_id();
+#endif
+#ifdef ARDUINO_ARCH_ESP8266
+  return true;
+#endif
+}
+
+void ComponentLoop::process_events_() {
+  if (this->events_dropped_) {
+    this->events_dropped_ = false;
+    ESP_LOGW(TAG, "Event queue was full, some events were dropped!");
+  }
+  // at most one queue worth of events, so that events posting new events can't stall the loop.
+  event_func_t f;
+  for (uint8_t i = 0; i < EVENT_QUEUE_SIZE && this->events_.pop(f); i++)
+    f();
+}
+
+ESPHOMELIB_NAMESPACE_END
@@ -0,0 +1,128 @@
+#ifndef ESPHOMELIB_COMPONENT_LOOP_H
+#define ESPHOMELIB_COMPONENT_LOOP_H
+
+#include <atomic>
+#include <vector>
+#ifdef ARDUINO_ARCH_ESP32
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/task.h>
+#endif
+#ifdef ARDUINO_ARCH_HOST
+  #include <thread>
+#endif
+
+#include "esphomelib/component.h"
+#include "esphomelib/scheduler.h"
+#include "esphomelib/event_queue.h"
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+#ifdef ARDUINO_ARCH_ESP8266
+/// The number of execution groups with their own loop. The ESP8266 has a single core, so everything runs in one.
+static const uint8_t EXECUTION_GROUP_LOOPS = 1;
+#else
+/// The number of execution groups with their own loop.
+static const uint8_t EXECUTION_GROUP_LOOPS = 2;
+#endif
+
+/** The loop of one execution group: its components, their time functions and the events posted to it.
+ *
+ * Application has one ComponentLoop per execution group, each one is only ever run by a single task
+ * (see is_current()). Because of that nothing in here is locked, the only way in from other tasks and
+ * cores is post() (and wake()), which goes through a lock-free queue. Interrupts can only call wake_isr().
+ */
+class ComponentLoop {
+ public:
+  /// Function type of events posted with post().
+  using event_func_t = InlineFunction<void(), 4 * sizeof(void *)>;
+  /// The number of events that can be queued between two loop() iterations.
+  static const uint8_t EVENT_QUEUE_SIZE = 16;
+
+  /// Add a component to this loop, called by Application::setup() in loop priority order.
+  void add_component(Component *component);
+
+  /// Whether any components run in this loop.
+  bool has_components() const;
+
+  /// Bind this loop to the calling task, call this from the task that's going to call loop().
+  void bind_current_task();
+
+  /** Make a loop iteration: run the posted events, due time functions and the loop() of the components,
+   * then idle if none of them needs to be looped continuously.
+   *
+   * @return Whether this iteration idled.
+   */
+  bool loop();
+
+  /// See Application::set_max_idle_time().
+  void set_max_idle_time(uint32_t max_idle_time);
+
+  /// Wake up loop() if it's idling.
+  void wake();
+
+  /// Like wake(), but safe to call from an interrupt service routine, placed in IRAM.
+  void wake_isr();
+
+  /// Get the fraction (0.0 to 1.0) of time loop() spent idling during the last minute.
+  float get_idle_ratio() const;
+
+  /// Loop component in the next iteration, must be called from this loop.
+  void request_loop(Component *component);
+
+  /// Run f at the start of the next iteration of this loop, see Application::post().
+  bool post(event_func_t &&f);
+
+  /** Like post(), but if the queue is full wait for this loop to make room instead of dropping f.
+   *
+   * For tasks that can block, see Application::post_wait(). Only call this while loop() is being run, from this
+   * loop itself it's the same as post().
+   */
+  bool post_wait(event_func_t &&f);
+
+  /// Whether the calling task is the one running this loop.
+  bool is_current() const;
+
+  /// The interval/timeout/defer functions of the components in this loop.
+  Scheduler scheduler;
+
+ protected:
+  /// Call loop_() of component, unless it failed.
+  void loop_component_(Component *component);
+  /// Run all events posted since the last iteration.
+  void process_events_();
+  /// Whether any component currently needs continuous loop() calls.
+  bool needs_continuous_loop_() const;
+  /// Block until idle_time ms passed or wake() is called.
+  void idle_(uint32_t idle_time);
+
+  std::vector<Component *> components_{};
+  /// The components looped every iteration (the ones overriding loop()), sorted by loop priority.
+  std::vector<Component *> looping_components_{};
+  /// Components that called request_loop() since the last iteration.
+  std::vector<Component *> loop_requests_{};
+  /// The loop requests currently being processed, swapped with loop_requests_ so that no allocation is needed.
+  std::vector<Component *> processing_loop_requests_{};
+  EventQueue<event_func_t, EVENT_QUEUE_SIZE> events_;
+  std::atomic<bool> events_dropped_{false}; ///< Set by post() if the queue was full, logged by loop().
+
+  bool first_loop_{true};
+  uint32_t max_idle_time_{100};
+  uint32_t idle_window_start_{0}; ///< micros() at the start of the current idle ratio window.
+  uint32_t idle_time_{0}; ///< Time in µs spent idling during the current idle ratio window.
+  float idle_ratio_{0.0f};
+#ifdef ARDUINO_ARCH_ESP32
+  TaskHandle_t task_{nullptr}; ///< The task running loop(), notified by wake().
+#endif
+#ifdef ARDUINO_ARCH_HOST
+  std::thread::id thread_{}; ///< The thread running loop().
+#endif
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
+  std::atomic<bool> wake_requested_{false};
+#endif
+};
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_COMPONENT_LOOP_H
@@ -0,0 +1,12 @@
+#include "esphomelib/coroutine.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+bool Coroutine::is_running() const {
+  return this->running_;
+}
+bool Coroutine::is_timed_out() const {
+  return this->timed_out_;
+}
+
+ESPHOMELIB_NAMESPACE_END
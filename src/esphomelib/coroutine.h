@@ -0,0 +1,106 @@
+#ifndef ESPHOMELIB_COROUTINE_H
+#define ESPHOMELIB_COROUTINE_H
+
+#include <cstdint>
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+/// What a coroutine step returns: the number of ms until it wants to be resumed, or COROUTINE_DONE.
+using CoroutineResult = uint32_t;
+
+/// Returned by a coroutine step once the coroutine has finished.
+static const CoroutineResult COROUTINE_DONE = UINT32_MAX;
+
+class Coroutine;
+
+/// The body of a coroutine, called once for each step with the state of the coroutine.
+using coroutine_func_t = InlineFunction<CoroutineResult(Coroutine &)>;
+
+/** The state of a stackless coroutine, see Component::start_coroutine().
+ *
+ * A coroutine is a function that can suspend itself with the CO_* macros below. While it's suspended,
+ * the main loop keeps running all other components, and once the suspension is over the function is
+ * called again and continues after the macro that suspended it. That way drivers can wait for a
+ * conversion of their sensor without delay()-ing the whole node:
+ *
+ * @code
+ * CoroutineResult MySensor::read_(Coroutine &co) {
+ *   CO_BEGIN(co);
+ *   this->write_byte(MY_REGISTER_START, 0x01);
+ *   CO_SLEEP(co, 15); // let the sensor convert
+ *   ...
+ *   CO_END(co);
+ * }
+ * @endcode
+ *
+ * Coroutines are stackless: local variables do NOT survive a suspension, keep everything that's needed
+ * after CO_SLEEP() in member variables. The macros are implemented with a switch statement, so don't put
+ * two of them on the same line and don't suspend from within another switch statement.
+ */
+class Coroutine {
+ public:
+  /// Whether this coroutine has been started and not finished yet.
+  bool is_running() const;
+
+  /// Whether the last CO_WAIT_UNTIL() gave up because of its timeout.
+  bool is_timed_out() const;
+
+  // ========== INTERNAL METHODS ==========
+  // (Only used by Component and the CO_* macros)
+  uint16_t resume_point_{0}; ///< The line to resume at, 0 for the start of the body.
+  bool running_{false};
+  bool timed_out_{false};
+  uint32_t wait_start_{0}; ///< millis() when the current CO_WAIT_UNTIL() started.
+  coroutine_func_t body_;
+};
+
+/// Start the body of a coroutine, must be the first statement of it.
+#define CO_BEGIN(co) switch ((co).resume_point_) { case 0:
+
+/// Suspend the coroutine for ms milliseconds, 0 resumes it in the next loop iteration.
+#define CO_SLEEP(co, ms) \
+  do { \
+    (co).resume_point_ = __LINE__; \
+    return (ms); \
+    case __LINE__:; \
+  } while (false)
+
+/// Give the other components a chance to run before continuing.
+#define CO_YIELD(co) CO_SLEEP(co, 0)
+
+/** Suspend until condition becomes true, checking it every poll_ms milliseconds.
+ *
+ * The condition is checked right away first. After timeout_ms milliseconds the coroutine continues anyway
+ * and Coroutine::is_timed_out() returns true.
+ */
+#define CO_WAIT_UNTIL(co, condition, poll_ms, timeout_ms) \
+  do { \
+    (co).wait_start_ = millis(); \
+    (co).timed_out_ = false; \
+    (co).resume_point_ = __LINE__; \
+    case __LINE__: \
+    if (!(condition)) { \
+      if (millis() - (co).wait_start_ <= (timeout_ms)) \
+        return (poll_ms); \
+      (co).timed_out_ = true; \
+    } \
+  } while (false)
+
+/// Finish the coroutine early.
+#define CO_RETURN(co) \
+  do { \
+    (co).resume_point_ = 0; \
+    return COROUTINE_DONE; \
+  } while (false)
+
+/// End the body of a coroutine, must be the last statement of it.
+#define CO_END(co) \
+  } \
+  (co).resume_point_ = 0; \
+  return COROUTINE_DONE
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_COROUTINE_H
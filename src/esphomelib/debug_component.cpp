@@ -7,6 +7,7 @@
 //
 
 #include "esphomelib/debug_component.h"
+#include "esphomelib/application.h"
 #include "esphomelib/log.h"
 #include "esphomelib/helpers.h"
 #include <string>
@@ -136,6 +137,10 @@ void DebugComponent::setup() {
   ESP_LOGD(TAG, "Reset Reason: %s", ESP.getResetReason().c_str());
   ESP_LOGD(TAG, "Reset Info: %s", ESP.getResetInfo().c_str());
 #endif
+
+  this->set_interval(fnv1a_hash("idle-ratio"), 60000, [] {
+    ESP_LOGD(TAG, "Loop idle: %.1f%%", App.get_idle_ratio() * 100.0f);
+  });
 }
 void DebugComponent::loop() {
   uint32_t new_free_heap = ESP.getFreeHeap();
@@ -144,6 +149,9 @@ void DebugComponent::loop() {
     ESP_LOGD(TAG, "Free Heap Size: %u bytes", this->free_heap_);
   }
 }
+bool DebugComponent::needs_continuous_loop() const {
+  return false;
+}
 float DebugComponent::get_setup_priority() const {
   return setup_priority::LATE; // display debug info via MQTT
 }
@@ -21,6 +21,7 @@ class DebugComponent : public Component {
  public:
   void setup() override;
   void loop() override;
+  bool needs_continuous_loop() const override;
   float get_setup_priority() const override;
  protected:
   uint32_t free_heap_{};
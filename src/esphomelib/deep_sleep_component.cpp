@@ -39,6 +39,9 @@ void DeepSleepComponent::loop() {
       this->begin_sleep();
   }
 }
+bool DeepSleepComponent::needs_continuous_loop() const {
+  return this->loop_cycles_;
+}
 float DeepSleepComponent::get_loop_priority() const {
   return -100.0f; // run after everything else is ready
 }
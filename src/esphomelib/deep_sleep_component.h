@@ -40,6 +40,7 @@ class DeepSleepComponent : public Component {
 
   void setup() override;
   void loop() override;
+  bool needs_continuous_loop() const override;
   float get_loop_priority() const override;
 
  protected:
@@ -52,14 +52,21 @@
   #define USE_LIGHT
   #define USE_SWITCH
   #define USE_SIMPLE_SWITCH
-  #define USE_IR_TRANSMITTER
+  #ifndef ARDUINO_ARCH_HOST
+    #define USE_IR_TRANSMITTER
+  #endif
   #define USE_GPIO_SWITCH
   #define USE_RESTART_SWITCH
   #define USE_SHUTDOWN_SWITCH
   #define USE_FAN
   #define USE_DEBUG_COMPONENT
-  #define USE_WEB_SERVER
-  #define USE_DEEP_SLEEP
+  #define USE_COMPONENT_PROFILER
+  #ifndef ARDUINO_ARCH_HOST
+    #define USE_WEB_SERVER
+  #endif
+  #ifndef ARDUINO_ARCH_HOST
+    #define USE_DEEP_SLEEP
+  #endif
   #define USE_PCF8574
   #define USE_IO
   #define USE_MPU6050
@@ -74,10 +81,16 @@
   #ifdef ARDUINO_ARCH_ESP32
     #define USE_ESP32_BLE_TRACKER
   #endif
-  #define USE_FAST_LED_LIGHT
+  #ifndef ARDUINO_ARCH_HOST
+    #define USE_FAST_LED_LIGHT
+  #endif
   #define USE_ROTARY_ENCODER_SENSOR
 #endif
 
+// Uncomment (or pass -DUSE_FIXED_POINT_FILTERS) to run the averaging filters with Q16.16 fixed point numbers
+// instead of float, see Fixed16. Only sensible on the ESP8266 (no FPU) with sensor values within +-32767.
+// #define USE_FIXED_POINT_FILTERS
+
 #ifdef USE_GPIO_BINARY_SENSOR
   #ifndef USE_BINARY_SENSOR
     #define USE_BINARY_SENSOR
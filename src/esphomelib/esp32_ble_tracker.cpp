@@ -16,6 +16,7 @@
 #include <esp_bt.h>
 #include <freertos/task.h>
 #include <esp_gap_ble_api.h>
+#include "esphomelib/application.h"
 #include "esphomelib/log.h"
 
 ESPHOMELIB_NAMESPACE_BEGIN
@@ -180,7 +181,9 @@ void ESP32BLETracker::gap_scan_result(const esp_ble_gap_cb_param_t::ble_scan_res
 
     for (auto *dev : this->devices_) {
       if (dev->address_ == address) {
-        dev->publish_state(true);
+        // we're in the BLE task, let the main loop publish the state.
+        dev->pending_ = ESP32BLEDevice::PENDING_PRESENT;
+        this->post_publish_();
 
         // no break here - maybe someone has a use-case where they need several binary sensors with the same
         // address, shouldn't slow things down much anyway.
@@ -216,9 +219,11 @@ void ESP32BLETracker::start_scan(bool first) {
         }
       }
       if (!found) {
-        device->publish_state(false);
+        device->pending_ = ESP32BLEDevice::PENDING_ABSENT;
       }
     }
+    // also retries a publish that didn't fit in the event queue during the last scan.
+    this->post_publish_();
   }
   this->discovered_.clear();
   this->scan_params_.scan_type = BLE_SCAN_TYPE_ACTIVE;
@@ -236,6 +241,28 @@ ESP32BLEDevice *ESP32BLETracker::make_device(const std::string &name, std::array
   this->devices_.push_back(dev);
   return dev;
 }
+void ESP32BLETracker::post_publish_() {
+  // one event publishes the states of all devices that changed until then, so that a scan with many tracked
+  // devices can't fill the event queue shared with the other tasks.
+  if (this->publish_posted_.exchange(true))
+    return;
+  bool posted = App.post([this] {
+    this->publish_posted_ = false;
+    this->publish_devices_();
+  });
+  if (!posted) {
+    // the states stay pending and are published after the next scan result or scan.
+    this->publish_posted_ = false;
+    ESP_LOGW(TAG, "Event queue full, publishing the device states later.");
+  }
+}
+void ESP32BLETracker::publish_devices_() {
+  for (auto *device : this->devices_) {
+    const uint8_t pending = device->pending_.exchange(ESP32BLEDevice::PENDING_NONE);
+    if (pending != ESP32BLEDevice::PENDING_NONE)
+      device->publish_state(pending == ESP32BLEDevice::PENDING_PRESENT);
+  }
+}
 void ESP32BLETracker::set_scan_interval(uint32_t scan_interval) {
   this->scan_interval_ = scan_interval;
 }
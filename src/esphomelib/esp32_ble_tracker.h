@@ -15,6 +15,7 @@
 
 #ifdef USE_ESP32_BLE_TRACKER
 
+#include <atomic>
 #include <string>
 #include <array>
 #include <esp_gap_ble_api.h>
@@ -105,6 +106,10 @@ class ESP32BLETracker : public Component {
   void gap_scan_set_param_complete(const esp_ble_gap_cb_param_t::ble_scan_param_cmpl_evt_param &param);
   /// Called when a `ESP_GAP_BLE_SCAN_START_COMPLETE_EVT` event is received.
   void gap_scan_start_complete(const esp_ble_gap_cb_param_t::ble_scan_start_cmpl_evt_param &param);
+  /// Post publish_devices_() to the main loop unless that's already pending, called from the BLE task.
+  void post_publish_();
+  /// Publish the pending states of all devices, runs in the main loop.
+  void publish_devices_();
 
   /// An array of registered devices to track
   std::vector<ESP32BLEDevice *> devices_;
@@ -114,6 +119,8 @@ class ESP32BLETracker : public Component {
   esp_ble_scan_params_t scan_params_;
   /// The interval in seconds to perform scans.
   uint32_t scan_interval_{300};
+  /// Whether a publish_devices_() event is in the event queue.
+  std::atomic<bool> publish_posted_{false};
 };
 
 /// Simple helper class to expose an BLE device as a binary sensor.
@@ -126,7 +133,15 @@ class ESP32BLEDevice : public binary_sensor::BinarySensor {
 
   std::string device_class() override;
 
+  enum : uint8_t {
+    PENDING_NONE = 0,
+    PENDING_ABSENT,
+    PENDING_PRESENT,
+  };
+
   uint64_t address_;
+  /// The state set by the BLE task that the main loop hasn't published yet, only the latest one matters.
+  std::atomic<uint8_t> pending_{PENDING_NONE};
 };
 
 extern ESP32BLETracker *global_esp32_ble_tracker;
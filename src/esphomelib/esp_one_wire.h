@@ -9,6 +9,7 @@
 #ifndef ESPHOMELIB_ONE_WIRE_H
 #define ESPHOMELIB_ONE_WIRE_H
 
+#include "esphomelib/component.h"
 #include "esphomelib/esphal.h"
 #include "esphomelib/defines.h"
 
@@ -26,7 +27,7 @@ const int ONE_WIRE_ROM_SEARCH = 0xF0;
  * It's more or less the same as Arduino's internal library but uses some fancy C++ and 64 bit
  * unsigned integers to make our lives easier.
  */
-class ESPOneWire {
+class ESPOneWire : public SharedBus {
  public:
   /// Construct a OneWire instance for the specified pin. There should only exist one instance per pin.
   explicit ESPOneWire(GPIOPin *pin);
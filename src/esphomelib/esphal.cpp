@@ -32,7 +32,7 @@ void print_pin_mode(uint8_t pin, uint8_t mode) {
       case FUNCTION_3: mode_s = "FUNCTION_3"; break;
       case FUNCTION_4: mode_s = "FUNCTION_4"; break;
 
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
       case PULLUP: mode_s = "PULLUP"; break;
       case PULLDOWN: mode_s = "PULLDOWN"; break;
       case INPUT_PULLDOWN: mode_s = "INPUT_PULLDOWN"; break;
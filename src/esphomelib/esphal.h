@@ -8,7 +8,7 @@
 #ifdef ARDUINO_ARCH_ESP32
   #include <esp32-hal.h>
 #endif
-#ifdef ARDUINO_ARCH_ESP8266
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
   #include "Arduino.h"
 #endif
 #include "esphomelib/espmath.h"
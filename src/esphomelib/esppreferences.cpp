@@ -10,7 +10,7 @@
 
 ESPHOMELIB_NAMESPACE_BEGIN
 
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
 void ESPPreferences::begin(const std::string &name) {
   this->preferences_.begin(truncate_string(name, 15).c_str());
 }
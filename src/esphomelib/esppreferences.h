@@ -7,7 +7,7 @@
 
 #include <string>
 
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
 #include <Preferences.h>
 #endif
 
@@ -48,7 +48,7 @@ class ESPPreferences {
 
  protected:
 
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
   /// Return a key for the nvs storage by hashing the friendly name and truncating the key to 7 characters.
   std::string get_preference_key(const std::string &friendly_name, const std::string &key);
 
@@ -0,0 +1,112 @@
+#ifndef ESPHOMELIB_EVENT_QUEUE_H
+#define ESPHOMELIB_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "esphomelib/esphal.h"
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+/** A bounded lock-free multi-producer single-consumer queue.
+ *
+ * push() can be called from any task or core, while pop() must only be called by a single consumer
+ * (for Application this is loop()). The template code isn't placed in IRAM, so interrupts shouldn't push.
+ * Each cell carries a sequence number that tells producers and the consumer whether the cell is free or
+ * filled (Dmitry Vyukov's bounded queue), so no locks are needed and nothing is allocated after construction.
+ *
+ * @tparam T The item type, needs to be default-constructible and move-assignable.
+ * @tparam SIZE The capacity of the queue, must be a power of two.
+ */
+template<typename T, size_t SIZE>
+class EventQueue {
+  static_assert(SIZE != 0 && (SIZE & (SIZE - 1)) == 0, "EventQueue size must be a power of two.");
+
+ public:
+  EventQueue();
+
+  /// Add item to the queue, returns false if the queue is full. Safe to call from any task, not from interrupts.
+  bool push(T &&item);
+
+  /// Take the oldest item from the queue, returns false if it's empty. Only call from the consumer.
+  bool pop(T &item);
+
+ protected:
+  /// Atomically replace tail_ with desired if it's expected, otherwise store the current value in expected.
+  bool compare_exchange_tail_(uint32_t &expected, uint32_t desired);
+
+  struct Cell {
+    std::atomic<uint32_t> sequence; ///< pos if the cell is free for push #pos, pos + 1 if it's filled by it.
+    T item;
+  };
+
+  Cell cells_[SIZE];
+  std::atomic<uint32_t> tail_{0}; ///< Position of the next push().
+  uint32_t head_{0}; ///< Position of the next pop(), only accessed by the consumer.
+};
+
+template<typename T, size_t SIZE>
+EventQueue<T, SIZE>::EventQueue() {
+  for (uint32_t i = 0; i < SIZE; i++)
+    this->cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+template<typename T, size_t SIZE>
+bool EventQueue<T, SIZE>::push(T &&item) {
+  uint32_t pos = this->tail_.load(std::memory_order_relaxed);
+  Cell *cell;
+  while (true) {
+    cell = &this->cells_[pos & (SIZE - 1)];
+    const uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const auto diff = int32_t(sequence - pos);
+    if (diff == 0) {
+      // cell is free, try to claim it
+      if (this->compare_exchange_tail_(pos, pos + 1))
+        break;
+    } else if (diff < 0) {
+      // cell still holds the item of the previous round, queue is full
+      return false;
+    } else {
+      // another producer claimed this position in the meantime
+      pos = this->tail_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->item = std::move(item);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+template<typename T, size_t SIZE>
+bool EventQueue<T, SIZE>::pop(T &item) {
+  Cell *cell = &this->cells_[this->head_ & (SIZE - 1)];
+  const uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+  if (sequence != this->head_ + 1)
+    // empty, or the producer of this cell hasn't finished writing it yet
+    return false;
+  item = std::move(cell->item);
+  cell->sequence.store(this->head_ + SIZE, std::memory_order_release);
+  this->head_++;
+  return true;
+}
+template<typename T, size_t SIZE>
+bool EventQueue<T, SIZE>::compare_exchange_tail_(uint32_t &expected, uint32_t desired) {
+#ifdef ARDUINO_ARCH_ESP8266
+  // The ESP8266 is single-core and has no compare-and-swap instruction, masking interrupts for
+  // these few instructions has the same effect.
+  const uint32_t state = xt_rsil(15);
+  const uint32_t current = this->tail_.load(std::memory_order_relaxed);
+  const bool success = current == expected;
+  if (success)
+    this->tail_.store(desired, std::memory_order_relaxed);
+  else
+    expected = current;
+  xt_wsr_ps(state);
+  return success;
+#else
+  return this->tail_.compare_exchange_weak(expected, desired, std::memory_order_relaxed);
+#endif
+}
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_EVENT_QUEUE_H
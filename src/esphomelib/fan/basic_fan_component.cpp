@@ -76,6 +76,9 @@ void BasicFanComponent::loop() {
     }
   }
 }
+bool BasicFanComponent::needs_continuous_loop() const {
+  return this->next_update_;
+}
 
 } // namespace fan
 
@@ -48,6 +48,7 @@ class BasicFanComponent : public Component {
   void set_state(FanState *state);
   void setup() override;
   void loop() override;
+  bool needs_continuous_loop() const override;
 
  protected:
   FanState *state_{nullptr};
@@ -41,7 +41,7 @@ const FanTraits &FanState::get_traits() const {
 void FanState::set_traits(const FanTraits &traits) {
   this->traits_ = traits;
 }
-void FanState::add_on_state_change_callback(std::function<void()> &&update_callback) {
+void FanState::add_on_state_change_callback(InlineFunction<void()> &&update_callback) {
   this->state_callback_.add(std::move(update_callback));
 }
 FanState::FanState(const std::string &name) : Nameable(name) {}
@@ -57,22 +57,24 @@ void FanState::save_to_preferences() {
   global_preferences.put_int32(this->get_name(), "speed", this->get_speed());
 }
 bool FanState::set_speed(const char *speed) {
-  if (strcasecmp(speed, "off") == 0) {
-    ESP_LOGD(TAG, "Turning Fan Speed off.");
-    this->set_speed(FanState::SPEED_OFF);
-  } else if (strcasecmp(speed, "low") == 0) {
-    ESP_LOGD(TAG, "Turning Fan Speed low.");
-    this->set_speed(FanState::SPEED_LOW);
-  } else if (strcasecmp(speed, "medium") == 0) {
-    ESP_LOGD(TAG, "Turning Fan Speed medium.");
-    this->set_speed(FanState::SPEED_MEDIUM);
-  } else if (strcasecmp(speed, "high") == 0) {
-    ESP_LOGD(TAG, "Turning Fan Speed high.");
-    this->set_speed(FanState::SPEED_HIGH);
-  } else
+  auto parsed = FanState::parse_speed(speed);
+  if (!parsed.defined)
     return false;
+  ESP_LOGD(TAG, "Turning Fan Speed %s.", speed);
+  this->set_speed(parsed.value);
   return true;
 }
+Optional<FanState::Speed> FanState::parse_speed(const char *speed) {
+  if (strcasecmp(speed, "off") == 0)
+    return FanState::SPEED_OFF;
+  if (strcasecmp(speed, "low") == 0)
+    return FanState::SPEED_LOW;
+  if (strcasecmp(speed, "medium") == 0)
+    return FanState::SPEED_MEDIUM;
+  if (strcasecmp(speed, "high") == 0)
+    return FanState::SPEED_HIGH;
+  return Optional<FanState::Speed>();
+}
 
 } // namespace fan
 
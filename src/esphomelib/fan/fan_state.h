@@ -39,7 +39,7 @@ class FanState : public Nameable {
   explicit FanState(const std::string &name);
 
   /// Register a callback that will be called each time the state changes.
-  void add_on_state_change_callback(std::function<void()> &&update_callback);
+  void add_on_state_change_callback(InlineFunction<void()> &&update_callback);
 
   /// Get the current ON/OFF state of this fan.
   bool get_state() const;
@@ -54,6 +54,8 @@ class FanState : public Nameable {
   /// Set the current speed of this fan.
   void set_speed(Speed speed);
   bool set_speed(const char *speed);
+  /// Parse a speed name ("off", "low", "medium" or "high", case insensitive), undefined if it's not valid.
+  static Optional<Speed> parse_speed(const char *speed);
   /// Get the traits of this fan (i.e. what features it supports).
   const FanTraits &get_traits() const;
   /// Set the traits of this fan (i.e. what features it supports).
@@ -28,7 +28,7 @@ std::string MQTTFanComponent::component_type() const {
 void MQTTFanComponent::setup() {
   ESP_LOGD(TAG, "Setting up MQTT fan...");
 
-  this->subscribe(this->get_command_topic(), [this](const std::string &payload) {
+  this->subscribe(this->get_command_topic(), [this](const StringRef &payload) {
     if (strcasecmp(payload.c_str(), "ON") == 0) {
       ESP_LOGD(TAG, "Turning Fan ON.");
       this->state_->set_state(true);
@@ -39,7 +39,7 @@ void MQTTFanComponent::setup() {
   });
 
   if (this->state_->get_traits().supports_oscillation()) {
-    this->subscribe(this->get_oscillation_command_topic(), [this](const std::string &payload) {
+    this->subscribe(this->get_oscillation_command_topic(), [this](const StringRef &payload) {
       auto val = parse_on_off(payload.c_str(), "oscillate_on", "oscillate_off");
       if (val.defined) {
         ESP_LOGW(TAG, "Unknown Oscillation Payload %s", payload.c_str());
@@ -50,13 +50,13 @@ void MQTTFanComponent::setup() {
   }
 
   if (this->state_->get_traits().supports_speed()) {
-    this->subscribe(this->get_speed_command_topic(), [this](const std::string &payload) {
+    this->subscribe(this->get_speed_command_topic(), [this](const StringRef &payload) {
       this->state_->set_speed(payload.c_str());
     });
   }
 
   this->state_->add_on_state_change_callback([this]() {
-    this->defer("send", [this]() {
+    this->defer(fnv1a_hash("send"), [this]() {
       this->send_state();
     });
   });
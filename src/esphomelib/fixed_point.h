@@ -0,0 +1,78 @@
+//
+// Created by Otto Winter on 17.10.26.
+//
+
+#ifndef ESPHOMELIB_FIXED_POINT_H
+#define ESPHOMELIB_FIXED_POINT_H
+
+#include <cstdint>
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+/** A signed Q16.16 fixed point number: 16 integer and 16 fraction bits in an int32_t.
+ *
+ * The ESP8266 has no FPU, so each float operation is a call into the soft-float library, while fixed point
+ * numbers only need integer instructions. The range is -32768 to 32767.99998 with a resolution of 1/65536,
+ * conversions from float saturate. Products and quotients use a 64-bit intermediate and truncate.
+ *
+ * Build with `-DUSE_FIXED_POINT_FILTERS` to run the averaging filters of sensors with this type, see
+ * SlidingWindowMovingAverageFilter. Only do this if all sensor values are within the range above
+ * (illuminance or gas resistance, for example, are not).
+ */
+class Fixed16 {
+ public:
+  static const uint8_t FRACTION_BITS = 16;
+  static const int32_t ONE = int32_t(1) << FRACTION_BITS;
+
+  Fixed16() = default;
+
+  /// Create a number from its raw Q16.16 representation.
+  static Fixed16 from_raw(int32_t raw) {
+    Fixed16 ret;
+    ret.raw_ = raw;
+    return ret;
+  }
+  /// Create a number from value, saturating at the limits of the range. NAN becomes 0.
+  static Fixed16 from_float(float value) {
+    if (value >= 32768.0f)
+      return from_raw(INT32_MAX);
+    if (value < -32768.0f)
+      return from_raw(INT32_MIN);
+    if (!(value == value))
+      return from_raw(0);
+    return from_raw(int32_t(value * ONE));
+  }
+  static Fixed16 from_int(int16_t value) { return from_raw(int32_t(value) * ONE); }
+
+  float to_float() const { return float(this->raw_) / ONE; }
+  int32_t raw() const { return this->raw_; }
+
+  Fixed16 operator+(Fixed16 other) const { return from_raw(this->raw_ + other.raw_); }
+  Fixed16 operator-(Fixed16 other) const { return from_raw(this->raw_ - other.raw_); }
+  Fixed16 operator*(Fixed16 other) const {
+    return from_raw(int32_t((int64_t(this->raw_) * other.raw_) >> FRACTION_BITS));
+  }
+  Fixed16 operator/(Fixed16 other) const {
+    return from_raw(int32_t((int64_t(this->raw_) << FRACTION_BITS) / other.raw_));
+  }
+  Fixed16 &operator+=(Fixed16 other) {
+    this->raw_ += other.raw_;
+    return *this;
+  }
+  Fixed16 &operator-=(Fixed16 other) {
+    this->raw_ -= other.raw_;
+    return *this;
+  }
+  bool operator==(Fixed16 other) const { return this->raw_ == other.raw_; }
+  bool operator!=(Fixed16 other) const { return this->raw_ != other.raw_; }
+  bool operator<(Fixed16 other) const { return this->raw_ < other.raw_; }
+  bool operator>(Fixed16 other) const { return this->raw_ > other.raw_; }
+
+ protected:
+  int32_t raw_{0};
+};
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_FIXED_POINT_H
@@ -2,6 +2,7 @@
 // Created by Otto Winter on 25.11.17.
 //
 
+#include <cassert>
 #include <cstdio>
 #include <algorithm>
 
@@ -10,6 +11,9 @@
 #else
   #include <Esp.h>
 #endif
+#ifdef ARDUINO_ARCH_HOST
+  #include <WiFi.h>
+#endif
 
 #include "esphomelib/helpers.h"
 #include "esphomelib/log.h"
@@ -26,7 +30,7 @@ std::string get_mac_address() {
 #ifdef ARDUINO_ARCH_ESP32
   esp_efuse_mac_get_default(mac);
 #endif
-#ifdef ARDUINO_ARCH_ESP8266
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
   WiFi.macAddress(mac);
 #endif
   sprintf(tmp, "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
@@ -109,7 +113,207 @@ float ExponentialMovingAverage::next_value(float value) {
   return this->calculate_average();
 }
 
+FixedExponentialMovingAverage::FixedExponentialMovingAverage(float alpha)
+    : alpha_(Fixed16::from_float(alpha)) {}
+
+float FixedExponentialMovingAverage::get_alpha() const {
+  return this->alpha_.to_float();
+}
+
+void FixedExponentialMovingAverage::set_alpha(float alpha) {
+  this->alpha_ = Fixed16::from_float(alpha);
+}
+
+Fixed16 FixedExponentialMovingAverage::calculate_average() {
+  return this->accumulator_;
+}
+
+Fixed16 FixedExponentialMovingAverage::next_value(Fixed16 value) {
+  // same as alpha * value + (1 - alpha) * accumulator, with a single multiplication
+  this->accumulator_ += this->alpha_ * (value - this->accumulator_);
+  return this->calculate_average();
+}
+
+SlidingWindowQuantile::SlidingWindowQuantile(size_t max_size)
+    : nodes_(new Node[max_size]), max_size_(max_size) {
+  assert(max_size > 0 && max_size < NONE);
+}
+void SlidingWindowQuantile::next_value(float value) {
+  uint16_t slot;
+  if (this->size_ < this->max_size_) {
+    slot = this->size_++;
+  } else {
+    slot = this->head_;
+    this->root_ = this->erase_(this->root_, slot);
+    if (++this->head_ == this->max_size_)
+      this->head_ = 0;
+  }
+
+  // xorshift32, the priorities only need to be "random enough" to keep the tree balanced.
+  this->seed_ ^= this->seed_ << 13;
+  this->seed_ ^= this->seed_ >> 17;
+  this->seed_ ^= this->seed_ << 5;
+  Node &node = this->nodes_[slot];
+  node.value = value;
+  node.priority = this->seed_;
+  node.left = node.right = NONE;
+  node.size = 1;
+
+  uint16_t left, right;
+  this->split_(this->root_, slot, left, right);
+  this->root_ = this->merge_(this->merge_(left, slot), right);
+}
+float SlidingWindowQuantile::get_kth(size_t k) const {
+  uint16_t node = this->root_;
+  while (true) {
+    const size_t left_size = this->subtree_size_(this->nodes_[node].left);
+    if (k < left_size) {
+      node = this->nodes_[node].left;
+    } else if (k == left_size) {
+      return this->nodes_[node].value;
+    } else {
+      k -= left_size + 1;
+      node = this->nodes_[node].right;
+    }
+  }
+}
+float SlidingWindowQuantile::get_quantile(float q) const {
+  if (this->size_ == 0)
+    return NAN;
+  const float position = clamp(0.0f, 1.0f, q) * (this->size_ - 1);
+  const size_t lower = size_t(position);
+  const float lower_value = this->get_kth(lower);
+  if (lower + 1 >= this->size_)
+    return lower_value;
+  return lower_value + (position - lower) * (this->get_kth(lower + 1) - lower_value);
+}
+float SlidingWindowQuantile::get_median() const {
+  return this->get_quantile(0.5f);
+}
+float SlidingWindowQuantile::get_median_absolute_deviation() const {
+  if (this->size_ == 0)
+    return NAN;
+  const float median = this->get_median();
+  const size_t split = this->size_ / 2;
+  if (this->size_ % 2 == 1)
+    return this->kth_distance_(split, split, median);
+  return (this->kth_distance_(split - 1, split, median) + this->kth_distance_(split, split, median)) / 2.0f;
+}
+float SlidingWindowQuantile::kth_distance_(size_t k, size_t split, float median) const {
+  // The distances of the values below split (walking down from split - 1) and of the values from split
+  // upwards are both ascending, so this is the k-th smallest element of two sorted sequences:
+  // binary search for how many elements come from the lower one.
+  auto lower = [&](size_t i) { return median - this->get_kth(split - 1 - i); };
+  auto upper = [&](size_t j) { return this->get_kth(split + j) - median; };
+  const size_t lower_count = split;
+  const size_t upper_count = this->size_ - split;
+  size_t lo = k + 1 > upper_count ? k + 1 - upper_count : 0;
+  size_t hi = std::min(k + 1, lower_count);
+  while (lo < hi) {
+    // i elements from lower and k + 1 - i from upper
+    const size_t i = (lo + hi) / 2;
+    if (lower(i) < upper(k - i))
+      lo = i + 1;
+    else
+      hi = i;
+  }
+  const size_t i = lo;
+  // the k-th smallest is the larger of the last elements taken from both sequences.
+  float result = -INFINITY;
+  if (i > 0)
+    result = std::max(result, lower(i - 1));
+  if (k + 1 - i > 0)
+    result = std::max(result, upper(k - i));
+  return result;
+}
+size_t SlidingWindowQuantile::size() const {
+  return this->size_;
+}
+size_t SlidingWindowQuantile::get_max_size() const {
+  return this->max_size_;
+}
+bool SlidingWindowQuantile::less_(uint16_t a, uint16_t b) const {
+  const float value_a = this->nodes_[a].value, value_b = this->nodes_[b].value;
+  return value_a < value_b || (value_a == value_b && a < b);
+}
+uint16_t SlidingWindowQuantile::subtree_size_(uint16_t node) const {
+  return node == NONE ? 0 : this->nodes_[node].size;
+}
+void SlidingWindowQuantile::update_size_(uint16_t node) {
+  Node &n = this->nodes_[node];
+  n.size = 1 + this->subtree_size_(n.left) + this->subtree_size_(n.right);
+}
+void SlidingWindowQuantile::split_(uint16_t tree, uint16_t key, uint16_t &left, uint16_t &right) {
+  if (tree == NONE) {
+    left = right = NONE;
+  } else if (this->less_(tree, key)) {
+    this->split_(this->nodes_[tree].right, key, this->nodes_[tree].right, right);
+    left = tree;
+    this->update_size_(tree);
+  } else {
+    this->split_(this->nodes_[tree].left, key, left, this->nodes_[tree].left);
+    right = tree;
+    this->update_size_(tree);
+  }
+}
+uint16_t SlidingWindowQuantile::merge_(uint16_t left, uint16_t right) {
+  if (left == NONE)
+    return right;
+  if (right == NONE)
+    return left;
+  if (this->nodes_[left].priority > this->nodes_[right].priority) {
+    this->nodes_[left].right = this->merge_(this->nodes_[left].right, right);
+    this->update_size_(left);
+    return left;
+  }
+  this->nodes_[right].left = this->merge_(left, this->nodes_[right].left);
+  this->update_size_(right);
+  return right;
+}
+uint16_t SlidingWindowQuantile::erase_(uint16_t tree, uint16_t key) {
+  if (tree == key)
+    return this->merge_(this->nodes_[tree].left, this->nodes_[tree].right);
+  if (this->less_(key, tree))
+    this->nodes_[tree].left = this->erase_(this->nodes_[tree].left, key);
+  else
+    this->nodes_[tree].right = this->erase_(this->nodes_[tree].right, key);
+  this->update_size_(tree);
+  return tree;
+}
+
+/// Powers of ten for value_accuracy_to_string(), so that it doesn't need pow10().
+static const float POWERS_OF_TEN[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f};
+static const int32_t INT_POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
 std::string value_accuracy_to_string(float value, int8_t accuracy_decimals) {
+  if (accuracy_decimals >= 0 && accuracy_decimals <= 8) {
+    // Format the rounded value as an integer with a decimal point, instead of pow10() and dtostrf()
+    // which are slow on the FPU-less ESP8266. Only the fraction is scaled as float, so that it's exact.
+    if (fabsf(value) * POWERS_OF_TEN[accuracy_decimals] < 2.0e9f) {
+      const float int_part = truncf(value);
+      const int32_t scaled = int32_t(int_part) * INT_POWERS_OF_TEN[accuracy_decimals] +
+          int32_t(roundf((value - int_part) * POWERS_OF_TEN[accuracy_decimals]));
+      const bool negative = scaled < 0;
+      uint32_t n = negative ? uint32_t(-scaled) : uint32_t(scaled);
+      char buffer[16];
+      char *end = buffer + sizeof(buffer);
+      char *p = end;
+      for (int8_t i = 0; i < accuracy_decimals; i++) {
+        *--p = char('0' + n % 10);
+        n /= 10;
+      }
+      if (accuracy_decimals > 0)
+        *--p = '.';
+      do {
+        *--p = char('0' + n % 10);
+        n /= 10;
+      } while (n != 0);
+      if (negative)
+        *--p = '-';
+      return std::string(p, end);
+    }
+  }
+  // NAN, infinite, huge values or negative accuracy decimals
   auto multiplier = float(pow10(accuracy_decimals));
   float value_rounded = roundf(value * multiplier) / multiplier;
   char tmp[32]; // should be enough, but we should maybe improve this at some point.
@@ -150,6 +354,17 @@ void parse_json(const std::string &data, const json_parse_t &f) {
 
   f(root);
 }
+void parse_json(char *data, const json_parse_t &f) {
+  StaticJsonBuffer<JSON_BUFFER_SIZE> buffer;
+  JsonObject &root = buffer.parseObject(data);
+
+  if (!root.success()) {
+    ESP_LOGW(TAG, "Parsing JSON failed.");
+    return;
+  }
+
+  f(root);
+}
 Optional<bool> parse_on_off(const char *str, const char *payload_on, const char *payload_off) {
   if (strcasecmp(str, payload_on) == 0)
     return true;
@@ -167,7 +382,7 @@ void reboot(const char *cause) {
   run_shutdown_hooks(cause);
   ESP.restart();
 }
-void add_shutdown_hook(std::function<void(const char *)> &&f) {
+void add_shutdown_hook(shutdown_hook_t &&f) {
   shutdown_hooks.add(std::move(f));
 }
 void safe_reboot(const char *cause) {
@@ -175,7 +390,7 @@ void safe_reboot(const char *cause) {
   run_safe_shutdown_hooks(cause);
   ESP.restart();
 }
-void add_safe_shutdown_hook(std::function<void(const char *)> &&f) {
+void add_safe_shutdown_hook(shutdown_hook_t &&f) {
   safe_shutdown_hooks.add(std::move(f));
 }
 
@@ -205,6 +420,24 @@ void enable_interrupts() {
 #endif
 }
 
+uint32_t fnv1a_hash(const std::string &str) {
+  return fnv1a_hash(str.data(), str.size());
+}
+bool operator==(const StringRef &lhs, const StringRef &rhs) {
+  return lhs.size() == rhs.size() && memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+bool operator!=(const StringRef &lhs, const StringRef &rhs) {
+  return !(lhs == rhs);
+}
+uint32_t fnv1a_hash(const char *data, size_t len) {
+  if (len == 0)
+    return 0;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; i++)
+    hash = (hash ^ uint8_t(data[i])) * 16777619UL;
+  return hash;
+}
+
 uint8_t crc8(uint8_t *data, uint8_t len) {
   uint8_t crc = 0;
 
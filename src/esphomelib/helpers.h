@@ -6,13 +6,18 @@
 #define ESPHOMELIB_HELPERS_H
 
 #include <string>
+#include <cstring>
 #include <IPAddress.h>
 #include <memory>
-#include <queue>
+#include <algorithm>
+#include <vector>
 #include <functional>
+#include <new>
+#include <type_traits>
 #include <ArduinoJson.h>
 
 #include "esphomelib/esphal.h"
+#include "esphomelib/fixed_point.h"
 #include "esphomelib/defines.h"
 
 #ifndef JSON_BUFFER_SIZE
@@ -27,6 +32,8 @@ using json_parse_t = std::function<void(JsonObject &)>;
 /// Callback function typedef for building JsonObjects.
 using json_build_t = std::function<void(JsonBuffer &, JsonObject &)>;
 
+template<typename Signature, size_t Size = 3 * sizeof(void *)> class InlineFunction;
+
 /// The characters that are allowed in a hostname.
 extern const char *HOSTNAME_CHARACTER_WHITELIST;
 
@@ -48,8 +55,11 @@ bool is_empty(const IPAddress &address);
 /// Force a shutdown (and reboot) of the ESP, calling any registered shutdown hooks.
 void reboot(const char *cause);
 
+/// Function type of shutdown hooks, the callable is stored inline (see InlineFunction).
+using shutdown_hook_t = InlineFunction<void(const char *)>;
+
 /// Add a shutdown callback.
-void add_shutdown_hook(std::function<void(const char *)> &&f);
+void add_shutdown_hook(shutdown_hook_t &&f);
 
 /// Create a safe shutdown (and reboot) of the ESP, calling any registered shutdown and safe shutdown hooks.
 void safe_reboot(const char *cause);
@@ -58,7 +68,7 @@ void safe_reboot(const char *cause);
 void run_shutdown_hooks(const char *cause);
 
 /// Add a safe shutdown callback that will be called if the device is shut down intentionally.
-void add_safe_shutdown_hook(std::function<void(const char *)> &&f);
+void add_safe_shutdown_hook(shutdown_hook_t &&f);
 
 /// Run safe shutdown and force shutdown hooks.
 void run_safe_shutdown_hooks(const char *cause);
@@ -72,6 +82,13 @@ std::string build_json(const json_build_t &f);
 /// Parse a JSON string and run the provided json parse function if it's valid.
 void parse_json(const std::string &data, const json_parse_t &f);
 
+/** Parse the null-terminated JSON string data in place and run the provided json parse function if it's valid.
+ *
+ * Unlike the std::string version this doesn't copy the string: data is modified and the strings of the
+ * JsonObject point into it.
+ */
+void parse_json(char *data, const json_parse_t &f);
+
 /** Clamp the value between min and max.
  *
  * @tparam T The input/output typename.
@@ -139,6 +156,25 @@ void enable_interrupts();
 /// Calculate a crc8 of data with the provided data length.
 uint8_t crc8(uint8_t *data, uint8_t len);
 
+/// Internal helper for fnv1a_hash(), one step of the FNV-1a algorithm.
+constexpr uint32_t fnv1a_hash_step(const char *str, uint32_t hash) {
+  return *str == '\0' ? hash : fnv1a_hash_step(str + 1, (hash ^ uint8_t(*str)) * 16777619UL);
+}
+
+/** Calculate the 32-bit FNV-1a hash of a string, returns 0 for an empty string.
+ *
+ * This is constexpr, so it can be used to turn a string literal into an integer id at compile time,
+ * for example for allocation-free names of interval/timeout functions.
+ */
+constexpr uint32_t fnv1a_hash(const char *str) {
+  return *str == '\0' ? 0 : fnv1a_hash_step(str, 2166136261UL);
+}
+
+/// Calculate the 32-bit FNV-1a hash of a std::string, returns 0 for an empty string.
+uint32_t fnv1a_hash(const std::string &str);
+/// Calculate the 32-bit FNV-1a hash of len bytes of data (not null-terminated), returns 0 if len is 0.
+uint32_t fnv1a_hash(const char *data, size_t len);
+
 /// Helper class to represent an optional value.
 template<typename T>
 class Optional {
@@ -164,13 +200,48 @@ class Optional {
 
 Optional<bool> parse_on_off(const char *str, const char *payload_on = "on", const char *payload_off = "off");
 
-/// Helper class that implements a sliding window moving average.
-template<typename T>
+/** A reference to a string owned by someone else, like std::string_view.
+ *
+ * Used to pass received data around without copying it into a std::string. It converts implicitly from and
+ * to std::string, so functions taking a StringRef also accept std::strings and string literals, and
+ * callbacks taking a `const std::string &` still work (with a copy).
+ */
+class StringRef {
+ public:
+  StringRef() = default;
+  StringRef(const char *data, size_t len) : data_(data), size_(len) {}
+  StringRef(const char *str) : data_(str), size_(strlen(str)) {} // NOLINT
+  StringRef(const std::string &str) : data_(str.data()), size_(str.size()) {} // NOLINT
+
+  const char *data() const { return this->data_; }
+  size_t size() const { return this->size_; }
+  bool empty() const { return this->size_ == 0; }
+  /// The data as a C string, only valid if the referenced string is null-terminated (like received MQTT messages).
+  const char *c_str() const { return this->data_; }
+  std::string str() const { return std::string(this->data_, this->size_); }
+  operator std::string() const { return this->str(); } // NOLINT
+
+ protected:
+  const char *data_{""};
+  size_t size_{0};
+};
+
+bool operator==(const StringRef &lhs, const StringRef &rhs);
+bool operator!=(const StringRef &lhs, const StringRef &rhs);
+
+/** Helper class that implements a sliding window moving average.
+ *
+ * @tparam T The type of the values.
+ * @tparam S The type of the sum of the window, for example int64_t for int32_t values so that it can't overflow.
+ */
+template<typename T, typename S = T>
 class SlidingWindowMovingAverage {
  public:
   /** Create the SlidingWindowMovingAverage.
    *
-   * @param max_size The window size.
+   * The buffer for the window is allocated once here, pushing values never allocates.
+   *
+   * @param max_size The window size, must be greater than 0.
    */
   explicit SlidingWindowMovingAverage(size_t max_size);
 
@@ -185,12 +256,18 @@ class SlidingWindowMovingAverage {
   T calculate_average();
 
   size_t get_max_size() const;
+  /// Change the window size, keeping the newest values. This re-allocates the buffer.
   void set_max_size(size_t max_size);
 
  protected:
-  std::queue<T> queue_;
+  /// Recompute sum_ from the values in the window, so that rounding errors don't accumulate.
+  void recalculate_sum_();
+
+  std::unique_ptr<T[]> buffer_; ///< Ring buffer of max_size_ values, the oldest one at head_.
   size_t max_size_;
-  T sum_;
+  size_t size_{0};
+  size_t head_{0};
+  S sum_;
 };
 
 /// Helper class that implements an exponential moving average.
@@ -210,24 +287,187 @@ class ExponentialMovingAverage {
   float accumulator_;
 };
 
-template<typename... X> class CallbackManager;
+/// Like ExponentialMovingAverage, but with Fixed16 numbers so that it doesn't need the soft-float library.
+class FixedExponentialMovingAverage {
+ public:
+  explicit FixedExponentialMovingAverage(float alpha);
+
+  Fixed16 next_value(Fixed16 value);
+
+  Fixed16 calculate_average();
+
+  void set_alpha(float alpha);
+  float get_alpha() const;
+
+ protected:
+  Fixed16 alpha_;
+  Fixed16 accumulator_;
+};
+
+/** A sliding window over the last max_size values that can return any order statistic (median, quantiles, ...).
+ *
+ * The values are kept in a treap (a randomized balanced search tree) whose nodes live in a ring buffer
+ * allocated once in the constructor, so pushing a value and getting the k-th smallest value both take
+ * O(log n), even for windows of several hundred values. NAN values must not be pushed.
+ */
+class SlidingWindowQuantile {
+ public:
+  /// Create the window, max_size must be between 1 and 65534.
+  explicit SlidingWindowQuantile(size_t max_size);
+
+  /// Add value to the window, replacing the oldest value if the window is full.
+  void next_value(float value);
+
+  /// Get the k-th smallest value in the window, 0 being the smallest. k must be less than size().
+  float get_kth(size_t k) const;
+
+  /// Get quantile q (0.0 to 1.0) of the window, linearly interpolating between the closest ranks. NAN if empty.
+  float get_quantile(float q) const;
+
+  /// Get the median of the window, NAN if empty.
+  float get_median() const;
+
+  /// Get the median absolute deviation from the median of the window in O(log^2 n), NAN if empty.
+  float get_median_absolute_deviation() const;
+
+  size_t size() const;
+  size_t get_max_size() const;
+
+ protected:
+  static const uint16_t NONE = 0xFFFF;
+
+  struct Node {
+    float value;
+    uint32_t priority;
+    uint16_t left;
+    uint16_t right;
+    uint16_t size; ///< The number of nodes in the subtree of this node.
+  };
+
+  /// Whether node a is sorted before node b, by value and then by slot.
+  bool less_(uint16_t a, uint16_t b) const;
+  uint16_t subtree_size_(uint16_t node) const;
+  void update_size_(uint16_t node);
+  /// Split tree into the nodes sorted before key and the rest.
+  void split_(uint16_t tree, uint16_t key, uint16_t &left, uint16_t &right);
+  /// Merge two trees, all nodes of left must be sorted before the ones of right.
+  uint16_t merge_(uint16_t left, uint16_t right);
+  uint16_t erase_(uint16_t tree, uint16_t key);
+  /// k-th smallest distance |x - median| given the position of the median, see get_median_absolute_deviation().
+  float kth_distance_(size_t k, size_t split, float median) const;
+
+  std::unique_ptr<Node[]> nodes_; ///< Ring buffer of nodes, the oldest one at head_.
+  size_t max_size_;
+  size_t size_{0};
+  size_t head_{0};
+  uint16_t root_{NONE};
+  uint32_t seed_{2463534242UL}; ///< State of the xorshift generator for the node priorities.
+};
+
+/** A std::function replacement that never allocates, the callable is stored inside the object.
+ *
+ * The callable (usually a lambda) must fit into Size bytes, otherwise compilation fails. By default
+ * that's enough for capturing `this` and two more pointers - capture pointers instead of larger objects
+ * like strings.
+ *
+ * @tparam R The return type of the callable.
+ * @tparam Args The arguments of the callable.
+ * @tparam Size The size of the inline storage in bytes.
+ */
+template<size_t Size, typename R, typename... Args>
+class InlineFunction<R(Args...), Size> {
+ public:
+  InlineFunction() = default;
+  InlineFunction(std::nullptr_t) {} // NOLINT
+
+  /// Store f, a null function pointer or an empty std::function results in an empty InlineFunction.
+  template<typename F, typename = typename std::enable_if<
+      !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+  InlineFunction(F &&f); // NOLINT
 
+  InlineFunction(const InlineFunction &other);
+  InlineFunction(InlineFunction &&other) noexcept;
+  InlineFunction &operator=(const InlineFunction &other);
+  InlineFunction &operator=(InlineFunction &&other) noexcept;
+  ~InlineFunction();
+
+  /// Call the stored callable, must not be empty.
+  R operator()(Args... args) const;
+
+  /// Return whether a callable is stored.
+  explicit operator bool() const;
+
+ protected:
+  enum Operation { COPY, MOVE, DESTROY };
+
+  template<typename F>
+  static R call_impl_(void *storage, Args... args);
+  template<typename F>
+  static void manage_impl_(Operation operation, void *dst, void *src);
+
+  /// Whether f is a callable that can't be called, like a null function pointer.
+  template<typename F>
+  static bool is_empty_(const F &f);
+  template<typename FR, typename... FArgs>
+  static bool is_empty_(FR (*f)(FArgs...));
+  template<typename Signature>
+  static bool is_empty_(const std::function<Signature> &f);
+
+  /// Destroy the stored callable, if any.
+  void reset_();
+
+  mutable typename std::aligned_storage<Size, alignof(std::max_align_t)>::type storage_;
+  R (*call_)(void *, Args...){nullptr};
+  void (*manage_)(Operation, void *, void *){nullptr};
+};
+
+template<typename Signature, size_t N = 0> class CallbackManager;
 
 /** Simple helper class to allow having multiple subscribers to a signal.
+ *
+ * The callbacks are stored in InlineFunctions, so registering a lambda capturing `this` and up to two more
+ * pointers only allocates the slot in the vector, never the callback itself.
  *
  * @tparam Ts The arguments for the callback, wrapped in void().
  */
 template<typename... Ts>
-class CallbackManager<void(Ts...)> {
+class CallbackManager<void(Ts...), 0> {
  public:
+  /// The type of the stored callbacks.
+  using callback_t = InlineFunction<void(Ts...)>;
+
   /// Add a callback to the internal callback list.
-  void add(std::function<void(Ts...)> &&callback);
+  void add(callback_t &&callback);
+
+  /// Call all callbacks in this manager.
+  void call(Ts... args);
+
+ protected:
+  std::vector<callback_t> callbacks_;
+};
+
+/** A CallbackManager with room for N callbacks inside the object, so it never allocates.
+ *
+ * Use this if the number of subscribers is known at compile time, adding more than N callbacks fails.
+ *
+ * @tparam Ts The arguments for the callback, wrapped in void().
+ * @tparam N The maximum number of callbacks.
+ */
+template<size_t N, typename... Ts>
+class CallbackManager<void(Ts...), N> {
+ public:
+  /// The type of the stored callbacks.
+  using callback_t = InlineFunction<void(Ts...)>;
+
+  /// Add a callback, returns false (and drops the callback) if all N slots are in use.
+  bool add(callback_t &&callback);
 
   /// Call all callbacks in this manager.
   void call(Ts... args);
 
  protected:
-  std::vector<std::function<void(Ts...)>> callbacks_;
+  callback_t callbacks_[N];
+  size_t size_{0};
 };
 
 extern CallbackManager<void(const char *)> shutdown_hooks;
@@ -276,55 +516,197 @@ std::unique_ptr<T> make_unique(Args &&...args) {
   return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
 }
 
-template<typename T>
-SlidingWindowMovingAverage<T>::SlidingWindowMovingAverage(size_t max_size) : max_size_(max_size), sum_(0) {
+template<typename T, typename S>
+SlidingWindowMovingAverage<T, S>::SlidingWindowMovingAverage(size_t max_size)
+    : buffer_(new T[max_size]), max_size_(max_size), sum_(0) {
 
 }
 
-template<typename T>
-T SlidingWindowMovingAverage<T>::next_value(T value) {
-  if (this->queue_.size() == this->max_size_) {
-    this->sum_ -= this->queue_.front();
-    this->queue_.pop();
+template<typename T, typename S>
+T SlidingWindowMovingAverage<T, S>::next_value(T value) {
+  if (this->size_ < this->max_size_) {
+    this->buffer_[this->size_++] = value;
+    this->sum_ += value;
+  } else {
+    // replace the oldest value, head_ then points to the next oldest one.
+    this->sum_ += value - this->buffer_[this->head_];
+    this->buffer_[this->head_] = value;
+    if (++this->head_ == this->max_size_) {
+      this->head_ = 0;
+      // once per wrap around, so O(1) amortized and the error never grows beyond one window.
+      this->recalculate_sum_();
+    }
   }
-  this->queue_.push(value);
-  this->sum_ += value;
 
   return this->calculate_average();
 }
-template<typename T>
-T SlidingWindowMovingAverage<T>::calculate_average() {
-  if (this->queue_.size() == 0)
+template<typename T, typename S>
+T SlidingWindowMovingAverage<T, S>::calculate_average() {
+  if (this->size_ == 0)
     return 0;
   else
-    return this->sum_ / this->queue_.size();
+    return T(this->sum_ / S(this->size_));
 }
 
-template<typename T>
-size_t SlidingWindowMovingAverage<T>::get_max_size() const {
+template<typename T, typename S>
+size_t SlidingWindowMovingAverage<T, S>::get_max_size() const {
   return this->max_size_;
 }
 
-template<typename T>
-void SlidingWindowMovingAverage<T>::set_max_size(size_t max_size) {
+template<typename T, typename S>
+void SlidingWindowMovingAverage<T, S>::set_max_size(size_t max_size) {
+  if (max_size == this->max_size_)
+    return;
+  std::unique_ptr<T[]> buffer(new T[max_size]);
+  const size_t size = std::min(this->size_, max_size);
+  // copy the newest size values, oldest first.
+  for (size_t i = 0; i < size; i++)
+    buffer[i] = this->buffer_[(this->head_ + this->size_ - size + i) % this->size_];
+
+  this->buffer_ = std::move(buffer);
   this->max_size_ = max_size;
+  this->size_ = size;
+  this->head_ = 0;
+  this->recalculate_sum_();
+}
+
+template<typename T, typename S>
+void SlidingWindowMovingAverage<T, S>::recalculate_sum_() {
+  S sum = 0;
+  for (size_t i = 0; i < this->size_; i++)
+    sum += this->buffer_[i];
+  this->sum_ = sum;
+}
 
-  while (this->queue_.size() > max_size) {
-    this->sum_ -= this->queue_.front();
-    this->queue_.pop();
+template<size_t Size, typename R, typename... Args>
+template<typename F, typename>
+InlineFunction<R(Args...), Size>::InlineFunction(F &&f) {
+  using Fn = typename std::decay<F>::type;
+  static_assert(sizeof(Fn) <= Size, "Callable does not fit into InlineFunction, capture pointers instead of objects.");
+  static_assert(alignof(Fn) <= alignof(std::max_align_t), "Callable is over-aligned for InlineFunction.");
+  if (is_empty_(f))
+    return;
+  new (&this->storage_) Fn(std::forward<F>(f));
+  this->call_ = &call_impl_<Fn>;
+  this->manage_ = &manage_impl_<Fn>;
+}
+template<size_t Size, typename R, typename... Args>
+InlineFunction<R(Args...), Size>::InlineFunction(const InlineFunction &other)
+    : call_(other.call_), manage_(other.manage_) {
+  if (this->manage_ != nullptr)
+    this->manage_(COPY, &this->storage_, &other.storage_);
+}
+template<size_t Size, typename R, typename... Args>
+InlineFunction<R(Args...), Size>::InlineFunction(InlineFunction &&other) noexcept
+    : call_(other.call_), manage_(other.manage_) {
+  if (this->manage_ != nullptr)
+    this->manage_(MOVE, &this->storage_, &other.storage_);
+  other.call_ = nullptr;
+  other.manage_ = nullptr;
+}
+template<size_t Size, typename R, typename... Args>
+InlineFunction<R(Args...), Size> &InlineFunction<R(Args...), Size>::operator=(const InlineFunction &other) {
+  if (this != &other) {
+    this->reset_();
+    this->call_ = other.call_;
+    this->manage_ = other.manage_;
+    if (this->manage_ != nullptr)
+      this->manage_(COPY, &this->storage_, &other.storage_);
   }
+  return *this;
+}
+template<size_t Size, typename R, typename... Args>
+InlineFunction<R(Args...), Size> &InlineFunction<R(Args...), Size>::operator=(InlineFunction &&other) noexcept {
+  if (this != &other) {
+    this->reset_();
+    this->call_ = other.call_;
+    this->manage_ = other.manage_;
+    if (this->manage_ != nullptr)
+      this->manage_(MOVE, &this->storage_, &other.storage_);
+    other.call_ = nullptr;
+    other.manage_ = nullptr;
+  }
+  return *this;
+}
+template<size_t Size, typename R, typename... Args>
+InlineFunction<R(Args...), Size>::~InlineFunction() {
+  this->reset_();
+}
+template<size_t Size, typename R, typename... Args>
+R InlineFunction<R(Args...), Size>::operator()(Args... args) const {
+  return this->call_(&this->storage_, std::forward<Args>(args)...);
+}
+template<size_t Size, typename R, typename... Args>
+InlineFunction<R(Args...), Size>::operator bool() const {
+  return this->call_ != nullptr;
+}
+template<size_t Size, typename R, typename... Args>
+template<typename F>
+R InlineFunction<R(Args...), Size>::call_impl_(void *storage, Args... args) {
+  return (*reinterpret_cast<F *>(storage))(std::forward<Args>(args)...);
+}
+template<size_t Size, typename R, typename... Args>
+template<typename F>
+void InlineFunction<R(Args...), Size>::manage_impl_(Operation operation, void *dst, void *src) {
+  switch (operation) {
+    case COPY:
+      new (dst) F(*reinterpret_cast<const F *>(src));
+      break;
+    case MOVE:
+      new (dst) F(std::move(*reinterpret_cast<F *>(src)));
+      reinterpret_cast<F *>(src)->~F();
+      break;
+    case DESTROY:
+      reinterpret_cast<F *>(dst)->~F();
+      break;
+  }
+}
+template<size_t Size, typename R, typename... Args>
+template<typename F>
+bool InlineFunction<R(Args...), Size>::is_empty_(const F &) {
+  return false;
+}
+template<size_t Size, typename R, typename... Args>
+template<typename FR, typename... FArgs>
+bool InlineFunction<R(Args...), Size>::is_empty_(FR (*f)(FArgs...)) {
+  return f == nullptr;
+}
+template<size_t Size, typename R, typename... Args>
+template<typename Signature>
+bool InlineFunction<R(Args...), Size>::is_empty_(const std::function<Signature> &f) {
+  return !f;
+}
+template<size_t Size, typename R, typename... Args>
+void InlineFunction<R(Args...), Size>::reset_() {
+  if (this->manage_ != nullptr)
+    this->manage_(DESTROY, &this->storage_, nullptr);
+  this->call_ = nullptr;
+  this->manage_ = nullptr;
 }
 
 template<typename... Ts>
-void CallbackManager<void(Ts...)>::add(std::function<void(Ts...)> &&callback) {
+void CallbackManager<void(Ts...), 0>::add(callback_t &&callback) {
   this->callbacks_.push_back(std::move(callback));
 }
 template<typename... Ts>
-void CallbackManager<void(Ts...)>::call(Ts... args) {
+void CallbackManager<void(Ts...), 0>::call(Ts... args) {
   for (auto &cb : this->callbacks_)
     cb(args...);
 }
 
+template<size_t N, typename... Ts>
+bool CallbackManager<void(Ts...), N>::add(callback_t &&callback) {
+  if (this->size_ >= N)
+    return false;
+  this->callbacks_[this->size_++] = std::move(callback);
+  return true;
+}
+template<size_t N, typename... Ts>
+void CallbackManager<void(Ts...), N>::call(Ts... args) {
+  for (size_t i = 0; i < this->size_; i++)
+    this->callbacks_[i](args...);
+}
+
 ESPHOMELIB_NAMESPACE_END
 
 #endif //ESPHOMELIB_HELPERS_H
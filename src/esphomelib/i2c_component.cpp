@@ -63,6 +63,9 @@ void I2CComponent::loop() {
     }
   }
 }
+bool I2CComponent::needs_continuous_loop() const {
+  return this->scan_;
+}
 float I2CComponent::get_setup_priority() const {
   return setup_priority::HARDWARE + 10.0f;
 }
@@ -31,8 +31,11 @@ ESPHOMELIB_NAMESPACE_BEGIN
  * On the ESP32, you can even have multiple I2C bus for communication, simply create multiple
  * I2CComponents, each with different SDA and SCL pins and use `set_parent` on all I2CDevices that use
  * the non-first I2C bus.
+ *
+ * The polling I2CDevices register with their bus in setup(), so that their updates are staggered
+ * on it (see SharedBus).
  */
-class I2CComponent : public Component {
+class I2CComponent : public Component, public SharedBus {
  public:
   I2CComponent(uint8_t sda_pin, uint8_t scl_pin, bool scan = false);
 
@@ -135,6 +138,7 @@ class I2CComponent : public Component {
   void setup() override;
   /// Do an address range scan if necessary.
   void loop() override;
+  bool needs_continuous_loop() const override;
   /// Set a very high setup priority to make sure it's loaded before all other hardware.
   float get_setup_priority() const override;
 
@@ -7,6 +7,7 @@
 //
 
 #include "esphomelib/light/fast_led_light_output.h"
+#include "esphomelib/application.h"
 #include "esphomelib/log.h"
 
 #ifdef USE_FAST_LED_LIGHT
@@ -28,6 +29,14 @@ void FastLEDLightOutputComponent::write_state(LightState *state) {
   state->current_values_as_rgb(&red, &green, &blue);
   CRGB crgb = CRGB(red * 255, green * 255, blue * 255);
 
+  if (!App.is_in_execution_group(this->get_execution_group())) {
+    // The LED buffer belongs to the loop showing it, hand the color over instead of writing it from here.
+    App.post(this->get_execution_group(), [this, crgb]() { this->fill_leds_(crgb); });
+    return;
+  }
+  this->fill_leds_(crgb);
+}
+void FastLEDLightOutputComponent::fill_leds_(CRGB crgb) {
   for (int i = 0; i < this->num_leds_; i++)
     this->leds_[i] = crgb;
 
@@ -57,6 +66,9 @@ void FastLEDLightOutputComponent::loop() {
 
   this->controller_->showLeds();
 }
+bool FastLEDLightOutputComponent::needs_continuous_loop() const {
+  return this->next_show_;
+}
 void FastLEDLightOutputComponent::schedule_show() {
   this->next_show_ = true;
 }
@@ -38,6 +38,10 @@ namespace light {
  * These add_leds helpers can, however, only be called once on a FastLEDLightOutput. Also,
  * with this component you cannot pass in the CRGB array and offset values as you would be
  * able to do with FastLED as the component manage the lights itself.
+ *
+ * Writing long strips takes a few milliseconds. On the ESP32 this can be moved to the other core with
+ * `set_execution_group(EXECUTION_GROUP_SECONDARY)`, custom effects then need to access the LEDs from
+ * that loop too (see Application::post()).
  */
 class FastLEDLightOutputComponent : public LightOutput, public Component {
  public:
@@ -336,9 +340,13 @@ class FastLEDLightOutputComponent : public LightOutput, public Component {
   void write_state(LightState *state) override;
   void setup() override;
   void loop() override;
+  bool needs_continuous_loop() const override;
   float get_setup_priority() const override;
 
  protected:
+  /// Set all LEDs to crgb and show them in the next loop().
+  void fill_leds_(CRGB crgb);
+
   CLEDController *controller_{nullptr};
   CRGB *leds_{nullptr};
   int num_leds_{0};
@@ -41,6 +41,9 @@ void LightEffect::initialize(LightState *state) {
 void LightEffect::stop(LightState *state) {
 
 }
+bool LightEffect::is_continuous() const {
+  return true;
+}
 
 std::string NoneLightEffect::get_name() const {
   return "None";
@@ -50,6 +53,10 @@ void NoneLightEffect::apply_effect(LightState *state) {
 
 }
 
+bool NoneLightEffect::is_continuous() const {
+  return false;
+}
+
 std::unique_ptr<LightEffect> NoneLightEffect::create() {
   return make_unique<NoneLightEffect>();
 }
@@ -46,6 +46,9 @@ class LightEffect {
 
   /// Apply this effect. Use the provided state for starting transitions, ...
   virtual void apply_effect(LightState *state) = 0;
+
+  /// Whether apply_effect() needs to be called continuously. Defaults to true.
+  virtual bool is_continuous() const;
 };
 
 /// Default effect for all lights. Does nothing.
@@ -55,6 +58,8 @@ class NoneLightEffect : public LightEffect {
 
   void apply_effect(LightState *state) override;
 
+  bool is_continuous() const override;
+
   static std::unique_ptr<LightEffect> create();
 };
 
@@ -221,6 +221,9 @@ void LightState::loop() {
     this->next_write_ = false;
   }
 }
+bool LightState::needs_continuous_loop() const {
+  return this->next_write_ || this->transformer_ != nullptr || this->effect_->is_continuous();
+}
 LightTraits LightState::get_traits() {
   return this->output_->get_traits();
 }
@@ -22,7 +22,7 @@ ESPHOMELIB_NAMESPACE_BEGIN
 
 namespace light {
 
-using light_send_callback_t = std::function<void()>;
+using light_send_callback_t = InlineFunction<void()>;
 
 class LightEffect;
 class LightOutput;
@@ -85,6 +85,7 @@ class LightState : public Nameable, public Component {
   /// Load state from preferences
   void setup() override;
   void loop() override;
+  bool needs_continuous_loop() const override;
   /// Shortly after HARDWARE.
   float get_setup_priority() const override;
 
@@ -26,7 +26,7 @@ void MQTTJSONLightComponent::setup() {
   });
 
   this->state_->add_new_remote_values_callback([this]() {
-    this->defer("send", [this]() {
+    this->defer(fnv1a_hash("send"), [this]() {
       this->send_light_values();
     });
   });
@@ -58,7 +58,7 @@ class LogComponent : public Component {
   int log_vprintf_(int level, const char *tag, const char *format, va_list args);
 
   /// Register a callback that will be called for every log message sent
-  void add_on_log_callback(std::function<void(int, const char *)> &&callback);
+  void add_on_log_callback(InlineFunction<void(int, const char *)> &&callback);
 
  protected:
   uint32_t baud_rate_;
@@ -3,7 +3,10 @@
 //
 
 #include "esphomelib/mqtt/mqtt_client_component.h"
+#include "esphomelib/mqtt/mqtt_offline_buffer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <utility>
 
 #include "esphomelib/log.h"
@@ -16,6 +19,11 @@ ESPHOMELIB_NAMESPACE_BEGIN
 
 namespace mqtt {
 
+/// The topic_len of the header marking the unused end of the receive buffer.
+static const uint32_t RECEIVE_WRAP = 0xFFFFFFFF;
+/// How long the network task waits (in ms) for room in the receive buffer before dropping a message.
+static const uint32_t RECEIVE_WAIT_TIME = 100;
+
 MQTTClientComponent::MQTTClientComponent(const MQTTCredentials &credentials)
     : credentials_(credentials) {
   global_mqtt_client = this;
@@ -28,16 +36,22 @@ void MQTTClientComponent::setup() {
   ESP_LOGCONFIG(TAG, "    Server Address: %s:%u", this->credentials_.address.c_str(), this->credentials_.port);
   ESP_LOGCONFIG(TAG, "    Username: '%s'", this->credentials_.username.c_str());
   ESP_LOGCONFIG(TAG, "    Password: '%s'", this->credentials_.password.c_str());
+  // AsyncMqttClient only keeps a pointer to the client id, so it has to outlive the connection attempt.
+  if (this->credentials_.client_id.empty())
+    this->credentials_.client_id = generate_hostname(App.get_name());
   this->credentials_.client_id = truncate_string(this->credentials_.client_id, 23);
   ESP_LOGCONFIG(TAG, "    Client ID: '%s'", this->credentials_.client_id.c_str());
   if (!this->discovery_info_.prefix.empty()) {
     ESP_LOGCONFIG(TAG, "    Discovery prefix: '%s'", this->discovery_info_.prefix.c_str());
     ESP_LOGCONFIG(TAG, "    Discovery retain: %s", this->discovery_info_.retain ? "true" : "false");
   }
+  ESP_LOGCONFIG(TAG, "    Receive buffer: %u bytes", unsigned(this->receive_buffer_size_));
+  this->receive_buffer_.reset(new char[this->receive_buffer_size_]);
   this->mqtt_client_.onMessage([this](char* topic, char* payload, AsyncMqttClientMessageProperties properties, size_t len, size_t index, size_t total){
-    std::string payload_s(payload, len);
-    std::string topic_s(topic);
-    this->on_message(topic_s, payload_s);
+    this->on_message(topic, payload, len, index, total);
+  });
+  this->mqtt_client_.onConnect([](bool session_present) {
+    App.wake_loop();
   });
   this->mqtt_client_.onDisconnect([this](AsyncMqttClientDisconnectReason reason) {
     const char *reason_s = nullptr;
@@ -71,38 +85,134 @@ void MQTTClientComponent::setup() {
         break;
     }
     ESP_LOGW(TAG, "MQTT Disconnected: %s.", reason_s);
+    this->disconnect_event_ = true;
+    // reconnect from the next loop() instead of waiting for an idle loop to time out.
+    App.wake_loop();
   });
   if (this->is_log_message_enabled())
     global_log_component->add_on_log_callback([this](int level, const char *message) {
       if (this->is_connected()) {
-        this->publish(this->log_message_.topic, message, this->log_message_.qos, this->log_message_.retain);
+        this->publish(this->log_message_.topic, message, this->log_message_.qos, this->log_message_.retain,
+                      MQTT_PRIORITY_LOG);
       }
     });
   add_shutdown_hook([this](const char *cause){
     this->mqtt_client_.disconnect(true);
   });
 
-  this->reconnect();
+  this->mqtt_client_.setClientId(this->credentials_.client_id.c_str());
+  const char *username = nullptr;
+  if (!this->credentials_.username.empty())
+    username = this->credentials_.username.c_str();
+  const char *password = nullptr;
+  if (!this->credentials_.password.empty())
+    password = this->credentials_.password.c_str();
+  this->mqtt_client_.setCredentials(username, password);
+  this->mqtt_client_.setServer(this->credentials_.address.c_str(), this->credentials_.port);
+  if (!this->last_will_.topic.empty()) {
+    this->mqtt_client_.setWill(this->last_will_.topic.c_str(), this->last_will_.qos, this->last_will_.retain,
+                               this->last_will_.payload.c_str(), this->last_will_.payload.length());
+  }
+
+  this->disconnected_since_ = millis();
+  this->start_connect_();
 }
 void MQTTClientComponent::set_keep_alive(uint16_t keep_alive_s) {
   this->mqtt_client_.setKeepAlive(keep_alive_s);
 }
+void MQTTClientComponent::set_reconnect_delay(uint32_t min_delay, uint32_t max_delay) {
+  this->min_reconnect_delay_ = min_delay;
+  this->max_reconnect_delay_ = std::max(min_delay, max_delay);
+}
+void MQTTClientComponent::set_connect_timeout(uint32_t connect_timeout) {
+  this->connect_timeout_ = connect_timeout;
+}
+void MQTTClientComponent::set_reboot_timeout(uint32_t reboot_timeout) {
+  this->reboot_timeout_ = reboot_timeout;
+}
+void MQTTClientComponent::set_publish_budget(size_t publish_budget) {
+  this->publish_budget_ = publish_budget;
+}
+void MQTTClientComponent::set_max_queue_size(size_t max_queue_size) {
+  this->max_queue_size_ = max_queue_size;
+}
+uint32_t MQTTClientComponent::get_messages_coalesced() const {
+  return this->messages_coalesced_;
+}
+uint32_t MQTTClientComponent::get_messages_dropped() const {
+  return this->messages_dropped_;
+}
+void MQTTClientComponent::set_receive_buffer_size(size_t receive_buffer_size) {
+  // whole message headers, so that they're always aligned.
+  this->receive_buffer_size_ = receive_buffer_size - receive_buffer_size % sizeof(MQTTReceivedMessage);
+}
+uint32_t MQTTClientComponent::get_messages_rejected() const {
+  return this->messages_rejected_;
+}
 
 void MQTTClientComponent::loop() {
-  this->reconnect();
+  const uint32_t now = millis();
+  const uint32_t rejected = this->messages_rejected_;
+  if (rejected != this->messages_rejected_logged_) {
+    ESP_LOGW(TAG, "Dropped %u received messages, they didn't fit into the receive buffer.",
+             unsigned(rejected - this->messages_rejected_logged_));
+    this->messages_rejected_logged_ = rejected;
+  }
+  switch (this->state_) {
+    case MQTT_CLIENT_DISCONNECTED:
+      if (this->reboot_timeout_ != 0 && now - this->disconnected_since_ > this->reboot_timeout_) {
+        ESP_LOGE(TAG, "Can't connect to MQTT... Restarting...");
+        reboot("mqtt");
+      }
+      if (now - this->state_start_ >= this->reconnect_delay_)
+        this->start_connect_();
+      break;
+    case MQTT_CLIENT_CONNECTING:
+      if (this->mqtt_client_.connected()) {
+        this->on_connected_();
+      } else if (this->disconnect_event_ || now - this->state_start_ >= this->connect_timeout_) {
+        ESP_LOGW(TAG, "MQTT connection failed");
+        this->on_disconnected_();
+      }
+      break;
+    case MQTT_CLIENT_CONNECTED:
+      if (!this->mqtt_client_.connected()) {
+        this->disconnected_since_ = now;
+        this->on_disconnected_();
+      } else if (!this->queue_.empty()) {
+        // the TCP send buffer was full during the last flush, try again.
+        this->schedule_flush_();
+      }
+      break;
+  }
+}
+bool MQTTClientComponent::needs_continuous_loop() const {
+  return false;
 }
 
+void MQTTClientComponent::add_subscription_(MQTTSubscription &&subscription) {
+  if (!this->subscription_index_.insert(subscription.topic, this->subscriptions_.size())) {
+    ESP_LOGE(TAG, "Invalid topic filter '%s'!", subscription.topic.c_str());
+    return;
+  }
+  if (this->is_connected())
+    this->mqtt_client_.subscribe(subscription.topic.c_str(), subscription.qos);
+  this->subscriptions_.push_back(std::move(subscription));
+}
 void MQTTClientComponent::subscribe(const std::string &topic, mqtt_callback_t callback, uint8_t qos) {
+  this->subscribe_with_topic(topic, [callback](const StringRef &topic, const StringRef &payload) {
+    callback(payload);
+  }, qos);
+}
+
+void MQTTClientComponent::subscribe_with_topic(const std::string &topic, mqtt_topic_callback_t callback, uint8_t qos) {
   ESP_LOGD(TAG, "Subscribing to topic='%s' qos=%u...", topic.c_str(), qos);
   MQTTSubscription subscription{
       .topic = topic,
       .qos = qos,
       .callback = std::move(callback),
   };
-  this->subscriptions_.push_back(subscription);
-
-  if (this->is_connected())
-    this->mqtt_client_.subscribe(topic.c_str(), qos);
+  this->add_subscription_(std::move(subscription));
 }
 
 void MQTTClientComponent::subscribe_json(const std::string &topic, json_parse_t callback, uint8_t qos) {
@@ -110,98 +220,214 @@ void MQTTClientComponent::subscribe_json(const std::string &topic, json_parse_t
   MQTTSubscription subscription{
       .topic = topic,
       .qos = qos,
-      .callback = [this, callback](const std::string &payload) {
-        parse_json(payload, callback);
-      },
+      .callback = nullptr,
+      .json_callback = std::move(callback),
   };
-  this->subscriptions_.push_back(subscription);
-
-  if (this->is_connected())
-    this->mqtt_client_.subscribe(topic.c_str(), qos);
+  this->add_subscription_(std::move(subscription));
 }
 
 bool MQTTClientComponent::is_connected() {
-  return this->mqtt_client_.connected();
+  return this->state_ == MQTT_CLIENT_CONNECTED && this->mqtt_client_.connected();
 }
 
-void MQTTClientComponent::reconnect() {
-  if (this->is_connected())
-    return;
-
-  ESP_LOGI(TAG, "Reconnecting to MQTT...");
-  uint32_t start = millis();
-  do {
-    // Force disconnect first
-    this->mqtt_client_.disconnect(true);
-    global_wifi_component->loop();
-
-    ESP_LOGD(TAG, "    Attempting MQTT connection...");
-    if (millis() - start > 30000) {
-      ESP_LOGE(TAG, "    Can't connect to MQTT... Restarting...");
-      reboot("mqtt");
-    }
-
-    std::string id;
-    if (this->credentials_.client_id.empty())
-      id = generate_hostname(App.get_name());
-    else
-      id = this->credentials_.client_id;
-    this->mqtt_client_.setClientId(id.c_str());
-
-    const char *username = nullptr;
-    if (!this->credentials_.username.empty())
-      username = this->credentials_.username.c_str();
-    const char *password = nullptr;
-    if (!this->credentials_.password.empty())
-      password = this->credentials_.password.c_str();
-    this->mqtt_client_.setCredentials(username, password);
-
-    this->mqtt_client_.setCredentials(this->credentials_.username.c_str(), this->credentials_.password.c_str());
-    this->mqtt_client_.setServer(this->credentials_.address.c_str(), this->credentials_.port);
-    if (!this->last_will_.topic.empty()) {
-      this->mqtt_client_.setWill(this->last_will_.topic.c_str(), this->last_will_.qos, this->last_will_.retain,
-                                 this->last_will_.payload.c_str(), this->last_will_.payload.length());
-    }
-
-    this->mqtt_client_.connect();
-    uint32_t start_time = millis();
-    do {
-      ESP_LOGD(TAG, ".");
-      delay(250);
-    } while (!this->mqtt_client_.connected() && millis() - start_time < 10000);
+MQTTClientState MQTTClientComponent::get_state() const {
+  return this->state_;
+}
 
-    if (this->mqtt_client_.connected()) {
-      ESP_LOGI(TAG, "    MQTT Connected!");
-      break;
-    } else {
-      ESP_LOGW(TAG, "    MQTT connection failed");
-    }
-  } while (!this->is_connected());
+void MQTTClientComponent::start_connect_() {
+  ESP_LOGI(TAG, "Connecting to MQTT...");
+  this->state_ = MQTT_CLIENT_CONNECTING;
+  this->state_start_ = millis();
+  // Force disconnect first
+  this->mqtt_client_.disconnect(true);
+  this->disconnect_event_ = false;
+  this->mqtt_client_.connect();
+}
+void MQTTClientComponent::on_connected_() {
+  ESP_LOGI(TAG, "MQTT Connected!");
+  this->state_ = MQTT_CLIENT_CONNECTED;
+  this->state_start_ = millis();
+  this->backoff_ = 0;
 
+  // the birth message has to be sent before the queued states.
   if (!this->birth_message_.topic.empty())
-    this->publish(this->birth_message_);
+    this->mqtt_client_.publish(this->birth_message_.topic.c_str(), this->birth_message_.qos,
+                               this->birth_message_.retain, this->birth_message_.payload.data(),
+                               this->birth_message_.payload.length());
 
   for (MQTTSubscription &subscription : this->subscriptions_)
     this->mqtt_client_.subscribe(subscription.topic.c_str(), subscription.qos);
 
   this->on_connect_.call();
+  this->schedule_flush_();
+}
+void MQTTClientComponent::on_disconnected_() {
+  this->mqtt_client_.disconnect(true);
+  this->state_ = MQTT_CLIENT_DISCONNECTED;
+  this->state_start_ = millis();
+  if (this->backoff_ == 0)
+    this->backoff_ = this->min_reconnect_delay_;
+  else
+    this->backoff_ = std::min(this->backoff_ * 2, this->max_reconnect_delay_);
+  // wait between half and all of the backoff, so that devices that lost the connection at the same time
+  // don't all reconnect at the same time.
+  this->reconnect_delay_ = this->backoff_ / 2 + uint32_t(random_float() * (this->backoff_ / 2));
+  ESP_LOGD(TAG, "Reconnecting in %ums", this->reconnect_delay_);
 }
 
-void MQTTClientComponent::publish(const std::string &topic, const std::string &payload, uint8_t qos, bool retain) {
+bool MQTTClientComponent::publish(const std::string &topic, const std::string &payload, uint8_t qos, bool retain,
+                                  MQTTPublishPriority priority) {
+  const bool buffered = this->offline_buffer_ != nullptr && priority == MQTT_PRIORITY_STATE;
+  if (!buffered && !this->is_connected())
+    return false;
+
   bool logging_topic = topic == this->log_message_.topic;
   if (!logging_topic) {
     ESP_LOGV(TAG, "Publish(topic='%s' payload='%s' retain=%d)", topic.c_str(), payload.c_str(), retain);
   }
 
-  this->reconnect();
-  uint16_t ret = this->mqtt_client_.publish(topic.c_str(), qos, retain, payload.data(), payload.length());
-  if (ret == 0 && !logging_topic)
-    ESP_LOGW(TAG, "Publish failed!");
-  yield();
+#ifndef ARDUINO_ARCH_ESP8266
+  if (!App.is_in_execution_group(this->get_execution_group()))
+    // Called from another task (for example logs), hand the message over to the loop of this component.
+    return this->post_message_(topic, payload, qos, retain, priority);
+#endif
+
+  MQTTMessage message{
+      .topic = topic,
+      .payload = payload,
+      .qos = qos,
+      .retain = retain,
+  };
+  return this->enqueue_(std::move(message), priority);
+}
+
+bool MQTTClientComponent::post_message_(const std::string &topic, const std::string &payload, uint8_t qos,
+                                        bool retain, MQTTPublishPriority priority) {
+#ifdef ARDUINO_ARCH_ESP8266
+  return false;
+#else
+  // claim a free slot, several tasks can publish at the same time.
+  uint32_t used = this->posted_used_.load(std::memory_order_relaxed);
+  uint8_t slot;
+  do {
+    const uint32_t free = ~used & ((1UL << POSTED_MESSAGES) - 1);
+    if (free == 0)
+      return false;
+    slot = __builtin_ctz(free);
+  } while (!this->posted_used_.compare_exchange_weak(used, used | (1UL << slot), std::memory_order_acquire,
+                                                     std::memory_order_relaxed));
+
+  MQTTQueuedMessage &posted = this->posted_messages_[slot];
+  posted.message.topic = topic;
+  posted.message.payload = payload;
+  posted.message.qos = qos;
+  posted.message.retain = retain;
+  posted.priority = priority;
+  const bool success = App.post(this->get_execution_group(), [this, slot] {
+    MQTTQueuedMessage &posted = this->posted_messages_[slot];
+    this->enqueue_(std::move(posted.message), posted.priority);
+    this->posted_used_.fetch_and(~(1UL << slot), std::memory_order_release);
+  });
+  if (!success)
+    this->posted_used_.fetch_and(~(1UL << slot), std::memory_order_release);
+  return success;
+#endif
+}
+
+bool MQTTClientComponent::publish(const MQTTMessage &message, MQTTPublishPriority priority) {
+  return this->publish(message.topic, message.payload, message.qos, message.retain, priority);
+}
+
+bool MQTTClientComponent::enqueue_(MQTTMessage &&message, MQTTPublishPriority priority) {
+  if (!this->is_connected()) {
+    // nothing is queued while disconnected, the offline buffer keeps the states and replays them.
+    if (this->offline_buffer_ == nullptr || priority != MQTT_PRIORITY_STATE)
+      return false;
+    this->offline_buffer_->add(message.topic, message.payload);
+    return true;
+  }
+
+  const size_t size = message.topic.size() + message.payload.size();
+  const uint32_t topic_hash = fnv1a_hash(message.topic);
+  if (message.retain) {
+    for (auto &queued : this->queue_) {
+      // the hash rules out nearly all other messages, the topic is only compared for the (rare) collisions.
+      if (queued.topic_hash == topic_hash && queued.message.retain && queued.priority == priority &&
+          queued.message.topic == message.topic) {
+        // latest value wins, keeping the place in the queue of the old one.
+        this->queue_size_ += message.payload.size();
+        this->queue_size_ -= queued.message.payload.size();
+        queued.message = std::move(message);
+        this->messages_coalesced_++;
+        return true;
+      }
+    }
+  }
+
+  // make room by dropping the oldest messages of the lowest class, but never for a message of a lower class.
+  while (this->queue_size_ + size > this->max_queue_size_ && !this->queue_.empty() &&
+      this->queue_.back().priority >= priority) {
+    const MQTTPublishPriority lowest = this->queue_.back().priority;
+    auto oldest = std::find_if(this->queue_.begin(), this->queue_.end(), [lowest](const MQTTQueuedMessage &queued) {
+      return queued.priority == lowest;
+    });
+    this->queue_size_ -= oldest->message.topic.size() + oldest->message.payload.size();
+    this->queue_.erase(oldest);
+    this->messages_dropped_++;
+  }
+  if (this->queue_size_ + size > this->max_queue_size_) {
+    this->messages_dropped_++;
+    return false;
+  }
+
+  auto it = std::upper_bound(this->queue_.begin(), this->queue_.end(), priority,
+                             [](MQTTPublishPriority priority, const MQTTQueuedMessage &queued) {
+                               return priority < queued.priority;
+                             });
+  this->queue_.insert(it, MQTTQueuedMessage{
+      .message = std::move(message),
+      .priority = priority,
+      .topic_hash = topic_hash,
+  });
+  this->queue_size_ += size;
+  this->schedule_flush_();
+  return true;
 }
 
-void MQTTClientComponent::publish(const MQTTMessage &message) {
-  this->publish(message.topic, message.payload, message.qos, message.retain);
+void MQTTClientComponent::schedule_flush_() {
+  if (this->flush_scheduled_)
+    return;
+  this->flush_scheduled_ = true;
+  this->defer([this] {
+    this->flush_scheduled_ = false;
+    if (this->is_connected())
+      this->flush_queue_();
+  });
+}
+
+void MQTTClientComponent::flush_queue_() {
+  size_t sent = 0, bytes = 0;
+  for (auto &queued : this->queue_) {
+    const MQTTMessage &message = queued.message;
+    const size_t size = message.topic.size() + message.payload.size();
+    if (sent != 0 && bytes + size > this->publish_budget_)
+      break;
+    if (this->mqtt_client_.publish(message.topic.c_str(), message.qos, message.retain, message.payload.data(),
+                                   message.payload.length()) == 0)
+      // the TCP send buffer is full (or the connection was lost), try again in the next iteration.
+      break;
+    sent++;
+    bytes += size;
+  }
+  if (sent == 0)
+    return;
+
+  this->queue_.erase(this->queue_.begin(), this->queue_.begin() + sent);
+  this->queue_size_ -= bytes;
+  if (!this->queue_.empty())
+    // the rest of the queue goes out in the next iterations, one publish budget each.
+    this->schedule_flush_();
+  yield();
 }
 
 void MQTTClientComponent::set_last_will(MQTTMessage &&message) {
@@ -279,27 +505,159 @@ void MQTTClientComponent::recalculate_availability() {
   this->availability_.payload_available = "online";
   this->availability_.payload_not_available = "offline";
 }
-void MQTTClientComponent::publish_json(const std::string &topic, const json_build_t &f, uint8_t qos, bool retain) {
+bool MQTTClientComponent::publish_json(const std::string &topic, const json_build_t &f, uint8_t qos, bool retain,
+                                       MQTTPublishPriority priority) {
   std::string message = build_json(f);
-  this->publish(topic, message, qos, retain);
+  return this->publish(topic, message, qos, retain, priority);
 }
 void MQTTClientComponent::set_log_message_template(MQTTMessage &&message) {
   this->log_message_ = std::move(message);
 }
-void MQTTClientComponent::add_on_connect_callback(std::function<void()> &&callback) {
+void MQTTClientComponent::set_offline_buffer(MQTTOfflineBuffer *offline_buffer) {
+  this->offline_buffer_ = offline_buffer;
+}
+void MQTTClientComponent::add_on_connect_callback(InlineFunction<void()> &&callback) {
   this->on_connect_.add(std::move(callback));
 }
 
 void MQTTClientComponent::on_message(const std::string &topic, const std::string &payload) {
-#ifdef ARDUINO_ARCH_ESP8266
-  this->defer([this, topic, payload]() {
+  this->on_message(topic.c_str(), payload.data(), payload.size(), 0, payload.size());
+}
+void MQTTClientComponent::on_message(const char *topic, const char *payload, size_t len, size_t index,
+                                     size_t total) {
+  // Called from the network context. Messages that don't fit into one TCP segment arrive in fragments, they're
+  // reassembled in the receive buffer, a ring buffer the main loop handles the messages from in order. That's
+  // the only copy of the message.
+  if (index == 0) {
+    this->receiving_ = nullptr;
+    if (!this->receive_buffer_) {
+      this->messages_rejected_++;
+      return;
+    }
+    const size_t topic_len = strlen(topic);
+    const size_t header_size = sizeof(MQTTReceivedMessage);
+    // header, topic and payload (both null-terminated), padded to align the next header
+    size_t size = header_size + topic_len + total + 2;
+    size += (header_size - size % header_size) % header_size;
+    if (size > this->receive_buffer_size_) {
+      this->messages_rejected_++;
+      return;
+    }
+    const uint32_t start = millis();
+    size_t head = this->receive_head_.load(std::memory_order_relaxed);
+    size_t offset = head % this->receive_buffer_size_;
+    if (this->receive_buffer_size_ - offset < size) {
+      // messages don't wrap around: mark the rest of the buffer unused first, the message goes to the start.
+      const size_t padding = this->receive_buffer_size_ - offset;
+      if (!this->wait_receive_space_(padding, start)) {
+        this->messages_rejected_++;
+        return;
+      }
+      reinterpret_cast<MQTTReceivedMessage *>(&this->receive_buffer_[offset])->topic_len = RECEIVE_WRAP;
+      head += padding;
+      offset = 0;
+      this->receive_head_.store(head, std::memory_order_release);
+    }
+    if (!this->wait_receive_space_(size, start)) {
+      this->messages_rejected_++;
+      return;
+    }
+
+    this->receiving_ = reinterpret_cast<MQTTReceivedMessage *>(&this->receive_buffer_[offset]);
+    this->receiving_->topic_len = topic_len;
+    this->receiving_->payload_len = total;
+    this->receiving_size_ = size;
+    memcpy(reinterpret_cast<char *>(this->receiving_ + 1), topic, topic_len + 1);
+  }
+
+  MQTTReceivedMessage *message = this->receiving_;
+  if (message == nullptr || index + len > message->payload_len)
+    // the rest of a dropped message
+    return;
+  char *data = reinterpret_cast<char *>(message + 1) + message->topic_len + 1;
+  memcpy(data + index, payload, len);
+  if (index + len < message->payload_len)
+    return;
+
+  data[message->payload_len] = '\0';
+  this->receiving_ = nullptr;
+  this->receive_head_.fetch_add(this->receiving_size_, std::memory_order_release);
+  this->post_drain_();
+}
+bool MQTTClientComponent::wait_receive_space_(size_t size, uint32_t start) {
+  bool fits = this->receive_space_() >= size;
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
+  // The network task can wait for the main loop to make room, which also holds back the broker (TCP flow
+  // control). On the ESP8266 this runs in the system context, which must not block.
+  while (!fits && !App.is_in_execution_group(EXECUTION_GROUP_MAIN) && millis() - start < RECEIVE_WAIT_TIME) {
+    this->post_drain_();
+    delay(1);
+    fits = this->receive_space_() >= size;
+  }
 #endif
-    for (auto &subscription : this->subscriptions_)
-      if (topic == subscription.topic)
-        subscription.callback(payload);
-#ifdef ARDUINO_ARCH_ESP8266
+  return fits;
+}
+size_t MQTTClientComponent::receive_space_() const {
+  return this->receive_buffer_size_ - (this->receive_head_.load(std::memory_order_relaxed) -
+      this->receive_tail_.load(std::memory_order_acquire));
+}
+void MQTTClientComponent::post_drain_() {
+  // one event handles all messages received until then.
+  if (this->drain_posted_.exchange(true))
+    return;
+  bool posted = App.post([this] {
+    this->drain_posted_ = false;
+    this->drain_receive_buffer_();
+  });
+  if (!posted)
+    // the messages are handled with the next one.
+    this->drain_posted_ = false;
+}
+void MQTTClientComponent::drain_receive_buffer_() {
+  const size_t head = this->receive_head_.load(std::memory_order_acquire);
+  size_t tail = this->receive_tail_.load(std::memory_order_relaxed);
+  while (tail != head) {
+    const size_t offset = tail % this->receive_buffer_size_;
+    auto *message = reinterpret_cast<MQTTReceivedMessage *>(&this->receive_buffer_[offset]);
+    if (message->topic_len == RECEIVE_WRAP) {
+      tail += this->receive_buffer_size_ - offset;
+      continue;
+    }
+    char *topic = reinterpret_cast<char *>(message + 1);
+    this->handle_message_(StringRef(topic, message->topic_len), topic + message->topic_len + 1,
+                          message->payload_len);
+    size_t size = sizeof(MQTTReceivedMessage) + message->topic_len + message->payload_len + 2;
+    size += (sizeof(MQTTReceivedMessage) - size % sizeof(MQTTReceivedMessage)) % sizeof(MQTTReceivedMessage);
+    tail += size;
+    // free the space for the network context
+    this->receive_tail_.store(tail, std::memory_order_release);
+  }
+  this->receive_tail_.store(tail, std::memory_order_release); // after skipping to the start
+}
+void MQTTClientComponent::handle_message_(const StringRef &topic, char *payload, size_t len) {
+  struct {
+    const StringRef &topic;
+    const StringRef payload;
+    bool has_json;
+  } message{topic, StringRef(payload, len), false};
+  this->subscription_index_.match(topic.data(), topic.size(), [this, &message](size_t index) {
+    const MQTTSubscription &subscription = this->subscriptions_[index];
+    if (subscription.callback)
+      subscription.callback(message.topic, message.payload);
+    else
+      message.has_json = true;
+  });
+  if (!message.has_json)
+    return;
+
+  // Parsing in place modifies the payload, so the JSON subscriptions come last and share the parsed object.
+  parse_json(payload, [this, &topic](JsonObject &root) {
+    this->subscription_index_.match(topic.data(), topic.size(), [this, &root](size_t index) {
+      const MQTTSubscription &subscription = this->subscriptions_[index];
+      if (subscription.json_callback)
+        subscription.json_callback(root);
+    });
   });
-#endif
 }
 void MQTTClientComponent::disable_log_message() {
   this->log_message_.topic = "";
@@ -5,14 +5,17 @@
 #ifndef ESPHOMELIB_MQTT_MQTT_CLIENT_COMPONENT_H
 #define ESPHOMELIB_MQTT_MQTT_CLIENT_COMPONENT_H
 
+#include <atomic>
 #include <string>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <ArduinoJson.h>
 #include <AsyncMqttClient.h>
 #include <WiFiClient.h>
 
 #include "esphomelib/component.h"
+#include "esphomelib/mqtt/mqtt_topic_index.h"
 #include "esphomelib/helpers.h"
 #include "esphomelib/defines.h"
 
@@ -20,11 +23,20 @@ ESPHOMELIB_NAMESPACE_BEGIN
 
 namespace mqtt {
 
-/** Callback for MQTT subscriptions.
+class MQTTOfflineBuffer;
+
+/** Callback for MQTT subscriptions, the parameter is the payload.
+ *
+ * The payload references the receive buffer of the message (null-terminated), so it's only valid during the
+ * call. Callbacks taking a `const std::string &` work too, with a copy of the payload.
+ */
+using mqtt_callback_t = std::function<void(const StringRef &)>;
+
+/** Callback for MQTT subscriptions that need the topic, for example with wildcards.
  *
- * First parameter is the topic, the second one is the payload.
+ * First parameter is the topic, the second one is the payload. Both are only valid during the call.
  */
-using mqtt_callback_t = std::function<void(const std::string &)>;
+using mqtt_topic_callback_t = std::function<void(const StringRef &, const StringRef &)>;
 
 /// internal struct for MQTT messages.
 struct MQTTMessage {
@@ -34,11 +46,36 @@ struct MQTTMessage {
   bool retain;
 };
 
+/** The priority classes of the outgoing message queue, see MQTTClientComponent::publish().
+ *
+ * Queued messages are sent in the order of their class, and messages of the lowest class are dropped
+ * first if the queue is full.
+ */
+enum MQTTPublishPriority : uint8_t {
+  MQTT_PRIORITY_STATE = 0, ///< States and everything else.
+  MQTT_PRIORITY_DISCOVERY, ///< Home Assistant discovery messages.
+  MQTT_PRIORITY_LOG, ///< Log messages.
+};
+
+/// internal struct for messages in the outgoing queue.
+struct MQTTQueuedMessage {
+  MQTTMessage message;
+  MQTTPublishPriority priority;
+  uint32_t topic_hash; ///< fnv1a_hash() of the topic, for coalescing retained messages.
+};
+
 /// internal struct for MQTT subscriptions.
 struct MQTTSubscription {
   std::string topic;
   uint8_t qos;
-  mqtt_callback_t callback;
+  mqtt_topic_callback_t callback;
+  json_parse_t json_callback; ///< Set instead of callback for subscribe_json().
+};
+
+/// internal struct for the header of a received message in the receive buffer, followed by topic and payload.
+struct MQTTReceivedMessage {
+  uint32_t topic_len; ///< Or RECEIVE_WRAP if the rest of the buffer is unused and the next message is at the start.
+  uint32_t payload_len;
 };
 
 /// internal struct for MQTT credentials.
@@ -66,6 +103,13 @@ struct MQTTDiscoveryInfo {
   bool retain; ///< Whether to retain discovery messages.
 };
 
+/// The states of the connection to the MQTT broker, see MQTTClientComponent::loop().
+enum MQTTClientState {
+  MQTT_CLIENT_DISCONNECTED = 0, ///< Waiting for the backoff delay to pass before the next connection attempt.
+  MQTT_CLIENT_CONNECTING, ///< Waiting for the broker to accept the connection.
+  MQTT_CLIENT_CONNECTED,
+};
+
 class MQTTClientComponent : public Component {
  public:
   explicit MQTTClientComponent(const MQTTCredentials &credentials);
@@ -83,6 +127,52 @@ class MQTTClientComponent : public Component {
   /// Set the keep alive time in seconds, every 0.7*keep_alive a ping will be sent.
   void set_keep_alive(uint16_t keep_alive_s);
 
+  /** Set the delay between connection attempts.
+   *
+   * After each failed attempt the delay is doubled, from min_delay up to max_delay, and then randomized
+   * to between half and all of it so that devices don't all reconnect at once after the broker restarts.
+   * The delay is reset once a connection was established. Defaults to 1s and 60s.
+   *
+   * @param min_delay The delay in ms after the first failed attempt or a lost connection.
+   * @param max_delay The maximum delay in ms.
+   */
+  void set_reconnect_delay(uint32_t min_delay, uint32_t max_delay);
+
+  /// Set how long a connection attempt may take in ms before it's aborted, defaults to 10s.
+  void set_connect_timeout(uint32_t connect_timeout);
+
+  /** Set after how long without a connection to the broker in ms the node reboots, 0 to never reboot.
+   *
+   * Defaults to 15 minutes.
+   */
+  void set_reboot_timeout(uint32_t reboot_timeout);
+
+  /** Set how many bytes (topic and payload) of queued messages are sent per loop() iteration.
+   *
+   * At least one message is sent per iteration, even if it's larger. Defaults to 1460 (one TCP segment).
+   */
+  void set_publish_budget(size_t publish_budget);
+
+  /// Set how many bytes (topic and payload) of messages can be queued, defaults to 8192.
+  void set_max_queue_size(size_t max_queue_size);
+
+  /// The number of queued messages that were replaced by a newer message for the same topic.
+  uint32_t get_messages_coalesced() const;
+  /// The number of messages that were dropped because the queue was full.
+  uint32_t get_messages_dropped() const;
+
+  /** Set the size of the buffer received messages are passed to the main loop in, allocated once in setup().
+   *
+   * Received messages (and the fragments of messages that don't fit into one TCP segment) are copied into
+   * this ring buffer by the network context, one after another, and the subscription callbacks reference them
+   * there. If a message doesn't fit (topic and payload plus up to 17 bytes each) into the space not yet handled
+   * by the main loop, the network task waits up to 100ms for the main loop on the ESP32. On the ESP8266 (where
+   * it can't wait) or if that's not enough, the message is dropped. Defaults to 2048 bytes.
+   */
+  void set_receive_buffer_size(size_t receive_buffer_size);
+  /// The number of received messages that were dropped because they didn't fit into the receive buffer.
+  uint32_t get_messages_rejected() const;
+
   /** Set the Home Assistant discovery info
    *
    * See <a href="https://home-assistant.io/docs/mqtt/discovery/">MQTT Discovery</a>.
@@ -137,17 +227,25 @@ class MQTTClientComponent : public Component {
 
   /** Subscribe to an MQTT topic and call callback when a message is received.
    *
-   * @param topic The topic. Wildcards are currently not supported.
+   * @param topic The topic filter, can contain the `+` and `#` wildcards.
    * @param callback The callback function.
    * @param qos The QoS of this subscription.
    */
   void subscribe(const std::string &topic, mqtt_callback_t callback, uint8_t qos = 0);
 
+  /** Subscribe to an MQTT topic filter and call callback with the topic and payload of each matching message.
+   *
+   * @param topic The topic filter, can contain the `+` and `#` wildcards.
+   * @param callback The callback function.
+   * @param qos The QoS of this subscription.
+   */
+  void subscribe_with_topic(const std::string &topic, mqtt_topic_callback_t callback, uint8_t qos = 0);
+
   /** Subscribe to a MQTT topic and automatically parse JSON payload.
    *
    * If an invalid JSON payload is received, the callback will not be called.
    *
-   * @param topic The topic. Wildcards are currently not supported.
+   * @param topic The topic filter, can contain the `+` and `#` wildcards.
    * @param callback The callback with a parsed JsonObject that will be called when a message with matching topic is received.
    * @param qos The QoS of this subscription.
    */
@@ -156,47 +254,116 @@ class MQTTClientComponent : public Component {
   /** Publish a MQTTMessage
    *
    * @param message The message.
+   * @param priority The priority class of the message.
+   * @return Whether the message was queued.
    */
-  void publish(const MQTTMessage &message);
+  bool publish(const MQTTMessage &message, MQTTPublishPriority priority = MQTT_PRIORITY_STATE);
 
   /** Publish a MQTT message
+   *
+   * Messages are put into an outgoing queue that's sent at the end of the loop() iteration, in batches of
+   * at most the publish budget (see set_publish_budget()) and by priority class. Retained messages are
+   * coalesced: If a retained message for the same topic is still queued, it's replaced, as only the latest
+   * value would be kept by the broker anyway. Other messages (like log messages) are all sent.
+   *
+   * If the queue is full, the oldest messages of the lowest priority class are dropped. Messages that were
+   * queued when the connection was lost are sent after reconnecting. While the client isn't connected
+   * nothing is queued: state messages are handed to the offline buffer if there is one (see
+   * MQTTOfflineBuffer), which replays them after reconnecting, all other messages are dropped.
    *
    * @param topic The topic.
    * @param payload The payload.
    * @param retain Whether to retain the message.
+   * @param priority The priority class of the message.
+   * @return Whether the message was queued (or buffered by the offline buffer).
    */
-  void publish(const std::string &topic, const std::string &payload, uint8_t qos, bool retain);
+  bool publish(const std::string &topic, const std::string &payload, uint8_t qos, bool retain,
+               MQTTPublishPriority priority = MQTT_PRIORITY_STATE);
 
   /** Construct and send a JSON MQTT message.
    *
    * @param topic The topic.
    * @param f The Json Message builder.
    * @param retain Whether to retain the message.
+   * @param priority The priority class of the message.
+   * @return Whether the message was queued.
    */
-  void publish_json(const std::string &topic, const json_build_t &f, uint8_t qos, bool retain);
+  bool publish_json(const std::string &topic, const json_build_t &f, uint8_t qos, bool retain,
+                    MQTTPublishPriority priority = MQTT_PRIORITY_STATE);
 
   /// Return whether this client is currently connected to the MQTT server.
   bool is_connected();
 
+  MQTTClientState get_state() const;
+
+  /** Buffer the state messages published while disconnected in offline_buffer, see MQTTOfflineBuffer.
+   *
+   * Called by the MQTTOfflineBuffer constructor.
+   */
+  void set_offline_buffer(MQTTOfflineBuffer *offline_buffer);
+
   /// Add a callback that will be called every time the MQTT client reconnects.
-  void add_on_connect_callback(std::function<void()> &&callback);
+  void add_on_connect_callback(InlineFunction<void()> &&callback);
 
-  /// Setup the MQTT client, registering a bunch of callbacks and attempting to connect.
+  /// Setup the MQTT client, registering a bunch of callbacks and starting the first connection attempt.
   void setup() override;
-  /// Reconnect if required
+  /** Advance the connection state machine and send queued messages, never blocks.
+   *
+   * DISCONNECTED starts a new attempt once the reconnect delay has passed, CONNECTING waits for the broker
+   * to accept the connection (or the attempt to fail or time out) and CONNECTED checks if the connection
+   * was lost.
+   */
   void loop() override;
+  bool needs_continuous_loop() const override;
   /// MQTT client setup priority
   float get_setup_priority() const override;
 
   void on_message(const std::string &topic, const std::string &payload);
+  /** Handle a (fragment of a) received message, the callbacks of the matching subscriptions are called
+   * from the main loop.
+   *
+   * @param topic The null-terminated topic.
+   * @param payload The payload data of this fragment.
+   * @param len The length of this fragment.
+   * @param index The offset of this fragment in the payload.
+   * @param total The length of the whole payload.
+   */
+  void on_message(const char *topic, const char *payload, size_t len, size_t index, size_t total);
 
  protected:
-  /// Reconnect to the MQTT broker if not already connected.
-  void reconnect();
+  /// Start a connection attempt.
+  void start_connect_();
+  /// Called once the broker accepted the connection: send the birth message and subscribe.
+  void on_connected_();
+  /// Go to the disconnected state and wait for the (increased) reconnect delay.
+  void on_disconnected_();
+
+  /// Hand a message published from another execution group over to the loop of this component.
+  bool post_message_(const std::string &topic, const std::string &payload, uint8_t qos, bool retain,
+                     MQTTPublishPriority priority);
+  /// Put a message into the outgoing queue, see publish().
+  bool enqueue_(MQTTMessage &&message, MQTTPublishPriority priority);
+  /// Flush the queue at the start of the next loop iteration, once all messages of this one are queued.
+  void schedule_flush_();
+  /// Send queued messages, up to the publish budget.
+  void flush_queue_();
 
   /// Re-calculate the availability property.
   void recalculate_availability();
 
+  /// Add subscription to the subscription tree and subscribe if connected, invalid topic filters are rejected.
+  void add_subscription_(MQTTSubscription &&subscription);
+  /// The free bytes of the receive buffer.
+  size_t receive_space_() const;
+  /// Wait (where the network context can) until size bytes of the receive buffer are free, since start (in ms).
+  bool wait_receive_space_(size_t size, uint32_t start);
+  /// Let the main loop handle the received messages, unless that's already pending.
+  void post_drain_();
+  /// Handle all complete messages in the receive buffer, called in the main loop.
+  void drain_receive_buffer_();
+  /// Call the callbacks of all subscriptions matching topic, payload is null-terminated and can be modified.
+  void handle_message_(const StringRef &topic, char *payload, size_t len);
+
   MQTTCredentials credentials_;
   /// The last will message. Disabled optional denotes it being default and
   /// an empty topic denotes the the feature being disabled.
@@ -216,8 +383,52 @@ class MQTTClientComponent : public Component {
   MQTTMessage log_message_;
 
   std::vector<MQTTSubscription> subscriptions_;
+  /// Maps topics to the indices of the matching subscriptions_.
+  MQTTTopicIndex subscription_index_;
   AsyncMqttClient mqtt_client_;
   CallbackManager<void()> on_connect_{};
+
+  MQTTClientState state_{MQTT_CLIENT_DISCONNECTED};
+  uint32_t state_start_{0}; ///< The millis() time of the last state change.
+  uint32_t disconnected_since_{0}; ///< The millis() time the connection was lost, for the reboot timeout.
+  uint32_t reconnect_delay_{0}; ///< The (randomized) delay before the next attempt.
+  uint32_t backoff_{0}; ///< The current exponential backoff, 0 after a successful connection.
+  uint32_t min_reconnect_delay_{1000};
+  uint32_t max_reconnect_delay_{60000};
+  uint32_t connect_timeout_{10000};
+  uint32_t reboot_timeout_{900000};
+  /// Set by the onDisconnect callback from the network context, lets a failed attempt end early.
+  std::atomic<bool> disconnect_event_{false};
+
+  MQTTOfflineBuffer *offline_buffer_{nullptr};
+
+  std::vector<MQTTQueuedMessage> queue_; ///< The outgoing messages, sorted by priority class.
+  size_t queue_size_{0}; ///< The bytes (topic and payload) of all queued messages.
+  size_t publish_budget_{1460};
+  size_t max_queue_size_{8192};
+  uint32_t messages_coalesced_{0};
+  uint32_t messages_dropped_{0};
+  bool flush_scheduled_{false}; ///< Whether flush_queue_() is deferred to the next loop iteration.
+
+#ifndef ARDUINO_ARCH_ESP8266
+  /// The number of messages from other execution groups that can be waiting for the loop of this component.
+  static const uint8_t POSTED_MESSAGES = 8;
+  /// Messages published from other execution groups, the slots are reused so that posting doesn't allocate.
+  MQTTQueuedMessage posted_messages_[POSTED_MESSAGES];
+  std::atomic<uint32_t> posted_used_{0}; ///< Bit i is set while posted_messages_[i] is in use.
+#endif
+
+  std::unique_ptr<char[]> receive_buffer_;
+  size_t receive_buffer_size_{2048};
+  /// The bytes written into (head) and handled from (tail) the receive buffer in total, the difference is in use.
+  std::atomic<size_t> receive_head_{0};
+  std::atomic<size_t> receive_tail_{0};
+  /// The message the fragments are copied into, only used in the network context. nullptr if it was dropped.
+  MQTTReceivedMessage *receiving_{nullptr};
+  size_t receiving_size_{0}; ///< The bytes of receiving_ (with padding), it's committed to receive_head_ once complete.
+  std::atomic<bool> drain_posted_{false};
+  std::atomic<uint32_t> messages_rejected_{0};
+  uint32_t messages_rejected_logged_{0};
 };
 
 extern MQTTClientComponent *global_mqtt_client;
@@ -70,7 +70,8 @@ void MQTTComponent::send_discovery_() {
 
   ESP_LOGV(TAG, "Sending discovery...");
 
-  this->send_json_message(this->get_discovery_topic(discovery_info), [&](JsonBuffer &buffer, JsonObject &root) {
+  const std::string topic = this->get_discovery_topic(discovery_info);
+  global_mqtt_client->publish_json(topic, [&](JsonBuffer &buffer, JsonObject &root) {
     SendDiscoveryConfig config;
     config.state_topic = true;
     config.command_topic = true;
@@ -99,7 +100,7 @@ void MQTTComponent::send_discovery_() {
       if (this->availability_->payload_not_available != "offline")
         root["payload_not_available"] = this->availability_->payload_not_available;
     }
-  }, 0, discovery_info.retain);
+  }, 0, discovery_info.retain, MQTT_PRIORITY_DISCOVERY);
 }
 
 bool MQTTComponent::get_retain() const {
@@ -165,6 +166,7 @@ void MQTTComponent::setup_() {
 
   global_mqtt_client->add_on_connect_callback([this]() {
     this->next_send_discovery_ = true;
+    this->request_loop();
   });
 }
 void MQTTComponent::loop_() {
@@ -0,0 +1,569 @@
+#include "esphomelib/mqtt/mqtt_offline_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "esphomelib/esphal.h"
+#include "esphomelib/helpers.h"
+#include "esphomelib/log.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace mqtt {
+
+static const char *TAG = "mqtt.offline_buffer";
+
+// Record layout: marker, length, crc8 (of everything after it), boot (2), time (4), topic length, topic, payload
+static const size_t RECORD_HEADER_SIZE = 10;
+static const uint8_t RECORD_VALID = 0xA5;
+/// Flash bits can be cleared without an erase, so replayed records are marked by clearing the marker.
+static const uint8_t RECORD_REPLAYED = 0x00;
+static const uint8_t RECORD_FREE = 0xFF;
+
+// Sector layout: magic (4), sequence (4), records
+static const uint32_t SECTOR_MAGIC = 0x3142514D; // "MQB1"
+static const size_t SECTOR_HEADER_SIZE = 8;
+
+/// How many messages are read into the summaries per replay step with a summarizing replay policy.
+static const uint8_t SUMMARIZE_BATCH_SIZE = 64;
+
+static void put_uint32(uint8_t *data, uint32_t value) {
+  for (uint8_t i = 0; i < 4; i++)
+    data[i] = uint8_t(value >> (i * 8));
+}
+static uint32_t get_uint32(const uint8_t *data) {
+  return data[0] | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+/// Parse str if it's a JSON number, decimals is the number of digits after the decimal point.
+static bool parse_json_number(const std::string &str, float &value, int8_t &decimals) {
+  const size_t n = str.size();
+  size_t i = 0;
+  if (i < n && str[i] == '-')
+    i++;
+  const size_t int_start = i;
+  while (i < n && isdigit(str[i]))
+    i++;
+  if (i == int_start || (str[int_start] == '0' && i - int_start > 1))
+    return false;
+  decimals = 0;
+  if (i < n && str[i] == '.') {
+    const size_t fraction_start = ++i;
+    while (i < n && isdigit(str[i]))
+      i++;
+    if (i == fraction_start)
+      return false;
+    decimals = int8_t(std::min<size_t>(i - fraction_start, 8));
+  }
+  if (i < n && (str[i] == 'e' || str[i] == 'E')) {
+    i++;
+    if (i < n && (str[i] == '+' || str[i] == '-'))
+      i++;
+    const size_t exponent_start = i;
+    while (i < n && isdigit(str[i]))
+      i++;
+    if (i == exponent_start)
+      return false;
+  }
+  if (i != n)
+    return false;
+  value = strtof(str.c_str(), nullptr);
+  return true;
+}
+
+static std::string json_quote(const std::string &str) {
+  std::string ret = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    } else if (uint8_t(c) < 0x20) {
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", unsigned(uint8_t(c)));
+      ret += buffer;
+    } else {
+      ret += c;
+    }
+  }
+  return ret + "\"";
+}
+
+/// The payload as a JSON value, numbers are kept as they are and everything else becomes a string.
+static std::string payload_to_json(const std::string &payload) {
+  float value;
+  int8_t decimals;
+  if (parse_json_number(payload, value, decimals))
+    return payload;
+  return json_quote(payload);
+}
+
+// ==================== MQTTBufferStorage ====================
+
+void MQTTBufferStorage::setup() {
+
+}
+bool MQTTBufferStorage::process() {
+  return false;
+}
+uint16_t MQTTBufferStorage::get_boot() const {
+  return this->boot_;
+}
+uint32_t MQTTBufferStorage::get_dropped() const {
+  return this->dropped_;
+}
+bool MQTTBufferStorage::encode_(const MQTTBufferedMessage &message, std::vector<uint8_t> &record) {
+  const size_t len = RECORD_HEADER_SIZE + message.topic.size() + message.payload.size();
+  if (len > MAX_RECORD_SIZE)
+    return false;
+  record.resize(len);
+  record[0] = RECORD_VALID;
+  record[1] = uint8_t(len);
+  record[3] = uint8_t(message.boot);
+  record[4] = uint8_t(message.boot >> 8);
+  put_uint32(&record[5], message.time);
+  record[9] = uint8_t(message.topic.size());
+  memcpy(&record[RECORD_HEADER_SIZE], message.topic.data(), message.topic.size());
+  memcpy(&record[RECORD_HEADER_SIZE + message.topic.size()], message.payload.data(), message.payload.size());
+  record[2] = crc8(&record[3], uint8_t(len - 3));
+  return true;
+}
+bool MQTTBufferStorage::decode_(const uint8_t *record, size_t len, MQTTBufferedMessage &message) {
+  if (len < RECORD_HEADER_SIZE || record[1] != len || RECORD_HEADER_SIZE + record[9] > len)
+    return false;
+  if (crc8(const_cast<uint8_t *>(&record[3]), uint8_t(len - 3)) != record[2])
+    return false;
+  message.boot = record[3] | (uint16_t(record[4]) << 8);
+  message.time = get_uint32(&record[5]);
+  const char *topic = reinterpret_cast<const char *>(&record[RECORD_HEADER_SIZE]);
+  message.topic.assign(topic, record[9]);
+  message.payload.assign(topic + record[9], len - RECORD_HEADER_SIZE - record[9]);
+  return true;
+}
+
+// ==================== MQTTRAMBufferStorage ====================
+
+MQTTRAMBufferStorage::MQTTRAMBufferStorage(size_t size)
+    : data_(new uint8_t[size]), size_(size) {
+
+}
+void MQTTRAMBufferStorage::push(const MQTTBufferedMessage &message) {
+  std::vector<uint8_t> record;
+  if (!encode_(message, record) || record.size() > this->size_) {
+    this->dropped_++;
+    return;
+  }
+  while (this->used_ + record.size() > this->size_) {
+    // drop the oldest message
+    uint8_t len;
+    this->read_(this->tail_ + 1, &len, 1);
+    this->tail_ = (this->tail_ + len) % this->size_;
+    this->used_ -= len;
+    this->dropped_++;
+  }
+  this->write_(this->tail_ + this->used_, record.data(), record.size());
+  this->used_ += record.size();
+}
+bool MQTTRAMBufferStorage::peek(MQTTBufferedMessage &message) {
+  if (this->used_ == 0)
+    return false;
+  uint8_t record[MAX_RECORD_SIZE];
+  this->read_(this->tail_, record, 2);
+  this->read_(this->tail_, record, record[1]);
+  return decode_(record, record[1], message);
+}
+void MQTTRAMBufferStorage::pop() {
+  if (this->used_ == 0)
+    return;
+  uint8_t len;
+  this->read_(this->tail_ + 1, &len, 1);
+  this->tail_ = (this->tail_ + len) % this->size_;
+  this->used_ -= len;
+}
+void MQTTRAMBufferStorage::read_(size_t pos, uint8_t *data, size_t len) const {
+  for (size_t i = 0; i < len; i++)
+    data[i] = this->data_[(pos + i) % this->size_];
+}
+void MQTTRAMBufferStorage::write_(size_t pos, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    this->data_[(pos + i) % this->size_] = data[i];
+}
+
+// ==================== MQTTFlashBufferStorage ====================
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
+MQTTFlashBufferStorage::MQTTFlashBufferStorage(std::string partition_label, size_t max_pending)
+    : partition_label_(std::move(partition_label)), max_pending_(max_pending) {
+
+}
+void MQTTFlashBufferStorage::setup() {
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                              this->partition_label_.c_str());
+  if (partition == nullptr || partition->size < 2 * SECTOR_SIZE) {
+    ESP_LOGE(TAG, "Flash partition '%s' not found (or smaller than 2 sectors)!", this->partition_label_.c_str());
+    return;
+  }
+  this->partition_ = partition;
+  this->sector_count_ = partition->size / SECTOR_SIZE;
+
+  // the newest sector has the highest sequence number.
+  for (size_t sector = 0; sector < this->sector_count_; sector++) {
+    uint32_t sequence;
+    if (!this->read_sector_header_(sector, sequence))
+      continue;
+    if (!this->has_head_ || int32_t(sequence - this->head_sequence_) > 0) {
+      this->has_head_ = true;
+      this->head_sector_ = sector;
+      this->head_sequence_ = sequence;
+    }
+  }
+  if (!this->has_head_) {
+    ESP_LOGCONFIG(TAG, "    Flash partition '%s' is empty.", this->partition_label_.c_str());
+    return;
+  }
+
+  // the sectors before it with consecutive sequence numbers hold the older records.
+  size_t oldest = this->head_sector_;
+  for (size_t i = 1; i < this->sector_count_; i++) {
+    const size_t sector = (this->head_sector_ + this->sector_count_ - i) % this->sector_count_;
+    uint32_t sequence;
+    if (!this->read_sector_header_(sector, sequence) || sequence != this->head_sequence_ - i)
+      break;
+    oldest = sector;
+  }
+
+  bool has_tail = false, has_records = false;
+  uint16_t last_boot = 0;
+  size_t stored = 0;
+  std::vector<uint8_t> record;
+  MQTTBufferedMessage message;
+  for (size_t sector = oldest;; sector = (sector + 1) % this->sector_count_) {
+    size_t offset = SECTOR_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= SECTOR_SIZE) {
+      const uint8_t marker = this->read_record_(sector, offset, record);
+      if (marker == RECORD_FREE)
+        break;
+      if (record.empty() || (marker != RECORD_VALID && marker != RECORD_REPLAYED) ||
+          !decode_(record.data(), record.size(), message)) {
+        // torn write (power loss), don't write after it.
+        if (sector == this->head_sector_)
+          offset = SECTOR_SIZE;
+        break;
+      }
+      if (!has_records || int16_t(message.boot - last_boot) > 0)
+        last_boot = message.boot;
+      has_records = true;
+      if (marker == RECORD_VALID) {
+        stored++;
+        if (!has_tail) {
+          has_tail = true;
+          this->tail_sector_ = sector;
+          this->tail_offset_ = offset;
+        }
+      }
+      offset += record.size();
+    }
+    if (sector == this->head_sector_) {
+      this->head_offset_ = offset;
+      break;
+    }
+  }
+  if (!has_tail) {
+    this->tail_sector_ = this->head_sector_;
+    this->tail_offset_ = this->head_offset_;
+  }
+  if (has_records)
+    this->boot_ = last_boot + 1;
+  ESP_LOGCONFIG(TAG, "    Recovered %u messages from flash partition '%s'.", unsigned(stored),
+                this->partition_label_.c_str());
+}
+void MQTTFlashBufferStorage::push(const MQTTBufferedMessage &message) {
+  std::vector<uint8_t> record;
+  if (this->partition_ == nullptr || !encode_(message, record) ||
+      this->pending_.size() + record.size() > this->max_pending_) {
+    this->dropped_++;
+    return;
+  }
+  this->pending_.insert(this->pending_.end(), record.begin(), record.end());
+}
+bool MQTTFlashBufferStorage::peek(MQTTBufferedMessage &message) {
+  std::vector<uint8_t> record;
+  while (this->has_head_) {
+    if (this->tail_offset_ + RECORD_HEADER_SIZE <= SECTOR_SIZE) {
+      const uint8_t marker = this->read_record_(this->tail_sector_, this->tail_offset_, record);
+      if (marker == RECORD_VALID && !record.empty() && decode_(record.data(), record.size(), message)) {
+        this->peeked_flash_ = true;
+        this->peeked_length_ = record.size();
+        return true;
+      }
+      if (marker == RECORD_REPLAYED && !record.empty()) {
+        this->tail_offset_ += record.size();
+        continue;
+      }
+    }
+    // end of the sector (or a torn record)
+    if (this->tail_sector_ == this->head_sector_)
+      break;
+    this->advance_tail_();
+  }
+
+  if (this->pending_.empty())
+    return false;
+  this->peeked_flash_ = false;
+  this->peeked_length_ = this->pending_[1];
+  return decode_(this->pending_.data(), this->peeked_length_, message);
+}
+void MQTTFlashBufferStorage::pop() {
+  if (this->peeked_length_ == 0)
+    return;
+  if (this->peeked_flash_) {
+    const uint8_t marker = RECORD_REPLAYED;
+    esp_partition_write(this->partition_, this->tail_sector_ * SECTOR_SIZE + this->tail_offset_, &marker, 1);
+    this->tail_offset_ += this->peeked_length_;
+  } else {
+    this->pending_.erase(this->pending_.begin(), this->pending_.begin() + this->peeked_length_);
+  }
+  this->peeked_length_ = 0;
+}
+bool MQTTFlashBufferStorage::process() {
+  if (this->pending_.empty())
+    return false;
+  if (!this->has_head_ || this->head_offset_ + this->pending_[1] > SECTOR_SIZE) {
+    // erasing takes a while, so that's all for this call.
+    this->start_next_sector_();
+    return true;
+  }
+
+  size_t written = 0;
+  while (written < this->pending_.size()) {
+    const uint8_t len = this->pending_[written + 1];
+    if (this->head_offset_ + len > SECTOR_SIZE || (written != 0 && written + len > PROCESS_BYTES))
+      break;
+    const size_t address = this->head_sector_ * SECTOR_SIZE + this->head_offset_;
+    if (esp_partition_write(this->partition_, address, &this->pending_[written], len) != ESP_OK) {
+      ESP_LOGW(TAG, "Writing to flash failed!");
+      this->dropped_++;
+    }
+    this->head_offset_ += len;
+    written += len;
+  }
+  this->pending_.erase(this->pending_.begin(), this->pending_.begin() + written);
+  // the last peek() can't refer to pending_ anymore.
+  this->peeked_length_ = 0;
+  return !this->pending_.empty();
+}
+bool MQTTFlashBufferStorage::is_ready() const {
+  return this->partition_ != nullptr;
+}
+uint8_t MQTTFlashBufferStorage::read_record_(size_t sector, size_t offset, std::vector<uint8_t> &record) {
+  uint8_t header[2];
+  record.clear();
+  if (esp_partition_read(this->partition_, sector * SECTOR_SIZE + offset, header, 2) != ESP_OK)
+    return RECORD_FREE;
+  if (header[0] == RECORD_FREE || header[1] < RECORD_HEADER_SIZE || offset + header[1] > SECTOR_SIZE)
+    return header[0];
+  record.resize(header[1]);
+  if (esp_partition_read(this->partition_, sector * SECTOR_SIZE + offset, record.data(), record.size()) != ESP_OK)
+    record.clear();
+  return header[0];
+}
+bool MQTTFlashBufferStorage::read_sector_header_(size_t sector, uint32_t &sequence) {
+  uint8_t header[SECTOR_HEADER_SIZE];
+  if (esp_partition_read(this->partition_, sector * SECTOR_SIZE, header, sizeof(header)) != ESP_OK)
+    return false;
+  sequence = get_uint32(&header[4]);
+  return get_uint32(&header[0]) == SECTOR_MAGIC;
+}
+void MQTTFlashBufferStorage::start_next_sector_() {
+  const size_t sector = this->has_head_ ? (this->head_sector_ + 1) % this->sector_count_ : 0;
+  if (this->has_head_ && sector == this->tail_sector_) {
+    // the log is full, drop the messages of the oldest sector that weren't replayed yet.
+    std::vector<uint8_t> record;
+    for (size_t offset = this->tail_offset_; offset + RECORD_HEADER_SIZE <= SECTOR_SIZE; offset += record.size()) {
+      const uint8_t marker = this->read_record_(sector, offset, record);
+      if (record.empty())
+        break;
+      if (marker == RECORD_VALID)
+        this->dropped_++;
+    }
+    this->advance_tail_();
+  }
+
+  esp_partition_erase_range(this->partition_, sector * SECTOR_SIZE, SECTOR_SIZE);
+  uint8_t header[SECTOR_HEADER_SIZE];
+  const uint32_t sequence = this->has_head_ ? this->head_sequence_ + 1 : 0;
+  put_uint32(&header[0], SECTOR_MAGIC);
+  put_uint32(&header[4], sequence);
+  esp_partition_write(this->partition_, sector * SECTOR_SIZE, header, sizeof(header));
+
+  if (!this->has_head_) {
+    this->tail_sector_ = sector;
+    this->tail_offset_ = SECTOR_HEADER_SIZE;
+  }
+  this->has_head_ = true;
+  this->head_sector_ = sector;
+  this->head_offset_ = SECTOR_HEADER_SIZE;
+  this->head_sequence_ = sequence;
+}
+void MQTTFlashBufferStorage::advance_tail_() {
+  this->tail_sector_ = (this->tail_sector_ + 1) % this->sector_count_;
+  this->tail_offset_ = SECTOR_HEADER_SIZE;
+}
+#endif
+
+// ==================== MQTTOfflineBuffer ====================
+
+MQTTOfflineBuffer::MQTTOfflineBuffer(MQTTClientComponent *client, MQTTBufferStorage *storage)
+    : client_(client), storage_(storage) {
+  client->set_offline_buffer(this);
+}
+void MQTTOfflineBuffer::set_replay_policy(MQTTReplayPolicy replay_policy) {
+  this->replay_policy_ = replay_policy;
+}
+void MQTTOfflineBuffer::set_replay_interval(uint32_t replay_interval) {
+  this->replay_interval_ = replay_interval;
+}
+void MQTTOfflineBuffer::set_topic_suffix(std::string topic_suffix) {
+  this->topic_suffix_ = std::move(topic_suffix);
+}
+void MQTTOfflineBuffer::add(const std::string &topic, const std::string &payload) {
+  this->storage_->push(MQTTBufferedMessage{
+      .topic = topic,
+      .payload = payload,
+      .time = millis(),
+      .boot = this->storage_->get_boot(),
+  });
+  this->pending_work_ = true;
+}
+MQTTBufferStorage *MQTTOfflineBuffer::get_storage() const {
+  return this->storage_;
+}
+uint32_t MQTTOfflineBuffer::get_replayed() const {
+  return this->replayed_;
+}
+void MQTTOfflineBuffer::setup() {
+  ESP_LOGCONFIG(TAG, "Setting up MQTT offline buffer...");
+  this->storage_->setup();
+  this->client_->add_on_connect_callback([this]() {
+    this->start_replay_();
+  });
+}
+void MQTTOfflineBuffer::loop() {
+  if (this->pending_work_)
+    this->pending_work_ = this->storage_->process();
+}
+bool MQTTOfflineBuffer::needs_continuous_loop() const {
+  return this->pending_work_;
+}
+float MQTTOfflineBuffer::get_setup_priority() const {
+  // before the client, so that nothing published while it's connecting is lost.
+  return setup_priority::MQTT_CLIENT + 1.0f;
+}
+void MQTTOfflineBuffer::start_replay_() {
+  if (this->replaying_)
+    return;
+  this->replaying_ = true;
+  this->set_interval("replay", this->replay_interval_, [this]() {
+    this->replay_step_();
+  });
+}
+void MQTTOfflineBuffer::replay_step_() {
+  if (!this->client_->is_connected()) {
+    // continued on the next connect.
+    this->cancel_interval("replay");
+    this->replaying_ = false;
+    return;
+  }
+
+  MQTTBufferedMessage message;
+  if (this->replay_policy_ == MQTT_REPLAY_ALL) {
+    if (this->storage_->peek(message)) {
+      this->client_->publish(message.topic + this->topic_suffix_, this->message_to_json_(message), 0, false);
+      this->storage_->pop();
+      this->replayed_++;
+      return;
+    }
+  } else {
+    uint8_t read = 0;
+    for (; read < SUMMARIZE_BATCH_SIZE && this->storage_->peek(message); read++) {
+      this->summarize_(message);
+      this->storage_->pop();
+      this->replayed_++;
+    }
+    if (read == SUMMARIZE_BATCH_SIZE)
+      return;
+    if (!this->summaries_.empty()) {
+      const TopicSummary &summary = this->summaries_.front();
+      this->client_->publish(summary.last.topic + this->topic_suffix_, this->summary_to_json_(summary), 0, false);
+      this->summaries_.erase(this->summaries_.begin());
+      return;
+    }
+  }
+
+  if (this->replayed_ != 0)
+    ESP_LOGD(TAG, "Replayed buffered messages, %u in total.", unsigned(this->replayed_));
+  this->cancel_interval("replay");
+  this->replaying_ = false;
+}
+void MQTTOfflineBuffer::summarize_(const MQTTBufferedMessage &message) {
+  auto it = std::find_if(this->summaries_.begin(), this->summaries_.end(), [&message](const TopicSummary &summary) {
+    return summary.last.topic == message.topic;
+  });
+  if (it == this->summaries_.end()) {
+    this->summaries_.push_back(TopicSummary{
+        .last = message,
+        .count = 0,
+        .numeric = true,
+        .min = INFINITY,
+        .max = -INFINITY,
+        .sum = 0.0,
+        .accuracy_decimals = 0,
+    });
+    it = this->summaries_.end() - 1;
+  }
+  it->last = message;
+  it->count++;
+  float value;
+  int8_t decimals;
+  if (it->numeric && parse_json_number(message.payload, value, decimals)) {
+    it->min = std::min(it->min, value);
+    it->max = std::max(it->max, value);
+    it->sum += value;
+    it->accuracy_decimals = std::max(it->accuracy_decimals, decimals);
+  } else {
+    it->numeric = false;
+  }
+}
+std::string MQTTOfflineBuffer::time_to_json_(const MQTTBufferedMessage &message) {
+  char buffer[48];
+  const uint16_t boots_ago = this->storage_->get_boot() - message.boot;
+  if (boots_ago == 0)
+    snprintf(buffer, sizeof(buffer), "\"age\":%u", unsigned(millis() - message.time));
+  else
+    snprintf(buffer, sizeof(buffer), "\"boots_ago\":%u,\"uptime\":%u", unsigned(boots_ago), unsigned(message.time));
+  return buffer;
+}
+std::string MQTTOfflineBuffer::message_to_json_(const MQTTBufferedMessage &message) {
+  return "{" + this->time_to_json_(message) + ",\"value\":" + payload_to_json(message.payload) + "}";
+}
+std::string MQTTOfflineBuffer::summary_to_json_(const TopicSummary &summary) {
+  if (this->replay_policy_ == MQTT_REPLAY_LAST_PER_TOPIC)
+    return this->message_to_json_(summary.last);
+
+  char count[12];
+  snprintf(count, sizeof(count), "%u", unsigned(summary.count));
+  std::string json = "{" + this->time_to_json_(summary.last) + ",\"count\":" + count;
+  if (summary.numeric) {
+    const int8_t decimals = summary.accuracy_decimals;
+    json += ",\"min\":" + value_accuracy_to_string(summary.min, decimals);
+    json += ",\"max\":" + value_accuracy_to_string(summary.max, decimals);
+    json += ",\"mean\":" + value_accuracy_to_string(summary.sum / summary.count, decimals);
+  }
+  return json + ",\"last\":" + payload_to_json(summary.last.payload) + "}";
+}
+
+} // namespace mqtt
+
+ESPHOMELIB_NAMESPACE_END
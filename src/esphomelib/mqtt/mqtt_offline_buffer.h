@@ -0,0 +1,244 @@
+#ifndef ESPHOMELIB_MQTT_MQTT_OFFLINE_BUFFER_H
+#define ESPHOMELIB_MQTT_MQTT_OFFLINE_BUFFER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
+#include <esp_partition.h>
+#endif
+
+#include "esphomelib/component.h"
+#include "esphomelib/mqtt/mqtt_client_component.h"
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace mqtt {
+
+/// How an MQTTOfflineBuffer replays the buffered messages once the connection is back.
+enum MQTTReplayPolicy {
+  MQTT_REPLAY_ALL = 0, ///< Replay every buffered message, oldest first.
+  MQTT_REPLAY_LAST_PER_TOPIC, ///< Only replay the last buffered message of each topic.
+  MQTT_REPLAY_AGGREGATE, ///< Replay count, min, max, mean and last value of the buffered messages of each topic.
+};
+
+/// A message captured by an MQTTOfflineBuffer.
+struct MQTTBufferedMessage {
+  std::string topic;
+  std::string payload;
+  uint32_t time; ///< The millis() time the message was published at.
+  uint16_t boot; ///< The boot the message was published in, see MQTTBufferStorage::get_boot().
+};
+
+/** The storage of an MQTTOfflineBuffer, a bounded FIFO of messages that drops the oldest messages if full.
+ *
+ * Messages are stored as records of at most MAX_RECORD_SIZE bytes (topic and payload plus a 10 byte
+ * header), larger messages are dropped.
+ */
+class MQTTBufferStorage {
+ public:
+  static const size_t MAX_RECORD_SIZE = 255;
+
+  virtual ~MQTTBufferStorage() = default;
+
+  /// Recover the messages stored before a reboot, called once in setup().
+  virtual void setup();
+  /// Store message, must return quickly.
+  virtual void push(const MQTTBufferedMessage &message) = 0;
+  /// Get the oldest message without removing it, false if the storage is empty.
+  virtual bool peek(MQTTBufferedMessage &message) = 0;
+  /// Remove the message returned by the last peek().
+  virtual void pop() = 0;
+  /// Do deferred work (like writing to flash) in small steps, returns whether there's more work to do.
+  virtual bool process();
+
+  /// The current boot, messages from earlier boots have a lower number. Only persistent storages count boots.
+  uint16_t get_boot() const;
+  /// The number of messages dropped because the storage was full (or the message too large).
+  uint32_t get_dropped() const;
+
+ protected:
+  /// Encode message into a record, false if it's too large.
+  static bool encode_(const MQTTBufferedMessage &message, std::vector<uint8_t> &record);
+  /// Decode a record of len bytes, false if the checksum doesn't match.
+  static bool decode_(const uint8_t *record, size_t len, MQTTBufferedMessage &message);
+
+  uint16_t boot_{0};
+  uint32_t dropped_{0};
+};
+
+/// An MQTTBufferStorage in a ring buffer in RAM, for the ESP8266. Messages are lost on reboot.
+class MQTTRAMBufferStorage : public MQTTBufferStorage {
+ public:
+  /// Create the storage, the size bytes are allocated once here.
+  explicit MQTTRAMBufferStorage(size_t size);
+
+  void push(const MQTTBufferedMessage &message) override;
+  bool peek(MQTTBufferedMessage &message) override;
+  void pop() override;
+
+ protected:
+  void read_(size_t pos, uint8_t *data, size_t len) const;
+  void write_(size_t pos, const uint8_t *data, size_t len);
+
+  std::unique_ptr<uint8_t[]> data_;
+  size_t size_;
+  size_t tail_{0}; ///< The position of the oldest record.
+  size_t used_{0};
+};
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
+/** An MQTTBufferStorage in a flash partition, messages survive reboots.
+ *
+ * The partition is used as a circular log of sectors: Records are appended to the newest sector, and once
+ * it's full the next sector is erased (dropping its messages if they weren't replayed yet) and started with
+ * a sequence number. So every sector is erased equally often, and the newest sector and the oldest record
+ * are found again after a reboot from the sequence numbers. Replayed records are marked by clearing their
+ * first byte, which flash can do without an erase.
+ *
+ * push() only queues the record in RAM, process() writes at most PROCESS_BYTES of them per call or erases
+ * one sector (which stalls the CPU for a few tens of ms, once per 4kB of messages).
+ *
+ * The partition needs to be added to the partition table of the ESP32, for example with the line
+ * `mqttbuf, data, 0x40, , 64K` in a custom partitions CSV.
+ */
+class MQTTFlashBufferStorage : public MQTTBufferStorage {
+ public:
+  static const size_t SECTOR_SIZE = SPI_FLASH_SEC_SIZE;
+  /// How many record bytes process() writes per call.
+  static const size_t PROCESS_BYTES = 256;
+
+  /** Create the storage.
+   *
+   * @param partition_label The label of the data partition, at least 2 sectors large.
+   * @param max_pending How many bytes of records can wait in RAM for being written.
+   */
+  explicit MQTTFlashBufferStorage(std::string partition_label, size_t max_pending = 1024);
+
+  void setup() override;
+  void push(const MQTTBufferedMessage &message) override;
+  bool peek(MQTTBufferedMessage &message) override;
+  void pop() override;
+  bool process() override;
+
+  /// Whether the partition was found and can be used.
+  bool is_ready() const;
+
+ protected:
+  /// Read the record at offset of sector into record, returns its marker.
+  uint8_t read_record_(size_t sector, size_t offset, std::vector<uint8_t> &record);
+  bool read_sector_header_(size_t sector, uint32_t &sequence);
+  /// Erase the sector after the newest one and start writing to it.
+  void start_next_sector_();
+  /// Move the tail to the start of the next sector.
+  void advance_tail_();
+
+  std::string partition_label_;
+  const esp_partition_t *partition_{nullptr};
+  size_t sector_count_{0};
+  bool has_head_{false}; ///< Whether a sector was started yet.
+  size_t head_sector_{0};
+  size_t head_offset_{0}; ///< The write position in the head sector.
+  uint32_t head_sequence_{0};
+  size_t tail_sector_{0};
+  size_t tail_offset_{0}; ///< The position of the oldest record not replayed yet.
+  std::vector<uint8_t> pending_; ///< Records waiting to be written by process().
+  size_t max_pending_;
+  bool peeked_flash_{false}; ///< Whether the last peek() returned a record from flash or from pending_.
+  size_t peeked_length_{0};
+};
+#endif
+
+/** Buffer the state messages published while the MQTT client isn't connected and replay them afterwards.
+ *
+ * Without this, all messages published while the client isn't connected are dropped, this is the only way
+ * states published during a broker outage are sent later (see MQTTClientComponent::publish()). The buffer
+ * captures the state messages with the time they were published at and, once connected again, publishes
+ * them (with the replay policy, see set_replay_policy()) to the topic of the message with "/buffered"
+ * appended, one message every replay interval:
+ *
+ *  - `{"age":12000,"value":21.5}` for single messages, age is how many ms ago it was published. Messages
+ *    from before a reboot have `"boots_ago"` and `"uptime"` (the millis() time in that boot) instead.
+ *  - `{"age":12000,"count":30,"min":20.5,"max":21.5,"mean":21.0,"last":21.5}` for MQTT_REPLAY_AGGREGATE,
+ *    min/max/mean only if all values are numbers.
+ *
+ * On the ESP8266 use MQTTRAMBufferStorage, on the ESP32 MQTTFlashBufferStorage keeps messages across reboots:
+ *
+ * @code
+ * auto *buffer = new mqtt::MQTTOfflineBuffer(mqtt, new mqtt::MQTTRAMBufferStorage(8192));
+ * buffer->set_replay_policy(mqtt::MQTT_REPLAY_AGGREGATE);
+ * App.register_component(buffer);
+ * @endcode
+ */
+class MQTTOfflineBuffer : public Component {
+ public:
+  /** Construct the buffer and attach it to the client.
+   *
+   * @param client The MQTT client whose messages are buffered.
+   * @param storage Where the messages are stored.
+   */
+  MQTTOfflineBuffer(MQTTClientComponent *client, MQTTBufferStorage *storage);
+
+  /// Set how the messages are replayed, MQTT_REPLAY_ALL by default.
+  void set_replay_policy(MQTTReplayPolicy replay_policy);
+  /// Set the time in ms between two replayed messages, defaults to 100ms.
+  void set_replay_interval(uint32_t replay_interval);
+  /// Set what's appended to the topic of replayed messages, defaults to "/buffered".
+  void set_topic_suffix(std::string topic_suffix);
+
+  /// Buffer a message, called by the client for the states published while it isn't connected.
+  void add(const std::string &topic, const std::string &payload);
+
+  MQTTBufferStorage *get_storage() const;
+  /// The number of messages replayed.
+  uint32_t get_replayed() const;
+
+  /// Recover the stored messages, before the MQTT client connects.
+  void setup() override;
+  /// Let the storage write the buffered messages.
+  void loop() override;
+  bool needs_continuous_loop() const override;
+  float get_setup_priority() const override;
+
+ protected:
+  /// The statistics of the buffered messages of one topic, for MQTT_REPLAY_LAST_PER_TOPIC and _AGGREGATE.
+  struct TopicSummary {
+    MQTTBufferedMessage last;
+    uint32_t count;
+    bool numeric; ///< Whether all payloads are numbers.
+    float min;
+    float max;
+    double sum;
+    int8_t accuracy_decimals; ///< The most decimals of the payloads.
+  };
+
+  /// Start replaying, called on each connect.
+  void start_replay_();
+  /// Replay a message, or with a summarizing policy read a batch of messages first.
+  void replay_step_();
+  /// Add message to the summary of its topic.
+  void summarize_(const MQTTBufferedMessage &message);
+  std::string message_to_json_(const MQTTBufferedMessage &message);
+  std::string summary_to_json_(const TopicSummary &summary);
+  /// The JSON fields for the time of message: age, or boots_ago and uptime.
+  std::string time_to_json_(const MQTTBufferedMessage &message);
+
+  MQTTClientComponent *client_;
+  MQTTBufferStorage *storage_;
+  MQTTReplayPolicy replay_policy_{MQTT_REPLAY_ALL};
+  uint32_t replay_interval_{100};
+  std::string topic_suffix_{"/buffered"};
+  bool replaying_{false};
+  bool pending_work_{false}; ///< Whether the storage has work left for process().
+  std::vector<TopicSummary> summaries_;
+  uint32_t replayed_{0};
+};
+
+} // namespace mqtt
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_MQTT_MQTT_OFFLINE_BUFFER_H
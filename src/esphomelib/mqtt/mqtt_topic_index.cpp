@@ -0,0 +1,137 @@
+#include "esphomelib/mqtt/mqtt_topic_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace mqtt {
+
+/// Compare the level [begin, end) with a child name, like strcmp.
+static int compare_level(const std::string &name, const char *begin, size_t len) {
+  const int cmp = memcmp(name.data(), begin, std::min(name.size(), len));
+  if (cmp != 0)
+    return cmp;
+  return name.size() < len ? -1 : (name.size() > len ? 1 : 0);
+}
+
+bool MQTTTopicIndex::insert(const std::string &filter, size_t value) {
+  if (!is_valid_filter(filter))
+    return false;
+
+  if (filter.find_first_of("+#") == std::string::npos) {
+    const uint32_t hash = fnv1a_hash(filter);
+    auto it = std::upper_bound(this->exact_.begin(), this->exact_.end(), hash,
+                               [](uint32_t h, const ExactFilter &exact) { return h < exact.hash; });
+    this->exact_.insert(it, ExactFilter{
+        .hash = hash,
+        .filter = filter,
+        .value = value,
+    });
+    return true;
+  }
+
+  this->has_wildcards_ = true;
+  Node *node = &this->root_;
+  size_t begin = 0;
+  while (true) {
+    size_t end = filter.find('/', begin);
+    if (end == std::string::npos)
+      end = filter.size();
+    const size_t len = end - begin;
+
+    if (len == 1 && filter[begin] == '#') {
+      node->multi_level.push_back(value);
+      return true;
+    }
+    if (len == 1 && filter[begin] == '+') {
+      if (!node->single_level)
+        node->single_level.reset(new Node());
+      node = node->single_level.get();
+    } else {
+      auto it = std::lower_bound(node->children.begin(), node->children.end(), filter.data() + begin,
+                                 [len](const std::pair<std::string, std::unique_ptr<Node>> &child, const char *level) {
+                                   return compare_level(child.first, level, len) < 0;
+                                 });
+      if (it == node->children.end() || compare_level(it->first, filter.data() + begin, len) != 0)
+        it = node->children.insert(it, std::make_pair(filter.substr(begin, len), std::unique_ptr<Node>(new Node())));
+      node = it->second.get();
+    }
+
+    if (end == filter.size()) {
+      node->values.push_back(value);
+      return true;
+    }
+    begin = end + 1;
+  }
+}
+void MQTTTopicIndex::match(const char *topic, size_t len, const InlineFunction<void(size_t)> &callback) const {
+  const uint32_t hash = fnv1a_hash(topic, len);
+  auto it = std::lower_bound(this->exact_.begin(), this->exact_.end(), hash,
+                             [](const ExactFilter &exact, uint32_t h) { return exact.hash < h; });
+  for (; it != this->exact_.end() && it->hash == hash; it++)
+    if (it->filter.size() == len && memcmp(it->filter.data(), topic, len) == 0)
+      callback(it->value);
+
+  if (this->has_wildcards_)
+    match_(&this->root_, topic, topic + len, true, callback);
+}
+bool MQTTTopicIndex::empty() const {
+  return this->exact_.empty() && !this->has_wildcards_;
+}
+bool MQTTTopicIndex::is_valid_filter(const std::string &filter) {
+  if (filter.empty())
+    return false;
+  for (size_t i = 0; i < filter.size(); i++) {
+    const char c = filter[i];
+    if (c != '+' && c != '#')
+      continue;
+    // wildcards have to be whole levels
+    if (i != 0 && filter[i - 1] != '/')
+      return false;
+    if (i + 1 != filter.size() && (c == '#' || filter[i + 1] != '/'))
+      return false;
+  }
+  return true;
+}
+void MQTTTopicIndex::match_(const Node *node, const char *level, const char *end, bool first_level,
+                           const InlineFunction<void(size_t)> &callback) {
+  auto *level_end = static_cast<const char *>(memchr(level, '/', end - level));
+  if (level_end == nullptr)
+    level_end = end;
+  const size_t len = level_end - level;
+  // topics like $SYS/... are only matched explicitly
+  const bool wildcards = !(first_level && len != 0 && level[0] == '$');
+
+  if (wildcards)
+    for (size_t value : node->multi_level)
+      callback(value);
+
+  auto it = std::lower_bound(node->children.begin(), node->children.end(), level,
+                             [len](const std::pair<std::string, std::unique_ptr<Node>> &child, const char *l) {
+                               return compare_level(child.first, l, len) < 0;
+                             });
+  if (it != node->children.end() && compare_level(it->first, level, len) == 0) {
+    if (level_end == end)
+      match_end_(it->second.get(), callback);
+    else
+      match_(it->second.get(), level_end + 1, end, false, callback);
+  }
+
+  if (wildcards && node->single_level) {
+    if (level_end == end)
+      match_end_(node->single_level.get(), callback);
+    else
+      match_(node->single_level.get(), level_end + 1, end, false, callback);
+  }
+}
+void MQTTTopicIndex::match_end_(const Node *node, const InlineFunction<void(size_t)> &callback) {
+  for (size_t value : node->values)
+    callback(value);
+  for (size_t value : node->multi_level)
+    callback(value);
+}
+
+} // namespace mqtt
+
+ESPHOMELIB_NAMESPACE_END
@@ -0,0 +1,84 @@
+#ifndef ESPHOMELIB_MQTT_MQTT_TOPIC_INDEX_H
+#define ESPHOMELIB_MQTT_MQTT_TOPIC_INDEX_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace mqtt {
+
+/** An index of MQTT topic filters, for finding the subscriptions matching a topic.
+ *
+ * Filters without wildcards (nearly all of them, the command topics of the MQTT components) are kept sorted
+ * by their FNV-1a hash, so a topic is matched with one hash and a binary search. Filters with wildcards are
+ * kept in a trie of topic levels, each node has its children sorted by name plus a `+` and a `#` branch, so
+ * a topic is matched with one binary search per level. Both don't depend on the number of filters.
+ *
+ * The wildcards follow the MQTT 3.1.1 rules: `+` matches exactly one level, `#` (only as the last level) the
+ * parent level and any number of levels below it, and neither matches topics starting with `$` at the first
+ * level.
+ *
+ * Filters are mapped to values (for example indices of subscriptions), a topic can match several values.
+ */
+class MQTTTopicIndex {
+ public:
+  /// Add value for filter, returns false (without adding it) if filter isn't a valid topic filter.
+  bool insert(const std::string &filter, size_t value);
+
+  /** Call callback with the value of each filter matching topic.
+   *
+   * @param topic The topic, doesn't need to be null-terminated.
+   * @param len The length of topic.
+   * @param callback Called once per matching value, in no specific order.
+   */
+  void match(const char *topic, size_t len, const InlineFunction<void(size_t)> &callback) const;
+
+  /// Whether the index has no filters.
+  bool empty() const;
+
+  /// Whether filter is a valid MQTT topic filter: not empty, wildcards only as whole levels and `#` last.
+  static bool is_valid_filter(const std::string &filter);
+
+ protected:
+  /// A filter without wildcards.
+  struct ExactFilter {
+    uint32_t hash;
+    std::string filter;
+    size_t value;
+  };
+
+  /// A level of the wildcard trie.
+  struct Node {
+    /// The children with a plain name, sorted by name.
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> children;
+    /// The `+` child.
+    std::unique_ptr<Node> single_level;
+    /// The values of the filters ending in `#` at this node.
+    std::vector<size_t> multi_level;
+    /// The values of the filters ending at this node.
+    std::vector<size_t> values;
+  };
+
+  /// Match the levels of the topic from level to end against the children of node.
+  static void match_(const Node *node, const char *level, const char *end, bool first_level,
+                     const InlineFunction<void(size_t)> &callback);
+  /// The topic ended at node: the filters ending here and the ones ending in `#` below it match.
+  static void match_end_(const Node *node, const InlineFunction<void(size_t)> &callback);
+
+  std::vector<ExactFilter> exact_; ///< Sorted by hash.
+  Node root_;
+  bool has_wildcards_{false};
+};
+
+} // namespace mqtt
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_MQTT_MQTT_TOPIC_INDEX_H
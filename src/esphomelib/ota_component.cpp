@@ -15,7 +15,7 @@
 ESPHOMELIB_NAMESPACE_BEGIN
 
 static const char *TAG = "ota";
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
   static const char *PREF_TAG = "ota"; ///< Tag for preferences.
   static const char *PREF_SAFE_MODE_COUNTER_KEY = "safe_mode";
 #endif
@@ -121,6 +121,9 @@ void OTAComponent::loop() {
     this->write_rtc_(0);
   }
 }
+bool OTAComponent::needs_continuous_loop() const {
+  return this->ota_triggered_;
+}
 
 OTAComponent::OTAComponent(uint16_t port, std::string hostname)
     : port_(port), hostname_(std::move(hostname)), auth_type_(OPEN), server_(nullptr) {
@@ -174,6 +177,7 @@ void OTAComponent::start_safe_mode(uint8_t num_attempts, uint32_t enable_time) {
     ESP_LOGI(TAG, "Waiting for OTA attempt.");
     uint32_t begin = millis();
     while ((millis() - begin) < enable_time) {
+      App.get_loop(EXECUTION_GROUP_MAIN).scheduler.call();
       this->loop_();
       App.get_wifi()->loop_();
     }
@@ -189,7 +193,7 @@ void OTAComponent::write_rtc_(uint8_t val) {
   uint32_t data = val;
   ESP.rtcUserMemoryWrite(0, &data, sizeof(data));
 #endif
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
   global_preferences.put_uint8(PREF_TAG, PREF_SAFE_MODE_COUNTER_KEY, static_cast<uint8_t>(val));
 #endif
 }
@@ -201,7 +205,7 @@ uint8_t OTAComponent::read_rtc_() {
     return 0;
   return uint8_t(rtc_data);
 #endif
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
   return global_preferences.get_uint8(PREF_TAG, PREF_SAFE_MODE_COUNTER_KEY, 0);
 #endif
 }
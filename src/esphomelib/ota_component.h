@@ -12,7 +12,7 @@
 
 #ifdef USE_OTA
 
-#ifdef ARDUINO_ARCH_ESP32
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_HOST)
   const uint16_t OTA_DEFAULT_PORT = 3232;
 #endif
 #ifdef ARDUINO_ARCH_ESP8266
@@ -74,6 +74,7 @@ class OTAComponent : public Component {
   void setup() override;
   float get_setup_priority() const override;
   void loop() override;
+  bool needs_continuous_loop() const override;
 
   const std::string &get_hostname() const;
 
@@ -107,6 +107,9 @@ void PCA9685OutputComponent::loop() {
 
   this->update_ = false;
 }
+bool PCA9685OutputComponent::needs_continuous_loop() const {
+  return this->update_;
+}
 
 float PCA9685OutputComponent::get_setup_priority() const {
   return setup_priority::HARDWARE;
@@ -59,6 +59,7 @@ class PCA9685OutputComponent : public Component, public I2CDevice {
   float get_setup_priority() const override;
   /// Send new values if they were updated.
   void loop() override;
+  bool needs_continuous_loop() const override;
 
   class Channel : public FloatOutput {
    public:
@@ -51,7 +51,7 @@ void PowerSupplyComponent::set_keep_on_time(uint32_t keep_on_time) {
 }
 
 void PowerSupplyComponent::request_high_power() {
-  this->cancel_timeout("power-supply-off");
+  this->cancel_timeout(fnv1a_hash("power-supply-off"));
   this->pin_->digital_write(true);
 
   if (this->active_requests_ == 0) {
@@ -77,7 +77,7 @@ void PowerSupplyComponent::unrequest_high_power() {
 
   if (this->active_requests_ == 0) {
     // set timeout for power supply off
-    this->set_timeout("power-supply-off", this->keep_on_time_, [this](){
+    this->set_timeout(fnv1a_hash("power-supply-off"), this->keep_on_time_, [this](){
       ESP_LOGI(TAG, "Disabling power supply.");
       this->pin_->digital_write(false);
       this->enabled_ = false;
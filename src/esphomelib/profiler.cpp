@@ -0,0 +1,104 @@
+#include "esphomelib/profiler.h"
+
+#ifdef USE_COMPONENT_PROFILER
+
+#include <algorithm>
+#include <cstring>
+#include <Esp.h>
+#include "esphomelib/esphal.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+ProfileStats::Start ProfileStats::start() {
+  return Start{
+      .cycles = ESP.getCycleCount(),
+      .micros = micros(),
+  };
+}
+void ProfileStats::record(const Start &start) {
+  const uint32_t cycles = ESP.getCycleCount() - start.cycles;
+  uint32_t duration = micros() - start.micros;
+  // The cycle counter overflows every few seconds (17s at 240MHz), only use it for short calls.
+  if (duration < 1000000)
+    duration = cycles / ESP.getCpuFreqMHz();
+  this->add(duration);
+}
+ProfileStats::ProfileStats(const ProfileStats &other) {
+  *this = other;
+}
+ProfileStats &ProfileStats::operator=(const ProfileStats &other) {
+  this->count = other.count;
+  this->min = other.min;
+  this->max = other.max;
+  this->total = other.total;
+  memcpy(this->histogram, other.histogram, sizeof(this->histogram));
+  return *this;
+}
+void ProfileStats::add(uint32_t duration) {
+  const uint32_t version = this->version_.load(std::memory_order_relaxed);
+  this->version_.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  this->count++;
+  this->min = std::min(this->min, duration);
+  this->max = std::max(this->max, duration);
+  this->total += duration;
+
+  uint8_t bucket = 0;
+  while (bucket + 1 < HISTOGRAM_SIZE && (duration >> (bucket + 1)) != 0)
+    bucket++;
+  if (this->histogram[bucket] != UINT16_MAX)
+    this->histogram[bucket]++;
+
+  this->version_.store(version + 2, std::memory_order_release);
+}
+void ProfileStats::reset() {
+  const uint32_t version = this->version_.load(std::memory_order_relaxed);
+  this->version_.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  *this = ProfileStats();
+  this->version_.store(version + 2, std::memory_order_release);
+}
+bool ProfileStats::read(ProfileStats &out) const {
+  // The recording task only holds the statistics for a few instructions, but it can be preempted while doing so.
+  for (uint8_t attempt = 0; attempt < 3; attempt++) {
+    const uint32_t version = this->version_.load(std::memory_order_acquire);
+    if (version % 2 == 1)
+      continue;
+    out = *this;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->version_.load(std::memory_order_relaxed) == version)
+      return true;
+  }
+  return false;
+}
+float ProfileStats::get_average() const {
+  if (this->count == 0)
+    return 0.0f;
+  return this->total / float(this->count);
+}
+
+std::string extract_profile_type_name(const char *pretty_function) {
+  // GCC: "std::string esphomelib::profile_type_name() [with T = esphomelib::WiFiComponent; ...]"
+  const char *begin = strstr(pretty_function, "T = ");
+  if (begin == nullptr)
+    return "Component";
+  begin += 4;
+  const char *end = begin;
+  int depth = 0;
+  while (*end != '\0' && (depth != 0 || (*end != ';' && *end != ']'))) {
+    if (*end == '<')
+      depth++;
+    else if (*end == '>')
+      depth--;
+    else if (depth == 0 && *end == ':')
+      // strip namespaces
+      begin = end + 1;
+    end++;
+  }
+  return std::string(begin, end);
+}
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_COMPONENT_PROFILER
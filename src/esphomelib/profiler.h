@@ -0,0 +1,89 @@
+#ifndef ESPHOMELIB_PROFILER_H
+#define ESPHOMELIB_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "esphomelib/defines.h"
+
+#ifdef USE_COMPONENT_PROFILER
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+/** Run time statistics of one kind of call (setup_(), loop_() or time functions) of a component.
+ *
+ * Calls are timed with the CPU cycle counter and stored in µs. Besides min/avg/max a log2 histogram
+ * is kept: bucket i counts the calls that took [2^i, 2^(i+1)) µs, the last bucket also counts all longer calls.
+ *
+ * The statistics are recorded by the loop of the component's execution group. Other tasks (the web server,
+ * the loops of other execution groups) must only access them through read().
+ */
+struct ProfileStats {
+  static const uint8_t HISTOGRAM_SIZE = 20;
+
+  ProfileStats() = default;
+  /// Copy the statistics of other, only from the task recording them, see read().
+  ProfileStats(const ProfileStats &other);
+  ProfileStats &operator=(const ProfileStats &other);
+
+  /// Opaque start time of a measurement, see start().
+  struct Start {
+    uint32_t cycles;
+    uint32_t micros;
+  };
+
+  /// Start a measurement, pass the result to record() after the call has finished.
+  static Start start();
+
+  /// Finish a measurement started with start().
+  void record(const Start &start);
+
+  /// Add a call that took duration µs.
+  void add(uint32_t duration);
+
+  /// Forget all recorded calls, only from the task recording them.
+  void reset();
+
+  /** Copy the statistics into out from any task, also while they're being recorded.
+   *
+   * @return false if the statistics were changed during each of the attempts to copy them, then out may be
+   *         inconsistent and should be discarded (try again later).
+   */
+  bool read(ProfileStats &out) const;
+
+  /// The average duration in µs, 0 if nothing was recorded yet.
+  float get_average() const;
+
+  uint32_t count{0};
+  uint32_t min{UINT32_MAX};
+  uint32_t max{0};
+  uint64_t total{0};
+  uint16_t histogram[HISTOGRAM_SIZE]{}; ///< Saturates at UINT16_MAX.
+
+ protected:
+  /// Incremented before and after each change, odd while the statistics are being modified.
+  std::atomic<uint32_t> version_{0};
+};
+
+/// Profiling data of a single component, see Component::get_profile().
+struct ComponentProfile {
+  std::string name; ///< Name used in the reports, set by Application::register_component().
+  ProfileStats setup;
+  ProfileStats loop;
+  ProfileStats timers; ///< Interval/timeout/defer functions of this component.
+};
+
+/// Extract the plain type name of T from the __PRETTY_FUNCTION__ of profile_type_name<T>().
+std::string extract_profile_type_name(const char *pretty_function);
+
+/// Get the name of type T (without namespaces) without having to rely on RTTI.
+template<typename T>
+std::string profile_type_name() {
+  return extract_profile_type_name(__PRETTY_FUNCTION__);
+}
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_COMPONENT_PROFILER
+
+#endif //ESPHOMELIB_PROFILER_H
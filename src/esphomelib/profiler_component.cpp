@@ -0,0 +1,133 @@
+#include "esphomelib/profiler_component.h"
+
+#ifdef USE_COMPONENT_PROFILER
+
+#include "esphomelib/application.h"
+#include "esphomelib/log.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+static const char *TAG = "profiler";
+
+static void log_profile_stats(const char *kind, const ProfileStats &recorded) {
+  ProfileStats stats;
+  if (!recorded.read(stats)) {
+    ESP_LOGD(TAG, "    %s: busy", kind);
+    return;
+  }
+  if (stats.count == 0)
+    return;
+  ESP_LOGD(TAG, "    %s: count=%u min=%uµs avg=%.1fµs max=%uµs",
+           kind, stats.count, stats.min, stats.get_average(), stats.max);
+  if_verbose {
+    // histogram of the non-empty buckets, for example "[4µs: 120] [8µs: 3]"
+    std::string histogram;
+    char buffer[24];
+    for (uint8_t i = 0; i < ProfileStats::HISTOGRAM_SIZE; i++) {
+      if (stats.histogram[i] == 0)
+        continue;
+      snprintf(buffer, sizeof(buffer), " [%uµs: %u]", 1u << i, stats.histogram[i]);
+      histogram += buffer;
+    }
+    ESP_LOGV(TAG, "     %s", histogram.c_str());
+  }
+}
+
+static bool add_profile_stats(JsonObject &root, const char *kind, const ProfileStats &recorded) {
+  ProfileStats stats;
+  if (!recorded.read(stats))
+    return false;
+  if (stats.count == 0)
+    return true;
+  JsonObject &obj = root.createNestedObject(kind);
+  obj["count"] = stats.count;
+  obj["min"] = stats.min;
+  obj["avg"] = stats.get_average();
+  obj["max"] = stats.max;
+  // trailing empty buckets are left out
+  uint8_t size = ProfileStats::HISTOGRAM_SIZE;
+  while (size > 0 && stats.histogram[size - 1] == 0)
+    size--;
+  JsonArray &histogram = obj.createNestedArray("histogram");
+  for (uint8_t i = 0; i < size; i++)
+    histogram.add(stats.histogram[i]);
+  return true;
+}
+
+ProfilerComponent::ProfilerComponent(uint32_t update_interval)
+    : PollingComponent(update_interval) {
+
+}
+void ProfilerComponent::dump_log() {
+  ESP_LOGD(TAG, "Component profile:");
+  for (Component *component : App.get_components()) {
+    const ComponentProfile &profile = component->get_profile();
+    ESP_LOGD(TAG, "  %s:", profile.name.c_str());
+    log_profile_stats("setup", profile.setup);
+    log_profile_stats("loop", profile.loop);
+    log_profile_stats("timers", profile.timers);
+  }
+}
+void ProfilerComponent::reset() {
+  // The statistics are only written by the loop of each component's execution group, so reset them there.
+  for (ExecutionGroup group : {EXECUTION_GROUP_MAIN, EXECUTION_GROUP_SECONDARY}) {
+    const bool posted = App.post(group, [group]() {
+      for (Component *component : App.get_components()) {
+        if (component->get_execution_group() != group)
+          continue;
+        // keep the setup() time, it can't be measured again.
+        component->get_profile().loop.reset();
+        component->get_profile().timers.reset();
+      }
+    });
+    if (!posted)
+      ESP_LOGW(TAG, "Couldn't reset the profile of execution group %u, the event queue is full.", group);
+  }
+}
+void ProfilerComponent::update() {
+  this->dump_log();
+
+  if (mqtt::global_mqtt_client == nullptr || !mqtt::global_mqtt_client->is_connected())
+    return;
+  const std::string topic = mqtt::global_mqtt_client->get_topic_prefix() + "/profile";
+  for (Component *component : App.get_components()) {
+    const std::string json = build_profile_json(component->get_profile());
+    if (!json.empty())
+      mqtt::global_mqtt_client->publish(topic, json, 0, false);
+  }
+}
+float ProfilerComponent::get_setup_priority() const {
+  return setup_priority::LATE;
+}
+
+std::string build_profile_json(const ComponentProfile &profile) {
+  // The histograms don't fit into the static buffer of build_json().
+  DynamicJsonBuffer buffer;
+  JsonObject &root = buffer.createObject();
+  root["name"] = profile.name;
+  if (!add_profile_stats(root, "setup", profile.setup) || !add_profile_stats(root, "loop", profile.loop) ||
+      !add_profile_stats(root, "timers", profile.timers))
+    return "";
+
+  std::string json;
+  root.printTo(json);
+  return json;
+}
+std::string build_profile_json() {
+  // joined by hand so that only one component has to be in a JSON buffer at a time.
+  std::string json = "[";
+  for (Component *component : App.get_components()) {
+    const std::string component_json = build_profile_json(component->get_profile());
+    if (component_json.empty())
+      return "";
+    if (json.size() > 1)
+      json += ",";
+    json += component_json;
+  }
+  json += "]";
+  return json;
+}
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_COMPONENT_PROFILER
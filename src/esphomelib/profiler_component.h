@@ -0,0 +1,49 @@
+#ifndef ESPHOMELIB_PROFILER_COMPONENT_H
+#define ESPHOMELIB_PROFILER_COMPONENT_H
+
+#include <string>
+#include "esphomelib/component.h"
+#include "esphomelib/profiler.h"
+#include "esphomelib/defines.h"
+
+#ifdef USE_COMPONENT_PROFILER
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+/** Periodically reports how long the setup(), loop() and time functions of each component take.
+ *
+ * The data is collected by Application and Scheduler whenever USE_COMPONENT_PROFILER is defined,
+ * this component only reports it: Each update it logs a summary, and publishes one JSON message per
+ * component to "<topic_prefix>/profile" if MQTT is connected. The web server additionally serves the
+ * data of all components as a JSON array at "/profile".
+ */
+class ProfilerComponent : public PollingComponent {
+ public:
+  /// Construct the profiler component, reporting every update_interval ms (defaults to 60s).
+  explicit ProfilerComponent(uint32_t update_interval = 60000);
+
+  /// Log the profiling data of all components.
+  void dump_log();
+
+  /// Reset the profiling data of all components, done by the loop of each execution group.
+  void reset();
+
+  void update() override;
+  float get_setup_priority() const override;
+};
+
+/** Build the JSON object for the profiling data of a single component, from any task.
+ *
+ * @return The JSON, or an empty string if the data was being recorded during each attempt to read it
+ *         (see ProfileStats::read()).
+ */
+std::string build_profile_json(const ComponentProfile &profile);
+
+/// Build a JSON array with the profiling data of all components of App, empty if any of them couldn't be read.
+std::string build_profile_json();
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_COMPONENT_PROFILER
+
+#endif //ESPHOMELIB_PROFILER_COMPONENT_H
@@ -0,0 +1,220 @@
+#include "esphomelib/scheduler.h"
+
+#include <algorithm>
+
+#include "esphomelib/component.h"
+#include "esphomelib/esphal.h"
+#include "esphomelib/log.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+// Only used by verbose logs, const so that it isn't an unused variable with lower log levels.
+static const char *const TAG = "scheduler";
+
+/// Rebuild the heap once more than this many cancelled items are waiting in it.
+static const uint32_t MAX_LOGICALLY_DELETED_ITEMS = 10;
+
+void Scheduler::set_interval(Component *component, uint32_t name_id, uint32_t interval, time_func_t &&f) {
+  // only put offset in lower half
+  uint32_t offset = interval == 0 ? 0 : (random_uint32() % interval) / 2;
+  ESP_LOGV(TAG, "set_interval(name_id=0x%08X, interval=%u, offset=%u)", name_id, interval, offset);
+
+  this->cancel_interval(component, name_id);
+  // first execution happens right away, the offset only shifts the phase of the following ones.
+  this->push_(component, name_id, SchedulerItem::INTERVAL, interval, this->millis_() - offset, std::move(f));
+}
+void Scheduler::set_interval(Component *component, uint32_t name_id, uint32_t interval, uint32_t phase,
+                             time_func_t &&f) {
+  if (interval != 0)
+    phase %= interval;
+  ESP_LOGV(TAG, "set_interval(name_id=0x%08X, interval=%u, phase=%u)", name_id, interval, phase);
+
+  this->cancel_interval(component, name_id);
+  // the last time with the phase, so that this runs right away and the following ones are in phase.
+  const uint64_t now = this->millis_();
+  const uint64_t since_boot = now - (uint64_t(1) << 32);
+  const uint64_t first = interval == 0 ? now : now - (since_boot + interval - phase) % interval;
+  this->push_(component, name_id, SchedulerItem::INTERVAL, interval, first, std::move(f));
+}
+bool Scheduler::cancel_interval(Component *component, uint32_t name_id) {
+  return this->cancel_(component, name_id, SchedulerItem::INTERVAL);
+}
+void Scheduler::set_timeout(Component *component, uint32_t name_id, uint32_t timeout, time_func_t &&f) {
+  ESP_LOGV(TAG, "set_timeout(name_id=0x%08X, timeout=%u)", name_id, timeout);
+
+  this->cancel_timeout(component, name_id);
+  this->push_(component, name_id, SchedulerItem::TIMEOUT, timeout, this->millis_() + timeout, std::move(f));
+}
+bool Scheduler::cancel_timeout(Component *component, uint32_t name_id) {
+  return this->cancel_(component, name_id, SchedulerItem::TIMEOUT);
+}
+void Scheduler::defer(Component *component, uint32_t name_id, time_func_t &&f) {
+  this->cancel_defer(component, name_id);
+  this->push_(component, name_id, SchedulerItem::DEFER, 0, this->millis_(), std::move(f));
+}
+bool Scheduler::cancel_defer(Component *component, uint32_t name_id) {
+  return this->cancel_(component, name_id, SchedulerItem::DEFER);
+}
+
+void Scheduler::call() {
+  this->process_to_add_();
+  if (this->to_remove_ > MAX_LOGICALLY_DELETED_ITEMS) {
+    auto removed = std::partition(this->items_.begin(), this->items_.end(),
+                                  [](const std::unique_ptr<SchedulerItem> &item) {
+                                    return !item->remove;
+                                  });
+    for (auto it = removed; it != this->items_.end(); it++)
+      this->recycle_(std::move(*it));
+    this->items_.erase(removed, this->items_.end());
+    std::make_heap(this->items_.begin(), this->items_.end(), SchedulerItem::cmp);
+    this->to_remove_ = 0;
+  }
+
+  const uint64_t now = this->millis_();
+  while (true) {
+    this->cleanup_();
+    if (this->items_.empty())
+      break;
+
+    SchedulerItem *item = this->items_.front().get();
+    if (item->next_execution > now)
+      // Nothing else is due, the heap is ordered by next_execution.
+      break;
+
+    if (item->component != nullptr && item->component->is_failed()) {
+      this->pop_();
+      continue;
+    }
+
+    if_very_verbose {
+      const char *type = item->type == SchedulerItem::INTERVAL ? "interval" :
+                         (item->type == SchedulerItem::TIMEOUT ? "timeout" : "defer");
+      ESP_LOGVV(TAG, "Running %s 0x%08X with interval=%u (now=%u)",
+                type, item->name_id, item->interval, uint32_t(now));
+      (void) type;
+    }
+
+    // Callbacks can only append to to_add_ and set remove flags, so item stays at the top of the heap.
+#ifdef USE_COMPONENT_PROFILER
+    const ProfileStats::Start start = ProfileStats::start();
+    item->f();
+    if (item->component != nullptr)
+      item->component->get_profile().timers.record(start);
+#else
+    item->f();
+#endif
+
+    std::pop_heap(this->items_.begin(), this->items_.end(), SchedulerItem::cmp);
+    std::unique_ptr<SchedulerItem> done = std::move(this->items_.back());
+    this->items_.pop_back();
+    if (item->remove) {
+      this->to_remove_--;
+      this->recycle_(std::move(done));
+    } else if (item->type == SchedulerItem::INTERVAL) {
+      if (item->interval != 0) {
+        const uint64_t amount = (now - item->next_execution) / item->interval + 1;
+        item->next_execution += amount * item->interval;
+      }
+      // Re-insert on the next call() so that an interval of 0 runs once per loop.
+      this->to_add_.push_back(std::move(done));
+    } else {
+      this->recycle_(std::move(done));
+    }
+  }
+}
+
+uint32_t Scheduler::next_schedule_in() {
+  if (!this->to_add_.empty())
+    // new items (like defers) might be due right away.
+    return 0;
+  this->cleanup_();
+  if (this->items_.empty())
+    return UINT32_MAX;
+
+  const uint64_t now = this->millis_();
+  const uint64_t next_execution = this->items_.front()->next_execution;
+  if (next_execution <= now)
+    return 0;
+  return uint32_t(std::min<uint64_t>(next_execution - now, UINT32_MAX));
+}
+
+void Scheduler::push_(Component *component, uint32_t name_id, SchedulerItem::Type type, uint32_t interval,
+                      uint64_t next_execution, time_func_t &&f) {
+  std::unique_ptr<SchedulerItem> item;
+  if (this->free_items_.empty()) {
+    item = make_unique<SchedulerItem>();
+  } else {
+    item = std::move(this->free_items_.back());
+    this->free_items_.pop_back();
+  }
+  item->component = component;
+  item->name_id = name_id;
+  item->type = type;
+  item->interval = interval;
+  item->next_execution = next_execution;
+  item->f = std::move(f);
+  item->remove = false;
+  this->to_add_.push_back(std::move(item));
+}
+bool Scheduler::cancel_(Component *component, uint32_t name_id, SchedulerItem::Type type) {
+  if (name_id == 0)
+    return false;
+  for (auto &item : this->items_) {
+    if (!item->remove && item->component == component && item->type == type && item->name_id == name_id) {
+      ESP_LOGV(TAG, "Removing old time function 0x%08X.", name_id);
+      item->remove = true;
+      this->to_remove_++;
+      return true;
+    }
+  }
+  for (auto &item : this->to_add_) {
+    if (!item->remove && item->component == component && item->type == type && item->name_id == name_id) {
+      ESP_LOGV(TAG, "Removing old time function 0x%08X.", name_id);
+      item->remove = true;
+      return true;
+    }
+  }
+  return false;
+}
+void Scheduler::process_to_add_() {
+  for (auto &item : this->to_add_) {
+    if (item->remove) {
+      this->recycle_(std::move(item));
+      continue;
+    }
+    this->items_.push_back(std::move(item));
+    std::push_heap(this->items_.begin(), this->items_.end(), SchedulerItem::cmp);
+  }
+  this->to_add_.clear();
+}
+void Scheduler::cleanup_() {
+  while (!this->items_.empty() && this->items_.front()->remove) {
+    this->pop_();
+    this->to_remove_--;
+  }
+}
+void Scheduler::pop_() {
+  std::pop_heap(this->items_.begin(), this->items_.end(), SchedulerItem::cmp);
+  this->recycle_(std::move(this->items_.back()));
+  this->items_.pop_back();
+}
+void Scheduler::recycle_(std::unique_ptr<SchedulerItem> &&item) {
+  // Release the captures now, the item itself is kept around for the next push_().
+  item->f = nullptr;
+  this->free_items_.push_back(std::move(item));
+}
+uint64_t Scheduler::millis_() {
+  const uint32_t now = millis();
+  if (now < this->last_millis_)
+    this->millis_major_++;
+  this->last_millis_ = now;
+  return (uint64_t(this->millis_major_) << 32) | now;
+}
+
+bool Scheduler::SchedulerItem::cmp(const std::unique_ptr<SchedulerItem> &a,
+                                   const std::unique_ptr<SchedulerItem> &b) {
+  // std::*_heap builds a max-heap, invert the comparison to get the earliest item at the front.
+  return a->next_execution > b->next_execution;
+}
+
+ESPHOMELIB_NAMESPACE_END
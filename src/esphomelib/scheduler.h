@@ -0,0 +1,105 @@
+#ifndef ESPHOMELIB_SCHEDULER_H
+#define ESPHOMELIB_SCHEDULER_H
+
+#include <memory>
+#include <vector>
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+class Component;
+
+/** Storage for the interval/timeout/defer functions of the components in one execution group.
+ *
+ * All time functions of those components are kept in a single min-heap keyed on their next
+ * execution time. A call to call() therefore only has to look at the top of the heap when
+ * nothing is due, instead of walking the time functions of every component each loop.
+ *
+ * Functions are identified by an integer name id (see fnv1a_hash()) and stored in an InlineFunction,
+ * and finished items are recycled, so after warm-up scheduling and cancelling don't allocate.
+ *
+ * Components should not use this class directly, but rather Component::set_interval() and
+ * friends which forward to the scheduler of their loop, see Application::get_loop().
+ */
+class Scheduler {
+ public:
+  /// Simple typedef for interval/timeout functions
+  using time_func_t = InlineFunction<void()>;
+
+  /** Schedule f every interval ms for component. Replaces an existing interval of component
+   * with the same name id. A name id of 0 means no cancelling possible.
+   *
+   * @param component The component this function belongs to.
+   * @param name_id The identifier for this interval function, for example fnv1a_hash("update").
+   * @param interval The interval in ms.
+   * @param f The function (or lambda) that should be called
+   */
+  void set_interval(Component *component, uint32_t name_id, uint32_t interval, time_func_t &&f);
+  /** Like set_interval(), but with a fixed phase instead of a random offset: f runs at the times
+   * that are phase ms after a multiple of interval (since boot). The first call is right away.
+   */
+  void set_interval(Component *component, uint32_t name_id, uint32_t interval, uint32_t phase, time_func_t &&f);
+  /// Cancel an interval function of component, returns whether a function was cancelled.
+  bool cancel_interval(Component *component, uint32_t name_id);
+
+  /// Schedule f once after timeout ms for component. See set_interval() for name_id semantics.
+  void set_timeout(Component *component, uint32_t name_id, uint32_t timeout, time_func_t &&f);
+  /// Cancel a timeout function of component, returns whether a function was cancelled.
+  bool cancel_timeout(Component *component, uint32_t name_id);
+
+  /// Call f in the next call() invocation. See set_interval() for name_id semantics.
+  void defer(Component *component, uint32_t name_id, time_func_t &&f);
+  /// Cancel a defer function of component, returns whether a function was cancelled.
+  bool cancel_defer(Component *component, uint32_t name_id);
+
+  /// Run all time functions that are due. Call this once per Application::loop().
+  void call();
+
+  /// The time in ms until the next time function is due, 0 if one is due now or UINT32_MAX if none is scheduled.
+  uint32_t next_schedule_in();
+
+ protected:
+  /// Internal struct for storing timeout/interval/defer functions.
+  struct SchedulerItem {
+    Component *component; ///< The component that owns this function.
+    uint32_t name_id; ///< The name id of this item, 0 for none.
+    enum Type { TIMEOUT, INTERVAL, DEFER } type; ///< The type of this item.
+    uint32_t interval; ///< The interval/timeout of this function.
+    uint64_t next_execution; ///< When this function should run next, in extended millis_() time.
+    time_func_t f; ///< The function (or callback) itself.
+    bool remove; ///< Whether this item has been cancelled and should be discarded.
+
+    /// Heap comparator, returns true if a should run after b.
+    static bool cmp(const std::unique_ptr<SchedulerItem> &a, const std::unique_ptr<SchedulerItem> &b);
+  };
+
+  void push_(Component *component, uint32_t name_id, SchedulerItem::Type type, uint32_t interval,
+             uint64_t next_execution, time_func_t &&f);
+  bool cancel_(Component *component, uint32_t name_id, SchedulerItem::Type type);
+  /// Move all items from to_add_ into the heap.
+  void process_to_add_();
+  /// Drop cancelled items from the top of the heap.
+  void cleanup_();
+  void pop_();
+  /// Return a finished item to free_items_ so that it can be reused by push_().
+  void recycle_(std::unique_ptr<SchedulerItem> &&item);
+  /// millis() extended to 64 bits so that the heap order survives the 49 day roll-over.
+  uint64_t millis_();
+
+  /// Min-heap of scheduled items, ordered by next_execution.
+  std::vector<std::unique_ptr<SchedulerItem>> items_;
+  /// Items added since the last call(), so that callbacks can schedule new items safely.
+  std::vector<std::unique_ptr<SchedulerItem>> to_add_;
+  /// Finished items that can be reused without allocating.
+  std::vector<std::unique_ptr<SchedulerItem>> free_items_;
+  /// Number of cancelled items that are still in items_.
+  uint32_t to_remove_{0};
+  uint32_t last_millis_{0};
+  /// Starts at 1, so that times before boot (like the first execution of an interval with an offset) don't underflow.
+  uint32_t millis_major_{1};
+};
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //ESPHOMELIB_SCHEDULER_H
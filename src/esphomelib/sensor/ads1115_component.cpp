@@ -8,6 +8,8 @@
 
 #include "esphomelib/sensor/ads1115_component.h"
 
+#include <algorithm>
+
 #ifdef USE_ADS1115_SENSOR
 
 ESPHOMELIB_NAMESPACE_BEGIN
@@ -81,51 +83,70 @@ float ADS1115Component::get_setup_priority() const {
   return setup_priority::HARDWARE_LATE;
 }
 void ADS1115Component::request_measurement_(ADS1115Sensor *sensor) {
+  auto it = std::find(this->measurement_queue_.begin(), this->measurement_queue_.end(), sensor);
+  if (it == this->measurement_queue_.end())
+    this->measurement_queue_.push_back(sensor);
+  this->start_coroutine(&this->measure_coroutine_, [this](Coroutine &co) { return this->measure_(co); });
+}
+bool ADS1115Component::start_conversion_(ADS1115Sensor *sensor) {
   uint16_t config;
   if (!this->read_byte_16(ADS1115_REGISTER_CONFIG, &config))
-    return;
+    return false;
   config &= 0b0111000000111111;
   config |= (sensor->get_multiplexer() & 0b111) << 12;
   config |= (sensor->get_gain() & 0b111) << 9;
   // Start conversion
   config |= 0b1000000000000000;
-  if (!this->write_byte_16(ADS1115_REGISTER_CONFIG, config))
-    return;
+  return this->write_byte_16(ADS1115_REGISTER_CONFIG, config);
+}
+bool ADS1115Component::is_conversion_done_() {
+  uint16_t config;
+  return !this->read_byte_16(ADS1115_REGISTER_CONFIG, &config) || (config >> 15) != 0;
+}
+CoroutineResult ADS1115Component::measure_(Coroutine &co) {
+  CO_BEGIN(co);
+  // The ADC can only convert one channel at a time, so the sensors are measured one after another.
+  while (!this->measurement_queue_.empty()) {
+    if (!this->start_conversion_(this->measurement_queue_.front())) {
+      this->measurement_queue_.erase(this->measurement_queue_.begin());
+      continue;
+    }
 
-  // about 1.6 ms with 860 samples per second
-  delay(2);
+    // about 1.6 ms with 860 samples per second
+    CO_SLEEP(co, 2);
+    CO_WAIT_UNTIL(co, this->is_conversion_done_(), 1, 100);
 
-  uint32_t start = millis();
-  while (this->read_byte_16(ADS1115_REGISTER_CONFIG, &config) && (config >> 15) == 0) {
-    if (millis() - start > 100) {
+    ADS1115Sensor *measured = this->measurement_queue_.front();
+    this->measurement_queue_.erase(this->measurement_queue_.begin());
+    if (co.is_timed_out()) {
       ESP_LOGW(TAG, "Reading ADS1115 timed out");
-      return;
+      continue;
     }
-    yield();
-  }
 
-  uint16_t raw_conversion;
-  if (!this->read_byte_16(ADS1115_REGISTER_CONVERSION, &raw_conversion))
-    return;
-  auto signed_conversion = static_cast<int16_t>(raw_conversion);
-
-  float millivolts;
-  switch (sensor->get_gain()) {
-    case ADS1115_GAIN_6P144: millivolts = signed_conversion * 0.187500f; break;
-    case ADS1115_GAIN_4P096: millivolts = signed_conversion * 0.125000f; break;
-    case ADS1115_GAIN_2P048: millivolts = signed_conversion * 0.062500f; break;
-    case ADS1115_GAIN_1P024: millivolts = signed_conversion * 0.031250f; break;
-    case ADS1115_GAIN_0P512: millivolts = signed_conversion * 0.015625f; break;
-    case ADS1115_GAIN_0P256:
-    case ADS1115_GAIN_0P256B:
-    case ADS1115_GAIN_0P256C:
-      millivolts = signed_conversion * 0.007813f; break;
-    default: millivolts = NAN;
-  }
+    uint16_t raw_conversion;
+    if (!this->read_byte_16(ADS1115_REGISTER_CONVERSION, &raw_conversion))
+      continue;
+    auto signed_conversion = static_cast<int16_t>(raw_conversion);
+
+    float millivolts;
+    switch (measured->get_gain()) {
+      case ADS1115_GAIN_6P144: millivolts = signed_conversion * 0.187500f; break;
+      case ADS1115_GAIN_4P096: millivolts = signed_conversion * 0.125000f; break;
+      case ADS1115_GAIN_2P048: millivolts = signed_conversion * 0.062500f; break;
+      case ADS1115_GAIN_1P024: millivolts = signed_conversion * 0.031250f; break;
+      case ADS1115_GAIN_0P512: millivolts = signed_conversion * 0.015625f; break;
+      case ADS1115_GAIN_0P256:
+      case ADS1115_GAIN_0P256B:
+      case ADS1115_GAIN_0P256C:
+        millivolts = signed_conversion * 0.007813f; break;
+      default: millivolts = NAN;
+    }
 
-  float v = millivolts / 1000.0f;
-  ESP_LOGD(TAG, "Got Voltage=%fV", v);
-  sensor->push_new_value(v);
+    float v = millivolts / 1000.0f;
+    ESP_LOGD(TAG, "Got Voltage=%fV", v);
+    measured->push_new_value(v);
+  }
+  CO_END(co);
 }
 
 ADS1115Sensor *ADS1115Component::get_sensor(const std::string &name, ADS1115Multiplexer multiplexer, ADS1115Gain gain,
@@ -91,8 +91,16 @@ class ADS1115Component : public Component, public I2CDevice {
  protected:
   /// Helper method to request a measurement from a sensor.
   void request_measurement_(ADS1115Sensor *sensor);
+  /// Measure all sensors in measurement_queue_, sleeping while the ADC converts.
+  CoroutineResult measure_(Coroutine &co);
+  /// Configure the multiplexer and gain for sensor and start a single conversion.
+  bool start_conversion_(ADS1115Sensor *sensor);
+  /// Whether the ADC finished the current conversion (or can't be read).
+  bool is_conversion_done_();
 
   std::vector<ADS1115Sensor *> sensors_;
+  std::vector<ADS1115Sensor *> measurement_queue_; ///< The sensors waiting for a measurement, in order.
+  Coroutine measure_coroutine_;
 };
 
 /// Internal holder class that is in instance of Sensor so that the hub can create individual sensors.
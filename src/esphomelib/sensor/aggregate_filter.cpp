@@ -0,0 +1,135 @@
+#include "esphomelib/sensor/aggregate_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "esphomelib/esphal.h"
+
+#ifdef USE_SENSOR
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace sensor {
+
+float AggregateStats::get(AggregateField field) const {
+  switch (field) {
+    case AGGREGATE_MIN: return this->min;
+    case AGGREGATE_MAX: return this->max;
+    case AGGREGATE_MEAN: return this->mean;
+    case AGGREGATE_STDDEV: return this->stddev;
+    case AGGREGATE_COUNT: return this->count;
+    case AGGREGATE_LAST: return this->last;
+  }
+  return NAN;
+}
+std::string AggregateStats::to_json(int8_t accuracy_decimals) const {
+  char count[12];
+  snprintf(count, sizeof(count), "%u", unsigned(this->count));
+  return "{\"min\":" + value_accuracy_to_string(this->min, accuracy_decimals) +
+      ",\"max\":" + value_accuracy_to_string(this->max, accuracy_decimals) +
+      ",\"mean\":" + value_accuracy_to_string(this->mean, accuracy_decimals) +
+      ",\"stddev\":" + value_accuracy_to_string(this->stddev, accuracy_decimals) +
+      ",\"last\":" + value_accuracy_to_string(this->last, accuracy_decimals) +
+      ",\"count\":" + count + "}";
+}
+
+AggregateFilter::AggregateFilter(uint32_t period, Sensor *sensor)
+    : period_(period), sensor_(sensor) {
+
+}
+Optional<float> AggregateFilter::new_value(float value) {
+  return this->new_timed_value(value, millis());
+}
+Optional<float> AggregateFilter::new_timed_value(float value, uint32_t time) {
+  if (isnan(value))
+    return Optional<float>();
+
+  Optional<float> out;
+  if (!this->has_period_) {
+    this->has_period_ = true;
+    this->stats_.start = time;
+  } else if (time - this->stats_.start >= this->period_) {
+    this->stats_.mean = this->mean_;
+    this->stats_.stddev = sqrt(this->m2_ / this->stats_.count);
+    this->callback_.call(this->stats_);
+    out = this->stats_.get(this->output_);
+    this->start_period_(time);
+  }
+
+  // Welford's algorithm, numerically stable even for large offsets like temperatures in Kelvin.
+  const uint32_t count = ++this->stats_.count;
+  if (count == 1) {
+    this->stats_.min = this->stats_.max = value;
+    this->mean_ = value;
+    this->m2_ = 0.0;
+  } else {
+    this->stats_.min = std::min(this->stats_.min, value);
+    this->stats_.max = std::max(this->stats_.max, value);
+    const double delta = value - this->mean_;
+    this->mean_ += delta / count;
+    this->m2_ += delta * (value - this->mean_);
+  }
+  this->stats_.last = value;
+  this->stats_.last_time = time;
+  return out;
+}
+void AggregateFilter::start_period_(uint32_t time) {
+  // skip periods without values, but stay aligned to the first period
+  this->stats_.start += (time - this->stats_.start) / this->period_ * this->period_;
+  this->stats_.count = 0;
+}
+uint32_t AggregateFilter::expected_interval(uint32_t input) {
+  return std::max(input, this->period_);
+}
+void AggregateFilter::set_output(AggregateField output) {
+  this->output_ = output;
+}
+void AggregateFilter::add_on_aggregate_callback(aggregate_callback_t &&callback) {
+  this->callback_.add(std::move(callback));
+}
+AggregateSensor *AggregateFilter::make_sensor(const std::string &name, AggregateField field) {
+  auto *sensor = new AggregateSensor(name, this, field);
+  this->add_on_aggregate_callback([sensor](const AggregateStats &stats) {
+    sensor->push_new_value(stats.get(sensor->get_field()), stats.last_time);
+  });
+  return sensor;
+}
+uint32_t AggregateFilter::get_period() const {
+  return this->period_;
+}
+Sensor *AggregateFilter::get_sensor() const {
+  return this->sensor_;
+}
+
+AggregateSensor::AggregateSensor(const std::string &name, AggregateFilter *parent, AggregateField field)
+    : Sensor(name), parent_(parent), field_(field) {
+  this->clear_filters();
+}
+std::string AggregateSensor::unit_of_measurement() {
+  if (this->field_ == AGGREGATE_COUNT || this->parent_->get_sensor() == nullptr)
+    return "";
+  return this->parent_->get_sensor()->get_unit_of_measurement();
+}
+std::string AggregateSensor::icon() {
+  if (this->parent_->get_sensor() == nullptr)
+    return "";
+  return this->parent_->get_sensor()->get_icon();
+}
+int8_t AggregateSensor::accuracy_decimals() {
+  if (this->field_ == AGGREGATE_COUNT || this->parent_->get_sensor() == nullptr)
+    return 0;
+  return this->parent_->get_sensor()->get_accuracy_decimals();
+}
+uint32_t AggregateSensor::update_interval() {
+  return this->parent_->get_period();
+}
+AggregateField AggregateSensor::get_field() const {
+  return this->field_;
+}
+
+} // namespace sensor
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_SENSOR
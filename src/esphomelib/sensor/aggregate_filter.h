@@ -0,0 +1,139 @@
+#ifndef ESPHOMELIB_SENSOR_AGGREGATE_FILTER_H
+#define ESPHOMELIB_SENSOR_AGGREGATE_FILTER_H
+
+#include <cstdint>
+#include <string>
+#include "esphomelib/sensor/filter.h"
+#include "esphomelib/sensor/sensor.h"
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+#ifdef USE_SENSOR
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace sensor {
+
+/// The statistics an AggregateFilter computes for each period.
+enum AggregateField {
+  AGGREGATE_MIN = 0,
+  AGGREGATE_MAX,
+  AGGREGATE_MEAN,
+  AGGREGATE_STDDEV, ///< The population standard deviation.
+  AGGREGATE_COUNT,
+  AGGREGATE_LAST,
+};
+
+/// The statistics of the values in one period of an AggregateFilter.
+struct AggregateStats {
+  float min;
+  float max;
+  float mean;
+  float stddev; ///< The population standard deviation, 0 for a single value.
+  float last;
+  uint32_t count;
+  uint32_t start; ///< The millis() time at which the period started.
+  uint32_t last_time; ///< The millis() time of the last value in the period.
+
+  /// Get field as a float.
+  float get(AggregateField field) const;
+
+  /// Format the statistics as a JSON object, for example `{"min":20.1,"max":21.3,...,"count":60}`.
+  std::string to_json(int8_t accuracy_decimals) const;
+};
+
+using aggregate_callback_t = InlineFunction<void(const AggregateStats &)>;
+
+class AggregateSensor;
+
+/** Aggregate the values of each period of `period` ms into min, max, mean, standard deviation, count and
+ * last value, for sensors that sample fast but should only publish once per period.
+ *
+ * The statistics are computed incrementally (with Welford's algorithm for the standard deviation), so this
+ * needs constant memory and constant work per value. Periods are aligned to the first value, a period is
+ * complete once the first value of a later period arrives. Periods without values are skipped, NAN values
+ * are ignored.
+ *
+ * The filter itself pushes out one field (the mean by default, see set_output()) down the filter chain. The
+ * other fields can be published as their own sensors (make_sensor()) or with a callback, for example as a
+ * single JSON state:
+ *
+ * @code
+ * auto *aggregate = sensor->add_aggregate_filter(60000);
+ * App.register_sensor(aggregate->make_sensor("Temperature Max", sensor::AGGREGATE_MAX));
+ * aggregate->add_on_aggregate_callback([](const sensor::AggregateStats &stats) {
+ *   mqtt::global_mqtt_client->publish("livingroom/temperature/stats", stats.to_json(1), 0, false);
+ * });
+ * @endcode
+ */
+class AggregateFilter : public Filter {
+ public:
+  /** Construct an AggregateFilter.
+   *
+   * @param period The length of a period in ms.
+   * @param sensor The sensor this filter is applied to, sensors created with make_sensor() use its unit,
+   *               icon and accuracy. Can be nullptr.
+   */
+  explicit AggregateFilter(uint32_t period, Sensor *sensor = nullptr);
+
+  Optional<float> new_value(float value) override;
+  Optional<float> new_timed_value(float value, uint32_t time) override;
+
+  uint32_t expected_interval(uint32_t input) override;
+
+  /// Set the field that's pushed out down the filter chain, AGGREGATE_MEAN by default.
+  void set_output(AggregateField output);
+
+  /// Add a callback that's called with the statistics at the end of each period.
+  void add_on_aggregate_callback(aggregate_callback_t &&callback);
+
+  /** Create a sensor that publishes field at the end of each period, register it with
+   * Application::register_sensor() to publish it via MQTT.
+   *
+   * @param name The name of the sensor.
+   * @param field The field the sensor publishes.
+   */
+  AggregateSensor *make_sensor(const std::string &name, AggregateField field);
+
+  uint32_t get_period() const;
+  Sensor *get_sensor() const;
+
+ protected:
+  /// Start a new period at the period boundary before time.
+  void start_period_(uint32_t time);
+
+  uint32_t period_;
+  Sensor *sensor_;
+  AggregateField output_{AGGREGATE_MEAN};
+  bool has_period_{false};
+  AggregateStats stats_{};
+  double mean_{0.0}; ///< The running mean, kept in double precision like m2_.
+  double m2_{0.0}; ///< Sum of squared differences from the mean (Welford).
+  CallbackManager<void(const AggregateStats &)> callback_{};
+};
+
+/// A sensor publishing one field of an AggregateFilter, see AggregateFilter::make_sensor().
+class AggregateSensor : public Sensor {
+ public:
+  /// Construct the sensor, the default filters are removed as the values are aggregated already.
+  AggregateSensor(const std::string &name, AggregateFilter *parent, AggregateField field);
+
+  std::string unit_of_measurement() override;
+  std::string icon() override;
+  int8_t accuracy_decimals() override;
+  uint32_t update_interval() override;
+
+  AggregateField get_field() const;
+
+ protected:
+  AggregateFilter *parent_;
+  AggregateField field_;
+};
+
+} // namespace sensor
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_SENSOR
+
+#endif //ESPHOMELIB_SENSOR_AGGREGATE_FILTER_H
@@ -29,6 +29,8 @@ BH1750Sensor::BH1750Sensor(I2CComponent *parent, const std::string &name,
 
 void BH1750Sensor::setup() {
   ESP_LOGCONFIG(TAG, "Setting up BS1750...");
+  // the measurement request, the conversion and the read after it
+  this->set_polling_bus(this->parent_, this->conversion_time_() + 1);
   if (!this->write_bytes(BH1750_COMMAND_POWER_ON, nullptr, 0)) {
     ESP_LOGE(TAG, "Communication with BH1750 failed!");
     this->mark_failed();
@@ -47,23 +49,22 @@ void BH1750Sensor::setup() {
   }
 }
 
-void BH1750Sensor::update() {
-  if (!this->write_bytes(this->resolution_, nullptr, 0))
-    return;
-
-  uint32_t wait = 0;
+uint32_t BH1750Sensor::conversion_time_() const {
   // use max conversion times
   switch (this->resolution_) {
+    case BH1750_RESOLUTION_4P0_LX:
+      return 24;
     case BH1750_RESOLUTION_0P5_LX:
     case BH1750_RESOLUTION_1P0_LX:
-      wait = 180;
-      break;
-    case BH1750_RESOLUTION_4P0_LX:
-      wait = 24;
-      break;
+    default:
+      return 180;
   }
+}
+void BH1750Sensor::update() {
+  if (!this->write_bytes(this->resolution_, nullptr, 0))
+    return;
 
-  this->set_timeout("illuminance", wait, [this]() {
+  this->set_timeout(fnv1a_hash("illuminance"), this->conversion_time_(), [this]() {
     this->read_data_();
   });
 }
@@ -54,6 +54,8 @@ class BH1750Sensor : public PollingSensorComponent, public I2CDevice {
   int8_t accuracy_decimals() override;
 
  protected:
+  /// The maximum conversion time in ms with the configured resolution.
+  uint32_t conversion_time_() const;
   void read_data_();
 
   BH1750Resolution resolution_{BH1750_RESOLUTION_0P5_LX};
@@ -93,6 +93,8 @@ static const char* iir_filter_to_str(BME280IIRFilter filter) {
 
 void BME280Component::setup() {
   ESP_LOGCONFIG(TAG, "Setting up BME280...");
+  // the conversion request, the measurement and the data read (~2ms) after it
+  this->set_polling_bus(this->parent_, this->measurement_time_() + 2);
   uint8_t chip_id;
   if (!this->read_byte(BME280_REGISTER_CHIPID, &chip_id) || chip_id != 0x60) {
     ESP_LOGE(TAG, "Communication with BME280 failed!");
@@ -148,6 +150,13 @@ inline uint8_t oversampling_to_time(BME280Oversampling over_sampling) {
   return (1 << uint8_t(over_sampling)) >> 1;
 }
 
+uint32_t BME280Component::measurement_time_() const {
+  float meas_time = 1;
+  meas_time += 2.3f * oversampling_to_time(this->temperature_oversampling_);
+  meas_time += 2.3f * oversampling_to_time(this->pressure_oversampling_) + 0.575f;
+  meas_time += 2.3f * oversampling_to_time(this->humidity_oversampling_) + 0.575f;
+  return uint32_t(ceilf(meas_time));
+}
 void BME280Component::update() {
   // Enable sensor
   ESP_LOGV(TAG, "Sending conversion request...");
@@ -157,12 +166,7 @@ void BME280Component::update() {
   meas_register |= 0b01; // Forced mode
   this->write_byte(BME280_REGISTER_CONTROL, meas_register);
 
-  float meas_time = 1;
-  meas_time += 2.3f * oversampling_to_time(this->temperature_oversampling_);
-  meas_time += 2.3f * oversampling_to_time(this->pressure_oversampling_) + 0.575f;
-  meas_time += 2.3f * oversampling_to_time(this->humidity_oversampling_) + 0.575f;
-
-  this->set_timeout("data", uint32_t(ceilf(meas_time)), [this]() {
+  this->set_timeout(fnv1a_hash("data"), this->measurement_time_(), [this]() {
     int32_t t_fine = 0;
     float temperature = this->read_temperature_(&t_fine);
     if (isnan(temperature)) {
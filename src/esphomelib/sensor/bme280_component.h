@@ -101,6 +101,8 @@ class BME280Component : public PollingComponent, public I2CDevice {
   void update() override;
 
  protected:
+  /// How long (in ms) a forced measurement with the configured oversampling takes.
+  uint32_t measurement_time_() const;
   /// Read the temperature value and store the calculated ambient temperature in t_fine.
   float read_temperature_(int32_t *t_fine);
   /// Read the pressure value in hPa using the provided t_fine value.
@@ -76,6 +76,8 @@ static const char* iir_filter_to_str(BME680IIRFilter filter) {
 
 void BME680Component::setup() {
   ESP_LOGCONFIG(TAG, "Setting up BME680...");
+  // the measurement request, the measurement (with heating) and the data read after it
+  this->set_polling_bus(this->parent_, this->calc_meas_duration_() + 3);
   uint8_t chip_id;
   if (!this->read_byte(BME680_REGISTER_CHIPID, &chip_id) || chip_id != 0x61) {
     ESP_LOGE(TAG, "Communication with BME680 failed!");
@@ -187,7 +189,7 @@ void BME680Component::update() {
   meas_control |= 0b01; // forced mode
   this->write_byte(BME680_REGISTER_CONTROL_MEAS, meas_control);
 
-  this->set_timeout("data", this->calc_meas_duration_(), [this]() {
+  this->set_timeout(fnv1a_hash("data"), this->calc_meas_duration_(), [this]() {
     this->read_data_();
   });
 }
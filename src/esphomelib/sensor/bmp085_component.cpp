@@ -27,15 +27,19 @@ static const uint8_t BMP085_REGISTER_CONTROL = 0xF4;
 static const uint8_t BMP085_REGISTER_DATA_MSB  = 0xF6;
 static const uint8_t BMP085_CONTROL_MODE_TEMPERATURE = 0x2E;
 static const uint8_t BMP085_CONTROL_MODE_PRESSURE_3 = 0xF4;
+static const uint32_t BMP085_TEMPERATURE_TIME = 5; ///< Conversion time of the temperature in ms.
+static const uint32_t BMP085_PRESSURE_TIME = 26; ///< Conversion time of the pressure (oversampling 3) in ms.
 
 void BMP085Component::update() {
   if (!this->set_mode_(BMP085_CONTROL_MODE_TEMPERATURE))
     return;
 
-  this->set_timeout("temperature", 5, [this]() { this->read_temperature_(); });
+  this->set_timeout(fnv1a_hash("temperature"), BMP085_TEMPERATURE_TIME, [this]() { this->read_temperature_(); });
 }
 void BMP085Component::setup() {
   ESP_LOGCONFIG(TAG, "Setting up BMP085...");
+  // the temperature conversion, the pressure conversion and the reads (~1ms each) after them
+  this->set_polling_bus(this->parent_, BMP085_TEMPERATURE_TIME + BMP085_PRESSURE_TIME + 2);
   uint8_t data[22];
   if (!this->read_bytes(BMP085_REGISTER_AC1_H, data, 22)) {
     ESP_LOGE(TAG, "Connection to BMP085 failed.");
@@ -86,7 +90,7 @@ void BMP085Component::read_temperature_() {
   if (!this->set_mode_(BMP085_CONTROL_MODE_PRESSURE_3))
     return;
 
-  this->set_timeout("pressure", 26, [this]() { this->read_pressure_(); });
+  this->set_timeout(fnv1a_hash("pressure"), BMP085_PRESSURE_TIME, [this]() { this->read_pressure_(); });
 }
 void BMP085Component::read_pressure_() {
   uint8_t buffer[3];
@@ -6,6 +6,7 @@
 
 #include "esphomelib/sensor/dallas_component.h"
 
+#include <algorithm>
 #include "esphomelib/helpers.h"
 #include "esphomelib/log.h"
 
@@ -25,6 +26,10 @@ static const uint8_t DALLAS_MODEL_DS28EA00 = 0x42;
 static const uint8_t DALLAS_COMMAND_START_CONVERSION = 0x44;
 static const uint8_t DALLAS_COMMAND_READ_SCRATCH_PAD = 0xBE;
 static const uint8_t DALLAS_COMMAND_WRITE_SCRATCH_PAD = 0x4E;
+/// The reset and skip + start conversion commands of update(), in ms.
+static const uint32_t DALLAS_START_TIME = 2;
+/// Reading the scratch pad of one sensor: reset, match ROM, read command and 9 bytes (~150 slots of ~70µs), in ms.
+static const uint32_t DALLAS_READ_TIME = 11;
 
 uint16_t DallasTemperatureSensor::millis_to_wait_for_conversion_() const {
   switch (this->resolution_) {
@@ -40,6 +45,12 @@ void DallasComponent::set_one_wire(ESPOneWire *one_wire) {
 }
 void DallasComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up DallasComponent...");
+  // reset and start conversion, the scratch pads are read one after another once the slowest conversion is done
+  uint32_t conversion_time = 0;
+  for (auto *sensor : this->sensors_)
+    conversion_time = std::max<uint32_t>(conversion_time, sensor->millis_to_wait_for_conversion_());
+  this->set_polling_bus(this->one_wire_,
+                        DALLAS_START_TIME + conversion_time + this->sensors_.size() * DALLAS_READ_TIME);
   ESP_LOGCONFIG(TAG, "    Want device count: %u", this->sensors_.size());
 
   yield();
@@ -117,7 +128,10 @@ void DallasComponent::update() {
   }
 
   for (auto *sensor : this->sensors_) {
-    this->set_timeout(sensor->get_address_name(), sensor->millis_to_wait_for_conversion_(), [sensor] {
+    // fold the 64-bit address into the timeout id, so that no address string has to be built each update.
+    const uint64_t address = sensor->get_address();
+    const auto name_id = uint32_t(address ^ (address >> 32));
+    this->set_timeout(name_id, sensor->millis_to_wait_for_conversion_(), [sensor] {
       disable_interrupts();
       bool res = sensor->read_scratch_pad_();
       enable_interrupts();
@@ -51,6 +51,7 @@ void DHT12Component::update() {
 }
 void DHT12Component::setup() {
   ESP_LOGD(TAG, "Setting up DHT12...");
+  this->set_polling_bus(this->parent_, 1);
   uint8_t data[5];
   if (!this->read_data_(data)) {
     ESP_LOGE(TAG, "Communication with DHT12 on 0x%02X failed!", this->address_);
@@ -44,6 +44,17 @@ void DHTComponent::setup() {
 }
 
 void DHTComponent::update() {
+  this->start_coroutine(&this->update_coroutine_, [this](Coroutine &co) { return this->read_(co); });
+}
+CoroutineResult DHTComponent::read_(Coroutine &co) {
+  CO_BEGIN(co);
+  if (this->model_ == DHT_MODEL_DHT11) {
+    // The DHT11 start signal is 18ms long, let the other components run meanwhile.
+    this->pin_->digital_write(false);
+    this->pin_->pin_mode(OUTPUT);
+    CO_SLEEP(co, 18);
+  }
+
   float temperature, humidity;
   this->read_sensor_safe_(&temperature, &humidity);
 
@@ -55,6 +66,7 @@ void DHTComponent::update() {
   } else {
     ESP_LOGW(TAG, "Invalid readings!");
   }
+  CO_END(co);
 }
 
 float DHTComponent::get_setup_priority() const {
@@ -73,13 +85,12 @@ uint8_t DHTComponent::read_sensor_(float *temperature, float *humidity) {
   *humidity = NAN;
   *temperature = NAN;
 
-  this->pin_->digital_write(false);
-  this->pin_->pin_mode(OUTPUT);
-
-  if (this->model_ == DHT_MODEL_DHT11)
-    delay(18);
-  else
+  if (this->model_ != DHT_MODEL_DHT11) {
+    // The DHT11 start signal is sent by read_() before.
+    this->pin_->digital_write(false);
+    this->pin_->pin_mode(OUTPUT);
     delayMicroseconds(800);
+  }
 
   this->pin_->pin_mode(INPUT);
   this->pin_->digital_write(true);
@@ -63,6 +63,9 @@ class DHTComponent : public PollingComponent {
   float get_setup_priority() const override;
 
  protected:
+  /// Send the start signal without blocking for the DHT11 and read the sensor.
+  CoroutineResult read_(Coroutine &co);
+  /// Read the sensor, for the DHT11 the start signal must have been sent already.
   uint8_t read_sensor_(float *temperature, float *humidity);
   uint8_t read_sensor_safe_(float *temperature, float *humidity);
 
@@ -70,6 +73,7 @@ class DHTComponent : public PollingComponent {
   DHTModel model_{DHT_MODEL_AUTO_DETECT};
   DHTTemperatureSensor *temperature_sensor_;
   DHTHumiditySensor *humidity_sensor_;
+  Coroutine update_coroutine_;
 };
 
 } // namespace sensor
@@ -4,6 +4,8 @@
 
 #include "esphomelib/sensor/filter.h"
 
+#include <algorithm>
+
 #include "esphomelib/log.h"
 #include "esphomelib/espmath.h"
 
@@ -13,9 +15,12 @@ ESPHOMELIB_NAMESPACE_BEGIN
 
 namespace sensor {
 
+// Only used by verbose logs, const so that it isn't an unused variable with lower log levels.
+static const char *const TAG = "sensor.filter";
+
 SlidingWindowMovingAverageFilter::SlidingWindowMovingAverageFilter(size_t window_size, size_t send_every)
-    : send_every_(send_every), send_at_(send_every - 1),
-      value_average_(SlidingWindowMovingAverage<float>(window_size)) {
+    : value_average_(window_size),
+      send_every_(send_every), send_at_(send_every - 1) {
 
 }
 size_t SlidingWindowMovingAverageFilter::get_send_every() const {
@@ -31,7 +36,14 @@ void SlidingWindowMovingAverageFilter::set_window_size(size_t window_size) {
   this->value_average_.set_max_size(window_size);
 }
 Optional<float> SlidingWindowMovingAverageFilter::new_value(float value) {
+#ifdef USE_FIXED_POINT_FILTERS
+  if (isnan(value))
+    return Optional<float>();
+  const int32_t raw = this->value_average_.next_value(Fixed16::from_float(value).raw());
+  float average_value = Fixed16::from_raw(raw).to_float();
+#else
   float average_value = this->value_average_.next_value(value);
+#endif
 
   if (++this->send_at_ >= this->send_every_) {
     this->send_at_ = 0;
@@ -44,12 +56,17 @@ uint32_t SlidingWindowMovingAverageFilter::expected_interval(uint32_t input) {
 }
 
 ExponentialMovingAverageFilter::ExponentialMovingAverageFilter(float alpha, size_t send_every)
-    : send_every_(send_every), send_at_(send_every - 1),
-      value_average_(ExponentialMovingAverage(alpha)),
-      accuracy_average_(ExponentialMovingAverage(alpha)) {
+    : value_average_(alpha),
+      send_every_(send_every), send_at_(send_every - 1) {
 }
 Optional<float> ExponentialMovingAverageFilter::new_value(float value) {
+#ifdef USE_FIXED_POINT_FILTERS
+  if (isnan(value))
+    return Optional<float>();
+  float average_value = this->value_average_.next_value(Fixed16::from_float(value)).to_float();
+#else
   float average_value = this->value_average_.next_value(value);
+#endif
 
   if (++this->send_at_ >= this->send_every_) {
     this->send_at_ = 0;
@@ -68,7 +85,6 @@ float ExponentialMovingAverageFilter::get_alpha() const {
 }
 void ExponentialMovingAverageFilter::set_alpha(float alpha) {
   this->value_average_.set_alpha(alpha);
-  this->accuracy_average_.set_alpha(alpha);
 }
 uint32_t ExponentialMovingAverageFilter::expected_interval(uint32_t input) {
   return input * this->send_every_;
@@ -90,6 +106,12 @@ Optional<float> LambdaFilter::new_value(float value) {
 Optional<float> OffsetFilter::new_value(float value) {
   return value + this->offset_;
 }
+size_t OffsetFilter::new_values(float *values, uint32_t * /*times*/, size_t count) {
+  const float offset = this->offset_;
+  for (size_t i = 0; i < count; i++)
+    values[i] += offset;
+  return count;
+}
 
 OffsetFilter::OffsetFilter(float offset)
     : offset_(offset) { }
@@ -100,6 +122,12 @@ MultiplyFilter::MultiplyFilter(float multiplier)
 Optional<float> MultiplyFilter::new_value(float value) {
   return value * this->multiplier_;
 }
+size_t MultiplyFilter::new_values(float *values, uint32_t * /*times*/, size_t count) {
+  const float multiplier = this->multiplier_;
+  for (size_t i = 0; i < count; i++)
+    values[i] *= multiplier;
+  return count;
+}
 
 FilterOutValueFilter::FilterOutValueFilter(float value_to_filter_out)
     : value_to_filter_out_(value_to_filter_out) {
@@ -110,16 +138,50 @@ Optional<float> FilterOutValueFilter::new_value(float value) {
     return Optional<float>();
   return value;
 }
+size_t FilterOutValueFilter::new_values(float *values, uint32_t *times, size_t count) {
+  size_t out = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (values[i] != this->value_to_filter_out_) {
+      values[out] = values[i];
+      times[out++] = times[i];
+    }
+  }
+  return out;
+}
 
 Optional<float> FilterOutNANFilter::new_value(float value) {
   if (isnan(value))
     return Optional<float>();
   return value;
 }
+size_t FilterOutNANFilter::new_values(float *values, uint32_t *times, size_t count) {
+  size_t out = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (!isnan(values[i])) {
+      values[out] = values[i];
+      times[out++] = times[i];
+    }
+  }
+  return out;
+}
 
 uint32_t Filter::expected_interval(uint32_t input) {
   return input;
 }
+Optional<float> Filter::new_timed_value(float value, uint32_t /*time*/) {
+  return this->new_value(value);
+}
+size_t Filter::new_values(float *values, uint32_t *times, size_t count) {
+  size_t out = 0;
+  for (size_t i = 0; i < count; i++) {
+    auto value = this->new_timed_value(values[i], times[i]);
+    if (value.defined) {
+      values[out] = value.value;
+      times[out++] = times[i];
+    }
+  }
+  return out;
+}
 
 Filter::~Filter() = default;
 
@@ -128,9 +190,11 @@ ThrottleFilter::ThrottleFilter(uint32_t min_time_between_updates)
 
 }
 Optional<float> ThrottleFilter::new_value(float value) {
-  const uint32_t now = millis();
-  if (this->last_update_ == 0 || now - this->last_update_ >= min_time_between_updates_) {
-    this->last_update_ = now;
+  return this->new_timed_value(value, millis());
+}
+Optional<float> ThrottleFilter::new_timed_value(float value, uint32_t time) {
+  if (this->last_update_ == 0 || time - this->last_update_ >= min_time_between_updates_) {
+    this->last_update_ = time;
     return value;
   }
   return Optional<float>();
@@ -183,6 +247,162 @@ Optional<float> UniqueFilter::new_value(float value) {
   return Optional<float>();
 }
 
+QuantileFilter::QuantileFilter(size_t window_size, size_t send_every, float quantile)
+    : window_(window_size), send_every_(send_every), send_at_(send_every - 1), quantile_(quantile) {
+
+}
+Optional<float> QuantileFilter::new_value(float value) {
+  if (isnan(value))
+    return Optional<float>();
+  this->window_.next_value(value);
+
+  if (++this->send_at_ >= this->send_every_) {
+    this->send_at_ = 0;
+    return this->window_.get_quantile(this->quantile_);
+  }
+  return Optional<float>();
+}
+size_t QuantileFilter::get_send_every() const {
+  return this->send_every_;
+}
+void QuantileFilter::set_send_every(size_t send_every) {
+  this->send_every_ = send_every;
+}
+size_t QuantileFilter::get_window_size() const {
+  return this->window_.get_max_size();
+}
+float QuantileFilter::get_quantile() const {
+  return this->quantile_;
+}
+void QuantileFilter::set_quantile(float quantile) {
+  this->quantile_ = quantile;
+}
+uint32_t QuantileFilter::expected_interval(uint32_t input) {
+  return input * this->send_every_;
+}
+
+MedianFilter::MedianFilter(size_t window_size, size_t send_every)
+    : QuantileFilter(window_size, send_every, 0.5f) {
+
+}
+
+/// Scales the median absolute deviation to the standard deviation of normally distributed values.
+static const float MAD_SCALE = 1.4826f;
+/// The smallest deviation the Hampel filter uses, relative to the median.
+static const float HAMPEL_MIN_RELATIVE_DEVIATION = 0.001f;
+
+HampelFilter::HampelFilter(size_t window_size, float threshold, float min_deviation)
+    : window_(window_size), threshold_(threshold), min_deviation_(min_deviation) {
+
+}
+Optional<float> HampelFilter::new_value(float value) {
+  if (isnan(value))
+    return Optional<float>();
+  this->window_.next_value(value);
+
+  const float median = this->window_.get_median();
+  float deviation = MAD_SCALE * this->window_.get_median_absolute_deviation();
+  deviation = std::max(deviation, std::max(this->min_deviation_, fabsf(median) * HAMPEL_MIN_RELATIVE_DEVIATION));
+  if (deviation > 0.0f && fabsf(value - median) > this->threshold_ * deviation) {
+    ESP_LOGV(TAG, "Hampel: replacing outlier %.2f by median %.2f", value, median);
+    return median;
+  }
+  return value;
+}
+float HampelFilter::get_threshold() const {
+  return this->threshold_;
+}
+void HampelFilter::set_threshold(float threshold) {
+  this->threshold_ = threshold;
+}
+float HampelFilter::get_min_deviation() const {
+  return this->min_deviation_;
+}
+void HampelFilter::set_min_deviation(float min_deviation) {
+  this->min_deviation_ = min_deviation;
+}
+
+TimeWeightedAverageFilter::TimeWeightedAverageFilter(uint32_t window)
+    : window_(window) {
+
+}
+Optional<float> TimeWeightedAverageFilter::new_value(float value) {
+  return this->new_timed_value(value, millis());
+}
+Optional<float> TimeWeightedAverageFilter::new_timed_value(float value, uint32_t time) {
+  if (isnan(value))
+    return Optional<float>();
+  if (!this->has_value_) {
+    this->has_value_ = true;
+    this->window_start_ = time;
+  } else {
+    // the last value was the current one until now
+    this->sum_ += this->last_value_ * float(time - this->last_time_);
+  }
+  this->last_value_ = value;
+  this->last_time_ = time;
+
+  const uint32_t duration = time - this->window_start_;
+  if (duration < this->window_ || duration == 0)
+    return Optional<float>();
+  const float average = this->sum_ / duration;
+  this->sum_ = 0.0f;
+  this->window_start_ = time;
+  return average;
+}
+uint32_t TimeWeightedAverageFilter::expected_interval(uint32_t input) {
+  return std::max(input, this->window_);
+}
+
+RateOfChangeFilter::RateOfChangeFilter(uint32_t time_unit)
+    : time_unit_(time_unit) {
+
+}
+Optional<float> RateOfChangeFilter::new_value(float value) {
+  return this->new_timed_value(value, millis());
+}
+Optional<float> RateOfChangeFilter::new_timed_value(float value, uint32_t time) {
+  if (isnan(value))
+    return Optional<float>();
+  const float last_value = this->last_value_;
+  const uint32_t dt = time - this->last_time_;
+  if (!isnan(last_value) && dt == 0)
+    // two values at the same time, keep the first one as reference.
+    return Optional<float>();
+  this->last_value_ = value;
+  this->last_time_ = time;
+  if (isnan(last_value))
+    return Optional<float>();
+  return (value - last_value) * this->time_unit_ / dt;
+}
+
+IntegralFilter::IntegralFilter(uint32_t time_unit)
+    : time_unit_(time_unit) {
+
+}
+Optional<float> IntegralFilter::new_value(float value) {
+  return this->new_timed_value(value, millis());
+}
+Optional<float> IntegralFilter::new_timed_value(float value, uint32_t time) {
+  if (isnan(value))
+    return Optional<float>();
+  if (!isnan(this->last_value_)) {
+    const float step = (this->last_value_ + value) / 2.0f * float(time - this->last_time_) / float(this->time_unit_);
+    // Kahan summation, a running total (like energy) soon gets too large for the steps to be added exactly.
+    const float y = step - this->compensation_;
+    const float sum = this->integral_ + y;
+    this->compensation_ = (sum - this->integral_) - y;
+    this->integral_ = sum;
+  }
+  this->last_value_ = value;
+  this->last_time_ = time;
+  return this->integral_;
+}
+void IntegralFilter::reset() {
+  this->integral_ = 0.0f;
+  this->compensation_ = 0.0f;
+}
+
 } // namespace sensor
 
 ESPHOMELIB_NAMESPACE_END
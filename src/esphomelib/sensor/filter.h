@@ -35,6 +35,30 @@ class Filter {
    */
   virtual Optional<float> new_value(float value) = 0;
 
+  /** Like new_value(), but with the time the value was measured at. This is what the sensor calls.
+   *
+   * By default the time is ignored and new_value() is called, override this for filters that work with
+   * time spans instead of value counts. An output value has the time of the latest input value.
+   *
+   * @param value The new value.
+   * @param time The millis() timestamp at which the value was measured.
+   * @return An optional float, the new value that should be pushed out.
+   */
+  virtual Optional<float> new_timed_value(float value, uint32_t time);
+
+  /** Filter a block of values in place, see Sensor::push_new_values().
+   *
+   * The values that pass the filter are moved to the front of values (in order) together with their
+   * times, the rest is discarded. By default this calls new_timed_value() for each value, simple filters
+   * override it with a tight loop the compiler can vectorize.
+   *
+   * @param values The values, overwritten with the output of the filter.
+   * @param times The millis() timestamps of the values, overwritten with the times of the output values.
+   * @param count The number of values.
+   * @return The number of values that passed the filter.
+   */
+  virtual size_t new_values(float *values, uint32_t *times, size_t count);
+
   virtual ~Filter();
 
   /// Return the amount of time that this filter is expected to take based on the input time interval.
@@ -45,6 +69,9 @@ class Filter {
  *
  * Essentially just takes takes the average of the last window_size values and pushes them out
  * every send_every.
+ *
+ * With USE_FIXED_POINT_FILTERS the window holds Fixed16 values and the sum is exact, NAN values are
+ * ignored then.
  */
 class SlidingWindowMovingAverageFilter : public Filter {
  public:
@@ -65,7 +92,11 @@ class SlidingWindowMovingAverageFilter : public Filter {
   uint32_t expected_interval(uint32_t input) override;
 
  protected:
+#ifdef USE_FIXED_POINT_FILTERS
+  SlidingWindowMovingAverage<int32_t, int64_t> value_average_; ///< Raw Fixed16 values.
+#else
   SlidingWindowMovingAverage<float> value_average_;
+#endif
   size_t send_every_;
   size_t send_at_;
 };
@@ -74,6 +105,8 @@ class SlidingWindowMovingAverageFilter : public Filter {
  *
  * Essentially just takes the average of the last few values using exponentially decaying weights.
  * Use alpha to adjust decay rate.
+ *
+ * With USE_FIXED_POINT_FILTERS the average is computed with Fixed16 numbers, NAN values are ignored then.
  */
 class ExponentialMovingAverageFilter : public Filter {
  public:
@@ -89,8 +122,11 @@ class ExponentialMovingAverageFilter : public Filter {
   uint32_t expected_interval(uint32_t input) override;
 
  protected:
+#ifdef USE_FIXED_POINT_FILTERS
+  FixedExponentialMovingAverage value_average_;
+#else
   ExponentialMovingAverage value_average_;
-  ExponentialMovingAverage accuracy_average_;
+#endif
   size_t send_every_;
   size_t send_at_;
 };
@@ -122,6 +158,7 @@ class OffsetFilter : public Filter {
   explicit OffsetFilter(float offset);
 
   Optional<float> new_value(float value) override;
+  size_t new_values(float *values, uint32_t *times, size_t count) override;
 
  protected:
   float offset_;
@@ -133,6 +170,7 @@ class MultiplyFilter : public Filter {
   explicit MultiplyFilter(float multiplier);
 
   Optional<float> new_value(float value) override;
+  size_t new_values(float *values, uint32_t *times, size_t count) override;
 
  protected:
   float multiplier_;
@@ -144,6 +182,7 @@ class FilterOutValueFilter : public Filter {
   explicit FilterOutValueFilter(float values_to_filter_out);
 
   Optional<float> new_value(float value) override;
+  size_t new_values(float *values, uint32_t *times, size_t count) override;
 
  protected:
   float value_to_filter_out_;
@@ -153,6 +192,7 @@ class FilterOutValueFilter : public Filter {
 class FilterOutNANFilter : public Filter {
  public:
   Optional<float> new_value(float value) override;
+  size_t new_values(float *values, uint32_t *times, size_t count) override;
 };
 
 class ThrottleFilter : public Filter {
@@ -160,6 +200,7 @@ class ThrottleFilter : public Filter {
   explicit ThrottleFilter(uint32_t min_time_between_updates);
 
   Optional<float> new_value(float value) override;
+  Optional<float> new_timed_value(float value, uint32_t time) override;
 
  protected:
   uint32_t last_update_{0};
@@ -205,6 +246,139 @@ class UniqueFilter : public Filter {
   float last_value_{NAN};
 };
 
+/** Quantile of the last window_size values, pushed out every send_every values.
+ *
+ * Unlike averages, quantiles aren't pulled towards spikes, so this removes outliers instead of smearing them.
+ * Costs O(log window_size) per value, see SlidingWindowQuantile. NAN values are ignored.
+ */
+class QuantileFilter : public Filter {
+ public:
+  /** Construct a QuantileFilter.
+   *
+   * @param window_size The number of values the quantile is computed over.
+   * @param send_every After how many sensor values should a new one be pushed out.
+   * @param quantile The quantile between 0.0 and 1.0, for example 0.9 for the 90th percentile.
+   */
+  QuantileFilter(size_t window_size, size_t send_every, float quantile);
+
+  Optional<float> new_value(float value) override;
+
+  size_t get_send_every() const;
+  void set_send_every(size_t send_every);
+  size_t get_window_size() const;
+  float get_quantile() const;
+  void set_quantile(float quantile);
+
+  uint32_t expected_interval(uint32_t input) override;
+
+ protected:
+  SlidingWindowQuantile window_;
+  size_t send_every_;
+  size_t send_at_;
+  float quantile_;
+};
+
+/// A QuantileFilter pushing out the median, the usual filter against spikes.
+class MedianFilter : public QuantileFilter {
+ public:
+  MedianFilter(size_t window_size, size_t send_every);
+};
+
+/** Hampel filter: replaces outliers by the median of the last window_size values (including the new one).
+ *
+ * A value is an outlier if it's more than threshold scaled median absolute deviations away from the median.
+ * Other values pass unchanged, so unlike MedianFilter this doesn't smooth the signal. NAN values are ignored.
+ *
+ * If at least half of the window has the same value (a sensor that doesn't change, or coarse quantization)
+ * the median absolute deviation is 0 and even the smallest change would be an outlier. The deviation is
+ * therefore at least min_deviation and at least 0.1% of the median: changes within threshold times that
+ * pass, set min_deviation to the resolution or noise level of the sensor. A larger step is replaced until it
+ * fills half the window, then it's the new median. If both are 0 (a window of zeros and min_deviation 0) no
+ * value is replaced.
+ */
+class HampelFilter : public Filter {
+ public:
+  /** Construct a HampelFilter.
+   *
+   * @param window_size The number of values the median and deviation are computed from.
+   * @param threshold The number of scaled median absolute deviations a value may be away from the median.
+   * @param min_deviation The smallest deviation used, in the unit of the sensor.
+   */
+  explicit HampelFilter(size_t window_size, float threshold = 3.0f, float min_deviation = 0.0f);
+
+  Optional<float> new_value(float value) override;
+
+  float get_threshold() const;
+  void set_threshold(float threshold);
+  float get_min_deviation() const;
+  void set_min_deviation(float min_deviation);
+
+ protected:
+  SlidingWindowQuantile window_;
+  float threshold_;
+  float min_deviation_;
+};
+
+/** Time-weighted average over windows of `window` milliseconds.
+ *
+ * Unlike SlidingWindowMovingAverageFilter, each value is weighted by how long it was the current value,
+ * so irregular updates or a slipping update interval don't bias the average. One average is pushed out at
+ * the end of each window, NAN values are ignored.
+ */
+class TimeWeightedAverageFilter : public Filter {
+ public:
+  explicit TimeWeightedAverageFilter(uint32_t window);
+
+  Optional<float> new_value(float value) override;
+  Optional<float> new_timed_value(float value, uint32_t time) override;
+
+  uint32_t expected_interval(uint32_t input) override;
+
+ protected:
+  uint32_t window_;
+  bool has_value_{false};
+  float last_value_;
+  uint32_t last_time_;
+  uint32_t window_start_;
+  float sum_{0.0f}; ///< Integral of the values over time since window_start_, in value*ms.
+};
+
+/// Pushes out the rate of change between consecutive values, per `time_unit` milliseconds (1000 = per second).
+class RateOfChangeFilter : public Filter {
+ public:
+  explicit RateOfChangeFilter(uint32_t time_unit = 1000);
+
+  Optional<float> new_value(float value) override;
+  Optional<float> new_timed_value(float value, uint32_t time) override;
+
+ protected:
+  uint32_t time_unit_;
+  float last_value_{NAN};
+  uint32_t last_time_{0};
+};
+
+/** Pushes out the integral of the values over time using the trapezoidal rule, for example to get
+ * energy from power. The time_unit (in ms) is the unit of time the integral is in, 3600000 for hours.
+ */
+class IntegralFilter : public Filter {
+ public:
+  explicit IntegralFilter(uint32_t time_unit = 1000);
+
+  Optional<float> new_value(float value) override;
+  Optional<float> new_timed_value(float value, uint32_t time) override;
+
+  /// Reset the integral to 0.
+  void reset();
+
+ protected:
+  uint32_t time_unit_;
+  float last_value_{NAN};
+  uint32_t last_time_{0};
+  float integral_{0.0f};
+  /// The low-order part lost when adding to integral_ (Kahan summation), small steps add up over time.
+  float compensation_{0.0f};
+};
+
 } // namespace sensor
 
 ESPHOMELIB_NAMESPACE_END
@@ -0,0 +1,323 @@
+#ifndef ESPHOMELIB_SENSOR_FILTER_CHAIN_H
+#define ESPHOMELIB_SENSOR_FILTER_CHAIN_H
+
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include "esphomelib/sensor/filter.h"
+#include "esphomelib/esphal.h"
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+#ifdef USE_SENSOR
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace sensor {
+
+/** Base for the steps of a FilterChain.
+ *
+ * A step is the compile-time counterpart of a Filter: a plain object with a non-virtual
+ * `bool apply(float &value, uint32_t time)` that modifies value in place and returns false to abort the
+ * chain, time is the millis() timestamp of the value. Steps can override expected_interval()
+ * (non-virtually) if they don't forward every value.
+ */
+struct FilterStep {
+  uint32_t expected_interval(uint32_t input) const { return input; }
+};
+
+/// Step that adds `offset` to each value, like OffsetFilter.
+struct OffsetStep : FilterStep {
+  explicit OffsetStep(float offset) : offset(offset) {}
+  bool apply(float &value, uint32_t /*time*/) {
+    value += this->offset;
+    return true;
+  }
+  float offset;
+};
+
+/// Step that multiplies each value by `multiplier`, like MultiplyFilter.
+struct MultiplyStep : FilterStep {
+  explicit MultiplyStep(float multiplier) : multiplier(multiplier) {}
+  bool apply(float &value, uint32_t /*time*/) {
+    value *= this->multiplier;
+    return true;
+  }
+  float multiplier;
+};
+
+/// Step that aborts the chain for `value_to_filter_out`, like FilterOutValueFilter.
+struct FilterOutValueStep : FilterStep {
+  explicit FilterOutValueStep(float value_to_filter_out) : value_to_filter_out(value_to_filter_out) {}
+  bool apply(float &value, uint32_t /*time*/) { return value != this->value_to_filter_out; }
+  float value_to_filter_out;
+};
+
+/// Step that aborts the chain for NAN, like FilterOutNANFilter.
+struct FilterOutNANStep : FilterStep {
+  bool apply(float &value, uint32_t /*time*/) { return !std::isnan(value); }
+};
+
+/** Sliding window moving average of the last WindowSize values, sent every SendEvery values.
+ *
+ * Like SlidingWindowMovingAverageFilter, but the window is stored inside the step so it never allocates.
+ * With USE_FIXED_POINT_FILTERS the window holds raw Fixed16 values and NAN values abort the chain.
+ */
+template<size_t WindowSize, size_t SendEvery = WindowSize>
+struct SlidingWindowStep : FilterStep {
+  static_assert(WindowSize > 0 && SendEvery > 0, "Window size and send every must be greater than 0.");
+
+  bool apply(float &value, uint32_t time);
+  uint32_t expected_interval(uint32_t input) const { return input * SendEvery; }
+
+#ifdef USE_FIXED_POINT_FILTERS
+  int32_t window[WindowSize];
+#else
+  float window[WindowSize];
+#endif
+  size_t size{0};
+  size_t head{0}; ///< The oldest value once the window is full.
+  size_t send_at{SendEvery - 1};
+#ifdef USE_FIXED_POINT_FILTERS
+  int64_t sum{0}; ///< Exact, so it doesn't need to be recomputed.
+#else
+  float sum{0.0f};
+#endif
+};
+
+/** Exponential moving average sent every `send_every` values, like ExponentialMovingAverageFilter.
+ *
+ * With USE_FIXED_POINT_FILTERS the average is computed with Fixed16 numbers and NAN values abort the chain.
+ */
+struct ExponentialMovingAverageStep : FilterStep {
+  ExponentialMovingAverageStep(float alpha, size_t send_every)
+      : average(alpha), send_every(send_every), send_at(send_every - 1) {}
+  bool apply(float &value, uint32_t /*time*/) {
+#ifdef USE_FIXED_POINT_FILTERS
+    if (std::isnan(value))
+      return false;
+    value = this->average.next_value(Fixed16::from_float(value)).to_float();
+#else
+    value = this->average.next_value(value);
+#endif
+    if (++this->send_at < this->send_every)
+      return false;
+    this->send_at = 0;
+    return true;
+  }
+  uint32_t expected_interval(uint32_t input) const { return input * this->send_every; }
+
+#ifdef USE_FIXED_POINT_FILTERS
+  FixedExponentialMovingAverage average;
+#else
+  ExponentialMovingAverage average;
+#endif
+  size_t send_every;
+  size_t send_at;
+};
+
+/// Step that only forwards values differing by at least `min_delta` from the last forwarded one, like DeltaFilter.
+struct DeltaStep : FilterStep {
+  explicit DeltaStep(float min_delta) : min_delta(min_delta) {}
+  bool apply(float &value, uint32_t /*time*/) {
+    if (std::isnan(value))
+      return false;
+    if (!std::isnan(this->last_value) && fabsf(value - this->last_value) < this->min_delta)
+      return false;
+    this->last_value = value;
+    return true;
+  }
+  float min_delta;
+  float last_value{NAN};
+};
+
+/// Step that forwards at most one value every `min_time_between_updates` ms, like ThrottleFilter.
+struct ThrottleStep : FilterStep {
+  explicit ThrottleStep(uint32_t min_time_between_updates) : min_time_between_updates(min_time_between_updates) {}
+  bool apply(float &/*value*/, uint32_t time) {
+    if (this->last_update != 0 && time - this->last_update < this->min_time_between_updates)
+      return false;
+    this->last_update = time;
+    return true;
+  }
+  uint32_t min_time_between_updates;
+  uint32_t last_update{0};
+};
+
+/// Step calling a lambda of the form float -> Optional<float>, like LambdaFilter. Create it with lambda_step().
+template<typename F>
+struct LambdaStep : FilterStep {
+  explicit LambdaStep(F f) : f(std::move(f)) {}
+  bool apply(float &value, uint32_t /*time*/) {
+    Optional<float> out = this->f(value);
+    if (!out.defined)
+      return false;
+    value = out.value;
+    return true;
+  }
+  F f;
+};
+
+/// Create a LambdaStep, the type of the lambda is deduced.
+template<typename F>
+LambdaStep<typename std::decay<F>::type> lambda_step(F &&f) {
+  return LambdaStep<typename std::decay<F>::type>(std::forward<F>(f));
+}
+
+/// The steps of a FilterChain, stored one after the other in a single object.
+template<typename... Steps> struct FilterSteps;
+
+template<> struct FilterSteps<> {
+  bool apply(float &/*value*/, uint32_t /*time*/) { return true; }
+  uint32_t expected_interval(uint32_t input) const { return input; }
+};
+
+template<typename First, typename... Rest>
+struct FilterSteps<First, Rest...> {
+  FilterSteps(First &&first, Rest &&... rest) : first(std::move(first)), rest(std::move(rest)...) {}
+  bool apply(float &value, uint32_t time) {
+    return this->first.apply(value, time) && this->rest.apply(value, time);
+  }
+  uint32_t expected_interval(uint32_t input) const {
+    return this->rest.expected_interval(this->first.expected_interval(input));
+  }
+
+  First first;
+  FilterSteps<Rest...> rest;
+};
+
+/** A filter chain composed at compile time.
+ *
+ * All steps live in this one object and are called without virtual dispatch, so the compiler can inline
+ * the whole chain. Only the chain itself is called through the Filter interface, which makes it a drop-in
+ * replacement for a list of filters on high-rate sensors:
+ *
+ * @code
+ * sensor->clear_filters();
+ * sensor->add_filter(make_filter_chain(
+ *   OffsetStep(-0.5f),
+ *   MultiplyStep(2.0f),
+ *   SlidingWindowStep<15>()
+ * ));
+ * @endcode
+ *
+ * High-rate code that owns the chain can also call apply() directly and skip the Filter interface entirely.
+ *
+ * @tparam Steps The step types, see FilterStep.
+ */
+template<typename... Steps>
+class FilterChain : public Filter {
+ public:
+  explicit FilterChain(Steps... steps);
+
+  /// Run value measured at time through all steps, returns false if one of them aborted the chain.
+  bool apply(float &value, uint32_t time);
+
+  Optional<float> new_value(float value) override;
+
+  Optional<float> new_timed_value(float value, uint32_t time) override;
+
+  size_t new_values(float *values, uint32_t *times, size_t count) override;
+
+  uint32_t expected_interval(uint32_t input) override;
+
+ protected:
+  FilterSteps<Steps...> steps_;
+};
+
+/// Create a FilterChain from steps, to be passed to Sensor::add_filter() (which takes ownership).
+template<typename... Steps>
+FilterChain<typename std::decay<Steps>::type...> *make_filter_chain(Steps &&... steps);
+
+// ================================================
+//                 Definitions
+// ================================================
+
+template<size_t WindowSize, size_t SendEvery>
+bool SlidingWindowStep<WindowSize, SendEvery>::apply(float &value, uint32_t /*time*/) {
+#ifdef USE_FIXED_POINT_FILTERS
+  if (std::isnan(value))
+    return false;
+  const int32_t raw = Fixed16::from_float(value).raw();
+  if (this->size < WindowSize) {
+    this->window[this->size++] = raw;
+    this->sum += raw;
+  } else {
+    this->sum += int64_t(raw) - this->window[this->head];
+    this->window[this->head] = raw;
+    if (++this->head == WindowSize)
+      this->head = 0;
+  }
+  value = Fixed16::from_raw(int32_t(this->sum / int64_t(this->size))).to_float();
+#else
+  if (this->size < WindowSize) {
+    this->window[this->size++] = value;
+    this->sum += value;
+  } else {
+    this->sum += value - this->window[this->head];
+    this->window[this->head] = value;
+    if (++this->head == WindowSize) {
+      // recompute the sum once per wrap around, see SlidingWindowMovingAverage.
+      this->head = 0;
+      this->sum = 0.0f;
+      for (float v : this->window)
+        this->sum += v;
+    }
+  }
+  value = this->sum / this->size;
+#endif
+
+  if (++this->send_at < SendEvery)
+    return false;
+  this->send_at = 0;
+  return true;
+}
+
+template<typename... Steps>
+FilterChain<Steps...>::FilterChain(Steps... steps) : steps_(std::move(steps)...) {
+
+}
+template<typename... Steps>
+bool FilterChain<Steps...>::apply(float &value, uint32_t time) {
+  return this->steps_.apply(value, time);
+}
+template<typename... Steps>
+Optional<float> FilterChain<Steps...>::new_value(float value) {
+  return this->new_timed_value(value, millis());
+}
+template<typename... Steps>
+Optional<float> FilterChain<Steps...>::new_timed_value(float value, uint32_t time) {
+  if (!this->steps_.apply(value, time))
+    return Optional<float>();
+  return value;
+}
+template<typename... Steps>
+size_t FilterChain<Steps...>::new_values(float *values, uint32_t *times, size_t count) {
+  size_t out = 0;
+  for (size_t i = 0; i < count; i++) {
+    float value = values[i];
+    if (this->steps_.apply(value, times[i])) {
+      values[out] = value;
+      times[out++] = times[i];
+    }
+  }
+  return out;
+}
+template<typename... Steps>
+uint32_t FilterChain<Steps...>::expected_interval(uint32_t input) {
+  return this->steps_.expected_interval(input);
+}
+
+template<typename... Steps>
+FilterChain<typename std::decay<Steps>::type...> *make_filter_chain(Steps &&... steps) {
+  return new FilterChain<typename std::decay<Steps>::type...>(std::forward<Steps>(steps)...);
+}
+
+} // namespace sensor
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_SENSOR
+
+#endif //ESPHOMELIB_SENSOR_FILTER_CHAIN_H
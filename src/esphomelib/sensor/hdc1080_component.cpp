@@ -35,6 +35,8 @@ HDC1080Component::HDC1080Component(I2CComponent *parent,
 }
 void HDC1080Component::setup() {
   ESP_LOGCONFIG(TAG, "Setting up HDC1080...");
+  // update() blocks for two 9ms conversions
+  this->set_polling_bus(this->parent_, 20);
 
   const uint8_t data[2] = {
       0b00000000, // resolution 14bit for both humidity and temperature
@@ -22,8 +22,11 @@ namespace sensor {
 static const char *TAG = "sensor.htu21d";
 static const uint8_t HTU21D_ADDRESS = 0x40;
 static const uint8_t HTU21D_REGISTER_RESET = 0xFE;
-static const uint8_t HTU21D_REGISTER_TEMPERATURE = 0xE3;
-static const uint8_t HTU21D_REGISTER_HUMIDITY = 0xE5;
+static const uint8_t HTU21D_REGISTER_TEMPERATURE = 0xF3; ///< no hold master, 50ms conversion
+static const uint8_t HTU21D_REGISTER_HUMIDITY = 0xF5; ///< no hold master, 16ms conversion
+static const uint32_t HTU21D_TEMPERATURE_CONVERSION = 50;
+static const uint32_t HTU21D_HUMIDITY_CONVERSION = 16;
+static const uint32_t HTU21D_RESET_TIME = 15;
 
 HTU21DComponent::HTU21DComponent(I2CComponent *parent,
                                  const std::string &temperature_name, const std::string &humidity_name,
@@ -35,32 +38,51 @@ HTU21DComponent::HTU21DComponent(I2CComponent *parent,
 }
 void HTU21DComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up HTU21D...");
+  // both conversions and the reads after them
+  this->set_polling_bus(this->parent_, HTU21D_TEMPERATURE_CONVERSION + HTU21D_HUMIDITY_CONVERSION + 2);
 
   if (!this->write_byte(HTU21D_REGISTER_RESET, 0x00)) {
     ESP_LOGE(TAG, "Connection to HTU21D failed.");
     this->mark_failed();
     return;
   }
-
-  // Wait for software reset to complete
-  delay(15);
+  this->resetting_ = true;
 }
 void HTU21DComponent::update() {
+  this->start_coroutine(&this->update_coroutine_, [this](Coroutine &co) { return this->read_(co); });
+}
+CoroutineResult HTU21DComponent::read_(Coroutine &co) {
+  CO_BEGIN(co);
+  if (this->resetting_) {
+    // The soft reset takes up to 15ms and the first update() runs right after setup(), the sensor would NACK.
+    this->resetting_ = false;
+    CO_SLEEP(co, HTU21D_RESET_TIME);
+  }
+  // Use the no hold master commands and sleep during the conversion instead of having the
+  // sensor stretch the I2C clock for it.
+  if (!this->write_bytes(HTU21D_REGISTER_TEMPERATURE, nullptr, 0))
+    CO_RETURN(co);
+  CO_SLEEP(co, HTU21D_TEMPERATURE_CONVERSION);
+
   uint16_t raw_temperature;
-  if (!this->read_byte_16(HTU21D_REGISTER_TEMPERATURE, &raw_temperature))
-    return;
+  if (!this->parent_->receive_16_(this->address_, &raw_temperature, 1))
+    CO_RETURN(co);
+  this->temperature_value_ = (float(raw_temperature & 0xFFFC)) * 175.72f / 65536.0f - 46.85f;
 
-  float temperature = (float(raw_temperature & 0xFFFC)) * 175.72f / 65536.0f - 46.85f;
+  if (!this->write_bytes(HTU21D_REGISTER_HUMIDITY, nullptr, 0))
+    CO_RETURN(co);
+  CO_SLEEP(co, HTU21D_HUMIDITY_CONVERSION);
 
   uint16_t raw_humidity;
-  if (!this->read_byte_16(HTU21D_REGISTER_HUMIDITY, &raw_humidity))
-    return;
+  if (!this->parent_->receive_16_(this->address_, &raw_humidity, 1))
+    CO_RETURN(co);
 
   float humidity = (float(raw_humidity & 0xFFFC)) * 125.0f / 65536.0f - 6.0f;
-  ESP_LOGD(TAG, "Got Temperature=%.1f°C Humidity=%.1f%%", temperature, humidity);
+  ESP_LOGD(TAG, "Got Temperature=%.1f°C Humidity=%.1f%%", this->temperature_value_, humidity);
 
-  this->temperature_->push_new_value(temperature);
+  this->temperature_->push_new_value(this->temperature_value_);
   this->humidity_->push_new_value(humidity);
+  CO_END(co);
 }
 HTU21DTemperatureSensor *HTU21DComponent::get_temperature_sensor() const {
   return this->temperature_;
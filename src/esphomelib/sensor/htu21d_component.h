@@ -48,8 +48,14 @@ class HTU21DComponent : public PollingComponent, public I2CDevice {
   void update() override;
 
  protected:
+  /// Measure temperature and then humidity, without blocking during the conversions.
+  CoroutineResult read_(Coroutine &co);
+
   HTU21DTemperatureSensor *temperature_{nullptr};
   HTU21DHumiditySensor *humidity_{nullptr};
+  Coroutine update_coroutine_;
+  float temperature_value_{NAN}; ///< The temperature of the running measurement.
+  bool resetting_{false}; ///< Whether the soft reset from setup() may still be running.
 };
 
 } // namespace sensor
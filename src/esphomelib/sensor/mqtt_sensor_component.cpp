@@ -4,6 +4,8 @@
 
 #include "esphomelib/sensor/mqtt_sensor_component.h"
 
+#include <algorithm>
+
 #include "esphomelib/espmath.h"
 #include "esphomelib/log.h"
 #include "esphomelib/component.h"
@@ -39,6 +41,13 @@ void MQTTSensorComponent::setup() {
     ESP_LOGD(TAG, "'%s': Pushing out value %f with accuracy %d", this->sensor_->get_name().c_str(), value, accuracy);
     this->send_message(this->get_state_topic(), value_accuracy_to_string(value, accuracy));
   });
+  this->sensor_->add_on_update_interval_change_callback([this](uint32_t /*update_interval*/) {
+    // adaptive polling, let Home Assistant know about the new expire_after.
+    if (this->get_expire_after() != this->advertised_expire_after_) {
+      this->next_send_discovery_ = true;
+      this->request_loop();
+    }
+  });
 }
 
 std::string MQTTSensorComponent::component_type() const {
@@ -50,8 +59,13 @@ uint32_t MQTTSensorComponent::get_expire_after() const {
     return this->expire_after_.value;
   } else {
     uint32_t interval = this->sensor_->update_interval();
+    if (interval == 0)
+      // not polling, the sensor reports irregularly and its value never expires.
+      return 0;
     for (auto *filter : this->sensor_->get_filters())
       interval = filter->expected_interval(interval);
+    // the estimate is too short if the update interval slipped, so use the measured interval if it's longer.
+    interval = std::max(interval, this->sensor_->get_value_interval());
     return interval * 3;
   }
 }
@@ -68,8 +82,9 @@ void MQTTSensorComponent::send_discovery(JsonBuffer &buffer, JsonObject &root, m
   if (!this->sensor_->get_unit_of_measurement().empty())
     root["unit_of_measurement"] = this->sensor_->get_unit_of_measurement();
 
-  if (this->get_expire_after() > 0)
-    root["expire_after"] = this->get_expire_after() / 1000;
+  this->advertised_expire_after_ = this->get_expire_after();
+  if (this->advertised_expire_after_ > 0)
+    root["expire_after"] = this->advertised_expire_after_ / 1000;
 
   if (!this->sensor_->get_icon().empty())
     root["icon"] = this->sensor_->get_icon();
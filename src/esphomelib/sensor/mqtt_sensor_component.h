@@ -41,7 +41,14 @@ class MQTTSensorComponent : public mqtt::MQTTComponent {
   /// Override setup.
   void setup() override;
 
-  /// Get the expire_after in milliseconds used for Home Assistant discovery, first checks override.
+  /** Get the expire_after in milliseconds used for Home Assistant discovery, first checks override.
+   *
+   * Otherwise it's three times the interval of the filtered values: the one expected from the update
+   * interval and the filters, or the measured one (see Sensor::get_value_interval()) if that's longer.
+   *
+   * With adaptive polling (see PollingComponent::set_adaptive_update_interval()) this follows the current
+   * update interval, discovery is sent again when it changes.
+   */
   uint32_t get_expire_after() const;
 
  protected:
@@ -53,6 +60,7 @@ class MQTTSensorComponent : public mqtt::MQTTComponent {
  protected:
   Sensor *sensor_;
   Optional<uint32_t> expire_after_; // Override the expire after advertised to Home Assistant
+  uint32_t advertised_expire_after_{0}; ///< The expire_after sent with the last discovery message.
 };
 
 } // namespace sensor
@@ -7,6 +7,7 @@
 //
 
 #include "esphomelib/sensor/rotary_encoder.h"
+#include "esphomelib/application.h"
 #include "esphomelib/log.h"
 
 #ifdef USE_ROTARY_ENCODER_SENSOR
@@ -137,7 +138,11 @@ void RotaryEncoderSensor::process_state_machine_() {
       this->counter_ = 0;
     }
 
-    this->has_changed_ = this->has_changed_ || counter_change;
+    if (counter_change) {
+      // the ISR only sets the flag, loop() pushes the latest counter value.
+      this->has_changed_ = true;
+      App.wake_loop_isr();
+    }
   }
 }
 void RotaryEncoderSensor::loop() {
@@ -62,7 +62,7 @@ class RotaryEncoderSensor : public Sensor, public Component {
   GPIOPin *pin_i_{nullptr}; /// Index pin, if this is not nullptr, the counter will reset to 0 once this pin is HIGH.
 
   volatile int32_t counter_{0}; /// The internal counter for steps
-  volatile bool has_changed_{true};
+  volatile bool has_changed_{true}; /// Whether the counter changed since the last loop(), set by the ISR.
   uint16_t state_{0};
   RotaryEncoderResolution resolution_{ROTARY_ENCODER_1_PULSE_PER_CYCLE};
 };
@@ -3,7 +3,9 @@
 //
 
 #include <utility>
+#include <algorithm>
 #include "esphomelib/sensor/sensor.h"
+#include "esphomelib/application.h"
 
 #include "esphomelib/log.h"
 
@@ -15,7 +17,26 @@ namespace sensor {
 
 static const char *TAG = "sensor.sensor";
 
+/// The number of values push_new_values() filters at once, the buffer lives on the stack.
+static const size_t PUSH_BLOCK_SIZE = 32;
+
+bool Sensor::post_new_value(float value) {
+  const uint32_t time = millis();
+  return App.post([this, value, time] {
+    this->push_new_value(value, time);
+  });
+}
 void Sensor::push_new_value(float value) {
+  this->push_new_value(value, millis());
+}
+void Sensor::push_new_value(float value, uint32_t time) {
+  if (!App.is_in_execution_group(EXECUTION_GROUP_MAIN)) {
+    // Published from the loop of another execution group, the filters and front-ends run in the main loop.
+    App.post_wait([this, value, time] {
+      this->push_new_value(value, time);
+    });
+    return;
+  }
   this->raw_value_ = value;
   this->raw_callback_.call(value);
 
@@ -23,7 +44,7 @@ void Sensor::push_new_value(float value) {
 
   unsigned int i = 0;
   for (auto *filter : this->filters_) {
-    auto optional_value = filter->new_value(value);
+    auto optional_value = filter->new_timed_value(value, time);
     if (!optional_value.defined) {
       ESP_LOGV(TAG, "'%s':  Filter #%u aborted chain", this->name_.c_str(), i);
       // The filter aborted the chain
@@ -35,7 +56,80 @@ void Sensor::push_new_value(float value) {
     i++;
   }
 
+  this->publish_value_(value, time);
+}
+bool Sensor::push_new_values(const float *values, size_t count, const uint32_t *times) {
+  if (count == 0)
+    return true;
+  const uint32_t now = millis();
+  if (!App.is_in_execution_group(EXECUTION_GROUP_MAIN)) {
+    // Published from the loop of another execution group: copy the block and post it as a single event.
+    auto *block = new PostedValues();
+    block->values.reset(new float[count]);
+    block->times.reset(new uint32_t[count]);
+    block->count = count;
+    std::copy(values, values + count, block->values.get());
+    if (times != nullptr)
+      std::copy(times, times + count, block->times.get());
+    else
+      std::fill(block->times.get(), block->times.get() + count, now);
+    const bool posted = App.post_wait([this, block] {
+      this->push_new_values(block->values.get(), block->count, block->times.get());
+      delete block;
+    });
+    if (!posted) {
+      ESP_LOGW(TAG, "'%s': Event queue full, dropped %u values.", this->name_.c_str(), unsigned(count));
+      delete block;
+    }
+    return posted;
+  }
+  this->raw_value_ = values[count - 1];
+  this->raw_callback_.call(this->raw_value_);
+
+  ESP_LOGV(TAG, "'%s': Received %u new values", this->name_.c_str(), unsigned(count));
+
+  bool has_value = false;
+  float value = NAN;
+  uint32_t time = 0;
+  float block[PUSH_BLOCK_SIZE];
+  uint32_t block_times[PUSH_BLOCK_SIZE];
+  for (size_t start = 0; start < count; start += PUSH_BLOCK_SIZE) {
+    size_t n = std::min(count - start, PUSH_BLOCK_SIZE);
+    std::copy(values + start, values + start + n, block);
+    if (times != nullptr)
+      std::copy(times + start, times + start + n, block_times);
+    else
+      std::fill(block_times, block_times + n, now);
+    for (auto *filter : this->filters_) {
+      n = filter->new_values(block, block_times, n);
+      if (n == 0)
+        break;
+    }
+    if (n != 0) {
+      has_value = true;
+      value = block[n - 1];
+      time = block_times[n - 1];
+    }
+  }
+  if (!has_value) {
+    ESP_LOGV(TAG, "'%s':  Filters aborted chain for all values", this->name_.c_str());
+    return true;
+  }
+
+  this->publish_value_(value, time);
+  return true;
+}
+void Sensor::publish_value_(float value, uint32_t time) {
+  if (this->has_value_)
+    this->value_interval_ = time - this->value_time_;
+  this->has_value_ = true;
   this->value_ = value;
+  this->value_time_ = time;
+  if (this->history_size_ != 0) {
+    if (!this->history_)
+      this->history_.reset(new SensorHistory(this->history_size_, this->get_accuracy_decimals()));
+    this->history_->add(time, value);
+  }
   this->callback_.call(value);
 }
 std::string Sensor::unit_of_measurement() {
@@ -65,12 +159,24 @@ void Sensor::set_icon(const std::string &icon) {
 void Sensor::set_accuracy_decimals(int8_t accuracy_decimals) {
   this->accuracy_decimals_ = accuracy_decimals;
 }
-void Sensor::add_on_value_callback(sensor_callback_t callback) {
+void Sensor::add_on_value_callback(sensor_callback_t &&callback) {
   this->callback_.add(std::move(callback));
 }
-void Sensor::add_on_raw_value_callback(sensor_callback_t callback) {
+void Sensor::add_on_raw_value_callback(sensor_callback_t &&callback) {
   this->raw_callback_.add(std::move(callback));
 }
+void Sensor::add_on_update_interval_change_callback(InlineFunction<void(uint32_t)> &&callback) {
+  this->update_interval_callback_.add(std::move(callback));
+}
+void Sensor::publish_update_interval_change(uint32_t update_interval) {
+  if (!App.is_in_execution_group(EXECUTION_GROUP_MAIN)) {
+    App.post_wait([this, update_interval] {
+      this->publish_update_interval_change(update_interval);
+    });
+    return;
+  }
+  this->update_interval_callback_.call(update_interval);
+}
 std::string Sensor::get_icon() {
   if (this->icon_)
     return this->icon_.value;
@@ -114,11 +220,31 @@ void Sensor::add_sliding_window_average_filter(size_t window_size, size_t send_e
 void Sensor::add_exponential_moving_average_filter(float alpha, size_t send_every) {
   this->add_filter(new ExponentialMovingAverageFilter(alpha, send_every));
 }
+AggregateFilter *Sensor::add_aggregate_filter(uint32_t period) {
+  auto *filter = new AggregateFilter(period, this);
+  this->add_filter(filter);
+  return filter;
+}
 void Sensor::clear_filters() {
   for (auto *filter : this->filters_)
     delete filter;
   this->filters_.clear();
 }
+void Sensor::enable_history(size_t size) {
+  this->history_size_ = size;
+}
+SensorHistory *Sensor::get_history() const {
+  return this->history_.get();
+}
+void Sensor::report_changes_to(PollingComponent *component, float threshold) {
+  float last_value = NAN;
+  this->add_on_value_callback([component, threshold, last_value](float value) mutable {
+    if (isnan(value))
+      return;
+    component->report_update_change(isnan(last_value) || fabsf(value - last_value) > threshold);
+    last_value = value;
+  });
+}
 std::list<Filter *> Sensor::get_filters() const {
   return this->filters_;
 }
@@ -128,10 +254,25 @@ float Sensor::get_value() const {
 float Sensor::get_raw_value() const {
   return this->raw_value_;
 }
+uint32_t Sensor::get_value_time() const {
+  return this->value_time_;
+}
+uint32_t Sensor::get_value_interval() const {
+  return this->value_interval_;
+}
 std::string Sensor::unique_id() { return ""; }
 
 PollingSensorComponent::PollingSensorComponent(const std::string &name, uint32_t update_interval)
-    : PollingComponent(update_interval), Sensor(name) {}
+    : PollingComponent(update_interval), Sensor(name) {
+  this->add_on_update_interval_callback([this](uint32_t update_interval) {
+    this->publish_update_interval_change(update_interval);
+  });
+}
+void PollingSensorComponent::set_adaptive_update_interval(uint32_t min_interval, uint32_t max_interval,
+                                                          float threshold) {
+  this->set_adaptive_update_interval(min_interval, max_interval);
+  this->report_changes_to(this, threshold);
+}
 
 uint32_t PollingSensorComponent::update_interval() {
   return this->get_update_interval();
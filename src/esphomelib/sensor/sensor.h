@@ -11,6 +11,7 @@
 #include "esphomelib/component.h"
 #include "esphomelib/helpers.h"
 #include "esphomelib/sensor/filter.h"
+#include "esphomelib/sensor/sensor_history.h"
 #include "esphomelib/defines.h"
 
 #ifdef USE_SENSOR
@@ -19,7 +20,9 @@ ESPHOMELIB_NAMESPACE_BEGIN
 
 namespace sensor {
 
-using sensor_callback_t = std::function<void(float)>;
+using sensor_callback_t = InlineFunction<void(float)>;
+
+class AggregateFilter;
 
 /** Base-class for all sensors.
  *
@@ -109,13 +112,50 @@ class Sensor : public Nameable {
   /// Helper to make adding exponential decay average filters a bit easier.
   void add_exponential_moving_average_filter(float alpha, size_t send_every);
 
+  /** Helper to add an AggregateFilter that pushes out the mean of each period of `period` ms.
+   *
+   * Use the returned filter to publish the min, max, standard deviation, ... of each period too.
+   *
+   * @param period The length of a period in ms.
+   * @return The filter.
+   */
+  AggregateFilter *add_aggregate_filter(uint32_t period);
+
   /// Clear the entire filter chain.
   void clear_filters();
 
+  /** Keep a compressed history of the filtered values of this sensor in RAM, see SensorHistory.
+   *
+   * The history is served by the web server under /sensor/<id>/history. Values published while MQTT is
+   * disconnected are replayed by the MQTTOfflineBuffer instead. Values are stored rounded to the accuracy
+   * decimals of this sensor, so that most samples need less than 2 bytes.
+   *
+   * @param size The memory budget in bytes, the oldest samples are dropped once it's full.
+   */
+  void enable_history(size_t size);
+
+  /// Get the history of this sensor, nullptr if it's disabled or no value was pushed out yet.
+  SensorHistory *get_history() const;
+
+  /** Report the changes of the filtered values of this sensor to component for adaptive polling,
+   * see PollingComponent::set_adaptive_update_interval().
+   *
+   * Use filters that push out a value for each update (the default sliding window only does that every 15
+   * updates), otherwise the update interval only adapts with the filtered values.
+   *
+   * @param component The component polling this sensor.
+   * @param threshold A value changed if it differs by more than this from the previous filtered value.
+   */
+  void report_changes_to(PollingComponent *component, float threshold);
+
   /// Get the latest filtered value from this sensor.
   float get_value() const;
   /// Get the latest raw value from this sensor.
   float get_raw_value() const;
+  /// Get the millis() timestamp at which the latest filtered value was measured.
+  uint32_t get_value_time() const;
+  /// Get the time in ms between the last two filtered values, 0 if there weren't two values yet.
+  uint32_t get_value_interval() const;
 
   /** Return the vector of filters this component uses for its value calculations.
    *
@@ -140,12 +180,49 @@ class Sensor : public Nameable {
   /** Push a new value to the MQTT front-end.
    *
    * Note that you should publish the raw value here, i.e. without any rounding as the user
-   * can later override this accuracy.
+   * can later override this accuracy. If called from the loop of another execution group,
+   * the value is handed over to the main loop with Application::post_wait(), so the values
+   * arrive in order and none are dropped.
    *
    * @param value The floating point value.
    */
   void push_new_value(float value);
 
+  /** Push a new value that was measured at time, for values that are published some time after their
+   * measurement. Time-based filters (see Filter::new_timed_value()) use this time.
+   *
+   * @param value The floating point value.
+   * @param time The millis() timestamp at which the value was measured.
+   */
+  void push_new_value(float value, uint32_t time);
+
+  /** Like push_new_value(), but safe to call from other tasks (not from interrupts, see
+   * Application::wake_loop_isr()).
+   *
+   * The value is pushed in the next Application::loop() iteration with the time of this call,
+   * see Application::post().
+   *
+   * @param value The floating point value.
+   * @return Whether the value could be posted, false if the event queue was full.
+   */
+  bool post_new_value(float value);
+
+  /** Push a burst of values at once, for sources that sample faster than they need to publish.
+   *
+   * The values are run through the filters block by block (see Filter::new_values()) and only the
+   * last value that passes all filters reaches the value callbacks (MQTT, web server, ...), once per call.
+   * The raw value callbacks are also only called once, with the last raw value.
+   *
+   * From other execution groups the values are copied and posted to the main group as one event
+   * (see Application::post_wait()), the caller can reuse its buffers right away.
+   *
+   * @param values The raw values, oldest first.
+   * @param count The number of values.
+   * @param times The millis() timestamps at which the values were measured, nullptr for now.
+   * @return Whether the values were pushed or posted, false if the event queue was full.
+   */
+  bool push_new_values(const float *values, size_t count, const uint32_t *times = nullptr);
+
   /** Override this to set the Home Assistant unit of measurement for this sensor.
    *
    * Return "" to disable this feature.
@@ -171,9 +248,13 @@ class Sensor : public Nameable {
   // ========== INTERNAL METHODS ==========
   // (In most use cases you won't need these)
   /// Add a callback that will be called every time a filtered value arrives.
-  void add_on_value_callback(sensor_callback_t callback);
+  void add_on_value_callback(sensor_callback_t &&callback);
   /// Add a callback that will be called every time the sensor sends a raw value.
-  void add_on_raw_value_callback(sensor_callback_t callback);
+  void add_on_raw_value_callback(sensor_callback_t &&callback);
+  /// Add a callback that will be called (in the main loop) with the new update interval when it changes.
+  void add_on_update_interval_change_callback(InlineFunction<void(uint32_t)> &&callback);
+  /// Call the update interval change callbacks, called by adaptive polling components. Safe to call from any task.
+  void publish_update_interval_change(uint32_t update_interval);
 
   /** A unique ID for this sensor, empty for no unique id. See unique ID requirements:
    * https://developers.home-assistant.io/docs/en/entity_registry_index.html#unique-id-requirements
@@ -183,10 +264,27 @@ class Sensor : public Nameable {
   virtual std::string unique_id();
 
  protected:
+  /// A block of values posted to the main execution group by push_new_values().
+  struct PostedValues {
+    std::unique_ptr<float[]> values;
+    std::unique_ptr<uint32_t[]> times;
+    size_t count;
+  };
+
+  /// Store the filtered value measured at time and call the value callbacks.
+  void publish_value_(float value, uint32_t time);
+
   float value_{NAN}; ///< Stores the last filtered value.
   float raw_value_{NAN}; ///< Stores the last raw value.
+  uint32_t value_time_{0}; ///< millis() at which the last filtered value was measured.
+  uint32_t value_interval_{0}; ///< Time between the last two filtered values.
+  bool has_value_{false}; ///< Whether a filtered value was pushed out yet.
+  size_t history_size_{0}; ///< The memory budget of the history, 0 for no history.
+  /// Created with the first value, so that the accuracy decimals are configured by then.
+  std::unique_ptr<SensorHistory> history_{nullptr};
   CallbackManager<void(float)> raw_callback_{}; ///< Storage for raw value callbacks.
   CallbackManager<void(float)> callback_{}; ///< Storage for filtered value callbacks.
+  CallbackManager<void(uint32_t)> update_interval_callback_{}; ///< Storage for update interval change callbacks.
   Optional<std::string> unit_of_measurement_{}; ///< Override the unit of measurement
   Optional<std::string> icon_{}; // Override the icon advertised to Home Assistant, otherwise sensor's icon will be used.
   Optional<int8_t> accuracy_decimals_{}; ///< Override the accuracy in decimals, otherwise the sensor's values will be used.
@@ -197,6 +295,17 @@ class PollingSensorComponent : public PollingComponent, public Sensor {
  public:
   explicit PollingSensorComponent(const std::string &name, uint32_t update_interval);
 
+  using PollingComponent::set_adaptive_update_interval;
+
+  /** Enable adaptive polling driven by the filtered values of this sensor, see
+   * PollingComponent::set_adaptive_update_interval() and report_changes_to().
+   *
+   * @param min_interval The shortest update interval in ms, used while the values change.
+   * @param max_interval The longest update interval in ms, used while the values are stable.
+   * @param threshold A value changed if it differs by more than this from the previous filtered value.
+   */
+  void set_adaptive_update_interval(uint32_t min_interval, uint32_t max_interval, float threshold);
+
   uint32_t update_interval() override;
 };
 
@@ -233,7 +342,9 @@ class EmptyPollingParentSensor
  public:
   EmptyPollingParentSensor(const std::string &name, ParentType *parent)
     : EmptySensor<default_accuracy_decimals, default_icon, default_unit_of_measurement>(name), parent_(parent) {
-
+    parent->add_on_update_interval_callback([this](uint32_t update_interval) {
+      this->publish_update_interval_change(update_interval);
+    });
   }
 
   uint32_t update_interval() override {
@@ -0,0 +1,237 @@
+#include "esphomelib/sensor/sensor_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#ifdef USE_SENSOR
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace sensor {
+
+/// The most bits a compressed sample can take: 4+32 for the timestamp and 2+5+5+32 for the value.
+static const size_t MAX_SAMPLE_BITS = 80;
+
+static uint32_t float_to_bits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+static float bits_to_float(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+/// Sign-extend the lowest bits of value.
+static int32_t sign_extend(uint32_t value, uint8_t bits) {
+  const uint32_t sign = 1UL << (bits - 1);
+  return int32_t((value ^ sign) - sign);
+}
+/// Whether value fits into a signed integer with bits bits.
+static bool fits_signed(int32_t value, uint8_t bits) {
+  const int32_t limit = 1L << (bits - 1);
+  return value >= -limit && value < limit;
+}
+
+SensorHistory::SensorHistory(size_t size, int8_t accuracy_decimals)
+    : block_count_(std::max(size / BLOCK_SIZE, size_t(2))) {
+  if (accuracy_decimals >= 0) {
+    this->round_ = true;
+    this->scale_ = powf(10.0f, accuracy_decimals);
+  }
+  this->data_.reset(new uint8_t[this->block_count_ * BLOCK_SIZE]);
+  this->blocks_.reset(new Block[this->block_count_]);
+}
+void SensorHistory::add(uint32_t time, float value) {
+  const uint32_t version = this->version_.load(std::memory_order_relaxed);
+  this->version_.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (this->round_)
+    value = roundf(value * this->scale_);
+  const uint32_t value_bits = float_to_bits(value);
+  time /= TIME_RESOLUTION;
+  const size_t current = (this->first_block_ + this->used_blocks_ - 1) % this->block_count_;
+  if (this->used_blocks_ == 0 || size_t(this->blocks_[current].bits) + MAX_SAMPLE_BITS > BLOCK_SIZE * 8) {
+    this->start_block_(time, value_bits);
+  } else {
+    // timestamp: delta of the deltas, 0 for a regular update interval. Both are computed modulo 2^32 like
+    // in the decoder, so any delta of delta (even of times that wrapped around) is exact in the 32 bit escape.
+    const uint32_t delta = time - this->last_time_;
+    const int32_t delta_of_delta = int32_t(delta - this->last_delta_);
+    if (delta_of_delta == 0) {
+      this->write_bits_(0b0, 1);
+    } else if (fits_signed(delta_of_delta, 7)) {
+      this->write_bits_(0b10, 2);
+      this->write_bits_(uint32_t(delta_of_delta) & 0x7F, 7);
+    } else if (fits_signed(delta_of_delta, 9)) {
+      this->write_bits_(0b110, 3);
+      this->write_bits_(uint32_t(delta_of_delta) & 0x1FF, 9);
+    } else if (fits_signed(delta_of_delta, 12)) {
+      this->write_bits_(0b1110, 4);
+      this->write_bits_(uint32_t(delta_of_delta) & 0xFFF, 12);
+    } else {
+      // escape: the whole 32 bit value
+      this->write_bits_(0b1111, 4);
+      this->write_bits_(uint32_t(delta_of_delta), 32);
+    }
+    this->last_time_ = time;
+    this->last_delta_ = delta;
+
+    // value: XOR with the last one, only the bits in between the leading and trailing zeros are stored.
+    const uint32_t x = value_bits ^ this->last_value_;
+    if (x == 0) {
+      this->write_bits_(0b0, 1);
+    } else {
+      const uint8_t leading = std::min(__builtin_clz(x), 31);
+      const uint8_t trailing = __builtin_ctz(x);
+      if (this->last_leading_ != 0xFF && leading >= this->last_leading_ && trailing >= this->last_trailing_) {
+        // fits into the window of the last value
+        this->write_bits_(0b10, 2);
+        this->write_bits_(x >> this->last_trailing_, 32 - this->last_leading_ - this->last_trailing_);
+      } else {
+        const uint8_t length = 32 - leading - trailing;
+        this->write_bits_(0b11, 2);
+        this->write_bits_(leading, 5);
+        this->write_bits_(length - 1, 5);
+        this->write_bits_(x >> trailing, length);
+        this->last_leading_ = leading;
+        this->last_trailing_ = trailing;
+      }
+    }
+    this->last_value_ = value_bits;
+    this->blocks_[current].count++;
+  }
+  this->sample_count_++;
+
+  this->version_.store(version + 2, std::memory_order_release);
+}
+void SensorHistory::start_block_(uint32_t time, uint32_t value) {
+  if (this->used_blocks_ == this->block_count_) {
+    // drop the oldest block
+    this->sample_count_ -= this->blocks_[this->first_block_].count;
+    this->first_block_ = (this->first_block_ + 1) % this->block_count_;
+    this->used_blocks_--;
+  }
+  const size_t block = (this->first_block_ + this->used_blocks_) % this->block_count_;
+  this->used_blocks_++;
+  this->blocks_[block].count = 1;
+  this->blocks_[block].bits = 0;
+  this->write_bits_(time, 32);
+  this->write_bits_(value, 32);
+
+  this->last_time_ = time;
+  this->last_delta_ = 0;
+  this->last_value_ = value;
+  this->last_leading_ = 0xFF;
+  this->last_trailing_ = 0;
+}
+void SensorHistory::write_bits_(uint64_t value, uint8_t bits) {
+  const size_t current = (this->first_block_ + this->used_blocks_ - 1) % this->block_count_;
+  Block &block = this->blocks_[current];
+  uint8_t *data = &this->data_[current * BLOCK_SIZE];
+  while (bits > 0) {
+    // fill the rest of the current byte, most significant bit first
+    const uint8_t offset = block.bits % 8;
+    const uint8_t n = std::min<uint8_t>(8 - offset, bits);
+    const uint8_t chunk = (value >> (bits - n)) & ((1u << n) - 1);
+    if (offset == 0)
+      data[block.bits / 8] = 0;
+    data[block.bits / 8] |= chunk << (8 - offset - n);
+    block.bits += n;
+    bits -= n;
+  }
+}
+bool SensorHistory::for_each(uint32_t since, const sensor_history_callback_t &callback, bool all_samples) const {
+  const uint32_t version = this->version_.load(std::memory_order_acquire);
+  if (version % 2 == 1)
+    return false;
+  const size_t first_block = this->first_block_;
+  const size_t used_blocks = std::min(this->used_blocks_, this->block_count_);
+  for (size_t i = 0; i < used_blocks; i++)
+    this->decode_block_((first_block + i) % this->block_count_, since, callback, all_samples);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return this->version_.load(std::memory_order_relaxed) == version;
+}
+void SensorHistory::decode_block_(size_t block, uint32_t since, const sensor_history_callback_t &callback,
+                                  bool all_samples) const {
+  const uint8_t *data = &this->data_[block * BLOCK_SIZE];
+  // bounded by the block size, in case the block is modified while decoding it.
+  const uint16_t end = std::min<uint16_t>(this->blocks_[block].bits, BLOCK_SIZE * 8);
+  const uint16_t count = this->blocks_[block].count;
+  uint16_t pos = 0;
+  auto read_bits = [&](uint8_t bits) -> uint32_t {
+    uint32_t value = 0;
+    while (bits > 0 && pos < end) {
+      const uint8_t offset = pos % 8;
+      const uint8_t n = std::min<uint8_t>(8 - offset, bits);
+      value = (value << n) | ((data[pos / 8] >> (8 - offset - n)) & ((1u << n) - 1));
+      pos += n;
+      bits -= n;
+    }
+    return value;
+  };
+  auto emit = [&](uint32_t time, uint32_t value) {
+    time *= TIME_RESOLUTION;
+    if (all_samples || int32_t(time - since) > 0)
+      callback(time, this->round_ ? bits_to_float(value) / this->scale_ : bits_to_float(value));
+  };
+
+  uint32_t time = read_bits(32);
+  uint32_t value = read_bits(32);
+  uint32_t delta = 0;
+  uint8_t leading = 0, trailing = 0;
+  emit(time, value);
+  for (uint16_t i = 1; i < count && pos < end; i++) {
+    uint32_t delta_of_delta = 0;
+    if (read_bits(1) == 0) {
+      delta_of_delta = 0;
+    } else if (read_bits(1) == 0) {
+      delta_of_delta = uint32_t(sign_extend(read_bits(7), 7));
+    } else if (read_bits(1) == 0) {
+      delta_of_delta = uint32_t(sign_extend(read_bits(9), 9));
+    } else if (read_bits(1) == 0) {
+      delta_of_delta = uint32_t(sign_extend(read_bits(12), 12));
+    } else {
+      delta_of_delta = read_bits(32);
+    }
+    delta += delta_of_delta;
+    time += delta;
+
+    if (read_bits(1) == 1) {
+      if (read_bits(1) == 1) {
+        leading = read_bits(5);
+        const uint8_t length = read_bits(5) + 1;
+        trailing = 32 - leading - length;
+      }
+      value ^= read_bits(32 - leading - trailing) << trailing;
+    }
+    emit(time, value);
+  }
+}
+size_t SensorHistory::size() const {
+  return this->sample_count_;
+}
+size_t SensorHistory::get_bytes_used() const {
+  size_t bytes = 0;
+  for (size_t i = 0; i < this->used_blocks_; i++)
+    bytes += (this->blocks_[(this->first_block_ + i) % this->block_count_].bits + 7) / 8;
+  return bytes;
+}
+size_t SensorHistory::get_capacity() const {
+  return this->block_count_ * BLOCK_SIZE;
+}
+
+std::string history_sample_to_json(uint32_t age, float value, int8_t accuracy_decimals) {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "[%u,", age);
+  return buffer + value_accuracy_to_string(value, accuracy_decimals) + "]";
+}
+
+} // namespace sensor
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_SENSOR
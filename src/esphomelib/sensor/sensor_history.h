@@ -0,0 +1,119 @@
+#ifndef ESPHOMELIB_SENSOR_SENSOR_HISTORY_H
+#define ESPHOMELIB_SENSOR_SENSOR_HISTORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "esphomelib/helpers.h"
+#include "esphomelib/defines.h"
+
+#ifdef USE_SENSOR
+
+ESPHOMELIB_NAMESPACE_BEGIN
+
+namespace sensor {
+
+/// Callback for iterating over the samples of a SensorHistory, with the millis() time and value of each sample.
+using sensor_history_callback_t = InlineFunction<void(uint32_t, float)>;
+
+/** A compressed in-memory history of the values of a sensor, see Sensor::enable_history().
+ *
+ * Samples are compressed like in Facebook's Gorilla time series database: timestamps are stored as the
+ * difference of consecutive intervals (a single bit if the update interval didn't change) and values are
+ * XOR-ed with the previous value so that only the bits that changed are stored. Regularly polled sensors
+ * need around 1-2 bytes per sample, especially if the values are rounded (see Sensor::enable_history()).
+ *
+ * The storage is split into blocks of BLOCK_SIZE bytes that each start with an uncompressed sample. Once
+ * all blocks are full, the oldest block is dropped to make room, so the history always holds the newest
+ * samples that fit into the memory budget.
+ *
+ * add() must only be called from a single task, for_each() can be called from any task (for example the
+ * web server) and detects if add() was called concurrently.
+ */
+class SensorHistory {
+ public:
+  /// The size in bytes of one block of compressed samples.
+  static const size_t BLOCK_SIZE = 128;
+
+  /// The resolution of the stored timestamps in ms, coarse enough that jitter of the update interval is free.
+  static const uint32_t TIME_RESOLUTION = 100;
+
+  /** Create the history, the memory for it is allocated once here.
+   *
+   * @param size The memory budget in bytes, rounded down to a multiple of BLOCK_SIZE (at least 2 blocks).
+   * @param accuracy_decimals Round values to this many decimals, or -1 to store them exactly. Rounded values
+   *                          are stored as integers, which makes them compress much better.
+   */
+  explicit SensorHistory(size_t size, int8_t accuracy_decimals = -1);
+
+  /// Add a sample measured at time (millis()). Samples must be added in chronological order.
+  /// Times are stored with a resolution of TIME_RESOLUTION.
+  void add(uint32_t time, float value);
+
+  /** Call callback for each sample (oldest first) measured after since.
+   *
+   * @param since Only samples measured after this millis() time are passed, use 0 with all_samples for all.
+   * @param callback The callback, called with the time and value of each sample.
+   * @param all_samples Ignore since and pass all samples.
+   * @return false if add() was called concurrently, then the samples passed may be invalid and should be
+   *         discarded (try again).
+   */
+  bool for_each(uint32_t since, const sensor_history_callback_t &callback, bool all_samples = false) const;
+
+  /// The number of samples in the history.
+  size_t size() const;
+
+  /// The number of bytes the stored samples take up.
+  size_t get_bytes_used() const;
+
+  /// The memory budget in bytes.
+  size_t get_capacity() const;
+
+ protected:
+  struct Block {
+    uint16_t count; ///< The number of samples in this block.
+    uint16_t bits; ///< The number of bits used in this block.
+  };
+
+  /// Start a new block (dropping the oldest one if needed) with an uncompressed sample.
+  void start_block_(uint32_t time, uint32_t value);
+  void write_bits_(uint64_t value, uint8_t bits);
+  /// Decode all samples of a block.
+  void decode_block_(size_t block, uint32_t since, const sensor_history_callback_t &callback, bool all_samples) const;
+
+  std::unique_ptr<uint8_t[]> data_; ///< block_count_ blocks of BLOCK_SIZE bytes.
+  std::unique_ptr<Block[]> blocks_;
+  size_t block_count_;
+  size_t first_block_{0}; ///< The oldest block.
+  size_t used_blocks_{0};
+  size_t sample_count_{0};
+  float scale_{1.0f}; ///< Values are stored multiplied by this (10^accuracy_decimals) and rounded.
+  bool round_{false};
+
+  // encoder state for the newest block
+  uint32_t last_time_{0};
+  uint32_t last_delta_{0}; ///< Modulo 2^32, like last_time_.
+  uint32_t last_value_{0};
+  uint8_t last_leading_{0xFF}; ///< Leading zeros of the last value window, 0xFF for none.
+  uint8_t last_trailing_{0};
+
+  /// Incremented before and after each add(), odd while the history is being modified.
+  std::atomic<uint32_t> version_{0};
+};
+
+/** Format a sample of a history as JSON for the web server: `[age,value]`.
+ *
+ * @param age How many ms ago the sample was measured, the devices millis() are meaningless for others.
+ * @param value The value of the sample.
+ * @param accuracy_decimals The accuracy decimals of the sensor.
+ */
+std::string history_sample_to_json(uint32_t age, float value, int8_t accuracy_decimals);
+
+} // namespace sensor
+
+ESPHOMELIB_NAMESPACE_END
+
+#endif //USE_SENSOR
+
+#endif //ESPHOMELIB_SENSOR_SENSOR_HISTORY_H
@@ -43,6 +43,8 @@ SHT3XDComponent::SHT3XDComponent(I2CComponent *parent,
 
 void SHT3XDComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up SHT3xD...");
+  // the command, the longest conversion (low accuracy) and the read after it
+  this->set_polling_bus(this->parent_, 15 + 1);
   if (!this->write_command(SHT3XD_COMMAND_READ_SERIAL_NUMBER)) {
     ESP_LOGE(TAG, "Communication with SHT3xD failed!");
     this->mark_failed();
@@ -71,6 +73,10 @@ float SHT3XDComponent::get_setup_priority() const {
   return setup_priority::HARDWARE_LATE;
 }
 void SHT3XDComponent::update() {
+  this->start_coroutine(&this->update_coroutine_, [this](Coroutine &co) { return this->read_(co); });
+}
+CoroutineResult SHT3XDComponent::read_(Coroutine &co) {
+  CO_BEGIN(co);
   uint16_t command;
   uint32_t conversion;
   switch (this->accuracy_) {
@@ -90,20 +96,21 @@ void SHT3XDComponent::update() {
   }
 
   if (!this->write_command(command))
-    return;
+    CO_RETURN(co);
 
-  delay(conversion);
+  CO_SLEEP(co, conversion);
 
   uint16_t raw_data[2];
   if (!this->read_data(raw_data, 2))
-    return;
+    CO_RETURN(co);
 
   float temperature = 175.0f * float(raw_data[0]) / 65535.0f - 45.0f;
   float humidity = 100.0f * float(raw_data[1]) / 65535.0f;
 
-  ESP_LOGD(TAG, "Got temperature=%.2°C humidity=%.2%");
+  ESP_LOGD(TAG, "Got temperature=%.2f°C humidity=%.2f%%", temperature, humidity);
   this->temperature_sensor_->push_new_value(temperature);
   this->humidity_sensor_->push_new_value(humidity);
+  CO_END(co);
 }
 
 bool SHT3XDComponent::write_command(uint16_t command) {
@@ -51,10 +51,13 @@ class SHT3XDComponent : public PollingComponent, public I2CDevice {
  protected:
   bool write_command(uint16_t command);
   bool read_data(uint16_t *data, uint8_t len);
+  /// Start a measurement and read it after the conversion time without blocking.
+  CoroutineResult read_(Coroutine &co);
 
   SHT3XDTemperatureSensor *temperature_sensor_;
   SHT3XDHumiditySensor *humidity_sensor_;
   SHT3XDAccuracy accuracy_{SHT3XD_ACCURACY_HIGH};
+  Coroutine update_coroutine_;
 };
 
 /// Helper class exposing an SHT3xD temperature sensor with a unique id.
@@ -34,6 +34,8 @@ TSL2561Sensor::TSL2561Sensor(I2CComponent *parent, const std::string &name,
 
 void TSL2561Sensor::setup() {
   ESP_LOGCONFIG(TAG, "Setting up TSL2561...");
+  // power on, the integration and the read after it, see update()
+  this->set_polling_bus(this->parent_, uint32_t(this->get_integration_time_ms_() + 20.0f) + 1);
   uint8_t id;
   if (!this->tsl2561_read_byte(TSL2561_REGISTER_ID, &id) || (id & 0x0A) == 0) {
     ESP_LOGE(TAG, "Communication with TSL2561 on address 0x%02X failed!", this->address_);
@@ -71,7 +73,7 @@ void TSL2561Sensor::update() {
   // Make sure the data is there when we will read it.
   uint32_t timeout = this->get_integration_time_ms_() + 20.0f;
 
-  this->set_timeout("illuminance", timeout, [this]() {
+  this->set_timeout(fnv1a_hash("illuminance"), timeout, [this]() {
     this->read_data_();
   });
 }
@@ -29,7 +29,7 @@ void MQTTSwitchComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up MQTT switch '%s'", this->switch_->get_name().c_str());
   ESP_LOGCONFIG(TAG, "    Icon: '%s'", this->switch_->get_icon().c_str());
 
-  this->subscribe(this->get_command_topic(), [&](const std::string &payload) {
+  this->subscribe(this->get_command_topic(), [&](const StringRef &payload) {
     if (strcasecmp(payload.c_str(), this->get_payload_on().c_str()) == 0)
       this->turn_on();
     else if (strcasecmp(payload.c_str(), this->get_payload_off().c_str()) == 0)
@@ -22,9 +22,10 @@ void RestartSwitch::turn_on() {
   ESP_LOGI(TAG, "Restarting device...");
   // first acknowledge command
   this->publish_state(false);
-  // then execute
-  delay(100); // Let MQTT settle a bit
-  safe_reboot("restart");
+  // then execute, after letting MQTT settle a bit
+  this->set_timeout(fnv1a_hash("restart"), 100, []() {
+    safe_reboot("restart");
+  });
 }
 std::string RestartSwitch::icon() {
   return "mdi:restart";
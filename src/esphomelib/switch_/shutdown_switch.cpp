@@ -25,16 +25,16 @@ void ShutdownSwitch::turn_on() {
   ESP_LOGI(TAG, "Shutting down...");
   // first acknowledge command
   this->publish_state(false);
-  // then execute
-  delay(100); // Let MQTT settle a bit
-
-  run_safe_shutdown_hooks("shutdown");
-#ifdef ARDUINO_ARCH_ESP8266
-  ESP.deepSleep(0);
+  // then execute, after letting MQTT settle a bit
+  this->set_timeout(fnv1a_hash("shutdown"), 100, []() {
+    run_safe_shutdown_hooks("shutdown");
+#if defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_HOST)
+    ESP.deepSleep(0);
 #endif
 #ifdef ARDUINO_ARCH_ESP32
-  esp_deep_sleep_start();
+    esp_deep_sleep_start();
 #endif
+  });
 }
 void ShutdownSwitch::turn_off() {
   // Do nothing
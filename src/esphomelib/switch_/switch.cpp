@@ -3,6 +3,7 @@
 //
 
 #include "esphomelib/switch_/switch.h"
+#include "esphomelib/application.h"
 #include "esphomelib/esppreferences.h"
 
 #ifdef USE_SWITCH
@@ -26,12 +27,22 @@ void Switch::set_icon(const std::string &icon) {
   this->icon_ = icon;
 }
 void Switch::write_state(bool state) {
+  if (!App.is_in_execution_group(this->get_execution_group())) {
+    // Commands come from the front-ends in the main loop, hand them over to the loop of this switch.
+    this->post_write_state(state);
+    return;
+  }
   if (state != this->inverted_) {
     this->turn_on();
   } else {
     this->turn_off();
   }
 }
+bool Switch::post_write_state(bool state) {
+  return App.post(this->get_execution_group(), [this, state] {
+    this->write_state(state);
+  });
+}
 float Switch::get_setup_priority() const {
   return setup_priority::HARDWARE - 1.0f;
 }
@@ -27,9 +27,14 @@ class Switch : public binary_sensor::BinarySensor, public Component {
   float get_setup_priority() const override;
   void setup_() override;
 
-  /// This method is called by the front-end components.
+  /// This method is called by the front-end components. If the switch is in another execution group,
+  /// the state is handed over to the loop of that group with post_write_state().
   void write_state(bool state);
 
+  /// Like write_state(), but safe to call from other tasks (not from interrupts), see Application::post().
+  /// Returns false if the event queue of the execution group of this switch was full.
+  bool post_write_state(bool state);
+
   void publish_state(bool state) override;
 
   /** Override this to set the Home Assistant icon for this switch.
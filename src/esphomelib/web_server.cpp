@@ -196,6 +196,10 @@ void WebServer::register_sensor(sensor::Sensor *obj) {
 void WebServer::handle_sensor_request(AsyncWebServerRequest *request, UrlMatch match) {
   for (sensor::Sensor *obj : this->sensors_) {
     if (obj->get_name_id() == match.id) {
+      if (match.method == "history") {
+        this->handle_sensor_history_request(request, obj);
+        return;
+      }
       std::string data = this->sensor_json(obj, obj->get_value());
       request->send(200, "text/json", data.c_str());
       return;
@@ -203,6 +207,35 @@ void WebServer::handle_sensor_request(AsyncWebServerRequest *request, UrlMatch m
   }
   request->send(404);
 }
+void WebServer::handle_sensor_history_request(AsyncWebServerRequest *request, sensor::Sensor *obj) {
+  sensor::SensorHistory *history = obj->get_history();
+  if (history == nullptr) {
+    request->send(404);
+    return;
+  }
+  struct {
+    std::string data;
+    uint32_t now;
+    int8_t accuracy;
+  } state{"", millis(), obj->get_accuracy_decimals()};
+  auto *s = &state;
+  // This runs in the web server's task, retry if the sensor added a value while the history was read.
+  bool complete = false;
+  for (uint8_t i = 0; i < 3 && !complete; i++) {
+    state.data = "{\"id\":\"sensor-" + obj->get_name_id() + "\",\"history\":[";
+    complete = history->for_each(0, [s](uint32_t time, float value) {
+      if (s->data.back() != '[')
+        s->data += ",";
+      s->data += sensor::history_sample_to_json(s->now - time, value, s->accuracy);
+    }, true);
+  }
+  if (!complete) {
+    request->send(503);
+    return;
+  }
+  state.data += "]}";
+  request->send(200, "text/json", state.data.c_str());
+}
 std::string WebServer::sensor_json(sensor::Sensor *obj, float value) {
   return build_json([obj, value](JsonBuffer &buffer, JsonObject &root) {
     root["id"] = "sensor-" + obj->get_name_id();
@@ -240,14 +273,14 @@ void WebServer::handle_switch_request(AsyncWebServerRequest *request, UrlMatch m
       std::string data = this->switch_json(obj, obj->get_value());
       request->send(200, "text/json", data.c_str());
     } else if (match.method == "toggle") {
-      obj->write_state(!obj->get_value());
-      request->send(200);
+      // Requests are handled in the network context, the state is changed in the main loop.
+      this->send_posted_(request, App.post([obj] {
+        obj->write_state(!obj->get_value());
+      }));
     } else if (match.method == "turn_on") {
-      obj->write_state(true);
-      request->send(200);
+      this->send_posted_(request, obj->post_write_state(true));
     } else if (match.method == "turn_off") {
-      obj->write_state(false);
-      request->send(200);
+      this->send_posted_(request, obj->post_write_state(false));
     } else {
       request->send(404);
     }
@@ -324,30 +357,40 @@ void WebServer::handle_fan_request(AsyncWebServerRequest *request, UrlMatch matc
       std::string data = this->fan_json(obj);
       request->send(200, "text/json", data.c_str());
     } else if (match.method == "toggle") {
-      obj->set_state(!obj->get_state());
-      request->send(200);
+      this->send_posted_(request, App.post([obj] {
+        obj->set_state(!obj->get_state());
+      }));
     } else if (match.method == "turn_on") {
-      obj->set_state(true);
+      // validate everything here so that the request can be answered, the fan is changed in the main loop.
+      Optional<fan::FanState::Speed> speed;
       if (request->hasParam("speed")) {
-        String speed = request->getParam("speed")->value();
-        if (!obj->set_speed(speed.c_str())) {
+        String value = request->getParam("speed")->value();
+        speed = fan::FanState::parse_speed(value.c_str());
+        if (!speed.defined) {
           request->send(404);
           return;
         }
       }
+      Optional<bool> oscillating;
       if (request->hasParam("oscillation")) {
-        String speed = request->getParam("oscillation")->value();
-        auto val = parse_on_off(speed.c_str());
-        if (!val.defined) {
+        String value = request->getParam("oscillation")->value();
+        oscillating = parse_on_off(value.c_str());
+        if (!oscillating.defined) {
           request->send(404);
           return;
         }
-        obj->set_oscillating(val.value);
       }
-      request->send(200);
+      this->send_posted_(request, App.post([obj, speed, oscillating] {
+        obj->set_state(true);
+        if (speed.defined)
+          obj->set_speed(speed.value);
+        if (oscillating.defined)
+          obj->set_oscillating(oscillating.value);
+      }));
     } else if (match.method == "turn_off") {
-      obj->set_state(false);
-      request->send(200);
+      this->send_posted_(request, App.post([obj] {
+        obj->set_state(false);
+      }));
     } else {
       request->send(404);
     }
@@ -366,6 +409,52 @@ void WebServer::register_light(light::LightState *obj) {
     });
   });
 }
+/// A light turn_on/turn_off request from the web server, see WebServer::handle_light_request().
+struct LightRequestCall {
+  bool state;
+  Optional<float> brightness;
+  Optional<float> red;
+  Optional<float> green;
+  Optional<float> blue;
+  Optional<float> white;
+  Optional<uint32_t> flash_length;
+  Optional<uint32_t> transition_length;
+  std::string effect;
+
+  void perform(light::LightState *obj) const {
+    if (!this->effect.empty()) {
+      obj->start_effect(this->effect);
+      return;
+    }
+
+    auto v = obj->get_remote_values();
+    v.set_state(this->state ? 1.0f : 0.0f);
+    if (this->state) {
+      auto traits = obj->get_traits();
+      if (traits.has_brightness() && this->brightness.defined)
+        v.set_brightness(this->brightness.value);
+      if (traits.has_rgb()) {
+        if (this->red.defined)
+          v.set_red(this->red.value);
+        if (this->green.defined)
+          v.set_green(this->green.value);
+        if (this->blue.defined)
+          v.set_blue(this->blue.value);
+      }
+      if (traits.has_rgb_white_value() && this->white.defined)
+        v.set_white(this->white.value);
+      v.normalize_color(traits);
+    }
+
+    if (this->flash_length.defined)
+      obj->start_flash(v, this->flash_length.value);
+    else if (this->transition_length.defined)
+      obj->start_transition(v, this->transition_length.value);
+    else
+      obj->start_default_transition(v);
+  }
+};
+
 void WebServer::handle_light_request(AsyncWebServerRequest *request, UrlMatch match) {
   for (light::LightState *obj : this->lights_) {
     if (obj->get_name_id() != match.id)
@@ -375,54 +464,43 @@ void WebServer::handle_light_request(AsyncWebServerRequest *request, UrlMatch ma
       std::string data = this->light_json(obj);
       request->send(200, "text/json", data.c_str());
     } else if (match.method == "toggle") {
-      auto v = obj->get_remote_values();
-      if (v.get_state() > 0.0f)
-        v.set_state(0.0f);
-      else
-        v.set_state(1.0f);
-      obj->start_default_transition(v);
-      request->send(200);
-    } else if (match.method == "turn_on") {
-      auto v = obj->get_remote_values();
-      v.set_state(1.0f);
-      if (obj->get_traits().has_brightness() && request->hasParam("brightness"))
-        v.set_brightness(request->getParam("brightness")->value().toFloat() / 255.0f);
-      if (obj->get_traits().has_rgb()) {
-        if (request->hasParam("r"))
-          v.set_red(request->getParam("r")->value().toFloat() / 255.0f);
-        if (request->hasParam("g"))
-          v.set_green(request->getParam("g")->value().toFloat() / 255.0f);
-        if (request->hasParam("b"))
-          v.set_blue(request->getParam("b")->value().toFloat() / 255.0f);
-      }
-      if (obj->get_traits().has_rgb_white_value() && request->hasParam("white_value"))
-        v.set_white(request->getParam("white_value")->value().toFloat() / 255.0f);
-
-      v.normalize_color(obj->get_traits());
-
-      if (request->hasParam("flash")) {
-        uint32_t length = request->getParam("flash")->value().toFloat() * 1000;
-        obj->start_flash(v, length);
-      } else if (request->hasParam("transition")) {
-        uint32_t length = request->getParam("transition")->value().toFloat() * 1000;
-        obj->start_transition(v, length);
-      } else if (request->hasParam("effect")) {
-        const char *effect = request->getParam("effect")->value().c_str();
-        obj->start_effect(effect);
-      } else {
-        obj->start_default_transition(v);
-      }
-      request->send(200);
-    } else if (match.method == "turn_off") {
-      auto v = obj->get_remote_values();
-      v.set_state(0.0f);
-      if (request->hasParam("transition")) {
-        uint32_t length = request->getParam("transition")->value().toFloat() * 1000;
-        obj->start_transition(v, length);
-      } else {
+      this->send_posted_(request, App.post([obj] {
+        auto v = obj->get_remote_values();
+        if (v.get_state() > 0.0f)
+          v.set_state(0.0f);
+        else
+          v.set_state(1.0f);
         obj->start_default_transition(v);
-      }
-      request->send(200);
+      }));
+    } else if (match.method == "turn_on" || match.method == "turn_off") {
+      // The parameters are parsed here, but the light is only changed in the main loop.
+      // They don't fit into an event, so they're passed on the heap.
+      auto *call = new LightRequestCall();
+      call->state = match.method == "turn_on";
+      if (request->hasParam("brightness"))
+        call->brightness = request->getParam("brightness")->value().toFloat() / 255.0f;
+      if (request->hasParam("r"))
+        call->red = request->getParam("r")->value().toFloat() / 255.0f;
+      if (request->hasParam("g"))
+        call->green = request->getParam("g")->value().toFloat() / 255.0f;
+      if (request->hasParam("b"))
+        call->blue = request->getParam("b")->value().toFloat() / 255.0f;
+      if (request->hasParam("white_value"))
+        call->white = request->getParam("white_value")->value().toFloat() / 255.0f;
+      if (call->state && request->hasParam("flash"))
+        call->flash_length = request->getParam("flash")->value().toFloat() * 1000;
+      else if (request->hasParam("transition"))
+        call->transition_length = request->getParam("transition")->value().toFloat() * 1000;
+      else if (call->state && request->hasParam("effect"))
+        call->effect = request->getParam("effect")->value().c_str();
+
+      bool posted = App.post([obj, call] {
+        call->perform(obj);
+        delete call;
+      });
+      if (!posted)
+        delete call;
+      this->send_posted_(request, posted);
     } else {
       request->send(404);
     }
@@ -443,6 +521,11 @@ bool WebServer::canHandle(AsyncWebServerRequest *request) {
   if (request->url() == "/")
     return true;
 
+#ifdef USE_COMPONENT_PROFILER
+  if (request->method() == HTTP_GET && request->url() == "/profile")
+    return true;
+#endif
+
   UrlMatch match = match_url(request->url().c_str(), true);
   if (!match.valid)
     return false;
@@ -476,12 +559,31 @@ bool WebServer::canHandle(AsyncWebServerRequest *request) {
 
   return false;
 }
+void WebServer::send_posted_(AsyncWebServerRequest *request, bool posted) {
+  if (posted)
+    request->send(200);
+  else
+    // the event queue of the main loop is full, let the client retry.
+    request->send(503);
+}
 void WebServer::handleRequest(AsyncWebServerRequest *request) {
   if (request->url() == "/") {
     this->handle_index_request(request);
     return;
   }
 
+#ifdef USE_COMPONENT_PROFILER
+  if (request->url() == "/profile") {
+    // This runs in the web server's task while the loops are recording, let the client retry if that collides.
+    const std::string json = build_profile_json();
+    if (json.empty())
+      request->send(503);
+    else
+      request->send(200, "text/json", json.c_str());
+    return;
+  }
+#endif
+
   UrlMatch match = match_url(request->url().c_str());
 #ifdef USE_SENSOR
   if (match.domain == "sensor") {
@@ -81,6 +81,9 @@ class WebServer : public StoringController, public Component, public AsyncWebHan
   /// Handle a sensor request under '/sensor/<id>'.
   void handle_sensor_request(AsyncWebServerRequest *request, UrlMatch match);
 
+  /// Handle a sensor history request under '/sensor/<id>/history', see Sensor::enable_history().
+  void handle_sensor_history_request(AsyncWebServerRequest *request, sensor::Sensor *obj);
+
   /// Dump the sensor state with its value as a JSON string.
   std::string sensor_json(sensor::Sensor *obj, float value);
 #endif
@@ -137,6 +140,9 @@ class WebServer : public StoringController, public Component, public AsyncWebHan
   bool isRequestHandlerTrivial() override;
 
  protected:
+  /// Answer a state change request depending on whether it could be posted to the main loop.
+  void send_posted_(AsyncWebServerRequest *request, bool posted);
+
   uint16_t port_;
   AsyncWebServer *server_;
   AsyncEventSource events_{"/events"};
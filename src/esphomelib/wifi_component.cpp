@@ -12,6 +12,9 @@
 #include <ESP8266WiFi.h>
 #include <user_interface.h>
 #endif
+#ifdef ARDUINO_ARCH_HOST
+#include <WiFi.h>
+#endif
 
 #include <utility>
 
@@ -90,6 +93,9 @@ void WiFiComponent::loop() {
     }
   }
 }
+bool WiFiComponent::needs_continuous_loop() const {
+  return false;
+}
 
 WiFiComponent::WiFiComponent() = default;
 
@@ -69,6 +69,7 @@ class WiFiComponent : public Component {
 
   /// Reconnect WiFi if required.
   void loop() override;
+  bool needs_continuous_loop() const override;
 
   bool has_sta() const;
   bool has_ap() const;